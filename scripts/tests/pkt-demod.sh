@@ -0,0 +1,39 @@
+#!/bin/sh
+
+# Decode synthetic AFSK with the packet demodulator bank, which is not yet
+# part of the fldigi build.  Each case must pass no bad frames and must
+# decode at least as many frames as demodulator 0, the one symbol window
+# without tilt correction that stands in for the single demodulator.
+#
+# Run from the build directory, which holds config.h:
+#   make pkt-demod-check
+# or
+#   srcdir=/path/to/fldigi/src sh /path/to/fldigi/scripts/tests/pkt-demod.sh
+
+: ${srcdir:=.}
+: ${CXX:=c++}
+
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' 0
+
+if ! $CXX $CPPFLAGS -I. -I"$srcdir" -I"$srcdir/include" $CXXFLAGS -std=gnu++11 -o "$tmp/check" \
+    "$srcdir/../scripts/tests/pkt_demod_check.cxx" "$srcdir/packet/pkt_demod.cxx"; then
+    echo "E: could not build the packet demodulator check" >&2
+    exit 1
+fi
+
+# frames, SNR in 3 kHz (dB), space to mark tilt (dB)
+r=0
+for c in "100 12 -6" "100 12 6" "100 14 -9" "100 12 9" "100 9 0" "100 8 0" "100 10 -3"; do
+    set -- $c
+    "$tmp/check" $1 $2 $3 > "$tmp/out" || { r=1; continue; }
+    line=$(awk -v c="$c" '
+        NR == 1 { split($2, f, "/"); bank = f[1]; bad = $4 }
+        NR == 3 { demod0 = $4 }
+        END { print c ": bank " bank ", demodulator 0 " demod0 ", bad " bad;
+              exit (bad != 0 || bank < demod0) }' "$tmp/out") || r=1
+    echo "$line"
+done
+
+test $r -eq 0 || echo "E: the packet demodulator bank check failed" >&2
+exit $r
@@ -0,0 +1,159 @@
+// ---------------------------------------------------------------------
+// pkt_demod_check.cxx  --  decodes synthetic AFSK with the demodulator bank
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is a proposed part of fldigi.
+//
+// fldigi is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi; if not, write to the Free Software
+// Foundation, Inc.
+// 59 Temple Place
+// Suite 330
+// Boston, MA  02111-1307  USA
+// ---------------------------------------------------------------------
+
+// Usage: pkt_demod_check FRAMES SNR TILT [BAUD]
+//
+// Sends FRAMES APRS frames as NRZI AFSK at 12000 Hz with white noise at
+// SNR dB in 3 kHz, and the space tone TILT dB louder than the mark tone.
+// Prints the number of frames that the bank decodes and the number of bad
+// frames that it passes, followed by its per-demodulator statistics.
+
+#include <config.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <random>
+
+#include "pkt_demod.h"
+
+using namespace std;
+
+static vector<int> bits;
+static int ones;
+
+static void put_bit(int b, bool stuff)
+{
+	bits.push_back(b);
+	if (!stuff) {
+		ones = 0;
+		return;
+	}
+	if (b && ++ones == 5) {
+		bits.push_back(0);
+		ones = 0;
+	}
+	else if (!b)
+		ones = 0;
+}
+
+static void put_byte(unsigned char c, bool stuff)
+{
+	for (int i = 0; i < 8; i++)
+		put_bit((c >> i) & 1, stuff);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 4) {
+		fprintf(stderr, "Usage: %s FRAMES SNR TILT [BAUD]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	int nframes = atoi(argv[1]);
+	double snr = atof(argv[2]);
+	double tilt_db = atof(argv[3]);
+	int baud = argc > 4 ? atoi(argv[4]) : 1200;
+
+	double fmark = baud == 300 ? 1600 : 1200, fspace = baud == 300 ? 1800 : 2200;
+	int sr = 12000;
+	double symbollen = (double)sr / baud;
+	mt19937 rng(1);
+	normal_distribution<double> gauss(0, 1);
+
+	vector<string> sent;
+	for (int f = 0; f < nframes; f++) {
+		string frame;
+		const char* addr = "APRS  \x60" "N0CALL\x61";
+		for (int i = 0; i < 14; i++)
+			frame += (char)(((unsigned char)addr[i]) << (i == 6 || i == 13 ? 0 : 1));
+		frame += '\x03';
+		frame += '\xf0';
+		char text[64];
+		snprintf(text, sizeof(text), "!4903.50N/07201.75W-Test frame %d %08x", f, (unsigned)rng());
+		frame += text;
+		unsigned fcs = pkt_demod_bank::fcs((const unsigned char*)frame.data(),
+						   (const unsigned char*)frame.data() + frame.size());
+		frame += (char)(fcs >> 8);
+		frame += (char)(fcs & 0xff);
+		sent.push_back(frame);
+
+		for (int i = 0; i < 20; i++)
+			put_byte(0x7e, false);
+		for (size_t i = 0; i < frame.size(); i++)
+			put_byte(frame[i], true);
+		for (int i = 0; i < 3; i++)
+			put_byte(0x7e, false);
+		// random bits without flags between the frames
+		for (int i = 0; i < 40; i++)
+			bits.push_back(rng() & 1);
+	}
+
+	// NRZI: a zero bit changes the tone
+	vector<double> audio;
+	double amark = 1.0, aspace = pow(10, tilt_db / 20);
+	double sigma = sqrt(0.5 * (1 + aspace * aspace) / 2) * pow(10, -snr / 20) *
+		sqrt(sr / 2.0 / 3000.0);
+	double phase = 0, next = symbollen;
+	int tone = bits[0] == 0;
+	size_t k = 0;
+	for (int n = 0; k < bits.size(); n++) {
+		if (n >= next) {
+			k++;
+			next += symbollen;
+			if (k < bits.size() && bits[k] == 0)
+				tone ^= 1;
+		}
+		phase += 2 * M_PI * (tone ? fspace : fmark) / sr;
+		audio.push_back((tone ? aspace : amark) * sin(phase) + sigma * gauss(rng));
+	}
+
+	pkt_demod_bank bank;
+	bank.init((int)floor(symbollen + 0.5), 1.0, 1.0);
+	double lo_phase = 0, hi_phase = 0;
+	int good = 0, bad = 0;
+	unsigned char buf[MAXOCTETS + 4];
+	for (size_t n = 0; n < audio.size(); n++) {
+		lo_phase += 2 * M_PI * fmark / sr;
+		hi_phase += 2 * M_PI * fspace / sr;
+		bank.process(cmplx(audio[n] * cos(lo_phase), audio[n] * sin(lo_phase)),
+			     cmplx(audio[n] * cos(hi_phase), audio[n] * sin(hi_phase)));
+		int len;
+		while ((len = bank.get_frame(buf)) > 0) {
+			string s((const char*)buf + 1, len - 1);
+			bool found = false;
+			for (size_t i = 0; i < sent.size() && !found; i++)
+				found = sent[i] == s;
+			found ? good++ : bad++;
+		}
+	}
+
+	printf("bank: %d/%d frames, %d bad\n", good, nframes, bad);
+	printf("%s", bank.statistics().c_str());
+
+	return EXIT_SUCCESS;
+}
@@ -49,6 +49,8 @@
 #include "debug.h"
 #include "FTextRXTX.h"
 #include "modem.h"
+#include "trx.h"
+#include "Viewer.h"
 
 #include "qrunner.h"
 
@@ -243,6 +245,7 @@ cw::~cw() {
 	if (cw_xmt_filter) delete cw_xmt_filter;
 	if (bitfilter) delete bitfilter;
 	if (trackingfilter) delete trackingfilter;
+	if (cwviewer) delete cwviewer;
 }
 
 cw::cw() : modem()
@@ -339,6 +342,8 @@ cw::cw() : modem()
 
 	trackingfilter = new Cmovavg(TRACKING_FILTER_SIZE);
 
+	cwviewer = new view_cw();
+
 	makeshape();
 	sync_parameters();
 	REQ(static_cast<void (waterfall::*)(int)>(&waterfall::Bandwidth), wf, (int)bandwidth);
@@ -692,6 +697,10 @@ int cw::rx_process(const double *buf, int len)
 	cwprocessing = true;
 	reset_rx_filter();
 
+	if (!progdefaults.report_when_visible ||
+	    (dlgViewer && dlgViewer->visible()) || progStatus.show_channels)
+		if (!bHistory && cwviewer) cwviewer->rx_process(buf, len);
+
 	if (use_fft_filter)
 		rx_FFTprocess(buf, len);
 	else
@@ -0,0 +1,394 @@
+// ----------------------------------------------------------------------------
+// view_cw.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+// view_cw is a multi channel CW decoder.  A single FFT filterbank with
+// 31.25 Hz wide filters, computed every 4 ms, replaces the per channel mixers
+// and low pass filters of the single signal decoder: the work per channel is
+// only the keying detector and the Morse timing, so that a crowded contest
+// band costs hardly more than a quiet one.
+
+#include <config.h>
+
+#include <cstring>
+#include <cmath>
+
+#include "view_cw.h"
+#include "cw.h"
+#include "misc.h"
+#include "configuration.h"
+#include "status.h"
+#include "spot.h"
+#include "Viewer.h"
+#include "qrunner.h"
+#include "view_route.h"
+
+#define BINWIDTH ((double)VIEW_CW_SampleRate / VIEW_CW_FFTLEN)
+
+// Each filter output is sorted into a key down and a key up class, split at
+// the middle of the two levels, and each level is the average of its class.
+// Noise alone gives a level ratio of at most 12 dB.
+#define KEYDOWN_AVG	8
+#define KEYUP_AVG	32
+// a signal that has been found may fade below the squelch
+#define KEYING_SQUELCH	0.8
+
+// the decoders of signals without a browser line feed the spotter with these
+// decoder numbers, which are out of the range of the browser lines
+#define SPOT_DECODER	100
+
+// The number of frames in the dot/dash threshold (two dots) at speed wpm
+static double threshold_frames(double wpm)
+{
+	return 2.0 * (DOT_MAGIC / wpm) / USECS_PER_SEC * VIEW_CW_FRAMERATE;
+}
+
+static void view_cw_spot(int decoder, int freq, int c)
+{
+	if (progStatus.spot_recv)
+		spot_recv(c, decoder, freq, MODE_CW);
+}
+
+view_cw::view_cw()
+{
+	fft = new g_fft<double>(VIEW_CW_FFTLEN);
+	for (int i = 0; i < VIEW_CW_FFTLEN; i++)
+		window[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / VIEW_CW_FFTLEN);
+	init();
+}
+
+view_cw::~view_cw()
+{
+	delete fft;
+}
+
+void view_cw::init()
+{
+	memset(history, 0, sizeof(history));
+	inptr = 0;
+	nframe = 0;
+
+	for (int i = 0; i < VIEW_CW_BINS; i++) {
+		amplitude[i] = noise[i] = peak[i] = 0.0;
+		owner[i] = -1;
+	}
+	for (int i = 0; i < VIEW_CW_CHANNELS; i++)
+		channel[i].used = false;
+	nactive = 0;
+
+	lowfreq = progdefaults.LowFreqCutoff;
+	lowbin = (int)ceil(lowfreq / BINWIDTH);
+	if (lowbin < 4)
+		lowbin = 4;
+	highbin = VIEW_CW_BINS - 4;
+
+	min_threshold = threshold_frames(progdefaults.CWupperlimit);
+	max_threshold = threshold_frames(progdefaults.CWlowerlimit);
+
+	for (int i = 0; i < MAXCHANNELS; i++) {
+		line_owner[i] = -1;
+		reset_line[i] = false;
+	}
+	reset_all = false;
+	for (int i = 0; i < progdefaults.VIEWERchannels; i++)
+		REQ(&viewclearchannel, i);
+}
+
+void view_cw::clear()
+{
+	reset_all = true;
+}
+
+void view_cw::clearch(int line)
+{
+	if (line >= 0 && line < MAXCHANNELS)
+		reset_line[line] = true;
+}
+
+int view_cw::get_freq(int line)
+{
+	if (line < 0 || line >= MAXCHANNELS || line_owner[line] < 0)
+		return NULLFREQ;
+	return (int)channel[line_owner[line]].frequency;
+}
+
+int view_cw::rx_process(const double *buf, int len)
+{
+	if (lowfreq != progdefaults.LowFreqCutoff)
+		init();
+
+	// requests from the browser
+	for (int i = 0; i < VIEW_CW_CHANNELS; i++) {
+		if (!channel[i].used)
+			continue;
+		if (reset_all || (channel[i].line >= 0 && reset_line[channel[i].line]))
+			release(channel[i]);
+	}
+	reset_all = false;
+	memset(reset_line, 0, sizeof(reset_line));
+
+	while (len-- > 0) {
+		history[inptr++] = *buf++;
+		if (inptr < VIEW_CW_FFTLEN)
+			continue;
+		frame();
+		memmove(history, history + VIEW_CW_HOP, (VIEW_CW_FFTLEN - VIEW_CW_HOP) * sizeof(*history));
+		inptr = VIEW_CW_FFTLEN - VIEW_CW_HOP;
+	}
+
+	return 0;
+}
+
+// One step of the filterbank: update the levels of every filter, look for new
+// signals and run the decoders.
+void view_cw::frame()
+{
+	nframe++;
+	squelch = pow(10.0, progStatus.VIEWER_cwsquelch / 20.0);
+
+	for (int i = 0; i < VIEW_CW_FFTLEN; i++)
+		fftbuf[i] = cmplx(history[i] * window[i], 0.0);
+	fft->ComplexFFT(fftbuf);
+
+	for (int k = lowbin - 2; k <= highbin + 2; k++) {
+		double a = abs(fftbuf[k]);
+		amplitude[k] = a;
+		if (nframe == 1) {
+			noise[k] = a;
+			peak[k] = 2.0 * a;
+		}
+		if (a > (peak[k] + noise[k]) / 2.0)
+			peak[k] = decayavg(peak[k], a, KEYDOWN_AVG);
+		else
+			noise[k] = decayavg(noise[k], a, KEYUP_AVG);
+	}
+
+	find_signals();
+
+	for (int i = 0; i < VIEW_CW_CHANNELS; i++)
+		if (channel[i].used)
+			track(channel[i]);
+}
+
+// A new signal is a filter whose key down level is above the squelch, that
+// is keyed down now and that is the strongest of its neighbours.
+void view_cw::find_signals()
+{
+	for (int k = lowbin; k <= highbin; k++) {
+		if (owner[k - 1] >= 0 || owner[k] >= 0 || owner[k + 1] >= 0)
+			continue;
+		if (peak[k] <= squelch * noise[k])
+			continue;
+		if ((amplitude[k] - noise[k]) < progdefaults.CWupper * (peak[k] - noise[k]))
+			continue;
+		if (peak[k] < peak[k - 1] || peak[k] <= peak[k + 1])
+			continue;
+
+		int i;
+		for (i = 0; i < VIEW_CW_CHANNELS; i++)
+			if (!channel[i].used)
+				break;
+		if (i == VIEW_CW_CHANNELS)
+			return;
+
+		channel_t& ch = channel[i];
+		ch.used = true;
+		ch.bin = k;
+		ch.frequency = interpolate(k);
+		ch.line = -1;
+		ch.keydown = false;
+		ch.start = ch.end = ch.heard = nframe;
+		ch.last_mark = ch.prev_mark = 0;
+		ch.threshold = CLAMP(threshold_frames(progdefaults.CWspeed), min_threshold, max_threshold);
+		ch.ntrack = 0;
+		ch.quality = 0.5;
+		ch.nrep = 0;
+		ch.space_sent = true;
+		owner[k] = i;
+		nactive++;
+	}
+}
+
+void view_cw::track(channel_t& ch)
+{
+	int k = ch.bin;
+	int i = owner[k];
+
+	// follow a drifting signal to the next filter
+	if (ch.keydown) {
+		for (int d = -1; d <= 1; d += 2) {
+			int n = k + d;
+			if (n < lowbin || n > highbin || owner[n] >= 0 ||
+			    owner[n + d] >= 0 || peak[n] < 1.25 * peak[k])
+				continue;
+			owner[k] = -1;
+			owner[n] = i;
+			ch.bin = k = n;
+			break;
+		}
+		ch.frequency = decayavg(ch.frequency, interpolate(k), 8);
+	}
+
+	double span = peak[k] - noise[k];
+	double value = span > 0.0 ? (amplitude[k] - noise[k]) / span : 0.0;
+
+	if (!ch.keydown && value > progdefaults.CWupper && peak[k] > KEYING_SQUELCH * squelch * noise[k])
+		key(ch, true);
+	else if (ch.keydown && value < progdefaults.CWlower)
+		key(ch, false);
+
+	if (!ch.keydown) {
+		int gap = nframe - ch.end;
+		if (ch.nrep && gap >= ch.threshold)
+			flush_char(ch);
+		if (!ch.space_sent && gap > 2 * ch.threshold) {
+			put(ch, " ");
+			ch.space_sent = true;
+		}
+	}
+
+	if (nframe - ch.heard > (unsigned)progdefaults.VIEWERtimeout * VIEW_CW_FRAMERATE)
+		release(ch);
+}
+
+void view_cw::key(channel_t& ch, bool down)
+{
+	ch.keydown = down;
+	if (down) {
+		// a fade in the middle of an element: the element goes on
+		if (ch.ntrack && ch.nrep > 0 && ch.nrep < VIEW_CW_MAXREP &&
+		    nframe - ch.end < ch.threshold / 4) {
+			ch.nrep--;
+			ch.last_mark = ch.prev_mark;
+			return;
+		}
+		ch.start = nframe;
+		return;
+	}
+
+	int element = nframe - ch.start;
+	// a noise spike: the key up period goes on
+	if (element < ch.threshold / 4)
+		return;
+	ch.end = nframe;
+	// a carrier, not Morse
+	if (element > 2 * max_threshold) {
+		ch.nrep = 0;
+		ch.last_mark = 0;
+		return;
+	}
+
+	// track the speed on dot-dash and dash-dot pairs, as the single
+	// signal decoder does
+	if (ch.last_mark > 0) {
+		if (element > 2 * ch.last_mark && element < 4 * ch.last_mark)
+			update_speed(ch, ch.last_mark, element);
+		else if (ch.last_mark > 2 * element && ch.last_mark < 4 * element)
+			update_speed(ch, element, ch.last_mark);
+	}
+	ch.prev_mark = ch.last_mark;
+	ch.last_mark = element;
+	ch.heard = nframe;
+
+	if (ch.nrep < VIEW_CW_MAXREP - 1)
+		ch.rep[ch.nrep] = element <= ch.threshold ? CW_DOT_REPRESENTATION : CW_DASH_REPRESENTATION;
+	ch.nrep++;
+}
+
+void view_cw::update_speed(channel_t& ch, int dot, int dash)
+{
+	if (ch.ntrack < TRACKING_FILTER_SIZE / 2)
+		ch.ntrack++;
+	ch.threshold = decayavg(ch.threshold, (dot + dash) / 2.0, ch.ntrack);
+	ch.threshold = CLAMP(ch.threshold, min_threshold, max_threshold);
+}
+
+// Characters are only printed once the speed has been measured and while
+// most characters have more than one element: noise that gets through the
+// squelch decodes mostly as single dots.
+void view_cw::flush_char(channel_t& ch)
+{
+	if (ch.nrep < VIEW_CW_MAXREP) {
+		ch.quality = decayavg(ch.quality, ch.nrep > 1 ? 1.0 : 0.0, 8);
+		ch.rep[ch.nrep] = '\0';
+		const char* s = morse.rx_lookup(ch.rep);
+		if (s && ch.ntrack && ch.quality >= 0.5) {
+			put(ch, s);
+			ch.space_sent = false;
+		}
+	}
+	ch.nrep = 0;
+}
+
+void view_cw::put(channel_t& ch, const char* s)
+{
+	if (ch.line < 0) {
+		ch.line = free_line(ch.frequency);
+		if (ch.line >= 0)
+			view_route_clear(SPOT_DECODER + (int)(&ch - channel));
+	}
+	if (ch.line >= 0)
+		line_owner[ch.line] = &ch - channel;
+
+	int decoder = ch.line >= 0 ? ch.line : SPOT_DECODER + (int)(&ch - channel);
+	double snr = 20.0 * log10(peak[ch.bin] / (noise[ch.bin] + 1e-20) + 1e-10);
+	for (; *s; s++) {
+		if (ch.line >= 0)
+			REQ(&viewaddchr, ch.line, (int)ch.frequency, *s, (int)MODE_CW);
+		else
+			REQ(&view_cw_spot, decoder, (int)ch.frequency, (int)*s);
+		view_route_chr(decoder, (int)ch.frequency, *s, MODE_CW, snr);
+	}
+}
+
+// The browser line of a 100 Hz slot, if no other signal has it
+int view_cw::free_line(double freq)
+{
+	int line = (int)floor((freq - lowfreq) / 100.0);
+	if (line < 0 || line >= progdefaults.VIEWERchannels || line >= MAXCHANNELS ||
+	    line_owner[line] >= 0)
+		return -1;
+	return line;
+}
+
+void view_cw::release(channel_t& ch)
+{
+	if (ch.line >= 0) {
+		line_owner[ch.line] = -1;
+		REQ(&viewclearchannel, ch.line);
+	}
+	view_route_clear(ch.line >= 0 ? ch.line : SPOT_DECODER + (int)(&ch - channel));
+	owner[ch.bin] = -1;
+	ch.used = false;
+	nactive--;
+}
+
+// The frequency of the peak near filter k, from the key down levels of the
+// filter and its neighbours
+double view_cw::interpolate(int k)
+{
+	double a = log(peak[k - 1] + 1e-10);
+	double b = log(peak[k] + 1e-10);
+	double c = log(peak[k + 1] + 1e-10);
+	double d = a - 2.0 * b + c;
+	double delta = d < 0.0 ? 0.5 * (a - c) / d : 0.0;
+	return (k + CLAMP(delta, -0.5, 0.5)) * BINWIDTH;
+}
@@ -23,6 +23,8 @@
 
 #include <config.h>
 #include <iostream>
+#include <cstring>
+#include <algorithm>
 using namespace std;
 
 //#include "rtty.h"
@@ -37,6 +39,7 @@ using namespace std;
 #include "digiscope.h"
 #include "Viewer.h"
 #include "qrunner.h"
+#include "view_route.h"
 
 //=====================================================================
 // Baudot support
@@ -58,13 +61,15 @@ static char figures[32] = {
 };
 
 const double	view_rtty::SHIFT[] = {23, 85, 160, 170, 182, 200, 240, 350, 425, 850};
-// FILTLEN must be same size as BAUD
 const double	view_rtty::BAUD[]  = {45, 45.45, 50, 56, 75, 100, 110, 150, 200, 300};
-const int		view_rtty::FILTLEN[] = { 512, 512, 512, 512, 512, 512, 512, 256, 128, 64};
 const int		view_rtty::BITS[]  = {5, 7, 8};
 const int		view_rtty::numshifts = (int)(sizeof(SHIFT) / sizeof(*SHIFT));
 const int		view_rtty::numbauds = (int)(sizeof(BAUD) / sizeof(*BAUD));
 
+// shifts looked for besides the one of the modem
+static const double search_shift[] = {170, 425, 850};
+static const int num_search_shifts = (int)(sizeof(search_shift) / sizeof(*search_shift));
+
 void view_rtty::rx_init()
 {
 	for (int ch = 0; ch < progdefaults.VIEWERchannels; ch++) {
@@ -74,20 +79,9 @@ void view_rtty::rx_init()
 		channel[ch].phaseacc = 0;
 		channel[ch].timeout = 0;
 		channel[ch].frequency = NULLFREQ;
+		channel[ch].shift = shift;
 		channel[ch].poserr = channel[ch].negerr = 0.0;
-
-		channel[ch].mark_phase = 0;
-		channel[ch].space_phase = 0;
-		channel[ch].mark_mag = 0;
-		channel[ch].space_mag = 0;
-		channel[ch].mark_env = 0;
-		channel[ch].space_env = 0;
-
-		channel[ch].inp_ptr = 0;
-
-		for (int i = 0; i < VIEW_MAXPIPE; i++)
-			channel[ch].mark_history[i] =
-			channel[ch].space_history[i] = cmplx(0,0);
+		channel[ch].stop_prev = cmplx(0,0);
 	}
 }
 
@@ -99,23 +93,20 @@ void view_rtty::init()
 	rx_init();
 }
 
-view_rtty::~view_rtty()
+void view_rtty::free_filterbank()
 {
-	for (int ch = 0; ch < MAX_CHANNELS; ch ++) {
-		if (channel[ch].mark_filt) delete channel[ch].mark_filt;
-		if (channel[ch].space_filt) delete channel[ch].space_filt;
-		if (channel[ch].bits) delete channel[ch].bits;
-	}
+	delete fft;
+	delete [] window;
+	delete [] history;
+	delete [] fftbuf;
+	delete [] power;
+	delete [] avgpwr;
+	delete [] sortbuf;
 }
 
-void view_rtty::reset_filters(int ch)
+view_rtty::~view_rtty()
 {
-	delete channel[ch].mark_filt;
-	channel[ch].mark_filt = new fftfilt(rtty_baud/samplerate, filter_length);
-	channel[ch].mark_filt->rtty_filter(rtty_baud/samplerate);
-	delete channel[ch].space_filt;
-	channel[ch].space_filt = new fftfilt(rtty_baud/samplerate, filter_length);
-	channel[ch].space_filt->rtty_filter(rtty_baud/samplerate);
+	free_filterbank();
 }
 
 void view_rtty::restart()
@@ -125,7 +116,6 @@ void view_rtty::restart()
 	rtty_shift = shift = (progdefaults.rtty_shift < rtty::numshifts ?
 			      SHIFT[progdefaults.rtty_shift] : progdefaults.rtty_custom_shift);
 	rtty_baud = BAUD[progdefaults.rtty_baud];
-	filter_length = FILTLEN[progdefaults.rtty_baud];
 
 	nbits = rtty_bits = BITS[progdefaults.rtty_bits];
 	if (rtty_bits == 5)
@@ -153,39 +143,61 @@ void view_rtty::restart()
 	if (bp_filt_lo < 0) bp_filt_lo = 0;
 	bp_filt_hi = (shift/2.0 + rtty_BW/2.0) / samplerate;
 
-	for (int ch = 0; ch < MAX_CHANNELS; ch ++) {
-
-		reset_filters(ch);
+// filterbank: a Hann window of 1.5 symbols, zero padded to a power of 2,
+// and VIEW_RTTY_HOPS frames per symbol
+	free_filterbank();
+	winlen = (int)(1.5 * samplerate / rtty_baud + 0.5);
+	for (fftlen = 64; fftlen < winlen; fftlen *= 2) ;
+	hop = (int)(samplerate / rtty_baud / VIEW_RTTY_HOPS + 0.5);
+	if (hop < 1) hop = 1;
+	symlen = samplerate / rtty_baud / hop;
+	nbuf = (int)(symlen + 0.5);
+	if (nbuf > VIEW_RTTY_MAXBITS) nbuf = VIEW_RTTY_MAXBITS;
+	nbins = fftlen / 2;
+	binwidth = (double)samplerate / fftlen;
+
+	fft = new g_fft<double>(fftlen);
+	window = new double[winlen];
+	history = new double[winlen];
+	fftbuf = new cmplx[fftlen];
+	power = new double[nbins];
+	avgpwr = new double[nbins];
+	sortbuf = new double[nbins];
+
+	double sum = 0, sum2 = 0;
+	for (int i = 0; i < winlen; i++) {
+		window[i] = 0.5 - 0.5 * cos(TWOPI * (i + 1) / (winlen + 1));
+		sum += window[i];
+		sum2 += window[i] * window[i];
+		history[i] = 0;
+	}
+	enbw = samplerate * sum2 / (sum * sum);
+	for (int i = 0; i < nbins; i++)
+		power[i] = avgpwr[i] = 0;
+	inptr = 0;
+	noise_floor = 0;
+
+	lowbin = (int)ceil(progdefaults.LowFreqCutoff / binwidth);
+	if (lowbin < 2) lowbin = 2;
+	highbin = (int)(progdefaults.HighFreqCutoff / binwidth);
+	if (highbin > nbins - 2) highbin = nbins - 2;
+	if (highbin <= lowbin) highbin = nbins - 2;
 
+	for (int ch = 0; ch < MAX_CHANNELS; ch ++) {
 		channel[ch].state = IDLE;
 		channel[ch].timeout = 0;
-		channel[ch].freqerr = 0.0;
 		channel[ch].metric = 0.0;
 		channel[ch].sigpwr = 0.0;
-		channel[ch].noisepwr = 0.0;
 		channel[ch].sigsearch = 0;
 		channel[ch].frequency = NULLFREQ;
-		channel[ch].counter = symbollen / 2;
-		channel[ch].mark_phase = 0;
-		channel[ch].space_phase = 0;
-		channel[ch].mark_mag = 0;
-		channel[ch].space_mag = 0;
-		channel[ch].mark_env = 0;
-		channel[ch].space_env = 0;
-		channel[ch].inp_ptr = 0;
-
-		if (channel[ch].bits)
-			channel[ch].bits->setLength(symbollen / 8);
-		else
-			channel[ch].bits = new Cmovavg(symbollen / 8);
+		channel[ch].shift = shift;
+		channel[ch].mark_bin = channel[ch].space_bin = 0;
+		channel[ch].counter = symlen / 2;
 
-		channel[ch].mark_noise = channel[ch].space_noise = 0;
-		channel[ch].bit = channel[ch].nubit = true;
-
-		for (int i = 0; i < VIEW_RTTY_MAXBITS; i++) channel[ch].bit_buf[i] = 0.0;
-
-		for (int i = 0; i < VIEW_MAXPIPE; i++)
-			channel[ch].mark_history[i] = channel[ch].space_history[i] = cmplx(0,0);
+		for (int i = 0; i < VIEW_RTTY_MAXBITS; i++) {
+			channel[ch].bit_buf[i] = 0;
+			channel[ch].afc_buf[i] = 0;
+		}
 	}
 
 // stop length = 1, 1.5 or 2 bits
@@ -206,26 +218,13 @@ view_rtty::view_rtty(trx_mode tty_mode)
 
 	samplerate = RTTY_SampleRate;
 
-	for (int ch = 0; ch < MAX_CHANNELS; ch ++) {
-		channel[ch].mark_filt = (fftfilt *)0;
-		channel[ch].space_filt = (fftfilt *)0;
-		channel[ch].bits = (Cmovavg *)0;
-	}
+	fft = 0;
+	window = history = power = avgpwr = sortbuf = 0;
+	fftbuf = 0;
 
 	restart();
 }
 
-cmplx view_rtty::mixer(double &phase, double f, cmplx in)
-{
-	cmplx z = cmplx( cos(phase), sin(phase)) * in;;
-
-	phase -= TWOPI * f / samplerate;
-	if (phase < - TWOPI) phase += TWOPI;
-
-	return z;
-}
-
-
 unsigned char view_rtty::bitreverse(unsigned char in, int n)
 {
 	unsigned char out = 0;
@@ -292,11 +291,11 @@ bool view_rtty::is_mark_space( int ch, int &correction)
 {
 	correction = 0;
 // test for rough bit position
-	if (channel[ch].bit_buf[0] && !channel[ch].bit_buf[symbollen-1]) {
+	if (channel[ch].bit_buf[0] && !channel[ch].bit_buf[nbuf-1]) {
 // test for mark/space straddle point
-		for (int i = 0; i < symbollen; i++)
+		for (int i = 0; i < nbuf; i++)
 			correction += channel[ch].bit_buf[i];
-		if (abs(symbollen/2 - correction) < 6) // too small & bad signals are not decoded
+		if (abs(nbuf/2 - correction) <= 1) // too small & bad signals are not decoded
 			return true;
 	}
 	return false;
@@ -304,7 +303,7 @@ bool view_rtty::is_mark_space( int ch, int &correction)
 
 bool view_rtty::is_mark(int ch)
 {
-	return channel[ch].bit_buf[symbollen / 2];
+	return channel[ch].bit_buf[nbuf / 2];
 }
 
 bool view_rtty::rx(int ch, bool bit)
@@ -314,10 +313,11 @@ bool view_rtty::rx(int ch, bool bit)
 
 	int correction = 0;
 
-	for (int i = 1; i < symbollen; i++)
+	for (int i = 1; i < nbuf; i++)
 		channel[ch].bit_buf[i-1] = channel[ch].bit_buf[i];
-	channel[ch].bit_buf[symbollen - 1] = bit;
+	channel[ch].bit_buf[nbuf - 1] = bit;
 
+// the counters run at the frame rate, symlen frames per bit
 	switch (channel[ch].rxstate) {
 	case RTTY_RX_STATE_IDLE:
 		if ( is_mark_space(ch, correction)) {
@@ -326,10 +326,10 @@ bool view_rtty::rx(int ch, bool bit)
 		}
 		break;
 	case RTTY_RX_STATE_START:
-		if (--channel[ch].counter == 0) {
+		if (--channel[ch].counter < 0.5) {
 			if (!is_mark(ch)) {
 				channel[ch].rxstate = RTTY_RX_STATE_DATA;
-				channel[ch].counter = symbollen;
+				channel[ch].counter += symlen;
 				channel[ch].bitcntr = 0;
 				channel[ch].rxdata = 0;
 			} else {
@@ -338,21 +338,25 @@ bool view_rtty::rx(int ch, bool bit)
 		}
 		break;
 	case RTTY_RX_STATE_DATA:
-		if (--channel[ch].counter == 0) {
+		if (--channel[ch].counter < 0.5) {
 			channel[ch].rxdata |= is_mark(ch) << channel[ch].bitcntr++;
-			channel[ch].counter = symbollen;
+			channel[ch].counter += symlen;
 		}
 		if (channel[ch].bitcntr == nbits + (rtty_parity != RTTY_PARITY_NONE ? 1 : 0))
 			channel[ch].rxstate = RTTY_RX_STATE_STOP;
 		break;
 	case RTTY_RX_STATE_STOP:
-		if (--channel[ch].counter == 0) {
+		if (--channel[ch].counter < 0.5) {
 			if (is_mark(ch)) {
 				if (channel[ch].metric > rtty_squelch) {
 					c = decode_char(ch);
 // print this RTTY_CHANNEL
-					if ( c != 0 )
+					if ( c != 0 ) {
 						REQ(&viewaddchr, ch, (int)channel[ch].frequency, c, mode);
+						// the metric is the SNR in 3 kHz
+						view_route_chr(ch, (int)channel[ch].frequency, c, mode,
+							       10.0 * log10(channel[ch].metric + 1e-10));
+					}
 				}
 				flag = true;
 			}
@@ -365,19 +369,29 @@ bool view_rtty::rx(int ch, bool bit)
 	return flag;
 }
 
+// The ratio of a bin power to the bin noise power is the signal to noise
+// ratio in the equivalent noise bandwidth of the bin.  The squelch is
+// relative to the noise in 3 kHz.
+double view_rtty::tone_snr(int bin)
+{
+	return avgpwr[bin] * enbw / (3000.0 * noise_floor + 1e-20);
+}
+
+void view_rtty::set_bins(int ch)
+{
+	channel[ch].mark_bin = (int)floor((channel[ch].frequency + channel[ch].shift / 2) / binwidth + 0.5);
+	channel[ch].space_bin = (int)floor((channel[ch].frequency - channel[ch].shift / 2) / binwidth + 0.5);
+	channel[ch].mark_bin = CLAMP(channel[ch].mark_bin, 1, nbins - 1);
+	channel[ch].space_bin = CLAMP(channel[ch].space_bin, 1, nbins - 1);
+}
+
 void view_rtty::Metric(int ch)
 {
-	double delta = rtty_baud/2.0;
-	double np = wf->powerDensity(channel[ch].frequency, delta) * 3000 / delta;
-	double sp =
-		wf->powerDensity(channel[ch].frequency - shift/2, delta) +
-		wf->powerDensity(channel[ch].frequency + shift/2, delta) + 1e-10;
+	double sp = avgpwr[channel[ch].mark_bin] + avgpwr[channel[ch].space_bin];
 
 	channel[ch].sigpwr = decayavg( channel[ch].sigpwr, sp, sp - channel[ch].sigpwr > 0 ? 2 : 16);
 
-	channel[ch].noisepwr = decayavg( channel[ch].noisepwr, np, 16 );
-
-	channel[ch].metric = CLAMP(channel[ch].sigpwr/channel[ch].noisepwr, 0.0, 100.0);
+	channel[ch].metric = CLAMP(channel[ch].sigpwr * enbw / (3000.0 * noise_floor + 1e-20), 0.0, 100.0);
 
 	if (channel[ch].state == RCVNG)
 		if (channel[ch].metric < rtty_squelch) {
@@ -390,39 +404,103 @@ void view_rtty::Metric(int ch)
 		if (!channel[ch].timeout) {
 			channel[ch].frequency = NULLFREQ;
 			channel[ch].metric = 0;
-			channel[ch].freqerr = 0;
 			channel[ch].state = IDLE;
 			REQ(&viewclearchannel, ch);
+			view_route_clear(ch);
 		}
 	}
 }
 
+// The noise is the lower quartile of the bin powers in the passband, which
+// is clear of signals in all but the most crowded bands.
+void view_rtty::measure_noise()
+{
+	int n = highbin - lowbin;
+	if (n < 4) return;
+	memcpy(sortbuf, avgpwr + lowbin, n * sizeof(*sortbuf));
+	nth_element(sortbuf, sortbuf + n / 4, sortbuf + n);
+	if (noise_floor == 0)
+		noise_floor = sortbuf[n / 4];
+	else
+		noise_floor = decayavg(noise_floor, sortbuf[n / 4], 16);
+}
+
+// Looks between lo and hi for a pair of tones with one of the searched
+// shifts: both peaks above the squelch, within 10 dB of each other, and a
+// gap between them.
+bool view_rtty::find_tones(double lo, double hi, double &freq, double &tshift)
+{
+	double best = 0;
+
+	for (int i = -1; i < num_search_shifts; i++) {
+		double s = (i < 0 ? shift : search_shift[i]);
+		if (i >= 0 && s == shift) continue;
+		int d = (int)floor(s / binwidth + 0.5);
+		if (d < 2) continue;
+		int klo = (int)floor((lo + s / 2) / binwidth + 0.5);
+		int khi = (int)floor((hi + s / 2) / binwidth + 0.5);
+		for (int m = klo; m <= khi; m++) {
+			if (m - d - 1 < lowbin || m > highbin) continue;
+			if (avgpwr[m] < avgpwr[m-1] || avgpwr[m] < avgpwr[m+1])
+				continue;
+// the shift is rarely a whole number of bins
+			int sp = m - d;
+			if (avgpwr[sp - 1] > avgpwr[sp]) sp--;
+			else if (avgpwr[sp + 1] > avgpwr[sp]) sp++;
+			if (avgpwr[sp] < avgpwr[sp-1] || avgpwr[sp] < avgpwr[sp+1])
+				continue;
+			double weaker = min(avgpwr[m], avgpwr[sp]);
+// the keying sidebands of a strong tone are not a second tone
+			if (weaker < max(avgpwr[m], avgpwr[sp]) / 10)
+				continue;
+			if (tone_snr(m) < rtty_squelch || tone_snr(sp) < rtty_squelch)
+				continue;
+			if (d >= 4 && avgpwr[(m + sp) / 2] > weaker / 2)
+				continue;
+			if (weaker > best) {
+				best = weaker;
+				freq = (m + sp) * binwidth / 2;
+				tshift = s;
+			}
+		}
+	}
+	return best > 0;
+}
+
+// The tones of an FSK signal take turns, those of two other signals that
+// happen to be a shift apart do not.  With independent keying the mean of
+// the product of the powers is the product of their means.
+bool view_rtty::is_fsk(int ch)
+{
+	double n = channel[ch].frames;
+	double ratio = channel[ch].cross_sum * n /
+		(channel[ch].mark_sum * channel[ch].space_sum + 1e-20);
+	return ratio < 0.5;
+}
+
 void view_rtty::find_signals()
 {
-	double spwrhi = 0.0, spwrlo = 0.0, npwr = 0.0;
-	double rtty_squelch = pow(10, progStatus.VIEWER_rttysquelch / 10.0);
+	double freq = 0, tshift = shift;
 	for (int i = 0; i < progdefaults.VIEWERchannels; i++) {
 		if (channel[i].state != IDLE) continue;
 		int cf = progdefaults.LowFreqCutoff + 100 * i;
 		if (cf < shift) cf = shift;
-		double delta = rtty_baud / 8;
-		for (int chf = cf; chf < cf + 100 - rtty_baud / 4; chf += 5) {
-			spwrlo = wf->powerDensity(chf - shift/2, delta);
-			spwrhi = wf->powerDensity(chf + shift/2, delta);
-			npwr = (wf->powerDensity(chf, delta) * 3000 / rtty_baud) + 1e-10;
-			if ((spwrlo / npwr > rtty_squelch) && (spwrhi / npwr > rtty_squelch)) {
-				if (!i && (channel[i+1].state == SRCHG || channel[i+1].state == RCVNG)) break;
-				if ((i == (progdefaults.VIEWERchannels -2)) &&
-					(channel[i+1].state == SRCHG || channel[i+1].state == RCVNG)) break;
-				if (i && (channel[i-1].state == SRCHG || channel[i-1].state == RCVNG)) break;
-				if (i > 3 && (channel[i-2].state == SRCHG || channel[i-2].state == RCVNG)) break;
-				channel[i].frequency = chf;
-				channel[i].sigsearch = SIGSEARCH;
-				channel[i].state = SRCHG;
-				REQ(&viewaddchr, i, (int)channel[i].frequency, 0, mode);
-				break;
-			}
-		}
+		if (!find_tones(cf, cf + 100 - rtty_baud / 4, freq, tshift)) continue;
+		if (!i && (channel[i+1].state == SRCHG || channel[i+1].state == RCVNG)) continue;
+		if ((i == (progdefaults.VIEWERchannels -2)) &&
+			(channel[i+1].state == SRCHG || channel[i+1].state == RCVNG)) continue;
+		if (i && (channel[i-1].state == SRCHG || channel[i-1].state == RCVNG)) continue;
+		if (i > 3 && (channel[i-2].state == SRCHG || channel[i-2].state == RCVNG)) continue;
+		channel[i].frequency = freq;
+		channel[i].shift = tshift;
+		channel[i].rxstate = RTTY_RX_STATE_IDLE;
+		channel[i].sigpwr = 0;
+		channel[i].mark_sum = channel[i].space_sum = channel[i].cross_sum = 0;
+		channel[i].frames = 0;
+		set_bins(i);
+		channel[i].sigsearch = SIGSEARCH;
+		channel[i].state = SRCHG;
+		REQ(&viewaddchr, i, (int)channel[i].frequency, 0, mode);
 	}
 	for (int i = 1; i < progdefaults.VIEWERchannels; i++ )
 		if (fabs(channel[i].frequency - channel[i-1].frequency) < rtty_baud/2)
@@ -438,6 +516,7 @@ void view_rtty::clearch(int ch)
 	channel[ch].frequency = NULLFREQ;
 	channel[ch].poserr = channel[ch].negerr = 0.0;
 	REQ( &viewclearchannel, ch);
+	view_route_clear(ch);
 }
 
 void view_rtty::clear()
@@ -452,12 +531,69 @@ void view_rtty::clear()
 	}
 }
 
-int view_rtty::rx_process(const double *buf, int buflen)
+void view_rtty::demodulate(int ch)
 {
-	cmplx z, zmark, zspace, *zp_mark, *zp_space;
-	static bool bit = true;
-	int n = 0;
+	RTTY_CHANNEL &c = channel[ch];
+
+// Kahn Square Law demodulator
+	bool bit = power[c.mark_bin] >= power[c.space_bin];
+
+	if (c.state == SRCHG) {
+		c.mark_sum += power[c.mark_bin];
+		c.space_sum += power[c.space_bin];
+		c.cross_sum += power[c.mark_bin] * power[c.space_bin];
+		c.frames++;
+	}
 
+// the AFC measures the stop tone as the phase advance of its bin from one
+// frame to the next.  The error is delayed like the bits, so that the one
+// of the middle of the stop bit is used.
+	int stop_bin = reverse ? c.space_bin : c.mark_bin;
+	cmplx z = fftbuf[stop_bin];
+	double bincenter = stop_bin * binwidth;
+	double dphi = arg(z * conj(c.stop_prev)) - TWOPI * bincenter * hop / samplerate;
+	dphi -= TWOPI * floor(dphi / TWOPI + 0.5);
+	c.stop_prev = z;
+
+	for (int i = 1; i < nbuf; i++)
+		c.afc_buf[i-1] = c.afc_buf[i];
+	c.afc_buf[nbuf - 1] = bincenter + dphi * samplerate / (TWOPI * hop) -
+		(c.frequency + (reverse ? -c.shift : c.shift) / 2);
+
+	if (c.state == RCVNG && rx( ch, reverse ? !bit : bit )) {
+		double ferr = c.afc_buf[nbuf / 2];
+		if (fabs(ferr) < binwidth / 2 && c.metric > rtty_squelch) {
+			c.frequency += ferr / (progdefaults.rtty_afcspeed == 0 ? 8 :
+					       progdefaults.rtty_afcspeed == 1 ? 4 : 1);
+			set_bins(ch);
+		}
+	}
+}
+
+void view_rtty::frame()
+{
+	for (int i = 0; i < winlen; i++)
+		fftbuf[i] = cmplx(history[i] * window[i], 0.0);
+	for (int i = winlen; i < fftlen; i++)
+		fftbuf[i] = cmplx(0, 0);
+	fft->ComplexFFT(fftbuf);
+
+// envelopes of all the filters at once; plain loops over arrays, which the
+// compiler vectorizes
+	const double *re_im = reinterpret_cast<const double *>(fftbuf);
+	for (int k = 0; k < nbins; k++)
+		power[k] = re_im[2*k] * re_im[2*k] + re_im[2*k+1] * re_im[2*k+1];
+	const double avg = 1.0 / (2 * VIEW_RTTY_HOPS);
+	for (int k = 0; k < nbins; k++)
+		avgpwr[k] += (power[k] - avgpwr[k]) * avg;
+
+	for (int ch = 0; ch < progdefaults.VIEWERchannels; ch++)
+		if (channel[ch].state != IDLE)
+			demodulate(ch);
+}
+
+int view_rtty::rx_process(const double *buf, int buflen)
+{
 	rtty_squelch = pow(10, progStatus.VIEWER_rttysquelch / 10.0);
 
 	for (int ch = 0; ch < progdefaults.VIEWERchannels; ch++) {
@@ -465,82 +601,31 @@ int view_rtty::rx_process(const double *buf, int buflen)
 			continue;
 		if (channel[ch].sigsearch) {
 			channel[ch].sigsearch--;
-			if (!channel[ch].sigsearch)
-				channel[ch].state = RCVNG;
-		}
-
-		for (int len = 0; len < buflen; len++) {
-			z = cmplx(buf[len], buf[len]);
-
-			zmark = mixer(channel[ch].mark_phase, channel[ch].frequency + shift/2.0, z);
-			channel[ch].mark_filt->run(zmark, &zp_mark);
-
-			zspace = mixer(channel[ch].space_phase, channel[ch].frequency - shift/2.0, z);
-			n = channel[ch].space_filt->run(zspace, &zp_space);
-
-// n loop
-			if (n) Metric(ch);
-
-			for (int i = 0; i < n; i++) {
-
-				channel[ch].mark_mag = abs(zp_mark[i]);
-				channel[ch].mark_env = decayavg (channel[ch].mark_env, channel[ch].mark_mag,
-					(channel[ch].mark_mag > channel[ch].mark_env) ? symbollen / 4 : symbollen * 16);
-				channel[ch].mark_noise = decayavg (channel[ch].mark_noise, channel[ch].mark_mag,
-					(channel[ch].mark_mag < channel[ch].mark_noise) ? symbollen / 4 : symbollen * 48);
-				channel[ch].space_mag = abs(zp_space[i]);
-				channel[ch].space_env = decayavg (channel[ch].space_env, channel[ch].space_mag,
-					(channel[ch].space_mag > channel[ch].space_env) ? symbollen / 4 : symbollen * 16);
-				channel[ch].space_noise = decayavg (channel[ch].space_noise, channel[ch].space_mag,
-					(channel[ch].space_mag < channel[ch].space_noise) ? symbollen / 4 : symbollen * 48);
-
-				channel[ch].noise_floor = min(channel[ch].space_noise, channel[ch].mark_noise);
-
-// clipped if clipped decoder selected
-				double mclipped = 0, sclipped = 0;
-				mclipped = channel[ch].mark_mag > channel[ch].mark_env ?
-							channel[ch].mark_env : channel[ch].mark_mag;
-				sclipped = channel[ch].space_mag > channel[ch].space_env ?
-							channel[ch].space_env : channel[ch].space_mag;
-				if (mclipped < channel[ch].noise_floor) mclipped = channel[ch].noise_floor;
-				if (sclipped < channel[ch].noise_floor) sclipped = channel[ch].noise_floor;
-
-// Optimal ATC
-//				int v = (((mclipped - channel[ch].noise_floor) * (channel[ch].mark_env - channel[ch].noise_floor) -
-//						(sclipped - channel[ch].noise_floor) * (channel[ch].space_env - channel[ch].noise_floor)) -
-//				0.25 * ((channel[ch].mark_env - channel[ch].noise_floor) *
-//						(channel[ch].mark_env - channel[ch].noise_floor) -
-//						(channel[ch].space_env - channel[ch].noise_floor) *
-//						(channel[ch].space_env - channel[ch].noise_floor)));
-//				bit = (v > 0);
-// Kahn Square Law demodulator
-				bit = norm(zp_mark[i]) >= norm(zp_space[i]);
-
-				channel[ch].mark_history[channel[ch].inp_ptr] = zp_mark[i];
-				channel[ch].space_history[channel[ch].inp_ptr] = zp_space[i];
-				channel[ch].inp_ptr = (channel[ch].inp_ptr + 1) % VIEW_MAXPIPE;
-
-				if (channel[ch].state == RCVNG && rx( ch, reverse ? !bit : bit ) ) {
-					if (channel[ch].sigsearch) channel[ch].sigsearch--;
-					int mp0 = channel[ch].inp_ptr - 2;
-					int mp1 = mp0 + 1;
-					if (mp0 < 0) mp0 += VIEW_MAXPIPE;
-					if (mp1 < 0) mp1 += VIEW_MAXPIPE;
-					double ferr = (TWOPI * samplerate / rtty_baud) *
-						(!reverse ?
-						arg(conj(channel[ch].mark_history[mp1]) * channel[ch].mark_history[mp0]) :
-						arg(conj(channel[ch].space_history[mp1]) * channel[ch].space_history[mp0]));
-					if (fabs(ferr) > rtty_baud / 2) ferr = 0;
-					channel[ch].freqerr = decayavg ( channel[ch].freqerr, ferr / 4,
-						progdefaults.rtty_afcspeed == 0 ? 8 :
-						progdefaults.rtty_afcspeed == 1 ? 4 : 1 );
-					if (channel[ch].metric > pow(10, progStatus.VIEWER_rttysquelch / 10.0))
-						channel[ch].frequency -= ferr;
+			if (!channel[ch].sigsearch) {
+				if (is_fsk(ch))
+					channel[ch].state = RCVNG;
+				else {
+					channel[ch].timeout = progdefaults.VIEWERtimeout * samplerate / WFBLOCKSIZE;
+					channel[ch].state = WAITING;
 				}
 			}
 		}
 	}
 
+	while (buflen-- > 0) {
+		history[inptr++] = *buf++;
+		if (inptr < winlen)
+			continue;
+		frame();
+		memmove(history, history + hop, (winlen - hop) * sizeof(*history));
+		inptr = winlen - hop;
+	}
+
+	measure_noise();
+	for (int ch = 0; ch < progdefaults.VIEWERchannels; ch++)
+		if (channel[ch].state != IDLE)
+			Metric(ch);
+
 	find_signals();
 
 	return 0;
@@ -82,6 +82,9 @@ void initViewer()
 		if (active_modem->get_mode() == MODE_RTTY) {
 			mvsquelch->range(-12.0, 6.0);
 			mvsquelch->value(progStatus.VIEWER_rttysquelch);
+		} else if (active_modem->get_mode() == MODE_CW) {
+			mvsquelch->range(6.0, 30.0);
+			mvsquelch->value(progStatus.VIEWER_cwsquelch);
 		} else {
 			mvsquelch->range(-3.0, 6.0);
 			mvsquelch->value(progStatus.VIEWER_psksquelch);
@@ -103,6 +106,9 @@ void initViewer()
 		if (active_modem->get_mode() == MODE_RTTY) {
 			sldrViewerSquelch->range(-12.0, 6.0);
 			sldrViewerSquelch->value(progStatus.VIEWER_rttysquelch);
+		} else if (active_modem->get_mode() == MODE_CW) {
+			sldrViewerSquelch->range(6.0, 30.0);
+			sldrViewerSquelch->value(progStatus.VIEWER_cwsquelch);
 		} else {
 			sldrViewerSquelch->range(-3.0, 6.0);
 			sldrViewerSquelch->value(progStatus.VIEWER_psksquelch);
@@ -236,6 +242,8 @@ static void cb_Squelch(Fl_Slider *, void *)
 {
 	if (active_modem->get_mode() == MODE_RTTY)
 		progStatus.VIEWER_rttysquelch = sldrViewerSquelch->value();
+	else if (active_modem->get_mode() == MODE_CW)
+		progStatus.VIEWER_cwsquelch = sldrViewerSquelch->value();
 	else
 		progStatus.VIEWER_psksquelch = sldrViewerSquelch->value();
 
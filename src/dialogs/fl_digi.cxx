@@ -65,6 +65,7 @@
 
 #include "waterfall.h"
 #include "raster.h"
+#include "image_sink.h"
 #include "progress.h"
 #include "Panel.h"
 
@@ -158,6 +159,7 @@
 #include "outputencoder.h"
 #include "record_loader.h"
 #include "record_browse.h"
+#include "rxlatency.h"
 
 #define LOG_TO_FILE_MLABEL     _("Log all RX/TX text")
 #define RIGCONTROL_MLABEL      _("Rig control")
@@ -945,6 +947,15 @@ void startup_modem(modem* m, int f)
 			sldrViewerSquelch->value(progStatus.VIEWER_psksquelch);
 			sldrViewerSquelch->range(-3.0, 6.0);
 		}
+	} else if (id == MODE_CW) {
+		if (mvsquelch) {
+			mvsquelch->value(progStatus.VIEWER_cwsquelch);
+			mvsquelch->range(6.0, 30.0);
+		}
+		if (sldrViewerSquelch) {
+			sldrViewerSquelch->value(progStatus.VIEWER_cwsquelch);
+			sldrViewerSquelch->range(6.0, 30.0);
+		}
 	}
 
 	if (m->get_cap() & modem::CAP_AFC) {
@@ -2219,6 +2230,18 @@ void cb_mnuShowCountries(Fl_Menu_ *, void *)
 	notify_dxcc_show();
 }
 
+// the country list may still be loading when the menu is created
+void update_countries_menu(void)
+{
+	Fl_Menu_Item* m = getMenuItem(COUNTRIES_MLABEL);
+	if (!m)
+		return;
+	if (dxcc_is_open())
+		m->show();
+	else
+		m->hide();
+}
+
 void cb_mnuContest(Fl_Menu_ *m, void *) {
 	if (QsoInfoFrame1A->visible()) {
 		QsoInfoFrame1A->hide();
@@ -2735,6 +2758,8 @@ void cb_mvsquelch(Fl_Widget *w, void *d)
 
 	if (active_modem->get_mode() == MODE_RTTY)
 		progStatus.VIEWER_rttysquelch = progStatus.squelch_value;
+	else if (active_modem->get_mode() == MODE_CW)
+		progStatus.VIEWER_cwsquelch = progStatus.squelch_value;
 	else
 		progStatus.VIEWER_psksquelch = progStatus.squelch_value;
 
@@ -5731,8 +5756,7 @@ int alt_btn_width = 2 * DEFAULT_SW;
 			}
 		}
 	}
-	if (!dxcc_is_open())
-		getMenuItem(COUNTRIES_MLABEL)->hide();
+	update_countries_menu();
 
 	toggle_smeter();
 
@@ -6688,12 +6712,16 @@ void disp_rx_processed_char(void)
 void put_rx_char(unsigned int data, int style)
 {
 #if BENCHMARK_MODE
-	if (!benchmark.output.empty()) {
+	if (benchmark.batching)
+		benchmark_put_char(data);
+	else if (!benchmark.output.empty() || benchmark.replay) {
 		if (unlikely(benchmark.buffer.length() + 16 > benchmark.buffer.capacity()))
 			benchmark.buffer.reserve(benchmark.buffer.capacity() + BUFSIZ);
 		benchmark.buffer += (char)data;
 	}
 #else
+	rxlat_char();
+
 	if (progdefaults.autoextract == true)
 		rx_extract_add(data);
 
@@ -6845,9 +6873,19 @@ void put_MODEstatus(trx_mode mode)
 }
 
 
-void put_rx_data(int *data, int len)
+// Called once per group of received Hellschreiber columns
+void put_rx_data(const image_sink& sink, int from, int to)
 {
- 	FHdisp->data(data, len);
+	int len = sink.row_bytes();
+	int col[len];
+	for (from -= from % len; from < to; from += len) {
+		const unsigned char* data = sink.at(from);
+		if (!data)
+			break;
+		for (int i = 0; i < len; i++)
+			col[i] = data[i];
+		FHdisp->data(col, len);
+	}
 }
 
 bool idling = false;
@@ -45,6 +45,7 @@ using namespace std;
 #include "fontdef.h"
 #include "confdialog.h"
 #include "qrunner.h"
+#include "image_sink.h"
 #include "status.h"
 #include "debug.h"
 
@@ -66,6 +67,10 @@ void feld::tx_init(SoundBase *sc)
 	return;
 }
 
+// Received columns, both halves of col_data, handed over to the display in pairs
+static image_sink rx_sink(put_rx_data, 2, false);
+static int rx_columns = 0;
+
 void feld::rx_init()
 {
 	rxcounter = 0.0;
@@ -73,6 +78,8 @@ void feld::rx_init()
 	for (int i = 0; i < 2*RxColumnLen; i++ )
 		col_data[i] = 0;
 	col_pointer = 0;
+	rx_sink.reset(2 * RxColumnLen, 1);
+	rx_columns = 0;
 	peakhold = 0.0;
 	minhold = 1.0;
 	agc = 0.0;
@@ -227,6 +234,22 @@ cmplx feld::mixer(cmplx in)
 	return z;
 }
 
+// Adds the column to the display, twice unless half width is selected
+void feld::put_rx_column(void)
+{
+	// positions restart from zero once the display has caught up
+	if (rx_columns >= (1 << 20) && rx_sink.idle()) {
+		rx_sink.reset(2 * RxColumnLen, 1);
+		rx_columns = 0;
+	}
+	for (int n = halfwidth ? 1 : 2; n > 0; n--) {
+		unsigned char* p = rx_sink.row(rx_columns);
+		for (int i = 0; i < 2 * RxColumnLen; i++)
+			p[i] = col_data[i];
+		rx_sink.commit(++rx_columns * 2 * RxColumnLen);
+	}
+}
+
 void feld::FSKHELL_rx(cmplx z)
 {
 	double f;
@@ -262,11 +285,8 @@ void feld::FSKHELL_rx(cmplx z)
 	col_data[col_pointer + RxColumnLen] = (int)(vid * 255.0);
 	col_pointer++;
 	if (col_pointer == RxColumnLen) {
-		if (metric > progStatus.sldrSquelchValue || progStatus.sqlonoff == false) {
-			REQ(put_rx_data, col_data, col_data.size());
-			if (!halfwidth)
-				REQ(put_rx_data, col_data, col_data.size());
-		}
+		if (metric > progStatus.sldrSquelchValue || progStatus.sqlonoff == false)
+			put_rx_column();
 		col_pointer = 0;
 		for (int i = 0; i < RxColumnLen; i++)
 			col_data[i] = col_data[i + RxColumnLen];
@@ -310,11 +330,8 @@ void feld::rx(cmplx z)
 	col_data[col_pointer + RxColumnLen] = (int)x;
 	col_pointer++;
 	if (col_pointer == RxColumnLen) {
-		if (metric > progStatus.sldrSquelchValue || progStatus.sqlonoff == false) {
-			REQ(put_rx_data, col_data, col_data.size());
-			if (!halfwidth)
-				REQ(put_rx_data, col_data, col_data.size());
-		}
+		if (metric > progStatus.sldrSquelchValue || progStatus.sqlonoff == false)
+			put_rx_column();
 		col_pointer = 0;
 		for (int i = 0; i < RxColumnLen; i++)
 			col_data[i] = col_data[i + RxColumnLen];
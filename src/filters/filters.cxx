@@ -46,13 +46,18 @@
 C_FIR_filter::C_FIR_filter () {
 	pointer = counter = length = 0;
 	decimateratio = 0;
-	ifilter = qfilter = (double *)0;
+	ifilter = qfilter = cfilter = (double *)0;
+	buffer = (cmplx *)0;
+	rbuffer = (double *)0;
 	ffreq = 0.0;
 }
 
 C_FIR_filter::~C_FIR_filter() {
 	if (ifilter) delete [] ifilter;
 	if (qfilter) delete [] qfilter;
+	if (cfilter) delete [] cfilter;
+	if (buffer) delete [] buffer;
+	if (rbuffer) delete [] rbuffer;
 }
 
 void C_FIR_filter::init(int len, int dec, double *itaps, double *qtaps) {
@@ -66,9 +71,19 @@ void C_FIR_filter::init(int len, int dec, double *itaps, double *qtaps) {
 		delete [] qfilter;
 		qfilter = (double *)0;
 	}
-
-	for (int i = 0; i < FIRBufferLen; i++)
-		ibuffer[i] = qbuffer[i] = 0.0;
+	if (cfilter) {
+		delete [] cfilter;
+		cfilter = (double *)0;
+	}
+	if (buffer) delete [] buffer;
+	if (rbuffer) delete [] rbuffer;
+
+	buffer = new cmplx[2 * len];
+	rbuffer = new double[2 * len];
+	for (int i = 0; i < 2 * len; i++) {
+		buffer[i] = cmplx(0.0, 0.0);
+		rbuffer[i] = 0.0;
+	}
 	
 	if (itaps) {
             ifilter = new double[len];
@@ -78,8 +93,15 @@ void C_FIR_filter::init(int len, int dec, double *itaps, double *qtaps) {
 		qfilter = new double[len];
 		for (int i = 0; i < len; i++) qfilter[i] = qtaps[i];
 	}
+	if (itaps && qtaps) {
+		cfilter = new double[2 * len];
+		for (int i = 0; i < len; i++) {
+			cfilter[2 * i] = itaps[i];
+			cfilter[2 * i + 1] = qtaps[i];
+		}
+	}
 
-	pointer = len;
+	pointer = 0;
 	counter = 0;
 }
 
@@ -163,27 +185,22 @@ void C_FIR_filter::init_hilbert (int len, int dec) {
 // passes a cmplx value (in) and receives the cmplx value (out)
 // function returns 0 if the filter is not yet stable
 // returns 1 when stable and decimated cmplx output value is valid
+//
+// The taps are only applied for the samples that are kept; the output
+// is that of the length samples before in.
 //=====================================================================
 
 int C_FIR_filter::run (const cmplx &in, cmplx &out) {
-	ibuffer[pointer] = in.real();
-	qbuffer[pointer] = in.imag();
-	counter++;
-	if (counter == decimateratio)
-		out = cmplx (	mac(&ibuffer[pointer - length], ifilter, length),
-						mac(&qbuffer[pointer - length], qfilter, length) );
-	pointer++;
-	if (pointer == FIRBufferLen) {
-		/// memmove is necessary if length >= FIRBufferLen/2 , theoretically possible.
-		memmove (ibuffer, ibuffer + FIRBufferLen - length, length * sizeof (double) );
-		memmove (qbuffer, qbuffer + FIRBufferLen - length, length * sizeof (double) );
-		pointer = length;
-	}
-	if (counter == decimateratio) {
+	int ret = 0;
+	if (++counter == decimateratio) {
+		out = mac(buffer + pointer, cfilter, length);
 		counter = 0;
-		return 1;
+		ret = 1;
 	}
-	return 0;
+	buffer[pointer] = buffer[pointer + length] = in;
+	if (++pointer == length)
+		pointer = 0;
+	return ret;
 }
 
 //=====================================================================
@@ -191,29 +208,16 @@ int C_FIR_filter::run (const cmplx &in, cmplx &out) {
 //=====================================================================
 
 int C_FIR_filter::Irun (const double &in, double &out) {
-	double *iptr = ibuffer + pointer;
-
-	pointer++;
-	counter++;
-
-	*iptr = in;
-
-	if (counter == decimateratio) {
-		out = mac(iptr - length, ifilter, length);
-	}
-
-	if (pointer == FIRBufferLen) {
-		iptr = ibuffer + FIRBufferLen - length;
-		memcpy(ibuffer, iptr, length * sizeof(double));
-		pointer = length;
-	}
-
-	if (counter == decimateratio) {
+	int ret = 0;
+	if (++counter == decimateratio) {
+		out = mac(rbuffer + pointer, ifilter, length);
 		counter = 0;
-		return 1;
+		ret = 1;
 	}
-
-	return 0;
+	rbuffer[pointer] = rbuffer[pointer + length] = in;
+	if (++pointer == length)
+		pointer = 0;
+	return ret;
 }
 
 //=====================================================================
@@ -221,32 +225,18 @@ int C_FIR_filter::Irun (const double &in, double &out) {
 //=====================================================================
 
 int C_FIR_filter::Qrun (const double &in, double &out) {
-	double *qptr = ibuffer + pointer;
-
-	pointer++;
-	counter++;
-
-	*qptr = in;
-
-	if (counter == decimateratio) {
-		out = mac(qptr - length, qfilter, length);
-	}
-
-	if (pointer == FIRBufferLen) {
-		qptr = qbuffer + FIRBufferLen - length;
-		memcpy(qbuffer, qptr, length * sizeof(double));
-		pointer = length;
-	}
-
-	if (counter == decimateratio) {
+	int ret = 0;
+	if (++counter == decimateratio) {
+		out = mac(rbuffer + pointer, qfilter, length);
 		counter = 0;
-		return 1;
+		ret = 1;
 	}
-
-	return 0;
+	rbuffer[pointer] = rbuffer[pointer + length] = in;
+	if (++pointer == length)
+		pointer = 0;
+	return ret;
 }
 
-
 //=====================================================================
 // Moving average filter
 //
@@ -28,10 +28,31 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#  define VITERBI_LANES 16
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#  define VITERBI_LANES 8
+#endif
 
 #include "viterbi.h"
 #include "misc.h"
 
+static inline void *align32(void *p)
+{
+	return (void *)(((uintptr_t)p + 31) & ~(uintptr_t)31);
+}
+
+// metric of the branch with output bits c, for the soft symbols a and b
+// less 128
+static inline int branch_metric(int c, int a, int b)
+{
+	return (c & 1 ? a : -a) + (c & 2 ? b : -b);
+}
+
 /* ---------------------------------------------------------------------- */
 viterbi::viterbi(int k, int poly1, int poly2)
 {
@@ -39,43 +60,56 @@ viterbi::viterbi(int k, int poly1, int poly2)
 	_traceback = PATHMEM - 1;
 	_chunksize = 8;
 	nstates = 1 << (k - 1);
-	
+	int half = nstates / 2;
+
 	output = new int[outsize];
-	
+
 	for (int i = 0; i < outsize; i++) {
 		output[i] = parity(poly1 & i) | (parity(poly2 & i) << 1);
 	}
-	
+// the outputs are linear in the state
+	upper_out = output[nstates];
+	odd_out = output[1];
+
+	metbuf = new short[2 * nstates + 2 * half + 16];
+	metrics[0] = (short *)align32(metbuf);
+	metrics[1] = metrics[0] + nstates;
+	sign[0] = metrics[1] + nstates;
+	sign[1] = sign[0] + half;
+	for (int j = 0; j < half; j++) {
+		sign[0][j] = (output[2 * j] & 1) ? 0 : -1;
+		sign[1][j] = (output[2 * j] & 2) ? 0 : -1;
+	}
+
+	histwords = (half + 15) / 16;
+	histbuf = new unsigned int[PATHMEM * histwords];
 	for (int i = 0; i < PATHMEM; i++) {
-		metrics[i] = new int[nstates];
-		history[i] = new int[nstates];
+		history[i] = histbuf + i * histwords;
 		sequence[i] = 0;
-		for (int j = 0; j < nstates; j++)
-			metrics[i][j] = history[i][j] = 0;
-	}
-	for (int i = 0; i < 256; i++) {
-		mettab[0][i] = 128 - i;
-		mettab[1][i] = i - 128;
+		symbols[i][0] = symbols[i][1] = 0;
 	}
+
+#ifdef VITERBI_LANES
+	vector = (half >= 16);
+#else
+	vector = false;
+#endif
 	reset();
 }
 
 viterbi::~viterbi()
 {
 	if (output) delete [] output;
-	for (int i = 0; i < PATHMEM; i++) {
-		if (metrics[i]) delete [] metrics[i];
-		if (history[i]) delete [] history[i];
-	}
+	delete [] metbuf;
+	delete [] histbuf;
 }
 
 void viterbi::reset()
 {
-	for (int i = 0; i < PATHMEM; i++) {
-		memset(metrics[i], 0, nstates * sizeof(int));
-		memset(history[i], 0, nstates * sizeof(int));
-	}
+	memset(metrics[0], 0, 2 * nstates * sizeof(short));
+	memset(histbuf, 0, PATHMEM * histwords * sizeof(*histbuf));
 	ptr = 0;
+	steps = 0;
 }
 
 int viterbi::settraceback(int trace) {
@@ -92,107 +126,252 @@ int viterbi::setchunksize(int chunk) {
 	return 0;
 }
 
+// Selects the vectorised or the plain add-compare-select.  Both decode the
+// same bits.
+int viterbi::setvector(bool on) {
+#ifdef VITERBI_LANES
+	if (on && nstates / 2 < 16)
+	return -1;
+	vector = on;
+	return 0;
+#else
+	if (on)
+	return -1;
+	return 0;
+#endif
+}
+
+// First state with the best metric
+static int best_state(const short *row, int n, bool vector)
+{
+#ifdef VITERBI_LANES
+	if (vector) {
+		__m128i m = _mm_load_si128((const __m128i *)row);
+		for (int i = 8; i < n; i += 8)
+			m = _mm_max_epi16(m, _mm_load_si128((const __m128i *)(row + i)));
+		m = _mm_max_epi16(m, _mm_srli_si128(m, 8));
+		m = _mm_max_epi16(m, _mm_srli_si128(m, 4));
+		m = _mm_max_epi16(m, _mm_srli_si128(m, 2));
+		__m128i top = _mm_set1_epi16((short)_mm_cvtsi128_si32(m));
+		for (int i = 0; i < n; i += 8) {
+			int eq = _mm_movemask_epi8(_mm_cmpeq_epi16(
+					_mm_load_si128((const __m128i *)(row + i)), top));
+			if (eq)
+				return i + (__builtin_ctz(eq) >> 1);
+		}
+	}
+#else
+	(void)vector;
+#endif
+	int best = 0;
+	for (int i = 1; i < n; i++)
+		if (row[i] > row[best])
+			best = i;
+	return best;
+}
+
+// The predecessor of state in row p.  Rows not written since the reset
+// lead to state 0.
+inline int viterbi::predecessor(unsigned int p, int state)
+{
+	if (steps < PATHMEM && (ptr - 1 - p) % PATHMEM >= steps)
+		return 0;
+	int j = state >> 1;
+	int bit = (history[p][j >> 4] >> ((j & 15) + 16 * (state & 1))) & 1;
+	return j + bit * (nstates / 2);
+}
+
+// Metric of the branch into state in row p
+int viterbi::branch(unsigned int p, int state)
+{
+	if ((ptr - 1 - p) % PATHMEM >= steps)
+		return 0;
+	int s = predecessor(p, state) >= nstates / 2 ? state | nstates : state;
+	return branch_metric(output[s], symbols[p][0], symbols[p][1]);
+}
+
 int viterbi::traceback(int *metric)
 {
-	int bestmetric, beststate;
 	unsigned int p, c = 0;
 
 	p = (ptr - 1) % PATHMEM;
 
-// Find the state with the best metric
-	bestmetric = INT_MIN;
-	beststate = 0;
-
-	for (int i = 0; i < nstates; i++) {
-		if (metrics[p][i] > bestmetric) {
-			bestmetric = metrics[p][i];
-			beststate = i;
-		}
-	}
-
-// Trace back 'traceback' steps, starting from the best state
-	sequence[p] = beststate;
+// Start from the state with the best metric
+	sequence[p] = best_state(metrics[p & 1], nstates, vector);
 
+// Trace back 'traceback' steps
 	for (int i = 0; i < _traceback; i++) {
 		unsigned int prev = (p - 1) % PATHMEM;
 
-		sequence[prev] = history[p][sequence[p]];
+		sequence[prev] = predecessor(p, sequence[p]);
 		p = prev;
 	}
 
+// Decode 'chunksize' bits.  The metric of the decoded path is the sum of
+// its branch metrics.
 	if (metric)
-		*metric = metrics[p][sequence[p]];
-
-// Decode 'chunksize' bits
+		*metric = 0;
 	for (int i = 0; i < _chunksize; i++) {
 // low bit of state is the previous input bit
 		c = (c << 1) | (sequence[p] & 1);
 		p = (p + 1) % PATHMEM;
+		if (metric)
+			*metric += branch(p, sequence[p]);
 	}
 
-	if (metric)
-		*metric = metrics[p][sequence[p]] - *metric;
-
 	return c;
 }
 
-int viterbi::decode(unsigned char *sym, int *metric)
+// Butterfly j: states j and j + nstates / 2 lead to states 2j and 2j + 1.
+// Ties go to the upper predecessor.
+void viterbi::acs(const short *prev, short *curr, unsigned int *dec, int a, int b)
 {
-	unsigned int currptr, prevptr;
-	int met[4];
-	
-	currptr = ptr;
-	prevptr = (currptr - 1) % PATHMEM;
-//	if (prevptr < 0) prevptr = PATHMEM - 1;
-
-	met[0] = mettab[0][sym[1]] + mettab[0][sym[0]];
-	met[1] = mettab[0][sym[1]] + mettab[1][sym[0]];
-	met[2] = mettab[1][sym[1]] + mettab[0][sym[0]];
-	met[3] = mettab[1][sym[1]] + mettab[1][sym[0]];
-
-//	met[0] = 256 - sym[1] - sym[0];
-//	met[1] = sym[0] - sym[1];
-//	met[2] = sym[1] - sym[0];
-//	met[3] = sym[0] + sym[1] - 256;
-
-	for (int n = 0; n < nstates; n++) {
-		int p0, p1, s0, s1, m0, m1;
-
-		m0 = 0;
-		m1 = 0;
-		s0 = n;
-		s1 = n + nstates;
-
-		p0 = s0 >> 1;
-		p1 = s1 >> 1;
-
-		m0 = metrics[prevptr][p0] + met[output[s0]];
-		m1 = metrics[prevptr][p1] + met[output[s1]];
-
-		if (m0 > m1) {
-			metrics[currptr][n] = m0;
-			history[currptr][n] = p0;
-		} else {
-			metrics[currptr][n] = m1;
-			history[currptr][n] = p1;
+	int half = nstates / 2;
+	int norm = prev[0];
+
+	memset(dec, 0, histwords * sizeof(*dec));
+	for (int j = 0; j < half; j++) {
+		int c = output[2 * j];
+		int p0 = prev[j] - norm, p1 = prev[j + half] - norm;
+		int m0, m1;
+
+		m0 = p0 + branch_metric(c, a, b);
+		m1 = p1 + branch_metric(c ^ upper_out, a, b);
+		if (m0 > m1)
+			curr[2 * j] = m0;
+		else {
+			curr[2 * j] = m1;
+			dec[j >> 4] |= 1U << (j & 15);
+		}
+
+		m0 = p0 + branch_metric(c ^ odd_out, a, b);
+		m1 = p1 + branch_metric(c ^ odd_out ^ upper_out, a, b);
+		if (m0 > m1)
+			curr[2 * j + 1] = m0;
+		else {
+			curr[2 * j + 1] = m1;
+			dec[j >> 4] |= 1U << ((j & 15) + 16);
 		}
 	}
+}
 
-	ptr = (ptr + 1) % PATHMEM;
+#if VITERBI_LANES == 16
 
-	if ((ptr % _chunksize) == 0)
-		return traceback(metric);
+#define VLOAD(p)	_mm256_load_si256((const __m256i *)(p))
+#define VMASK(c, bit)	_mm256_set1_epi16((c) & (bit) ? -1 : 0)
+// (x ^ s) - s is x or -x
+#define VSIGN(x, s)	_mm256_sub_epi16(_mm256_xor_si256(x, s), s)
+#define VBM(ta, tb, s0, s1)	_mm256_add_epi16(VSIGN(ta, s0), VSIGN(tb, s1))
 
-	if (metrics[currptr][0] > INT_MAX / 2) {
-		for (int i = 0; i < PATHMEM; i++)
-			for (int j = 0; j < nstates; j++)
-				metrics[i][j] -= INT_MAX / 2;
+void viterbi::acs_vector(const short *prev, short *curr, unsigned int *dec, int a, int b)
+{
+	int half = nstates / 2;
+	__m256i A = _mm256_set1_epi16(a), B = _mm256_set1_epi16(b);
+	__m256i norm = _mm256_set1_epi16(prev[0]);
+	__m256i u0 = VMASK(upper_out, 1), u1 = VMASK(upper_out, 2);
+	__m256i o0 = VMASK(odd_out, 1), o1 = VMASK(odd_out, 2);
+	__m256i ou0 = VMASK(odd_out ^ upper_out, 1), ou1 = VMASK(odd_out ^ upper_out, 2);
+
+	for (int j = 0; j < half; j += 16) {
+		__m256i p0 = _mm256_sub_epi16(VLOAD(prev + j), norm);
+		__m256i p1 = _mm256_sub_epi16(VLOAD(prev + j + half), norm);
+		__m256i ta = VSIGN(A, VLOAD(sign[0] + j));
+		__m256i tb = VSIGN(B, VLOAD(sign[1] + j));
+
+		__m256i e0 = _mm256_add_epi16(p0, _mm256_add_epi16(ta, tb));
+		__m256i e1 = _mm256_add_epi16(p1, VBM(ta, tb, u0, u1));
+		__m256i d0 = _mm256_add_epi16(p0, VBM(ta, tb, o0, o1));
+		__m256i d1 = _mm256_add_epi16(p1, VBM(ta, tb, ou0, ou1));
+
+		__m256i even = _mm256_max_epi16(e0, e1);
+		__m256i odd = _mm256_max_epi16(d0, d1);
+		__m256i lo = _mm256_unpacklo_epi16(even, odd);
+		__m256i hi = _mm256_unpackhi_epi16(even, odd);
+		_mm256_store_si256((__m256i *)(curr + 2 * j), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_store_si256((__m256i *)(curr + 2 * j + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+
+		unsigned int me = _mm256_movemask_epi8(_mm256_packs_epi16(
+					_mm256_cmpgt_epi16(e0, e1), _mm256_cmpgt_epi16(d0, d1)));
+// bytes 0-7 and 16-23 are the even states, 8-15 and 24-31 the odd ones
+		unsigned int sel = (me & 0xff) | ((me >> 8) & 0xff00) |
+			((me << 8) & 0xff0000) | (me & 0xff000000);
+		dec[j >> 4] = ~sel;
 	}
-	if (metrics[currptr][0] < INT_MIN / 2) {
-		for (int i = 0; i < PATHMEM; i++)
-			for (int j = 0; j < nstates; j++)
-				metrics[i][j] += INT_MIN / 2;
+}
+
+#elif VITERBI_LANES == 8
+
+#define VLOAD(p)	_mm_load_si128((const __m128i *)(p))
+#define VMASK(c, bit)	_mm_set1_epi16((c) & (bit) ? -1 : 0)
+// (x ^ s) - s is x or -x
+#define VSIGN(x, s)	_mm_sub_epi16(_mm_xor_si128(x, s), s)
+#define VBM(ta, tb, s0, s1)	_mm_add_epi16(VSIGN(ta, s0), VSIGN(tb, s1))
+
+void viterbi::acs_vector(const short *prev, short *curr, unsigned int *dec, int a, int b)
+{
+	int half = nstates / 2;
+	__m128i A = _mm_set1_epi16(a), B = _mm_set1_epi16(b);
+	__m128i norm = _mm_set1_epi16(prev[0]);
+	__m128i u0 = VMASK(upper_out, 1), u1 = VMASK(upper_out, 2);
+	__m128i o0 = VMASK(odd_out, 1), o1 = VMASK(odd_out, 2);
+	__m128i ou0 = VMASK(odd_out ^ upper_out, 1), ou1 = VMASK(odd_out ^ upper_out, 2);
+
+	for (int j = 0; j < half; j += 16) {
+		__m128i ce[2], co[2];
+		for (int h = 0; h < 2; h++) {
+			int i = j + 8 * h;
+			__m128i p0 = _mm_sub_epi16(VLOAD(prev + i), norm);
+			__m128i p1 = _mm_sub_epi16(VLOAD(prev + i + half), norm);
+			__m128i ta = VSIGN(A, VLOAD(sign[0] + i));
+			__m128i tb = VSIGN(B, VLOAD(sign[1] + i));
+
+			__m128i e0 = _mm_add_epi16(p0, _mm_add_epi16(ta, tb));
+			__m128i e1 = _mm_add_epi16(p1, VBM(ta, tb, u0, u1));
+			__m128i d0 = _mm_add_epi16(p0, VBM(ta, tb, o0, o1));
+			__m128i d1 = _mm_add_epi16(p1, VBM(ta, tb, ou0, ou1));
+
+			__m128i even = _mm_max_epi16(e0, e1);
+			__m128i odd = _mm_max_epi16(d0, d1);
+			_mm_store_si128((__m128i *)(curr + 2 * i), _mm_unpacklo_epi16(even, odd));
+			_mm_store_si128((__m128i *)(curr + 2 * i + 8), _mm_unpackhi_epi16(even, odd));
+			ce[h] = _mm_cmpgt_epi16(e0, e1);
+			co[h] = _mm_cmpgt_epi16(d0, d1);
+		}
+		unsigned int even = _mm_movemask_epi8(_mm_packs_epi16(ce[0], ce[1]));
+		unsigned int odd = _mm_movemask_epi8(_mm_packs_epi16(co[0], co[1]));
+		dec[j >> 4] = ~(even | (odd << 16));
 	}
+}
+
+#else
+
+void viterbi::acs_vector(const short *prev, short *curr, unsigned int *dec, int a, int b)
+{
+	acs(prev, curr, dec, a, b);
+}
+
+#endif
+
+int viterbi::decode(unsigned char *sym, int *metric)
+{
+	unsigned int currptr = ptr;
+	int a = sym[0] - 128, b = sym[1] - 128;
+
+	symbols[currptr][0] = a;
+	symbols[currptr][1] = b;
+
+// the rows of metrics alternate
+	if (vector)
+		acs_vector(metrics[~currptr & 1], metrics[currptr & 1], history[currptr], a, b);
+	else
+		acs(metrics[~currptr & 1], metrics[currptr & 1], history[currptr], a, b);
+	if (steps < PATHMEM)
+		steps++;
+
+	ptr = (ptr + 1) % PATHMEM;
+
+	if ((ptr % _chunksize) == 0)
+		return traceback(metric);
 
 	return -1;
 }
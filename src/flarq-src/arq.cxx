@@ -23,6 +23,7 @@
 #include <sys/time.h>
 
 #include <iostream>
+#include <cmath>
 
 #include "arq.h"
 
@@ -90,8 +91,9 @@ arq::arq()
 
 	SessionNumber = 0;
 	
-	exponent = EXPONENT;
+	exponent = baseExponent = EXPONENT;
 	maxheaders = MAXHEADERS;
+	adaptive = true;
 	RetryTime = RETRYTIME;
 	Retries = RETRIES;
 	Timeout = TIMEOUT;
@@ -100,7 +102,9 @@ arq::arq()
 	primary = false;
 
 	setBufferlength();
-	
+	resetLink();
+	NoticeQueue.clear();
+	inNotice = false;
 
 // status variables //
 //	totalRx = 0;
@@ -132,7 +136,8 @@ arq::arq()
 	MyMissing.clear();
 	MissingRxBlocks = "";
 	
-	TxBlocks.clear();
+	clearUnsent();
+	Bytes2Send = 0;
 	TxMissing.clear();
 	TxPending.clear();
 
@@ -166,7 +171,8 @@ void arq::resetTx()
 	LastHeader = MAXCOUNT - 1;		// Last Header I sent last turn
 	Lastqueued = MAXCOUNT - 1;		// Last Header in static send queue
 	TxMissing.clear();
-	TxBlocks.clear();
+	clearUnsent();
+	turnOpen = false;
 	TxPending.clear();
 	TxTextQueue.clear();
 //	UrMissing.clear();
@@ -183,6 +189,31 @@ void arq::resetRx()
 	MissingRxBlocks = "";
 }
 
+// A new link starts with the configured block length and forgets the
+// statistics of the previous one
+void arq::resetLink()
+{
+	exponent = baseExponent;
+	setBufferlength();
+// start with one turn at the error rate for which the configured block
+// length is about the best
+	charerr = 1.0 * FRAME_OVERHEAD / (Bufferlength * Bufferlength);
+	sentAvg = maxheaders;
+	charsAvg = sentAvg * (Bufferlength + FRAME_OVERHEAD);
+	lostAvg = sentAvg * (1.0 - pow(1.0 - charerr, Bufferlength + FRAME_OVERHEAD));
+	window = maxheaders;
+	turnOpen = false;
+	s2nvalid = false;
+	s2n = s2nref = 0.0;
+
+	busyTicks = 0;
+	bytesAcked = 0;
+	blocksSent = 0;
+	blocksRepeated = 0;
+	turns = 0;
+	pollRetries = 0;
+}
+
 void arq::reset()
 {
 	resetTx();
@@ -670,6 +701,7 @@ void arq::parseCONREQ()
 	}
 		
 	reset();
+	resetLink();
 
 	LinkState = WAITFORACK;
 	newsession();
@@ -730,7 +762,7 @@ void arq::parseDISREQ()
 	if (LinkState == DOWN) return;
 	TxTextQueue.clear();//erase();
 	TxMissing.clear();
-	TxBlocks.clear();
+	clearUnsent();
 	TxPlainTextQueue.clear();
 	disackFrame();
 	immediate = true;
@@ -801,15 +833,17 @@ void arq::parseSTATUS()
 // append those not reported missing from UrEndHeader to LastHeader
 		if (UrEndHeader != LastHeader) {
 			int m = UrEndHeader + 1;
-			if (m > MAXCOUNT) m -= MAXCOUNT;
+			if (m >= MAXCOUNT) m -= MAXCOUNT;
 			while (m != LastHeader) {
 				missing.push_back(m);
 				m++;
-				if (m > MAXCOUNT) m -= MAXCOUNT;
+				if (m >= MAXCOUNT) m -= MAXCOUNT;
 			}
 			missing.push_back(LastHeader);
 		}
 	
+		measureTurn(missing);
+
 		if (missing.empty())
 			TxMissing.clear();		
 		
@@ -834,6 +868,7 @@ void arq::parseSTATUS()
 
 	p1 = TxPending.begin();
 	while (p1 != TxPending.end()) {
+		bytesAcked += p1->text().length();
 		if(p1->nbr() == UrGoodHeader) {
 			if (printTX) printTX(p1->text());
 			TxPending.erase(p1);
@@ -1115,8 +1150,45 @@ int arq::parseFrame(string txt)
 }
 
 
+// <DC2> notices from the modem, e.g. "<DC2><s2n: CC, A.a, D.d>\n", are
+// taken out of the character stream
+void arq::parseNotice()
+{
+	double count, avg, stddev;
+	if (sscanf(NoticeQueue.c_str(), "<s2n: %lf, %lf, %lf>", &count, &avg, &stddev) != 3)
+		return;
+	s2n = avg;
+	if (!s2nvalid) {
+		s2nref = s2n;
+		s2nvalid = true;
+		return;
+	}
+// a fade that the block counts have not seen yet: halve the block length
+// for the next turn
+	if (adaptive && s2n < s2nref - S2N_FADE && exponent > EXPONENT_MIN) {
+		exponent--;
+		setBufferlength();
+		s2nref = s2n;
+	} else
+		s2nref += (s2n - s2nref) / ERRAVERAGE;
+}
+
 void arq::rcvChar( char c )
 {
+	if (inNotice) {
+		if (c == '\n' || NoticeQueue.length() > 64) {
+			parseNotice();
+			NoticeQueue.clear();
+			inNotice = false;
+		} else
+			NoticeQueue += c;
+		return;
+	}
+	if (c == 0x12) {
+		inNotice = true;
+		return;
+	}
+
 	if ( c == 0x06 ) {
 		Sending = 0;
 		retrytime = rtry();
@@ -1148,21 +1220,26 @@ void arq::rcvChar( char c )
 
 //=====================================================================
 
+// Text is cut into blocks as they are sent, with the block length of
+// the time
 void arq::sendText (string txt)
 {
-	size_t offset = 0;
-	cTxtBlk tempblk;
 	if (LinkState < CONNECTED) return;
-	
-	Blocks2Send = 0;
-	while (offset < txt.length()) {
-		newblocknumber();
-		tempblk.nbr(Lastqueued);
-		tempblk.text(txt.substr(offset, Bufferlength));
-		offset += Bufferlength;
-		TxBlocks.push_back(tempblk);
-		Blocks2Send++;
+
+	if (UnsentPos) {
+		TxUnsent.erase(0, UnsentPos);
+		UnsentPos = 0;
 	}
+	TxUnsent.append(txt);
+	Bytes2Send = bytesPending();
+}
+
+size_t arq::bytesPending()
+{
+	size_t n = TxUnsent.length() - UnsentPos;
+	for (list<cTxtBlk>::iterator p = TxMissing.begin(); p != TxMissing.end(); p++)
+		n += p->text().length();
+	return n;
 }
 
 void arq::sendblocks()
@@ -1181,30 +1258,112 @@ void arq::sendblocks()
 		}
 	}
 	missedblks = framecount;
-	if (!TxBlocks.empty()) {
-		while (TxBlocks.empty() == false && framecount < maxheaders) {
-			tempblk = TxBlocks.front();
-			if ((tempblk.nbr() + 2)%MAXCOUNT == UrGoodHeader)
-				break;
-			TxBlocks.pop_front();
-			TxMissing.push_back(tempblk);
-			TxPending.push_back(tempblk);
-			textFrame(tempblk);
-			LastHeader = tempblk.nbr();
-			framecount++;
-		}
+	while (unsent() && framecount < window) {
+		if ((Lastqueued + 1 + 2)%MAXCOUNT == UrGoodHeader)
+			break;
+		newblocknumber();
+		tempblk.nbr(Lastqueued);
+		tempblk.text(TxUnsent.substr(UnsentPos, Bufferlength));
+		UnsentPos += tempblk.text().length();
+		TxMissing.push_back(tempblk);
+		TxPending.push_back(tempblk);
+		textFrame(tempblk);
+		LastHeader = tempblk.nbr();
+		framecount++;
 	}
+	if (!unsent())
+		clearUnsent();
 	newblks = framecount - missedblks;
-	snprintf(szStatus, sizeof(szStatus),"TX: repeat %d new %d",
-		missedblks, newblks);
+	blocksSent += framecount;
+	blocksRepeated += missedblks;
+	if (framecount) {
+		turns++;
+		turnOpen = true;
+	}
+	snprintf(szStatus, sizeof(szStatus),"TX: repeat %d new %d (%d)",
+		missedblks, newblks, Bufferlength);
 	printSTATUS(szStatus, 0.0);
 
-	if (!TxMissing.empty() || !TxBlocks.empty())
+	if (!TxMissing.empty() || unsent())
 		pollFrame();
 
 	if (LinkState != ABORT && LinkState != ABORTING)
 		LinkState = WAITING;
 }
+
+// The first status report after a turn tells which of its blocks were
+// lost.  A block is lost when any of its characters is, so the fraction
+// f of lost blocks of average frame length L gives the character error
+// rate p = 1 - (1 - f)^(1/L).  The counts of the last few turns are
+// pooled, so that the short last turn of a transfer weighs little.
+void arq::measureTurn(const vector<int>& missing)
+{
+	if (!turnOpen || TxMissing.empty())
+		return;
+	turnOpen = false;
+
+	int sent = 0, lost = 0;
+	size_t chars = 0;
+	for (list<cTxtBlk>::iterator p = TxMissing.begin(); p != TxMissing.end(); p++) {
+		sent++;
+		chars += p->text().length() + FRAME_OVERHEAD;
+		for (size_t n = 0; n < missing.size(); n++)
+			if (p->nbr() == missing[n]) {
+				lost++;
+				break;
+			}
+	}
+
+	double keep = 1.0 - 1.0 / ERRAVERAGE;
+	sentAvg = sentAvg * keep + sent;
+	lostAvg = lostAvg * keep + lost;
+	charsAvg = charsAvg * keep + chars;
+
+	double f = lostAvg / sentAvg;
+	if (f > 0.95) f = 0.95;
+	charerr = 1.0 - pow(1.0 - f, sentAvg / charsAvg);
+
+	adaptBlocks();
+}
+
+// A frame of payload L gets through with probability (1 - p)^(L + H),
+// which makes the payload throughput L (1 - p)^(L + H) / (L + H).  The
+// window keeps about the configured number of bytes in each turn, so that
+// the turn around time costs the same share of the airtime.
+void arq::adaptBlocks()
+{
+	if (!adaptive)
+		return;
+
+	double best = 0.0;
+	int bestexp = exponent;
+	for (int e = EXPONENT_MIN; e <= EXPONENT_MAX; e++) {
+		int len = 1 << e;
+		double tput = len * pow(1.0 - charerr, len + FRAME_OVERHEAD) / (len + FRAME_OVERHEAD);
+		if (tput > best) {
+			best = tput;
+			bestexp = e;
+		}
+	}
+	exponent = bestexp;
+	setBufferlength();
+
+	window = maxheaders << baseExponent >> exponent;
+	if (window < 2) window = 2;
+	if (window > MAXWINDOW) window = MAXWINDOW;
+}
+
+string arq::statistics()
+{
+	char szStats[200];
+	snprintf(szStats, sizeof(szStats),
+		"%lu bytes in %.0f sec, %.1f cps; %d turns, %d blocks, %d repeated, "
+		"%d poll retries; block %d x %d, char errors %.2g",
+		(unsigned long)bytesAcked, busyTicks * ARQLOOPTIME / 1000.0, goodput(),
+		turns, blocksSent, blocksRepeated, pollRetries,
+		window, Bufferlength, charerr);
+	return szStats;
+}
 	
 void arq::connect(string callsign)
 {
@@ -1214,6 +1373,7 @@ void arq::connect(string callsign)
 
 	if (rxUrCall) rxUrCall(UrCall);
 	TxTextQueue.clear();
+	resetLink();
 	connectFrame();
 	LinkState = CONNECTING;
 	immediate = true;
@@ -1285,167 +1445,179 @@ int arq::rtry()
 
 //---------------------------------------------------------------------
 
-void arqloop(void *who)
+// one ARQLOOPTIME tick of the link
+void arq::step()
 {
-	arq *me = (arq *)who;
 	char c;
-		
+
+	if (!transferComplete())
+		busyTicks++;
+
 // check for received chars including 0x06 for Sending = 0
-	if (me->getc1(c) == true) {
-		me->rcvChar(c);
-		while (me->getc1(c) == true)
-			me->rcvChar(c);
-		if (me->tx2txdelay < me->TxDelay / ARQLOOPTIME)
-			me->tx2txdelay = me->TxDelay / ARQLOOPTIME;
+	if (getc1(c) == true) {
+		rcvChar(c);
+		while (getc1(c) == true)
+			rcvChar(c);
+		if (tx2txdelay < TxDelay / ARQLOOPTIME)
+			tx2txdelay = TxDelay / ARQLOOPTIME;
 	}
-	if (me->Sending == 0) { // not transmitting
+	if (Sending == 0) { // not transmitting
 // wait period between transmits
-		if (me->tx2txdelay > 0) {
-			me->tx2txdelay--;
+		if (tx2txdelay > 0) {
+			tx2txdelay--;
 		} else {
-			if (me->immediate == true) {
-				me->transmitdata();
-				me->retrytime = me->rtry();
-				me->retries = me->Retries;
-				me->immediate = false;
+			if (immediate == true) {
+				transmitdata();
+				retrytime = rtry();
+				retries = Retries;
+				immediate = false;
 			} else {
-				switch (me->LinkState) {
+				switch (LinkState) {
 				case  CONNECTING :
 					break;
 				case  DISCONNECT :
-					me->LinkState = DISCONNECTING;
-					me->TxTextQueue.clear();
-					me->TxMissing.clear();
-					me->TxBlocks.clear();
-					me->TxPlainTextQueue.clear();
-					me->disconnectFrame();
-					me->immediate = true;
+					LinkState = DISCONNECTING;
+					TxTextQueue.clear();
+					TxMissing.clear();
+					clearUnsent();
+					TxPlainTextQueue.clear();
+					disconnectFrame();
+					immediate = true;
 					break;				
 				case  DISCONNECTING :
-					if (me->retrytime-- == 0) {
-						me->retrytime = me->rtry();
-						if (--me->retries) {
-							me->TxTextQueue.clear();
-							me->TxMissing.clear();
-							me->TxBlocks.clear();
-							me->TxPlainTextQueue.clear();
-							me->disconnectFrame();
-							me->transmitdata();
-							me->timeout = me->Timeout / ARQLOOPTIME;
+					if (retrytime-- == 0) {
+						retrytime = rtry();
+						if (--retries) {
+							TxTextQueue.clear();
+							TxMissing.clear();
+							clearUnsent();
+							TxPlainTextQueue.clear();
+							disconnectFrame();
+							transmitdata();
+							timeout = Timeout / ARQLOOPTIME;
 						}
 					}
 					break;
 				case ABORT :
-					me->LinkState = ABORTING;
-					me->TxTextQueue.clear();
-					me->TxMissing.clear();
-					me->TxBlocks.clear();
-					me->TxPlainTextQueue.clear();
-					me->tx2txdelay = 5000/ ARQLOOPTIME; // 5 sec delay for abort
-					me->abortFrame();
-					me->immediate = true;
+					LinkState = ABORTING;
+					TxTextQueue.clear();
+					TxMissing.clear();
+					clearUnsent();
+					TxPlainTextQueue.clear();
+					tx2txdelay = 5000/ ARQLOOPTIME; // 5 sec delay for abort
+					abortFrame();
+					immediate = true;
 					break;
 				case ABORTING :
-					if (--me->retrytime == 0) {
-						me->retrytime = me->rtry();
-						if (me->retries--) {
-							me->TxTextQueue.clear();
-							me->TxMissing.clear();
-							me->TxBlocks.clear();
-							me->TxPlainTextQueue.clear();
-							me->abortFrame();
-							me->transmitdata();
-							me->timeout = me->Timeout / ARQLOOPTIME;
+					if (--retrytime == 0) {
+						retrytime = rtry();
+						if (retries--) {
+							TxTextQueue.clear();
+							TxMissing.clear();
+							clearUnsent();
+							TxPlainTextQueue.clear();
+							abortFrame();
+							transmitdata();
+							timeout = Timeout / ARQLOOPTIME;
 						}
 					}
 					break;
 				case  WAITING :
-					if (me->retrytime-- == 0) {
-						me->retrytime = me->rtry();
-						if (--me->retries) {
-							me->TxTextQueue.clear();
-							me->pollFrame();
-							me->transmitdata();
-							me->nbrbadTx++;
-							me->timeout = me->Timeout / ARQLOOPTIME;
+					if (retrytime-- == 0) {
+						retrytime = rtry();
+						if (--retries) {
+							TxTextQueue.clear();
+							pollFrame();
+							transmitdata();
+							nbrbadTx++;
+							pollRetries++;
+							timeout = Timeout / ARQLOOPTIME;
 						}
 					}
 					break;
 				case WAITFORACK :
-					if (me->retrytime-- == 0) {
-						me->retrytime = me->rtry();
-						if (--me->retries) {
-							me->TxTextQueue.clear();
-							me->ackFrame();
-							me->transmitdata();
-							me->nbrbadTx++;
-							me->timeout = me->Timeout / ARQLOOPTIME;
+					if (retrytime-- == 0) {
+						retrytime = rtry();
+						if (--retries) {
+							TxTextQueue.clear();
+							ackFrame();
+							transmitdata();
+							nbrbadTx++;
+							timeout = Timeout / ARQLOOPTIME;
 						}
 					}
 					break;
 				
 				case CONNECTED :
 				default:
-					if (me->TxTextQueue.empty() == false) {
-						me->transmitdata();
-					} else if ( (me->TxMissing.empty() == false) || (me->TxBlocks.empty() == false)) {
-						me->nbrbadTx += me->TxMissing.size();
-						me->sendblocks();
-						me->transmitdata();
-					} else if ( me->TxPlainTextQueue.empty() == false ) {
-						me->transmitdata();
+					if (TxTextQueue.empty() == false) {
+						transmitdata();
+					} else if ( (TxMissing.empty() == false) || unsent()) {
+						nbrbadTx += TxMissing.size();
+						sendblocks();
+						transmitdata();
+					} else if ( TxPlainTextQueue.empty() == false ) {
+						transmitdata();
 					}
 					break;
 				}
-				me->timeout--;
-				if (me->timeout == 0 // 10000 / ARQLOOPTIME // 10 seconds remaining
-				    && me->LinkState == CONNECTED // link is connected
-				    && me->primary == true ) { // this is the connecting station
-					if (--me->retries) { // repeat Retries and then allow timeout
-						me->TxTextQueue.clear();
-						me->identFrame(); // send an identity frame to try to keep
-						me->transmitdata(); // the link up
-						me->timeout = me->rtry(); //10000 / ARQLOOPTIME + 1;
+				timeout--;
+				if (timeout == 0 // 10000 / ARQLOOPTIME // 10 seconds remaining
+				    && LinkState == CONNECTED // link is connected
+				    && primary == true ) { // this is the connecting station
+					if (--retries) { // repeat Retries and then allow timeout
+						TxTextQueue.clear();
+						identFrame(); // send an identity frame to try to keep
+						transmitdata(); // the link up
+						timeout = rtry(); //10000 / ARQLOOPTIME + 1;
 					}
 				}
-				if (me->timeout == 0) {
-					if (me->LinkState == CONNECTED)
-						me->LinkState = TIMEDOUT;
+				if (timeout == 0) {
+					if (LinkState == CONNECTED)
+						LinkState = TIMEDOUT;
 					else
-						me->LinkState = DOWN;
-					me->Retries = me->baseRetries;
-					me->Timeout = me->baseTimeout;
-					me->RetryTime = me->baseRetryTime;
+						LinkState = DOWN;
+					Retries = baseRetries;
+					Timeout = baseTimeout;
+					RetryTime = baseRetryTime;
 				
-					me->retries = me->Retries;
-					me->retrytime = me->rtry();
-					me->TxMissing.clear();
-					me->TxBlocks.clear();
-					me->TxTextQueue.clear();
-					me->TxPlainTextQueue.clear();
-					me->timeout = me->Timeout / ARQLOOPTIME;
-					if (me->rxUrCall) me->rxUrCall("");
+					retries = Retries;
+					retrytime = rtry();
+					TxMissing.clear();
+					clearUnsent();
+					TxTextQueue.clear();
+					TxPlainTextQueue.clear();
+					timeout = Timeout / ARQLOOPTIME;
+					if (rxUrCall) rxUrCall("");
 				}
-				if (me->retries == 0) {
-					me->LinkState = DOWN;
-					me->Retries = me->baseRetries;
-					me->Timeout = me->baseTimeout;
-					me->RetryTime = me->baseRetryTime;
-
-					me->retries = me->Retries;
-					me->retrytime = me->rtry();
-					me->TxMissing.clear();
-					me->TxBlocks.clear();
-					me->TxTextQueue.clear();
-					me->TxPlainTextQueue.clear();
-					me->timeout = me->Timeout / ARQLOOPTIME;
-					if (me->rxUrCall) me->rxUrCall("");
-					me->printSTATUS(STIMEDOUT, 10.0);
+				if (retries == 0) {
+					LinkState = DOWN;
+					Retries = baseRetries;
+					Timeout = baseTimeout;
+					RetryTime = baseRetryTime;
+
+					retries = Retries;
+					retrytime = rtry();
+					TxMissing.clear();
+					clearUnsent();
+					TxTextQueue.clear();
+					TxPlainTextQueue.clear();
+					timeout = Timeout / ARQLOOPTIME;
+					if (rxUrCall) rxUrCall("");
+					printSTATUS(STIMEDOUT, 10.0);
 				}
 			}
 		}
 	}
 
+}
+
+void arqloop(void *who)
+{
+	arq *me = (arq *)who;
+
+	me->step();
+
 	if (me->arqstop)
 		return;
 
@@ -0,0 +1,215 @@
+// ----------------------------------------------------------------------------
+// arqloopback.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi
+//
+// fldigi is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+//=====================================================================
+//
+// Loopback test rig for the arq engine
+//
+// Two arq endpoints are connected through a simulated half duplex radio
+// channel that sends a fixed number of characters per second and changes
+// each character into a random one with a given probability.  The
+// transmitting endpoint is told that its transmission has ended with an
+// <ACK>, as fldigi does.  The link runs on a simulated clock, one
+// ARQLOOPTIME tick per step, so the test takes seconds for hours of
+// airtime.  A transfer is timed with the fixed block lengths and with the
+// adaptive engine:
+//
+//   flarq --arq-loopback RATE[:CPS]
+//
+//=====================================================================
+
+#include <config.h>
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <deque>
+
+#include "arq.h"
+
+using namespace std;
+
+#define LOOPBACK_TEXT	16384	// bytes in the test transfer
+#define LOOPBACK_HOURS	6		// give up after this much airtime
+
+struct loopback_end {
+	string	tx;			// characters on the air
+	size_t	txpos;
+	double	credit;		// characters that may be sent this tick
+	deque<char> rx;		// characters for the endpoint
+};
+
+static loopback_end stations[2];
+static double errrate;
+static double cps;
+static string received;
+static unsigned long seed;
+
+// deterministic, so that runs can be compared
+static double uniform()
+{
+	seed = seed * 1103515245UL + 12345UL;
+	return ((seed >> 16) & 0x7FFF) / 32768.0;
+}
+
+static void send_a(const string& s) { stations[0].tx.append(s); }
+static void send_b(const string& s) { stations[1].tx.append(s); }
+
+static bool getc_end(loopback_end& e, char& c)
+{
+	if (e.rx.empty())
+		return false;
+	c = e.rx.front();
+	e.rx.pop_front();
+	return true;
+}
+static bool getc_a(char& c) { return getc_end(stations[0], c); }
+static bool getc_b(char& c) { return getc_end(stations[1], c); }
+
+static void print_rx_b(string s) { received.append(s); }
+static void print_none(string s) { }
+static void status_none(string s, double disptime) { }
+
+// moves one tick of characters from end i to the other end
+static void channel(int i)
+{
+	loopback_end& e = stations[i];
+	loopback_end& other = stations[1 - i];
+
+	if (e.txpos == e.tx.length()) {
+		e.credit = 0.0;
+		return;
+	}
+	e.credit += cps * ARQLOOPTIME / 1000.0;
+	for (; e.credit >= 1.0 && e.txpos < e.tx.length(); e.credit -= 1.0) {
+		char c = e.tx[e.txpos++];
+		if (uniform() < errrate)
+			c = ' ' + (int)(uniform() * 95);
+		other.rx.push_back(c);
+	}
+	if (e.txpos == e.tx.length()) {
+		e.tx.clear();
+		e.txpos = 0;
+		e.rx.push_back(ACK);
+	}
+}
+
+static void setup(arq& a, const char* call, int exponent, bool adaptive)
+{
+	a.myCall(call);
+	a.setExponent(exponent);
+	a.setAdaptive(adaptive);
+	a.setPrintRX(print_none);
+	a.setPrintTX(print_none);
+	a.setPrintTALK(print_none);
+	a.setPrintRX_DEBUG(print_none);
+	a.setPrintTX_DEBUG(print_none);
+	a.setPrintSTATUS(status_none);
+}
+
+// returns false if the transfer did not complete
+static bool run(int exponent, bool adaptive, const string& text)
+{
+	for (int i = 0; i < 2; i++) {
+		stations[i].tx.clear();
+		stations[i].txpos = 0;
+		stations[i].credit = 0.0;
+		stations[i].rx.clear();
+	}
+	received.clear();
+	seed = 1;
+
+	arq a, b;
+	setup(a, "A0AAA", exponent, adaptive);
+	a.setSendFunc(send_a);
+	a.setGetCFunc(getc_a);
+	setup(b, "B0BBB", exponent, adaptive);
+	b.setSendFunc(send_b);
+	b.setGetCFunc(getc_b);
+	b.setPrintRX(print_rx_b);
+
+	const unsigned long limit = LOOPBACK_HOURS * 3600UL * 1000 / ARQLOOPTIME;
+	unsigned long tick = 0;
+	bool queued = false;
+	for (; tick < limit; tick++) {
+		if (tick == 0)
+			a.connect("B0BBB");
+		if (!queued && a.connected()) {
+			a.sendText(text);
+			queued = true;
+		}
+		a.step();
+		b.step();
+		channel(0);
+		channel(1);
+		if (queued && a.transferComplete() && received.length() >= text.length())
+			break;
+	// the retries have run out
+		if (queued && (a.state() & 0x7F) <= TIMEDOUT)
+			break;
+	}
+	bool ok = queued && a.transferComplete() && received.length() >= text.length();
+
+	char mode[20];
+	if (adaptive)
+		snprintf(mode, sizeof(mode), "adaptive");
+	else
+		snprintf(mode, sizeof(mode), "fixed %d", 1 << exponent);
+	printf("%-10s %s%s\n", mode, a.statistics().c_str(),
+	       ok ? "" : (tick == limit ? " (incomplete)" : " (link lost)"));
+	if (received.compare(0, text.length(), text.substr(0, received.length())) != 0)
+		printf("%-10s received text differs\n", mode);
+
+	return ok;
+}
+
+int arq_loopback_test(const char *spec)
+{
+	errrate = strtod(spec, NULL);
+	cps = 20.0;
+	const char* p = strchr(spec, ':');
+	if (p)
+		cps = strtod(p + 1, NULL);
+	if (errrate < 0.0 || errrate >= 1.0 || cps <= 0.0) {
+		fprintf(stderr, "E: bad loopback RATE[:CPS] `%s'\n", spec);
+		return EXIT_FAILURE;
+	}
+
+	string text;
+	seed = 12345;
+	while (text.length() < LOOPBACK_TEXT) {
+		int n = 2 + (int)(uniform() * 8);
+		for (int i = 0; i < n; i++)
+			text += 'a' + (int)(uniform() * 26);
+		text += (uniform() < 0.1) ? '\n' : ' ';
+	}
+
+	printf("%d bytes, %.0f cps, character error rate %g\n",
+	       LOOPBACK_TEXT, cps, errrate);
+	bool ok = true;
+	for (int e = EXPONENT_MIN; e <= EXPONENT_MAX; e++)
+		ok = run(e, false, text) && ok;
+	ok = run(EXPONENT, true, text) && ok;
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
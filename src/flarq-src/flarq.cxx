@@ -1520,7 +1520,8 @@ void dispState()
 		if (digi_arq->transferComplete()) {
 			time(&EndTime_t);
 			TransferTime = difftime(EndTime_t,StartTime_t);
-			snprintf(xfrmsg, sizeof(xfrmsg), "Transfer Completed in %4.0f sec's", TransferTime);
+			snprintf(xfrmsg, sizeof(xfrmsg), "Transfer Completed in %4.0f sec's, %.1f cps",
+				TransferTime, digi_arq->goodput());
 			txtStatus->value(xfrmsg);
 			blocksSent = 0;
 			prgStatus->value(0.0);
@@ -1541,7 +1542,8 @@ void dispState()
 		if (digi_arq->transferComplete()) {
 			time(&EndTime_t);
 			TransferTime = difftime(EndTime_t,StartTime_t);
-			snprintf(xfrmsg, sizeof(xfrmsg), "Transfer Completed in %4.0f sec's", TransferTime);
+			snprintf(xfrmsg, sizeof(xfrmsg), "Transfer Completed in %4.0f sec's, %.1f cps",
+				TransferTime, digi_arq->goodput());
 			txtStatus->value(xfrmsg);
 			moveEmailFile();
 			blocksSent = 0;
@@ -48,6 +48,7 @@
 
 #include "stacktrace.h"
 #include "flarq.h"
+#include "arq.h"
 
 using namespace std;
 
@@ -76,6 +77,12 @@ void generate_option_help(void)
 	     << "    Set the ARQ TCP server port\n"
 	     << "    The default is: " << arq_port << "\n\n"
 
+	     << "  --arq-loopback RATE[:CPS]\n"
+	     << "    Time a transfer between two ARQ engines over a simulated\n"
+	     << "    channel with character error rate RATE and CPS characters\n"
+	     << "    per second, print the statistics and exit\n"
+	     << "    The default CPS is: 20\n\n"
+
 	     << "  --debug\n"
 	     << "    Enable debugging messages\n\n"
 
@@ -145,7 +152,7 @@ int parse_args(int argc, char** argv, int& idx)
 #ifndef __WOE32__
 	       OPT_RX_IPC_KEY, OPT_TX_IPC_KEY,
 #endif
-	       OPT_ARQ_PROTOCOL, OPT_ARQ_ADDRESS, OPT_ARQ_PORT,
+	       OPT_ARQ_PROTOCOL, OPT_ARQ_ADDRESS, OPT_ARQ_PORT, OPT_ARQ_LOOPBACK,
 
 	       OPT_FONT,
 
@@ -161,6 +168,7 @@ int parse_args(int argc, char** argv, int& idx)
 		{ "arq-protocol",  1, 0, OPT_ARQ_PROTOCOL },
 		{ "arq-server-address", 1, 0, OPT_ARQ_ADDRESS },
 		{ "arq-server-port",    1, 0, OPT_ARQ_PORT },
+		{ "arq-loopback",  1, 0, OPT_ARQ_LOOPBACK },
 
 		{ "font",	   1, 0, OPT_FONT },
 
@@ -199,6 +207,8 @@ int parse_args(int argc, char** argv, int& idx)
 		case OPT_ARQ_PORT:
 			arq_port = optarg;
 			break;
+		case OPT_ARQ_LOOPBACK:
+			exit(arq_loopback_test(optarg));
 
 		case OPT_FONT: {
 			char *p;
@@ -79,6 +79,12 @@ using namespace std;
 #define	MAXHEADERS  	8	// Max. number of missing blocks
 #define MAXCOUNT		64  // DO NOT CHANGE THIS CONSTANT
 #define EXPONENT		7	// Bufferlength = 2 ^ EXPONENT = 128
+#define EXPONENT_MIN	4	// range of the adaptive block length
+#define EXPONENT_MAX	8
+#define MAXWINDOW		16	// Max. number of blocks in one turn
+#define FRAME_OVERHEAD	12	// header, block number, checksum, SOH and CRLF
+#define ERRAVERAGE		4	// # turns in the block error counts
+#define S2N_FADE		6.0	// dB change in the s/n that resizes the blocks
 //=====================================================================
 //link timing defaults
 #define	RETRIES			5
@@ -199,6 +205,29 @@ private:
 	int		maxheaders;
 	int		exponent;
 
+// adaptive block length and window
+	bool	adaptive;
+	int		baseExponent;				// configured block length
+	int		window;						// blocks sent per turn
+	double	charerr;					// character error rate estimate
+	double	sentAvg;					// blocks, lost blocks and characters
+	double	lostAvg;					// of the last few turns
+	double	charsAvg;
+	bool	turnOpen;					// blocks sent, status not yet seen
+	double	s2n;						// last s/n reported by the modem
+	double	s2nref;						// average s/n of the link
+	bool	s2nvalid;
+	string	NoticeQueue;				// <DC2> notice from the modem
+	bool	inNotice;
+
+// transfer statistics
+	unsigned long	busyTicks;			// loop counts with data to send
+	size_t	bytesAcked;					// payload confirmed by the other station
+	int		blocksSent;
+	int		blocksRepeated;
+	int		turns;
+	int		pollRetries;
+
 // status variables
 	int 	payloadlength;	// Average length of payload received
 	int	totalRx;		// total number of frames received
@@ -237,13 +266,14 @@ private:
 	int		EndHeader;					// Last I received o.k.
 	int		GoodHeader;					// Last Header received consecutively
 	int		blkcount;
-	int		Blocks2Send;				// number of blocks at beginning of Tx
+	size_t	Bytes2Send;					// number of bytes at beginning of Tx
 
 	vector<int>	MyMissing;				// missing Rx blocks
 	string MissingRxBlocks;
 	vector<cTxtBlk> RxPending;			// RxPending Rx blocks (not consecutive)
 	
-	list<cTxtBlk> TxBlocks;				// fifo of transmit buffers
+	string	TxUnsent;					// text not yet cut into blocks
+	size_t	UnsentPos;					// and the start of it
 	list<cTxtBlk> TxMissing;			// fifo of sent; RxPending Status report
 	list<cTxtBlk> TxPending;			// fifo of transmitted buffers pending print
 
@@ -265,9 +295,16 @@ private:
 	void	reset();
 	void	resetTx();
 	void	resetRx();
+	void	resetLink();
 	int     rtry();
 	
 	void	setBufferlength();
+	void	clearUnsent() { TxUnsent.clear(); UnsentPos = 0; }
+	bool	unsent() { return UnsentPos < TxUnsent.length(); }
+	size_t	bytesPending();
+	void	measureTurn(const vector<int>& missing);
+	void	adaptBlocks();
+	void	parseNotice();
 	
 	void	checkblocks();
 	string	upcase(string s);
@@ -337,6 +374,7 @@ public:
 
 	friend	void	arqloop(void *me);
 	void	start_arq();
+	void	step();
 
 	string	checksum(string &s);
 
@@ -360,7 +398,10 @@ public:
 	void	setPrintSTATUS (void (*f)(string s, double disptime)) { printSTATUS = f;}
 	
 	void	setMaxHeaders( int mh ) { maxheaders = mh; }
-	void	setExponent( int exp ) { exponent = exp; setBufferlength(); }
+	void	setExponent( int exp ) {
+				exponent = baseExponent = exp; setBufferlength(); }
+	void	setAdaptive( bool on ) { adaptive = on; }
+	bool	getAdaptive() { return adaptive; }
 	int		getExponent() { return (int) exponent;}
 	void	setWaitTime( int rtime ) { RetryTime = rtime; baseRetryTime = rtime; }
 	int		getWaitTime() { return (int) RetryTime; }
@@ -406,19 +447,37 @@ public:
 		if (totalTx == 0) return 1.0;
 		return ( 1.0 * (totalTx - nbrbadTx) / totalTx );
 	}
+
+	int		blockLength() { return Bufferlength; }
+	int		windowSize() { return window; }
+	double	charErrorRate() { return charerr; }
+	int		blocksTx() { return blocksSent; }
+	int		blocksRepeatedTx() { return blocksRepeated; }
+	int		turnsTx() { return turns; }
+	int		pollRetriesTx() { return pollRetries; }
+	size_t	bytesConfirmed() { return bytesAcked; }
+// confirmed payload per second of transfer time
+	double	goodput() {
+		if (busyTicks == 0) return 0.0;
+		return 1000.0 * bytesAcked / (1.0 * busyTicks * ARQLOOPTIME);
+	}
+	string	statistics();
 	
 	float  percentSent() {
-		if (Blocks2Send == 0) return 0.0;
-		if ((TxBlocks.empty() && TxMissing.empty())) return 1.0;
-		return (1.0 * (Blocks2Send - TxBlocks.size() - TxMissing.size()) / Blocks2Send);
+		if (Bytes2Send == 0) return 0.0;
+		if (transferComplete()) return 1.0;
+		return (1.0 * (Bytes2Send - bytesPending()) / Bytes2Send);
 	}
 	
 	bool	transferComplete() {
 		if (TxMissing.empty() == false) return false;
-		if (TxBlocks.empty() == false) return false;
+		if (unsent()) return false;
 		return true;
 	}
 };
 
+// runs two endpoints over a simulated channel, see arqloopback.cxx
+extern int arq_loopback_test(const char *spec);
+
 #endif
 
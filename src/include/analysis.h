@@ -26,49 +26,36 @@
 #include <string>
 #include <ctime>
 
-#include "complex.h"
-#include "filters.h"
-#include "fftfilt.h"
+#include "freqmeas.h"
 #include "modem.h"
 
 #define ANAL_SAMPLERATE	8000
-#define FILT_LEN        4		//seconds
 #define PIPE_LEN		120
-#define DSP_CNT			1		//seconds
 #define ANAL_BW			4
 
 class anal : public modem {
 private:
 
-	double		phaseacc;
-
-	C_FIR_filter	*hilbert;
-	fftfilt *bpfilt;
-	Cmovavg *ffilt;
-	Cmovavg *favg;
+	freqmeas	*meas;
 
 	double pipe[PIPE_LEN];
 
-	double prevsymbol;
-	cmplx prevsmpl;
-
 	double		fout;
 	long int	wf_freq;
-	double      dspcnt;
-	long int	passno;
 
 	struct timespec start_time;
 
 	double elapsed;
 
 	void clear_syncscope();
-	inline cmplx mixer(cmplx in);
-	int rx(bool bit);
-
-	double nco(double freq);
+	void update();
 	void writeFile();
 
 	std::string	analysisFilename;
+	std::string	analysisLogname;
+	fmt_csv		csv;
+	fmt_log		binlog;
+	bool		write_to_csv;
 
 public:
 	anal();
@@ -78,6 +65,8 @@ public:
 	void tx_init(SoundBase *sc);
 	void restart();
 	void start_csv();
+	void stop_csv();
+	int  is_csv() { return write_to_csv; }
 	int rx_process(const double *buf, int len);
 	int tx_process();
 
@@ -22,6 +22,7 @@
 #define BENCHMARK_H_
 
 #include <string>
+#include <vector>
 #include <sys/types.h>
 #include "globals.h"
 
@@ -34,10 +35,23 @@ struct benchmark_params {
 	int src_type;
 	std::string input, output, buffer;
 	size_t samples;
+
+	// batch decoding
+	std::vector<std::string> batch;	// files, directories and @lists
+	std::vector<trx_mode> modes;
+	int jobs;			// worker processes, 0 for one per cpu
+	bool batching;
+
+	bool replay;			// input with its capture events
 };
 extern struct benchmark_params benchmark;
 
 int setup_benchmark(void);
-void do_benchmark(void);
+bool do_benchmark(void);
+
+bool benchmark_set_modes(const char* list);
+void benchmark_put_char(unsigned int data);
+int benchmark_viterbi(size_t nbits);
+int benchmark_kiss(size_t nframes, size_t nbytes);
 
 #endif
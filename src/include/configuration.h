@@ -805,6 +805,19 @@
               "Populate logbook notes (comment) field with mailing address",            \
               false)                                                                    \
         ELEM_(bool, QRZchanged, "", "",  false)                                         \
+        ELEM_(bool, lookup_cache, "LOOKUP_CACHE",                                       \
+              "Keep the results of online callsign lookups in a local cache",           \
+              true)                                                                     \
+        ELEM_(int, lookup_cache_days, "LOOKUP_CACHE_DAYS",                              \
+              "Number of days that a cached lookup result remains valid",               \
+              30)                                                                       \
+        ELEM_(int, lookup_cache_size, "LOOKUP_CACHE_SIZE",                              \
+              "Maximum number of callsigns kept in the lookup cache",                   \
+              5000)                                                                     \
+        ELEM_(bool, lookup_prefetch, "LOOKUP_PREFETCH",                                 \
+              "Look up callsigns heard calling CQ in the background.  Requires the\n"   \
+              "spotter and an online lookup service",                                   \
+              false)                                                                    \
         /* eQSL */                                                                      \
         ELEM_(std::string, eqsl_id, "EQSL_ID",                                          \
               "eQSL login id",                                                          \
@@ -1009,6 +1022,18 @@
               "PortAudio input device index",                                           \
               -1)                                                                       \
         ELEM_(int, PortFramesPerBuffer, "", "",  0)                                     \
+        ELEM_(std::string, IQInput, "", "",  "")                                        \
+        ELEM_(int, IQFormat, "", "",  0)                                                \
+        ELEM_(int, IQSampleRate, "", "",  96000)                                        \
+        ELEM_(std::string, IQReceivers, "", "",  "0")                                   \
+        ELEM_(std::string, WFStreamAddress, "", "",  "127.0.0.1")                       \
+        ELEM_(std::string, WFStreamPort, "", "",  "")                                   \
+        ELEM_(std::string, WFArchive, "", "",  "")                                      \
+        ELEM_(int, WFArchiveHours, "", "",  24)                                         \
+        ELEM_(std::string, ViewStreamAddress, "", "",  "127.0.0.1")                     \
+        ELEM_(std::string, ViewStreamPort, "", "",  "")                                 \
+        ELEM_(std::string, ViewLog, "", "",  "")                                        \
+        ELEM_(std::string, AnalysisCarriers, "", "",  "")                               \
         ELEM_(std::string, PulseServer, "PULSESERVER",                                  \
               "PulseAudio server string",                                               \
               "")                                                                       \
@@ -35,6 +35,7 @@
 #include "filters.h"
 #include "fftfilt.h"
 #include "mbuffer.h"
+#include "view_cw.h"
 
 
 #define	CWSampleRate	8000
@@ -224,6 +225,8 @@ protected:
 	void	makeshape();
 	void	sync_transmit_parameters();
 
+	view_cw	*cwviewer;
+
 	fftfilt	*cw_xmt_filter;
 	double	nbfreq;
 	double	nbpf;
@@ -242,6 +245,10 @@ public:
 	void	tx_init(SoundBase *sc);
 	void	restart() {};
 
+	void	clear_viewer() { cwviewer->clear(); }
+	void	clear_ch(int n) { cwviewer->clearch(n); }
+	int	viewer_get_freq(int n) { return cwviewer->get_freq(n); }
+
 	int		rx_process(const double *buf, int len);
 	void	rx_FFTprocess(const double *buf, int len);
 	void	rx_FIRprocess(const double *buf, int len);
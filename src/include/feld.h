@@ -96,6 +96,7 @@ protected:
 	cmplx mixer(cmplx);
 	double nco(double);
 	void	rx(cmplx);
+	void	put_rx_column(void);
 	void	FSKHELL_rx(cmplx);
 	void	send_symbol(int currsymbol, int nextsymbol);
 	void	send_null_column();
@@ -35,18 +35,21 @@
 //=====================================================================
 
 class C_FIR_filter {
-#define FIRBufferLen 4096
 private:
 	int length;
 	int decimateratio;
 
 	double *ifilter;
 	double *qfilter;
+	double *cfilter;	// ifilter and qfilter interleaved
 
 	double ffreq;
-	
-	double ibuffer[FIRBufferLen];
-	double qbuffer[FIRBufferLen];
+
+// The history is a ring of length samples stored twice, so that the last
+// length samples always lie in one run starting at pointer.  The complex
+// samples are interleaved; Irun and Qrun have a ring of their own.
+	cmplx *buffer;
+	double *rbuffer;
 
 	int pointer;
 	int counter;
@@ -86,6 +89,29 @@ private:
 			sum += (*a++) * (*b++);
 		return sum + sum2 + sum3 + sum4 ;
 	}
+	// Both parts of the interleaved samples against the interleaved taps,
+	// each part summed as mac() sums it
+	inline cmplx mac(const cmplx *z, const double *b, unsigned int size) {
+		const double *a = reinterpret_cast<const double *>(z);
+		double isum = 0.0, isum2 = 0.0, isum3 = 0.0, isum4 = 0.0;
+		double qsum = 0.0, qsum2 = 0.0, qsum3 = 0.0, qsum4 = 0.0;
+		for (; size > 3; size -= 4, a += 8, b += 8)
+		{
+			isum  += a[0] * b[0];
+			qsum  += a[1] * b[1];
+			isum2 += a[2] * b[2];
+			qsum2 += a[3] * b[3];
+			isum3 += a[4] * b[4];
+			qsum3 += a[5] * b[5];
+			isum4 += a[6] * b[6];
+			qsum4 += a[7] * b[7];
+		}
+		for (; size; --size, a += 2, b += 2) {
+			isum += a[0] * b[0];
+			qsum += a[1] * b[1];
+		}
+		return cmplx(isum + isum2 + isum3 + isum4, qsum + qsum2 + qsum3 + qsum4);
+	}
 
 protected:
 	
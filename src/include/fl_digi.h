@@ -45,6 +45,8 @@
 #include "smeter.h"
 #include "pwrmeter.h"
 
+class image_sink;
+
 extern fre_t seek_re;
 
 extern Fl_Double_Window *fl_digi_main;
@@ -158,6 +160,7 @@ extern void activate_rig_menu_item(bool b);
 extern void activate_test_menu_item(bool b);
 extern void activate_mfsk_image_item(bool b);
 extern void activate_wefax_image_item(bool b);
+extern void update_countries_menu();
 extern void WF_UI();
 
 extern void set_macroLabels();
@@ -243,7 +246,7 @@ extern int override_kiss_dual_port_enabled;
 extern int override_data_io_enabled;
 
 extern int rxtx_charset;
-extern void put_rx_data(int *data, int len);
+extern void put_rx_data(const image_sink& sink, int from, int to);
 
 // Values returned by get_tx_char() to signal various conditions to the
 // modems. These values need to be negative so they don't interfere with
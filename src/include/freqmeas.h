@@ -0,0 +1,174 @@
+// ----------------------------------------------------------------------------
+// freqmeas.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef FREQMEAS_H_
+#define FREQMEAS_H_
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <stdint.h>
+
+#include "complex.h"
+#include "filters.h"
+
+// phase samples per second, and the length of a measurement block
+#define FMT_PHASE_RATE	20
+#define FMT_BLOCK_LEN	1	// seconds
+// blocks in the long term fit
+#define FMT_LONG_BLOCKS	60
+
+/// Measurement of one carrier over one block
+struct fmt_result {
+	double	offset;		// Hz, fit of the phase samples of the block
+	double	mean;		// Hz, fit of the block phases of the long term window
+	double	sigma;		// Hz, standard error of mean
+	double	phase;		// radians at the middle of the block, unwrapped
+	double	level;		// dBFS
+	int	blocks;		// in the long term fit
+};
+
+/// Tracks the frequency of several carriers in one pass over the samples.
+/// Each carrier is mixed to 0 Hz by its own oscillator, low pass filtered
+/// and decimated to FMT_PHASE_RATE, and its phase unwrapped.  A straight
+/// line fitted to the phase samples of a block gives the offset of the
+/// carrier from its nominal frequency over that block; a line fitted to
+/// the phases of the last FMT_LONG_BLOCKS blocks gives the long term
+/// offset, with a resolution well below one millihertz for a clean carrier.
+/// All the times are counted in samples, so a file replays exactly.
+class freqmeas
+{
+public:
+	freqmeas(int samplerate, double bandwidth);
+	~freqmeas();
+
+	void set_carriers(const std::vector<double>& freqs);
+	size_t carriers(void) const { return targets.size(); }
+	double carrier(size_t i) const { return targets[i]->freq; }
+
+	/// Runs samples up to the end of the current block.  Returns the number
+	/// of samples used; block_done() is then true if the block is complete.
+	int run(const double* buf, int len);
+	bool block_done(void) const { return done; }
+	/// Seconds from the first sample to the end of the last block
+	double elapsed(void) const { return (double)blocks * blocklen / samplerate; }
+	/// False while the filters of the first blocks settle
+	bool valid(void) const { return blocks > 2; }
+	const fmt_result& result(size_t i) const { return targets[i]->res; }
+
+private:
+	freqmeas(const freqmeas&);
+	freqmeas& operator=(const freqmeas&);
+
+	struct target {
+		double		freq;
+		cmplx		nco, nco_step;
+		C_FIR_filter	lp1, lp2;
+		double		phase;		// unwrapped, radians
+		double		base;		// phase at the start of the block
+		cmplx		prev;
+		// sums of the straight line fit of the block
+		double		sp, stp, sa;
+		int		n;
+		// block phases of the long term fit, oldest first
+		std::vector<double> history;
+		fmt_result	res;
+	};
+	void end_block(target& t);
+
+	int samplerate;
+	double bandwidth;
+	double gain;		// of the low pass filters
+	int dec1, dec2;
+	int blocklen;		// samples
+	int count;		// samples of the current block
+	unsigned long blocks;
+	bool done;
+	std::vector<target*> targets;
+};
+
+/// Parses a comma separated list of audio frequencies
+bool parse_fmt_carriers(const std::string& list, std::vector<double>& freqs);
+
+// The binary log is a header followed by one record per carrier per block,
+// all in host byte order.  Times are counted from the start of the log in
+// samples, so that the records of a replayed file are identical.
+#define FMT_LOG_MAGIC	"FLFMT01\n"
+
+struct fmt_log_header {
+	char		magic[8];
+	uint32_t	record_size;	// sizeof(fmt_log_record)
+	uint32_t	carriers;
+	double		samplerate;
+	double		start;		// unix time of the first sample
+};
+
+struct fmt_log_record {
+	double		time;		// unix time of the end of the block
+	double		elapsed;	// seconds from the first sample
+	uint32_t	carrier;	// index, 0 is the modem frequency
+	uint32_t	flags;
+	double		audio;		// Hz
+	double		rf;		// Hz
+	double		offset;		// the fmt_result fields
+	double		mean;
+	double		sigma;
+	double		phase;
+	double		level;
+};
+
+enum { FMT_VALID = 1 << 0 };
+
+/// Writes the CSV log, one row per block with the columns of every carrier
+class fmt_csv
+{
+public:
+	fmt_csv() : out(0), own(false) { }
+	~fmt_csv() { close(); }
+	bool open(const std::string& name, size_t carriers);
+	bool open(FILE* f, size_t carriers);
+	void close(void);
+	bool is_open(void) const { return out != 0; }
+	/// rec holds one record per carrier
+	void write(const fmt_log_record* rec, size_t n);
+private:
+	FILE* out;
+	bool own;
+};
+
+class fmt_log
+{
+public:
+	fmt_log() : out(0) { }
+	~fmt_log() { close(); }
+	bool open(const std::string& name, size_t carriers, double samplerate, double start);
+	void close(void);
+	bool is_open(void) const { return out != 0; }
+	void write(const fmt_log_record* rec, size_t n);
+private:
+	FILE* out;
+};
+
+/// Converts a binary log to CSV on out
+bool fmt_replay(const std::string& name, FILE* out);
+
+#endif // FREQMEAS_H_
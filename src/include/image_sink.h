@@ -0,0 +1,128 @@
+// ----------------------------------------------------------------------------
+// image_sink.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef IMAGE_SINK_H_
+#define IMAGE_SINK_H_
+
+#include <cstdio>
+#include <deque>
+
+#include "threads.h"
+
+/// Writes a PNG file one row at a time.  A file name that ends with a slash
+/// is a directory in which a time stamped file name is generated.
+class png_stream
+{
+public:
+	png_stream();
+	~png_stream();
+
+	/// color_type and bit_depth are those of png_set_IHDR.  The comments
+	/// are appended to the usual program, time, mode and frequency ones.
+	bool open(const char* filename, int width, int height, int color_type,
+		  int bit_depth, const char* extra_comments = 0);
+	bool write_row(const unsigned char* row);
+	bool close(void);
+
+private:
+	png_stream(const png_stream&);
+	png_stream& operator=(const png_stream&);
+
+	void* png;
+	void* info;
+	FILE* fp;
+};
+
+/// The frame buffer of an image decoder.  The decoder fills it from its own
+/// thread and commits its progress; every completed row (or every group of
+/// rows) is then published to the GUI thread with a single request, instead
+/// of one request per pixel.  Positions are byte offsets from the start of
+/// the image, which is width * depth bytes wide.
+class image_sink
+{
+public:
+	/// Called from the GUI thread with the bytes [from, to) that have been
+	/// committed since the previous call.  They may be read with at().
+	typedef void (*publish_t)(const image_sink& sink, int from, int to);
+
+	/// The rows are published in groups of batch rows.  Unless keep is set,
+	/// published rows are released: the decoder then cannot save the image.
+	image_sink(publish_t publish, int batch = 1, bool keep = true);
+	~image_sink();
+
+	// decoder thread
+	void reset(int width, int depth);
+	void skip(int pos);
+	unsigned char* row(int r);
+	void put(int pos, unsigned char value) {
+		if (pos < 0)
+			return;
+		int r = pos / stride;
+		if (r != cur_row) {
+			cur_data = row(r);
+			cur_row = r;
+		}
+		cur_data[pos - r * stride] = value;
+	}
+	void commit(int pos);
+	void flush(void);
+	bool idle(void);
+	int save_png(const char* filename, bool monochrome, const char* extra_comments = 0);
+
+	// GUI thread, from the publish function
+	const unsigned char* at(int pos) const;
+
+	int width(void) const { return width_; }
+	int depth(void) const { return depth_; }
+	int row_bytes(void) const { return stride; }
+	int committed(void) const { return committed_; }
+
+private:
+	image_sink(const image_sink&);
+	image_sink& operator=(const image_sink&);
+
+	void notify(int pos);
+	void deliver(unsigned gen, int to);
+	void release(void);
+
+	publish_t publish;
+	int batch;
+	bool keep;
+
+	int width_;
+	int depth_;
+	int stride;
+	unsigned gen;
+
+	int committed_;		// bytes that the decoder will not change anymore
+	int notified;		// bytes covered by requests that have been posted
+	int published;		// bytes handed over to the publish function
+
+	std::deque<unsigned char*> rows;
+	int first_row;		// the row of rows.front(), rows before it are released
+	int cur_row;
+	unsigned char* cur_data;
+
+	pthread_mutex_t mutex;
+};
+
+#endif // IMAGE_SINK_H_
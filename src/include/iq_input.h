@@ -0,0 +1,138 @@
+// ----------------------------------------------------------------------------
+// iq_input.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef IQ_INPUT_H_
+#define IQ_INPUT_H_
+
+#include <string>
+#include <vector>
+
+#include "sound.h"
+#include "complex.h"
+#include "filters.h"
+#include "globals.h"
+
+/// Reads interleaved I/Q samples from a file, a FIFO, standard input ("-")
+/// or a local socket ("unix:PATH").  Samples are in host byte order.
+class iq_source
+{
+public:
+	enum format_t { IQ_S16, IQ_F32 };
+
+	iq_source();
+	~iq_source();
+
+	bool open(const std::string& spec, format_t format);
+	void close(void);
+	bool is_open(void) const { return fd != -1; }
+	/// True for a regular file, which must be paced to real time
+	bool regular(void) const { return regular_; }
+
+	/// Returns up to n samples, or 0 at the end of the input
+	size_t read(cmplx* buf, size_t n);
+
+private:
+	iq_source(const iq_source&);
+	iq_source& operator=(const iq_source&);
+
+	int fd;
+	bool regular_;
+	format_t format;
+	std::vector<char> raw;
+	size_t have;		// bytes of an incomplete sample left in raw
+};
+
+/// One virtual receiver.  It mixes its slice of the I/Q band down to zero,
+/// low pass filters and decimates it, and returns the slice as upper
+/// sideband audio: the dial frequency, an offset from the centre of the I/Q
+/// band, becomes 0 Hz.
+class iq_receiver
+{
+public:
+	iq_receiver(double in_rate, double out_rate, double dial);
+	~iq_receiver();
+
+	double dial(void) const { return dial_; }
+	void tune(double dial);
+
+	/// Appends the audio of n input samples to out
+	void process(const cmplx* in, size_t n, std::vector<float>& out);
+
+private:
+	iq_receiver(const iq_receiver&);
+	iq_receiver& operator=(const iq_receiver&);
+
+	double in_rate, out_rate;
+	double dial_;
+	double bandwidth;
+	int decimation;
+	double mid_rate;	// rate after decimation, before resampling
+
+	C_FIR_filter filter;
+	cmplx nco, nco_step;	// moves the middle of the slice to 0 Hz
+	cmplx up, up_step;	// and the decimated slice back up to bandwidth/2
+	unsigned count;
+
+	SRC_STATE* src_state;
+	std::vector<float> mid;
+	std::vector<float> resampled;
+};
+
+/// A virtual receiver and the modem that decodes it
+struct iq_channel {
+	double dial;
+	trx_mode mode;		// NUM_MODES: not given
+};
+
+/// Parses a comma separated list of DIAL[:MODE] receivers, where MODE is
+/// a modem id or short name.
+bool parse_iq_channels(const std::string& list, std::vector<iq_channel>& channels);
+
+/// The soundcard of a wide band I/Q input.  The first receiver of the
+/// configured list feeds the modem and the waterfall; transmitted audio is
+/// discarded.
+class SoundIQ : public SoundBase
+{
+public:
+	SoundIQ(const std::string& spec);
+	~SoundIQ();
+
+	int	Open(int mode, int freq = 8000);
+	void    Close(unsigned dir = UINT_MAX) { }
+	void    Abort(unsigned dir = UINT_MAX) { }
+	size_t	Write(double* buf, size_t count);
+	size_t	Write_stereo(double* bufleft, double* bufright, size_t count);
+	size_t	Read(float *buf, size_t count);
+	bool	must_close(int dir = 0) { return false; }
+	void	flush(unsigned dir = UINT_MAX) { }
+
+private:
+	std::string spec;
+	iq_source source;
+	iq_receiver* rx;
+	std::vector<cmplx> iqbuf;
+	std::vector<float> audio;
+	size_t head;		// audio that has not been read yet starts here
+	bool eof;
+};
+
+#endif // IQ_INPUT_H_
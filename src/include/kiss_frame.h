@@ -0,0 +1,93 @@
+// ----------------------------------------------------------------------------
+// kiss_frame.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef KISS_FRAME_H
+#define KISS_FRAME_H
+
+#include <cstddef>
+
+#define HDLC_CNT_OFFSET   32
+#define HDLC_CNT          0xDE
+#define HDLC_TCNT         0xE0
+
+#define KISS_FEND         0xC0
+#define KISS_FESC         0xDB
+#define KISS_TFEND        0xDC
+#define KISS_TFESC        0xDD
+
+#define KISS_INVALID 512
+
+#define CRC_LOW(a)              (a & 0xFF)
+#define CRC_HIGH(a)             ((a >> 8) & 0xFF)
+#define CRC_LOW_HIGH(l,h)       (((h << 8) & 0xFF00) | (l & 0xFF))
+
+#define CRC16_NONE  0
+#define CRC16_CCITT 1
+#define CRC16_FCS   2
+#define CRC8_XOR    3
+
+// Largest encoded frames of n bytes, with their delimiters and CRC
+#define KISS_ENCODED_SIZE(n)    (2 * ((n) + 1 + 2) + 2)
+#define HDLC_ENCODED_SIZE(n)    (2 * ((n) + 2) + 4)
+
+// Frames up to this size come from the pool, larger ones from the heap
+#define KISS_POOL_FRAMES        256
+#define KISS_POOL_FRAME_SIZE    1024
+
+/// A frame buffer.  data and size are the view of the buffer that holds the
+/// frame.  kiss_frame_release() returns it to the pool.
+typedef struct kiss_queue_frame {
+	char *data;
+	size_t size;
+	char *buffer;
+	size_t capacity;
+	struct kiss_queue_frame *next; // in the free list
+} KISS_QUEUE_FRAME;
+
+KISS_QUEUE_FRAME *kiss_frame_alloc(size_t capacity);
+void kiss_frame_release(KISS_QUEUE_FRAME *frame);
+
+int calc_ccitt_crc(const char *buf, int n);
+int calc_xor_crc(const char *buf, int n);
+int calc_fcs_crc(const char *buf, int n);
+
+/// Writes a KISS frame of the header byte and n bytes of src, followed by a
+/// SMACK CRC of crc_type, to dst which must hold KISS_ENCODED_SIZE(n)
+/// bytes.  The CRC is computed as the bytes are escaped.  Returns the
+/// size of the frame.
+size_t kiss_encode_frame(int header, const char *src, size_t n, int crc_type, char *dst);
+/// The header byte of a KISS frame, or -1 if there is none
+int kiss_frame_header(const char *buf, size_t n);
+/// Decodes a KISS frame in place, and checks its crc_type CRC in the same
+/// pass.  Returns the number of bytes decoded, the header byte included and
+/// the CRC excluded, or 0 if the frame is short or its CRC is bad.
+size_t kiss_decode_frame(char *buf, size_t n, int crc_type);
+
+/// Writes an HDLC frame of n bytes of src and their FCS to dst, which must
+/// hold HDLC_ENCODED_SIZE(n) bytes.  Returns the size of the frame.
+size_t hdlc_encode_frame(const char *src, size_t n, char *dst);
+/// Decodes an HDLC frame from src to dst, which may be src, and checks its
+/// FCS in the same pass.  Returns the number of data bytes, or 0 if the
+/// frame is short or its FCS is bad.
+size_t hdlc_decode_frame(const char *src, size_t n, char *dst);
+
+#endif // KISS_FRAME_H
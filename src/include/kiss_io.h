@@ -6,15 +6,7 @@
 #include "threads.h"
 #include "socket.h"
 #include "modem.h"
-
-#define HDLC_CNT_OFFSET   32
-#define HDLC_CNT          0xDE
-#define HDLC_TCNT         0xE0
-
-#define KISS_FEND         0xC0
-#define KISS_FESC         0xDB
-#define KISS_TFEND        0xDC
-#define KISS_TFESC        0xDD
+#include "kiss_frame.h"
 
 #define KISS_DATA         0x00
 #define KISS_TXDELAY      0x01
@@ -37,24 +29,10 @@
 #define SMACK_CRC(a)            (a & 0x08)
 #define SMACK_CRC_MASK(a)       (a & 0xF7)
 #define SMACK_CRC_ASSIGN(a)     ((a | 0x08) & 0xFF)
-#define CRC_LOW(a)              (a & 0xFF)
-#define CRC_HIGH(a)             ((a >> 8) & 0xFF)
-#define CRC_LOW_HIGH(l,h)       (((h << 8) & 0xFF00) | (l & 0xFF))
-
-#define CRC16_NONE  0
-#define CRC16_CCITT 1
-#define CRC16_FCS   2
-#define CRC8_XOR    3
-
-#define KISS_INVALID 512
 
 #define KISS_HALF_DUPLEX 0
 #define KISS_FULL_DUPLEX 1
 
-#define BUFFER_PADDING 32
-#define KISS_BUFFER_FACTOR 2
-#define HDLC_BUFFER_FACTOR 3
-
 #define MAX_TEMP_BUFFER_SIZE 32000
 
 #define TX_BUFFER_TIMEOUT (60 * 10) // Ten minute timeout
@@ -63,11 +41,6 @@
 
 #define KPSQL_MIN_BANDWIDTH 400
 
-typedef struct {
-	char *data;
-	size_t size;
-} KISS_QUEUE_FRAME;
-
 typedef struct {
 	char *cmd;
 	void (*cmd_func) (char *arg);
@@ -84,16 +57,11 @@ inline std::string uppercase_string(std::string str);
 static double detect_signal(int freq, int bw, double *low, double *high);
 static bool kiss_queue_frame(KISS_QUEUE_FRAME * frame, std::string cmd);
 static bool valid_kiss_modem(std::string _modem);
-static KISS_QUEUE_FRAME *encap_kiss_frame(char *buffer, size_t size, int frame_type, int kiss_port_no);
+static KISS_QUEUE_FRAME *encap_kiss_frame(const char *buffer, size_t size, int frame_type, int kiss_port_no);
 static KISS_QUEUE_FRAME *encap_kiss_frame(std::string data, int kiss_frame_type, int port);
-static KISS_QUEUE_FRAME *encap_kiss_frame(std::string package, int frame_type, int kiss_port_no);
-static size_t decap_hdlc_frame(char *buffer, size_t data_count);
-static size_t encap_hdlc_frame(char *buffer, size_t data_count);
-static size_t kiss_decode(char *src, size_t src_size, char **dst);
-static size_t kiss_encode(char *src, size_t src_size, char **dst);
-//static std::string kiss_decode(std::string frame);
-//static std::string kiss_encode(std::string frame);
-static std::string unencap_kiss_frame(std::string package, int *frame_type, int *kiss_port_no);
+static KISS_QUEUE_FRAME *decap_hdlc_frame(const char *buffer, size_t data_count);
+static KISS_QUEUE_FRAME *encap_hdlc_frame(const char *buffer, size_t data_count);
+static size_t unencap_kiss_frame(char *buffer, size_t buffer_size, int *frame_type, int *kiss_port_no, char **data);
 static void exec_hardware_command(std::string cmd, std::string arg);
 static void flush_tx_buffer(void);
 static void parse_hardware_frame(std::string frame);
@@ -87,8 +87,7 @@ extern void cb_doExport();
 
 extern void WriteCabrillo();
 
-extern void dxcc_entity_cache_enable(bool v);
-extern bool qsodb_dxcc_entity_find(const char* country);
+extern void qsodb_dxcc_update(void);
 
 extern void adif_read_OK();
 
@@ -0,0 +1,91 @@
+// ----------------------------------------------------------------------------
+// lookup_cache.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef LOOKUP_CACHE_H_
+#define LOOKUP_CACHE_H_
+
+#include <ctime>
+#include <string>
+#include <list>
+#include <map>
+
+#include "threads.h"
+
+/// The parsed result of one online callsign lookup
+struct lookup_record {
+	std::string name;
+	std::string fname;
+	std::string addr1;
+	std::string addr2;
+	std::string state;
+	std::string province;
+	std::string zip;
+	std::string country;
+	std::string born;
+	std::string qth;
+	std::string grid;
+	std::string latd;
+	std::string lond;
+	std::string notes;
+	bool append_notes;	// notes are added to, rather than replace, the log notes
+	time_t stamp;
+};
+
+/// A bounded, thread-safe LRU cache of lookup results that is kept on disk
+/// between sessions.  Entries older than the TTL are treated as missing.
+class lookup_cache
+{
+public:
+	lookup_cache(const std::string& filename);
+	~lookup_cache();
+
+	void limits(size_t maxsize, time_t ttl);
+
+	bool get(const std::string& key, lookup_record& rec);
+	void put(const std::string& key, const lookup_record& rec);
+	bool fresh(const std::string& key);
+
+	bool load(void);
+	bool save(void);
+	bool dirty(void);
+
+private:
+	lookup_cache(const lookup_cache&);
+	lookup_cache& operator=(const lookup_cache&);
+
+	typedef std::pair<std::string, lookup_record> entry_t;
+	typedef std::list<entry_t> entry_list_t;
+
+	void trim(void);
+	bool expired(const lookup_record& rec, time_t now) const;
+
+	std::string filename;
+	size_t maxsize;
+	time_t ttl;
+	size_t changes;
+
+	entry_list_t entries;	// most recently used first
+	std::map<std::string, entry_list_t::iterator> index;
+	pthread_mutex_t mutex;
+};
+
+#endif // LOOKUP_CACHE_H_
@@ -36,6 +36,8 @@ extern std::string lookup_country;
 extern void clear_Lookup();
 
 extern void CALLSIGNquery();
+extern void QRZclose(void);
+extern void lookup_prefetch_start(void);
 
 enum qrz_xmlquery_t { 
 QRZXML_EXIT = -1, 
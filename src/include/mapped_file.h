@@ -0,0 +1,65 @@
+// ----------------------------------------------------------------------------
+// mapped_file.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+#include <stdint.h>
+
+/// A read-only view of a whole file.  Uses mmap where available and falls
+/// back to reading the file into a heap buffer elsewhere.
+class mapped_file
+{
+public:
+	mapped_file();
+	~mapped_file();
+
+	bool open(const char* filename);
+	void close(void);
+
+	bool is_open(void) const { return data_ != 0; }
+	const char* data(void) const { return data_; }
+	size_t size(void) const { return size_; }
+
+private:
+	mapped_file(const mapped_file&);
+	mapped_file& operator=(const mapped_file&);
+
+	const char* data_;
+	size_t size_;
+	bool heap;
+};
+
+/// Identifies the source of a binary snapshot so that stale caches can be
+/// detected without parsing them.
+struct snapshot_stamp {
+	uint64_t size;
+	int64_t mtime;
+};
+
+bool snapshot_stamp_get(const char* filename, snapshot_stamp& stamp);
+bool snapshot_write(const std::string& filename, const void* data, size_t len);
+std::string snapshot_path(const char* source);
+
+#endif // MAPPED_FILE_H_
@@ -40,6 +40,7 @@
 #include "mfskvaricode.h"
 #include "mbuffer.h"
 #include "picture.h"
+#include "image_sink.h"
 
 
 #define	MFSKSampleRate		8000
@@ -60,7 +61,7 @@ class	mfsk;
 extern 	int		print_time_left(float secs, char *str, size_t len,
 			  		const char *prefix = "", const char *suffix = "");
 extern	void	updateTxPic(unsigned char data);
-extern	void	updateRxPic(unsigned char data, int pos);
+extern	void	updateRxPic(const image_sink& sink, int from, int to);
 extern	void	TxViewerResize(int W, int H);
 extern	void	showTxViewer(int W, int H);
 extern	void	createTxViewer();
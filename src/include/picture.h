@@ -41,6 +41,8 @@ private:
 	void slant_undo();
 	int zoom ;
 	int background ;
+	int dirty_first ;
+	int dirty_last ;
 	bool binary ;
 	unsigned char binary_threshold ;
 
@@ -65,6 +67,15 @@ public:
 		FL_UNLOCK_D();
 	}
 	unsigned char	pixel(int);
+	/// Does not redraw: the caller reports the changed rows with damage_rows().
+	void	set_pixel(unsigned char data, int pos) {
+		if (pos < 0 || pos >= bufsize) {
+			return ;
+		}
+		vidbuf[pos] = data;
+	}
+	void	pixels(const unsigned char *data, int pos, int len);
+	void	damage_rows(int first, int last);
 	int		handle(int);
 	void	draw();
 	void	clear();
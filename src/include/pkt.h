@@ -43,6 +43,7 @@
 #include "waterfall.h"
 #include "trx.h"
 #include "nco.h"
+#include "pkt_demod.h"
 
 #define	PKT_SampleRate 12000
 
@@ -55,27 +56,15 @@
 
 #define PKT_MinSignalPwr 0.1
 
-// is adjval too small? maybe 0.25 ? too large?
-#define PKT_PLLAdjVal	0.1
-
-// special and unique start+end of AX.25 frame symbol
-#define PKT_Flag	0x7e
 // number of mark bits prior to start of frame at 1200 baud
 #define PKT_MarkBits	320
 // number of flags used indicate start or end of frame at 1200 baud
 #define PKT_StartFlags	24
 #define PKT_EndFlags	12
 
-// 70 bytes addr + 256 payload + 2 FCS + 1 Control + 1 Protocol ID
-#define MAXOCTETS 340
-// 136 bits minimum (including start and end flags) - AX.25 v2.2 section 3.9
-//  == 15 octets.  we count only one of the two flags, though.
-#define MINOCTETS  14
-
 enum PKT_RX_STATE {
     PKT_RX_STATE_IDLE = 0,
     PKT_RX_STATE_DROP,
-    PKT_RX_STATE_START,
     PKT_RX_STATE_DATA,
     PKT_RX_STATE_STOP
 };
@@ -167,24 +156,19 @@ class pkt : public modem {
     int		detect_drop;
     void 	detect_signal();
 
-    double	lo_sync, hi_sync, mid_symbol;
-    int		lo_sync_ptr, hi_sync_ptr;
-    bool	prev_symbol, pll_symbol;
-    void	do_sync();
-
-    int		seq_ones; // number of sequential ones in data
+    // slicers, bit clocks and HDLC deframers
+    pkt_demod_bank demods;
 
     int		select_val;
     void	set_pkt_modem_params(int i);
 
-    void	rx_data();
-    void	rx(bool bit);
+    void	put_frame(int len);
 
     void Metric();
 
     unsigned char bitreverse(unsigned char in, int n);
 
-    unsigned char rxbuf[MAXOCTETS+4], *cbuf;
+    unsigned char rxbuf[MAXOCTETS+4];
 
     unsigned int computeFCS(unsigned char *h, unsigned char *t);
     bool	checkFCS(unsigned char *cp);
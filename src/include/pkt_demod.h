@@ -0,0 +1,132 @@
+// ---------------------------------------------------------------------
+// pkt_demod.h  --  bank of AX.25 AFSK demodulators
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is a proposed part of fldigi.
+//
+// fldigi is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi; if not, write to the Free Software
+// Foundation, Inc.
+// 59 Temple Place
+// Suite 330
+// Boston, MA  02111-1307  USA
+// ---------------------------------------------------------------------
+
+#ifndef PKT_DEMOD_H
+#define PKT_DEMOD_H
+
+#include <string>
+#include <deque>
+
+#include "complex.h"
+
+// special and unique start+end of AX.25 frame symbol
+#define PKT_Flag	0x7e
+
+// 70 bytes addr + 256 payload + 2 FCS + 1 Control + 1 Protocol ID
+#define MAXOCTETS 340
+// 136 bits minimum (including start and end flags) - AX.25 v2.2 section 3.9
+//  == 15 octets.  we count only one of the two flags, though.
+#define MINOCTETS  14
+
+// correlation windows: one symbol, and a shorter one with less
+// intersymbol interference
+#define PKT_Windows	2
+// mark to space gain ratios of the slicers, for de-emphasized and
+// pre-emphasized audio
+#define PKT_Tilts	3
+#define PKT_Demods	(PKT_Windows * PKT_Tilts)
+
+// frames that arrive again within this many symbols are duplicates
+#define PKT_DedupSymbols 32
+#define PKT_Recent	8
+
+// Demodulators with different filters and slicers decode the same
+// samples, one after another.  They share the mixers and the correlator
+// ring buffers, so that each one only adds a slicer, a bit clock and an
+// HDLC deframer.  Frames that pass the FCS check are merged and duplicates
+// dropped.  See scripts/tests/pkt-demod.sh.
+class pkt_demod_bank
+{
+public:
+	pkt_demod_bank();
+	~pkt_demod_bank();
+
+	void	init(int symbollen, double lo_gain, double hi_gain);
+	void	reset();
+
+	// one sample of the mark and space mixer outputs
+	void	process(cmplx lo, cmplx hi);
+
+	// copies the next new frame to buf as <flag> data FCS, and returns
+	// its length, or 0
+	int	get_frame(unsigned char *buf);
+
+	// frames decoded, decoded first and decoded by no other demodulator
+	std::string statistics();
+
+	static unsigned int fcs(const unsigned char *head, const unsigned char *tail);
+
+private:
+	pkt_demod_bank(const pkt_demod_bank&);
+	pkt_demod_bank& operator=(const pkt_demod_bank&);
+
+	struct deframer_t {
+		unsigned char	shift;
+		int		nbits;
+		int		ones;
+		int		len;		// -1: discard until the next flag
+		unsigned char	buf[MAXOCTETS];
+	};
+
+	struct recent_t {
+		bool		used;
+		unsigned long	when;
+		unsigned	mask;		// demodulators that decoded it
+		int		len;
+		unsigned char	buf[MAXOCTETS];
+	};
+
+	void	hdlc(int d, bool bit);
+	void	put_bit(deframer_t& m, int bit);
+	void	frame(int d);
+	void	retire(recent_t& r);
+
+	int	symbollen;
+	int	shortlen;
+
+	cmplx	*lo_buf, *hi_buf;
+	int	ptr;
+	cmplx	lo_sum[PKT_Windows], hi_sum[PKT_Windows];
+	double	lo_gain[PKT_Tilts], hi_gain[PKT_Tilts];
+
+	// slicer and bit clock state, one element per demodulator
+	double	mid_symbol[PKT_Demods];
+	bool	prev_symbol[PKT_Demods];
+	bool	pll_symbol[PKT_Demods];
+	deframer_t deframer[PKT_Demods];
+
+	recent_t recent[PKT_Recent];
+	int	next_recent;
+	unsigned long nsample;
+
+	std::deque<std::string> frames;
+
+	unsigned long decoded[PKT_Demods];
+	unsigned long first[PKT_Demods];
+	unsigned long only[PKT_Demods];
+};
+
+#endif
@@ -45,6 +45,7 @@ public:
 	double	sigpeak(int &f, int f1, int f2);
 	double	peak(int &f, int f1, int f2, double level);
 	double	power(int f1, int f2);
+	double	snr(int f);
 };
 
 #endif
@@ -169,24 +169,59 @@ field and restart the search to return the primary reference.
 #include <stdio.h>
 #include <string.h>
 
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+
+#include "mapped_file.h"
+
 extern char *Composite( char * );
 
+/*
+**    A decoded database record, as returned by the batch lookup
+*/
+struct qrz_record {
+  std::string call;
+  std::string fname;
+  std::string lname;
+  std::string street;
+  std::string city;
+  std::string state;
+  std::string zip;
+  std::string opclass;
+  std::string efdate;
+  std::string expdate;
+  std::string p_call;
+  std::string p_class;
+};
+
 class QRZ 
 {
   private:
+    // cached result of a callsign search: the found flag and the raw record
+    typedef std::pair<std::string, std::pair<int, std::string> > cache_entry;
+    typedef std::list<cache_entry> cache_list;
+    enum { CACHE_SIZE = 128 };
+
     char          criteria;
     index_header  idxhdr;
     char          *data;
-    char          *index;
-    char          *top;
-    FILE          *idxfile;
+    const char    *index;
+    const char    *top;
+    mapped_file   idxmap;
+    mapped_file   datmap;
+    cache_list    cache;
+    std::map<std::string, cache_list::iterator> cachemap;
+    bool          dfvalid;
+    char          lastkey[7];
     long          idxsize;
     FILE          *datafile;
     long          dataoffset;
     long          databytesread;
     char          *dfptr;
     char          *endofline;
-    char          *idxptr;
+    const char    *idxptr;
     int           found;
     char          recbuffer[512];
     unsigned int  datarecsize;
@@ -198,6 +233,9 @@ class QRZ
     int           FindState( char * ); 
     int           FindZip( char * );
     int           ReadDataBlock( long );
+    long          IndexSearch( const char *, int (*)( const char *, const char *, size_t ), size_t );
+    int           FindCallsignCached( char * );
+    void          CloseQRZFiles();
     int           nextrec();
 	bool		  hasImage;
         
@@ -230,6 +268,8 @@ class QRZ
     void NewDBpath( const char * );
 
     int  FindRecord( char * );
+    int  FindCallsigns( const std::vector<std::string>&, std::vector<qrz_record>& );
+    void GetRecord( qrz_record& );
     int  NextRecord();
     int  ReadRec();
     int  GetCount( char * );
@@ -23,9 +23,11 @@
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 #include <cstring>
 
 #include "adif_def.h"
+#include "qso_index.h"
 
 using namespace std;
 
@@ -85,6 +87,24 @@ private:
 	int nbrrecs;
 	int dirty;
 
+	// The records stay where they were added, except that a deleted
+	// record is replaced by the last one; order[n] is the index in
+	// qsorec of the n-th record in the sort order, and all the record
+	// numbers of the interface are positions in that order.
+	vector<int> order;
+	// order follows the key of the last sort, new records are inserted
+	// in place
+	bool sorted;
+	int sort_by;
+	bool sort_date_off, sort_rev;
+
+	cQsoIndex *qsoindex;
+
+	void grow();
+	void sort(int by);
+	void sort_key();
+	bool in_order(int pos);
+
 	static const int jdays[][13];
 	bool isleapyear( int y ) const;
 	int dayofyear (int year, int mon, int mday);
@@ -103,8 +123,12 @@ public:
 	void qsoDelRec (int);
 	void qsoUpdRec (int, cQsoRec *);
 	int qsoFindRec (cQsoRec *);
-	cQsoRec *getRec (int n) {return &qsorec[n];};
+	// Changes to a record returned by getRec must be passed to qsoUpdRec
+	cQsoRec *getRec (int n) {return &qsorec[order[n]];};
 	int nbrRecs () const {return nbrrecs;};
+	// position in the sort order of the n-th record of recarray()
+	int position (int n) const;
+	cQsoIndex& index ();
 	bool qsoIsValidFile(const char *);
 	int qsoReadFile (const char *);
 	int qsoWriteFile (const char *);
@@ -113,6 +137,8 @@ public:
 	void SortByMode ();
 	void SortByFreq ();
 	void sort_reverse(bool rev) { reverse = rev;}
+	// the records in storage order: that is the order in which they were
+	// added until one is deleted, which moves the last record into its slot
 	const cQsoRec *recarray() { return qsorec; }
 
 	bool duplicate(
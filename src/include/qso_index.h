@@ -0,0 +1,161 @@
+// ----------------------------------------------------------------------------
+// qso_index.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef QSO_INDEX_H_
+#define QSO_INDEX_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <pthread.h>
+#if HAVE_STD_HASH
+#	include <unordered_map>
+#elif HAVE_STD_TR1_HASH
+#	include <tr1/unordered_map>
+#endif
+
+#include "globals.h"
+
+class cQsoDb;
+class cQsoRec;
+
+/// What a query matches.  Empty fields match every record; the text
+/// fields are not case sensitive.
+struct qso_query {
+	std::string call;
+	std::string band;		// band name, e.g. "20m"
+	std::string mode;
+	std::string grid;		// first four characters of the locator
+	std::string dxcc;		// entity name, as in cty.dat
+	std::string date_from;		// YYYYMMDD, inclusive
+	std::string date_to;
+};
+
+/// Flags of cQsoIndex::status().  A QSO is confirmed when its QSL has been
+/// received.
+enum {
+	QSO_WORKED		= 1 << 0,	// the entity, on any band and mode
+	QSO_WORKED_BAND		= 1 << 1,	// on the band, in any mode
+	QSO_WORKED_MODE		= 1 << 2,	// on the band and in the mode
+	QSO_CONFIRMED		= 1 << 3,
+	QSO_CONFIRMED_BAND	= 1 << 4,
+	QSO_CONFIRMED_MODE	= 1 << 5
+};
+
+/// Secondary indexes of a cQsoDb by callsign, band, mode, date, grid
+/// square and DXCC entity.  cQsoDb keeps them up to date as records are
+/// added, changed and deleted; a query starts from the smallest list of
+/// records that can match and checks the other fields of each.
+/// The record numbers are indices in cQsoDb::recarray().  The index reads
+/// the records only on the GUI thread, which owns the log.  Other threads,
+/// such as the trx thread of the spot notifier, may query it: it has a lock
+/// for them.  While the log is being read the index is out of date, and
+/// queries answer as if the log were empty until the GUI thread rebuilds it.
+/// The index also counts the worked and confirmed QSOs of each entity,
+/// band and mode, so that status() is a few hash lookups.
+class cQsoIndex
+{
+public:
+	cQsoIndex(cQsoDb& db);
+	~cQsoIndex();
+
+	// called by cQsoDb
+	void add(int rec);
+	void remove(int rec);
+	/// Reindexes a changed record, unless its keys are the same
+	void update(int rec);
+	void move(int from, int to);
+	void clear(void);
+	/// Marks the index out of date until the next rebuild.  Must be
+	/// called before the records are read or moved by another thread.
+	void invalidate(void);
+	/// GUI thread only
+	void rebuild(void);
+	/// Rebuilds the index unless it is out of date already, for when the
+	/// keys it derives from the records change.  GUI thread only.
+	void refresh(void);
+	/// False while the index is out of date
+	bool ready(void);
+
+	/// Fills recs with the records that match q, the most recent first.
+	/// Stops after max records if max is not 0.  Returns the number found.
+	size_t find(const qso_query& q, std::vector<int>& recs, size_t max = 0);
+	/// The most recent QSO with call, or -1
+	int last(const char* call);
+	bool worked(const char* call, const char* band = "", const char* mode = "");
+	/// The QSO_* flags of an entity, on band and in mode.  The band flags
+	/// are not set if band is NUM_BANDS, nor the mode flags if mode is empty.
+	unsigned status(const char* dxcc, band_t band = NUM_BANDS, const char* mode = "");
+
+private:
+	cQsoIndex(const cQsoIndex&);
+	cQsoIndex& operator=(const cQsoIndex&);
+
+	typedef std::map<std::string, std::vector<int> > list_map;
+	typedef std::multimap<std::string, int> date_map;
+
+	struct counts {
+		unsigned worked, confirmed;
+		counts() : worked(0), confirmed(0) { }
+	};
+	// by entity, entity and band, entity, band and mode
+#if HAVE_STD_HASH
+	typedef std::unordered_map<std::string, counts> status_map;
+#elif HAVE_STD_TR1_HASH
+	typedef std::tr1::unordered_map<std::string, counts> status_map;
+#else
+	typedef std::map<std::string, counts> status_map;
+#endif
+
+	// the keys of a record, as indexed
+	struct entry {
+		bool		used;
+		bool		confirmed;
+		band_t		band;
+		std::string	call, mode, grid, dxcc, date, when;
+		entry() : used(false), confirmed(false), band(BAND_OTHER) { }
+	};
+
+	struct recent_first;
+
+	void keys(int rec, entry& e);
+	static bool same_keys(const entry& a, const entry& b);
+	void add_(int rec);
+	void remove_(int rec);
+	void clear_(void);
+	void rebuild_(void);
+	bool match(const entry& e, const qso_query& q, band_t band);
+	static void unlist(std::vector<int>& v, int rec);
+	static void relist(std::vector<int>& v, int from, int to);
+	void count(const entry& e, int n);
+
+	cQsoDb& db;
+	pthread_mutex_t mutex;
+	bool valid;
+	std::vector<entry> entries;	// by record number
+	list_map calls, modes, grids, dxccs;
+	std::vector<int> bands[NUM_BANDS];
+	date_map dates;
+	status_map statuses;
+};
+
+#endif // QSO_INDEX_H_
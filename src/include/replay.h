@@ -0,0 +1,64 @@
+// ----------------------------------------------------------------------------
+// replay.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <string>
+#include <vector>
+
+// While the audio is captured to a file, the receiver settings that the
+// modems use are recorded next to it in NAME.events, whether they were
+// changed from the GUI, by XML-RPC or by a macro.  The benchmark build can
+// then replay the session, see --benchmark-replay.  Each line is an event
+//
+//	FRAME KEY VALUE
+//
+// where FRAME is the position in the capture file from which the value
+// holds.  The keys are mode (short name), freq (Hz), afc and sql (0 or 1)
+// and sqlevel.  A capture starts with all of them; a mode event is
+// followed by the frequency of the new modem.  Lines that start with # are
+// comments.
+
+struct replay_event
+{
+	long long frame;
+	std::string key;
+	std::string value;
+};
+
+/// Starts recording the events of the capture file name
+bool replay_record_start(const char* name);
+void replay_record_stop(void);
+
+/// Called from the trx thread before the capture is given more frames.
+/// frame is the number of frames captured so far.
+void replay_record(long long frame);
+
+/// Called by the modems when their frequency is set.  The changes made by
+/// the trx thread itself, such as the AFC's, are not events.
+void replay_freq_changed(void);
+
+/// Reads the events of the capture file name in frame order
+bool replay_load(const char* name, std::vector<replay_event>& events);
+
+#endif // REPLAY_H_
@@ -0,0 +1,86 @@
+// ----------------------------------------------------------------------------
+// rxlatency.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef RXLATENCY_H_
+#define RXLATENCY_H_
+
+#include <string>
+
+// Stages of the receive path.  Each block of samples read from the sound
+// card carries the capture time of its newest sample down to the modem and
+// to the characters it decodes.
+enum {
+	RXLAT_CAPTURE,		// sample captured -> returned by SoundBase::Read
+	RXLAT_READ,		// one SoundBase::Read call
+	RXLAT_MODEM,		// one modem::rx_process call
+	RXLAT_DECODE,		// sample captured -> character decoded
+	RXLAT_DISPLAY,		// sample captured -> character shown
+	RXLAT_NUM_STAGES
+};
+
+// Queues between the stages, sampled once per block
+enum {
+	RXLAT_SOUND_QUEUE,	// captured samples not read yet, in blocks
+	RXLAT_GUI_QUEUE,	// trx thread requests waiting for the GUI thread
+	RXLAT_NUM_QUEUES
+};
+
+// quarter octaves of microseconds, from 1 us to about 30 s
+#define RXLAT_BUCKETS	100
+#define RXLAT_DEPTHS	64
+
+// Each histogram has a single writer, the trx thread or, for the display
+// stage, the GUI thread.  Readers take a copy without locking, which may
+// be off by the block being added.
+struct rxlat_hist_t {
+	unsigned long	count;
+	double		sum;
+	double		max;
+	unsigned long	bucket[RXLAT_BUCKETS];
+};
+
+struct rxlat_depth_t {
+	unsigned long	count;
+	unsigned long	sum;
+	unsigned long	max;
+	unsigned long	bucket[RXLAT_DEPTHS];	// the last one counts all deeper
+};
+
+double	rxlat_now(void);
+
+// trx thread
+void	rxlat_stage(int stage, double seconds);
+void	rxlat_queue(int queue, unsigned long depth);
+void	rxlat_block(double capture_time);
+void	rxlat_block_done(void);
+void	rxlat_char(void);
+
+void	rxlat_get(int stage, rxlat_hist_t& h);
+void	rxlat_get_queue(int queue, rxlat_depth_t& d);
+double	rxlat_percentile(const rxlat_hist_t& h, double p);
+double	rxlat_bucket_top(int bucket);
+const char* rxlat_stage_name(int stage);
+const char* rxlat_queue_name(int queue);
+std::string rxlat_report(void);
+void	rxlat_reset(void);
+
+#endif // RXLATENCY_H_
@@ -97,6 +97,8 @@ protected:
 
 	bool   new_playback;
 
+	sf_count_t capture_frames;	// written to ofCapture
+
 	sf_count_t  read_file(SNDFILE* file, float* buf, size_t count);
 	void         write_file(SNDFILE* file, float* buf, size_t count);
 	void         write_file(SNDFILE* file, double* buf, size_t count);
@@ -110,6 +112,9 @@ protected:
 	bool	playback;
 	bool	generate;
 
+	// seconds since the newest sample returned by Read was captured
+	double	rx_age;
+
 public:
 	SoundBase();
 	virtual ~SoundBase();
@@ -121,6 +126,7 @@ public:
 	virtual size_t	Read(float *, size_t) = 0;
 	virtual void    flush(unsigned dir = UINT_MAX) = 0;
 	virtual bool	must_close(int dir = 0) = 0;
+	double	capture_age(void) const { return rx_age; }
 #if USE_SNDFILE
 	void	get_file_params(const char* def_fname, const char** fname, int* format);
 	int		Capture(bool val);
@@ -263,6 +269,7 @@ private:
                 ringbuffer<float>* rb;
 		size_t blocksize;
                 size_t advance;
+		volatile double cb_time; // of the last input callback
         } sd[2];
 };
 
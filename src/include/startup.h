@@ -0,0 +1,40 @@
+// ----------------------------------------------------------------------------
+// startup.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef STARTUP_H_
+#define STARTUP_H_
+
+/// Records the end of a startup phase that ran on the main thread.
+void startup_mark(const char* phase);
+
+/// Runs job() on its own thread.  done(), if given, is then called from the
+/// FLTK thread so that it may enable the widgets that depend on the data.
+void startup_job(const char* name, void (*job)(void), void (*done)(void) = 0);
+
+/// Blocks until all background jobs have finished.
+void startup_wait(void);
+
+/// Marks the main window as shown and writes the phase timings to the debug
+/// log as soon as all background jobs have finished.
+void startup_report(void);
+
+#endif // STARTUP_H_
@@ -42,6 +42,10 @@ class synop {
 	// the name of the regular expression which matched. It helps
 	// for debugging because the output is independent of the locale.
 	static bool m_test_mode ;
+
+	// When set, groups are matched with regexec instead of the precompiled
+	// tables. The results are the same, this is for comparing them.
+	static bool m_posix_regex ;
 public:
 
 	static const synop_callback * ptr_callback ;
@@ -74,6 +78,9 @@ public:
 
 	static bool GetTestMode(void) { return m_test_mode ; };
 	static void SetTestMode(bool test_mode) { m_test_mode = test_mode ; };
+
+	static bool GetPosixRegex(void) { return m_posix_regex ; };
+	static void SetPosixRegex(bool posix_regex) { m_posix_regex = posix_regex ; };
 };
 
 // gathers the various data files used for Synop decoding.
@@ -66,6 +66,12 @@ private:
 
 	// Cell data
 	std::vector<char**> data;
+	// or the source of the rows, see dataSource()
+	const char *(*source)(int row, int column, void *arg);
+	void *sourceArg;
+	std::vector<char*> sourceRow;
+	char **rowData(int row);
+	const char *cellData(int row, int column);
 	bool (*highlighter)(int, char **, Fl_Color *);
 
 	// Table dimensions
@@ -194,6 +200,8 @@ public:
 	void addFromTSV(const char *data);
 	void removeRow(int row);
 	void clear(bool removeColumns = false);
+	void dataSource(const char *(*source)(int row, int column, void *arg),
+	    void *arg, int rows);
 
 	void where(int x, int y, int &row, int &column, int &resize);
 	void scrollTo(int pos);
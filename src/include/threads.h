@@ -50,6 +50,7 @@ enum {
 	ARQSOCKET_TID,
 	KISS_TID,
 	KISSSOCKET_TID,
+	VIEWROUTE_TID,
 	FLMAIN_TID,
 	NUM_THREADS,
 	NUM_QRUNNER_THREADS = NUM_THREADS - 1
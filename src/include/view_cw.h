@@ -0,0 +1,123 @@
+// ----------------------------------------------------------------------------
+// view_cw.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef VIEW_CW_H
+#define VIEW_CW_H
+
+#include "complex.h"
+#include "gfft.h"
+#include "morse.h"
+#include "viewpsk.h"
+
+#define	VIEW_CW_SampleRate	8000
+#define VIEW_CW_FFTLEN		256	// 31.25 Hz filters
+#define VIEW_CW_HOP		32	// 4 ms frames
+#define VIEW_CW_BINS		(VIEW_CW_FFTLEN / 2)
+#define VIEW_CW_FRAMERATE	(VIEW_CW_SampleRate / VIEW_CW_HOP)
+#define VIEW_CW_CHANNELS	96
+#define VIEW_CW_MAXREP		8	// longest dot-dash shape + 1
+
+/// A CW skimmer.  One FFT filterbank covers the whole audio passband; every
+/// keyed carrier that rises above the squelch gets a channel with its own
+/// adaptive speed Morse decoder.  The decoded text goes to the signal browser
+/// and to the spotter, which picks out the callsigns.
+class view_cw
+{
+public:
+	view_cw();
+	~view_cw();
+
+	void init();
+	int rx_process(const double *buf, int len);
+
+	/// Browser lines are 100 Hz slots above the low frequency cutoff
+	void clear();
+	void clearch(int line);
+	int get_freq(int line);
+
+	/// The number of signals that are being decoded
+	int active(void) const { return nactive; }
+
+private:
+	view_cw(const view_cw&);
+	view_cw& operator=(const view_cw&);
+
+	struct channel_t {
+		bool		used;
+		int		bin;		// filter that carries the signal
+		double		frequency;
+		int		line;		// browser line, or -1
+		bool		keydown;
+		unsigned	start;		// frame of the last key down
+		unsigned	end;		// frame of the last key up
+		unsigned	heard;		// frame of the last element
+		int		last_mark;	// length of the last element
+		int		prev_mark;	// and of the one before
+		double		threshold;	// dot/dash threshold (2 dots)
+		int		ntrack;		// dot-dash pairs seen, up to the filter length
+		double		quality;	// share of characters with several elements
+		char		rep[VIEW_CW_MAXREP];
+		int		nrep;
+		bool		space_sent;
+	};
+
+	void	frame();
+	void	find_signals();
+	void	track(channel_t& ch);
+	void	key(channel_t& ch, bool down);
+	void	update_speed(channel_t& ch, int dot, int dash);
+	void	flush_char(channel_t& ch);
+	void	put(channel_t& ch, const char* s);
+	void	release(channel_t& ch);
+	int	free_line(double freq);
+	double	interpolate(int bin);
+
+	g_fft<double>	*fft;
+	double		window[VIEW_CW_FFTLEN];
+	double		history[VIEW_CW_FFTLEN];
+	cmplx		fftbuf[VIEW_CW_FFTLEN];
+	int		inptr;
+
+	double		amplitude[VIEW_CW_BINS];
+	double		noise[VIEW_CW_BINS];	// key up level
+	double		peak[VIEW_CW_BINS];	// key down level
+	int		owner[VIEW_CW_BINS];	// channel of the bin, or -1
+
+	channel_t	channel[VIEW_CW_CHANNELS];
+	int		nactive;
+	unsigned	nframe;
+
+	int		lowfreq;
+	int		lowbin;
+	int		highbin;
+	double		min_threshold;	// fastest speed
+	double		max_threshold;	// slowest speed
+	double		squelch;	// key down to key up level ratio
+
+	int		line_owner[MAXCHANNELS];
+	bool		reset_line[MAXCHANNELS];
+	bool		reset_all;
+
+	cMorse		morse;
+};
+
+#endif
@@ -0,0 +1,76 @@
+// ----------------------------------------------------------------------------
+// view_route.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef VIEW_ROUTE_H_
+#define VIEW_ROUTE_H_
+
+#include <string>
+#include <sys/time.h>
+
+#include "globals.h"
+
+// The decoders of the signal browser pass their characters to
+// view_route_chr() from the trx thread.  The characters of each channel are
+// put together into lines, without locking, and the lines are queued for a
+// thread that hands them to the subscribers, a text log and the clients of
+// a TCP socket.  A line ends at a newline, at a space after
+// VIEW_ROUTE_LINE_BREAK characters, at VIEW_ROUTE_LINE_MAX characters, and
+// when the channel loses its signal.  The spotter is not a subscriber: it
+// gets each character as soon as it is decoded, so that slow CW spots are
+// not delayed until the end of their line and no spotter input is dropped
+// with the lines of a full queue.
+
+#define VIEW_ROUTE_LINE_BREAK	64
+#define VIEW_ROUTE_LINE_MAX	80
+
+struct view_line_t
+{
+	struct timeval time;	// of the first character
+	int channel;		// browser line, or decoder number
+	int afreq;		// of the last character
+	trx_mode mode;
+	double snr;		// dB, averaged over the line
+	std::string text;	// empty for a newline alone
+	bool eol;		// ended by a newline, which is not in text
+};
+
+typedef void (*view_route_cb_t)(const view_line_t& line, void* data);
+
+/// Adds a character from the trx thread.  snr is the decoder's estimate in dB.
+void view_route_chr(int channel, int afreq, int c, trx_mode mode, double snr);
+/// Ends the line of a channel that has lost its signal, from the trx thread
+void view_route_clear(int channel);
+
+/// Registers a subscriber, called in the routing thread.  A subscriber that
+/// updates the GUI must pass the lines on with REQ itself.
+void view_route_subscribe(view_route_cb_t cb, void* data);
+void view_route_unsubscribe(view_route_cb_t cb, const void* data);
+
+/// Formats a line as the text log and the socket clients get it:
+/// TIME CHANNEL AFREQ MODE SNR TEXT, tab separated, TIME in UTC.  They do
+/// not get the lines without text.
+std::string view_route_format(const view_line_t& line);
+
+void view_route_start(void);
+void view_route_stop(void);
+
+#endif // VIEW_ROUTE_H_
@@ -30,14 +30,14 @@
 #include "complex.h"
 #include "modem.h"
 #include "globals.h"
-#include "filters.h"
-#include "fftfilt.h"
+#include "gfft.h"
 #include "digiscope.h"
 
 #define	VIEW_RTTY_SampleRate	8000
 
-#define VIEW_MAXPIPE 1024
-#define	VIEW_RTTY_MAXBITS	(2 * VIEW_RTTY_SampleRate / 23 + 1)
+// filterbank outputs per symbol
+#define VIEW_RTTY_HOPS	8
+#define	VIEW_RTTY_MAXBITS	(2 * VIEW_RTTY_HOPS)
 
 #define MAX_CHANNELS 30
 
@@ -63,10 +63,8 @@ enum RTTY_PARITY {
 	static const double	SHIFT[];
 	static const double	BAUD[];
 	static const int		BITS[];
-	static const int		FILTLEN[];
 	static const int		numshifts;
 	static const int		numbauds;
-	int		filter_length;
 
 private:
 
@@ -76,17 +74,20 @@ struct RTTY_CHANNEL {
 
 	double			phaseacc;
 
-	fftfilt *mark_filt;
-	fftfilt *space_filt;
-
-	Cmovavg		*bits;
-	bool		nubit;
-	bool		bit;
+	// filterbank bins of the tones, the mark tone is the upper one
+	double		shift;
+	int			mark_bin;
+	int			space_bin;
+	cmplx		stop_prev;	// stop bit tone of the previous frame, for the AFC
 
 	bool		bit_buf[VIEW_RTTY_MAXBITS];
+	double		afc_buf[VIEW_RTTY_MAXBITS];	// stop tone error of each frame
 
-	double mark_phase;
-	double space_phase;
+	// mark and space powers and their product while searching
+	double		mark_sum;
+	double		space_sum;
+	double		cross_sum;
+	int			frames;
 
 	double		metric;
 
@@ -94,39 +95,15 @@ struct RTTY_CHANNEL {
 	RTTY_RX_STATE	rxstate;
 
 	double		frequency;
-	double		freqerr;
-	double		phase;
-	double		posfreq;
-	double		negfreq;
-	double		freqerrhi;
-	double		freqerrlo;
 	double		poserr;
 	double		negerr;
-	int			poscnt;
-	int			negcnt;
 	int			timeout;
 
-	double		mark_mag;
-	double		space_mag;
-	double		mark_env;
-	double		space_env;
-	double		noise_floor;
-	double		mark_noise;
-	double		space_noise;
-
 	double		sigpwr;
-	double		noisepwr;
-	double		avgsig;
 
-	double		prevsymbol;
-	cmplx		prevsmpl;
-	int			counter;
+	double		counter;	// frames to the next bit sample
 	int			bitcntr;
 	int			rxdata;
-	int			inp_ptr;
-
-	cmplx		mark_history[VIEW_MAXPIPE];
-	cmplx		space_history[VIEW_MAXPIPE];
 
 	int			sigsearch;
 };
@@ -140,6 +117,28 @@ struct RTTY_CHANNEL {
 
 	RTTY_CHANNEL	channel[MAX_CHANNELS];
 
+// One short time Fourier transform feeds all the channels.  Its bins are
+// the mark and space filters, their squared magnitudes the envelopes.
+	g_fft<double>	*fft;
+	int			fftlen;
+	int			winlen;		// Hann window, 1.5 symbols
+	int			hop;		// samples between frames
+	int			nbins;
+	double		binwidth;
+	double		enbw;		// equivalent noise bandwidth of a bin
+	double		symlen;		// frames per symbol
+	int			nbuf;		// bit_buf length, one symbol
+	double		*window;
+	double		*history;
+	cmplx		*fftbuf;
+	int			inptr;
+	double		*power;		// envelopes of the current frame
+	double		*avgpwr;	// and their averages over two symbols
+	double		*sortbuf;
+	double		noise_floor;	// bin noise power
+	int			lowbin;
+	int			highbin;
+
 	double		rtty_squelch;
 	double		rtty_shift;
 	double      rtty_BW;
@@ -158,7 +157,15 @@ struct RTTY_CHANNEL {
 
 	void clear_syncscope();
 	void update_syncscope();
-	cmplx mixer(double &phase, double f, cmplx in);
+
+	void free_filterbank();
+	void set_bins(int ch);
+	void frame();
+	void demodulate(int ch);
+	void measure_noise();
+	double tone_snr(int bin);
+	bool find_tones(double lo, double hi, double &freq, double &tshift);
+	bool is_fsk(int ch);
 
 	unsigned char bitreverse(unsigned char in, int n);
 	int decode_char(int ch);
@@ -175,7 +182,6 @@ public:
 	void rx_init();
 	void tx_init(SoundBase *sc){}
 	void restart();
-	void reset_filters(int ch);
 	int rx_process(const double *buf, int len);
 	int tx_process();
 
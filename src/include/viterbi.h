@@ -33,11 +33,32 @@ private:
 	int _chunksize;
 	int nstates;
 	int *output;
-	int *metrics[PATHMEM];
-	int *history[PATHMEM];
+// Two rows of path metrics.  The metric of state 0 is subtracted at every
+// step, which keeps them within a short; their spread is at most
+// (k - 1) * 510.
+	short *metrics[2];
+	short *metbuf;
+// ACS decisions, one bit per state.  Word w of a step holds the decisions
+// of the even states 2j, j = 16w .. 16w + 15, in its low half and those of
+// the odd states 2j + 1 in its high half.  A set bit selects the upper
+// predecessor j + nstates / 2.
+	unsigned int *history[PATHMEM];
+	unsigned int *histbuf;
+	int histwords;
+// Sign masks of the branch metrics of the even states, and the output bits
+// that change from state 2j to 2j + nstates and to 2j + 1
+	short *sign[2];
+	int upper_out;
+	int odd_out;
+	int symbols[PATHMEM][2];	// soft symbols - 128
 	int sequence[PATHMEM];
-	int mettab[2][256];
 	unsigned int ptr;
+	unsigned int steps;		// written since reset, up to PATHMEM
+	bool vector;
+	void acs(const short *prev, short *curr, unsigned int *dec, int a, int b);
+	void acs_vector(const short *prev, short *curr, unsigned int *dec, int a, int b);
+	int predecessor(unsigned int p, int state);
+	int branch(unsigned int p, int state);
 	int traceback(int *metric);
 public:
 	viterbi(int k, int poly1, int poly2);
@@ -45,6 +66,7 @@ public:
 	void reset();
 	int settraceback(int trace);
 	int setchunksize(int chunk);
+	int setvector(bool on);
 	int decode(unsigned char *sym, int *metric);
 };
 
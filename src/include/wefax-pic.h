@@ -27,6 +27,7 @@
 class Fl_Menu_ ;
 
 class wefax ;
+class image_sink ;
 
 class wefax_pic
 {
@@ -37,7 +38,7 @@ public:
 	static int  normalize_lpm( double the_lpm_value );
 	static void update_rx_lpm(int lpm);
 	static int update_rx_pic_col(unsigned char data, int pos);
-	static void update_rx_pic_bw(unsigned char data, int pos);
+	static void update_rx_pic_bw(const image_sink & sink, int from, int to);
 	static void tx_viewer_resize(int the_width, int the_height);
 	static void restart_tx_viewer(void);
 	static void abort_rx_viewer(void);
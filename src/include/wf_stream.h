@@ -0,0 +1,103 @@
+// ----------------------------------------------------------------------------
+// wf_stream.h
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#ifndef WF_STREAM_H_
+#define WF_STREAM_H_
+
+#include <cstddef>
+
+// The waterfall rows are streamed to the clients of a TCP socket, and may be
+// archived to files, as a sequence of frames.  A frame is a header of
+// WF_STREAM_HEADER_SIZE bytes, all fields little endian:
+//
+//	 0  "FLWF"
+//	 4  u8	version, WF_STREAM_VERSION
+//	 5  u8	flags, WF_STREAM_KEY
+//	 6  u16	width, the number of 1 Hz bins from 0 Hz
+//	 8  u32	sequence number, in steps of one row
+//	12  u32	time, seconds
+//	16  u32	time, microseconds
+//	20  i64	RF carrier frequency in Hz
+//	28  i16	waterfall reference level, dB
+//	30  i16	waterfall amplitude span, dB
+//	32  u8	1 if upper sideband
+//	33  u8	3 bytes of padding
+//	36  u32	payload size
+//
+// followed by the payload, the power of each bin in integer dB clamped to
+// [-128, 127].  Each bin is predicted from the previous bin of the row in a
+// key frame, and from the same bin of the previous row otherwise; the
+// difference d to the prediction is coded as:
+//
+//	0x00 - 0x7f	d in [-64, 63], as 7 bit two's complement
+//	0x81 - 0xff	(byte & 0x7f) bins with d = 0
+//	0x80 v		the bin is v, as a signed byte
+//
+// A client that connects, or that cannot keep up, is sent a key frame next.
+// The archive files start with a key frame.
+
+#define WF_STREAM_MAGIC		"FLWF"
+#define WF_STREAM_HEADER_SIZE	40
+
+enum { WF_STREAM_VERSION = 1 };
+enum { WF_STREAM_KEY = 1 << 0 };
+
+struct wf_stream_header
+{
+	unsigned char version, flags;
+	unsigned short width;
+	unsigned int seq;
+	unsigned int sec, usec;
+	long long rf;
+	short reflevel, ampspan;
+	bool usb;
+	unsigned int size;
+};
+
+void wf_stream_pack(const wf_stream_header& h, unsigned char* buf);
+/// Returns false if buf is not a frame header
+bool wf_stream_unpack(const unsigned char* buf, wf_stream_header& h);
+
+/// Codes the width bins of row.  prev is the previous row, or NULL for a key
+/// frame.  out must hold 2 * width bytes.  Returns the payload size.
+size_t wf_stream_encode(const signed char* row, const signed char* prev, int width,
+			unsigned char* out);
+/// Decodes a payload to row, which holds the previous row unless key.
+/// Returns false if the payload is not width bins.
+bool wf_stream_decode(const unsigned char* in, size_t n, bool key, int width,
+		      signed char* row);
+
+/// Starts the stream server and the archive if they are configured
+void wf_stream_start(void);
+void wf_stream_stop(void);
+
+// Called by the waterfall from the trx thread.  wf_stream_row() returns the
+// buffer of the next row, or NULL when there is nothing to stream to; the
+// row is queued by wf_stream_commit().  A full queue drops its oldest row,
+// the server never blocks the waterfall.
+signed char* wf_stream_row(int width);
+void wf_stream_commit(long long rf, bool usb, int reflevel, int ampspan);
+
+/// Decodes the archive file name to a PGM image, name.pgm, as fast as it can
+bool wf_stream_replay(const char* name);
+
+#endif // WF_STREAM_H_
@@ -46,6 +46,7 @@ void start_logbook ()
 		logbook_filename = progdefaults.logbookfilename;
 
 	qsodb.deleteRecs();
+	wBrowser->clear();
 
 	adifFile.readFile (logbook_filename.c_str(), &qsodb);
 
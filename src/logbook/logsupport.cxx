@@ -242,11 +242,6 @@ void saveLogbook()
 
 }
 
-static void dxcc_entity_cache_clear(void);
-static void dxcc_entity_cache_add(cQsoRec* r);
-static void dxcc_entity_cache_rm(cQsoRec* r);
-static void dxcc_entity_cache_add(cQsoDb& db);
-
 void cb_mnuNewLogbook(Fl_Menu_* m, void* d){
 	saveLogbook();
 
@@ -256,7 +251,6 @@ void cb_mnuNewLogbook(Fl_Menu_* m, void* d){
 	dlgLogbook->label(fl_filename_name(logbook_filename.c_str()));
 	progdefaults.changed = true;
 	qsodb.deleteRecs();
-	dxcc_entity_cache_clear();
 	wBrowser->clear();
 	clearRecord();
 }
@@ -265,8 +259,7 @@ void adif_read_OK()
 {
 	if (qsodb.nbrRecs() == 0)
 		adifFile.writeFile(logbook_filename.c_str(), &qsodb);
-	dxcc_entity_cache_clear();
-	dxcc_entity_cache_add(qsodb);
+	qsodb.index().rebuild();
 	restore_sort();
 	activateButtons();
 	loadBrowser();
@@ -285,6 +278,8 @@ void cb_mnuOpenLogbook(Fl_Menu_* m, void* d)
 	if (p) {
 		saveLogbook();
 		qsodb.deleteRecs();
+		// the browser reads qsodb, which is filled by the ADIF thread
+		wBrowser->clear();
 
 		logbook_filename = p;
 		progdefaults.logbookfilename = logbook_filename;
@@ -747,14 +742,12 @@ void DupCheck()
 	inpCall4->redraw();
 }
 
+// Returns the most recent QSO with callsign
 cQsoRec* SearchLog(const char *callsign)
 {
-	size_t len = strlen(callsign);
-	char* re = new char[len + 3];
-	snprintf(re, len + 3, "^%s$", callsign);
-
-	int row = 0, col = 2;
-	return wBrowser->search(row, col, !cQsoDb::reverse, re) ? qsodb.getRec(row) : 0;
+	int rec = qsodb.index().last(callsign);
+	int pos = rec < 0 ? -1 : qsodb.position(rec);
+	return pos < 0 ? 0 : qsodb.getRec(pos);
 }
 
 void SearchLastQSO(const char *callsign)
@@ -770,12 +763,9 @@ void SearchLastQSO(const char *callsign)
 
 	Fl::focus(inpCall);
 
-	char* re = new char[len + 3];
-	snprintf(re, len + 3, "^%s$", callsign);
-
-	int row = 0, col = 2;
-	if (wBrowser->search(row, col, !cQsoDb::reverse, re)) {
-		wBrowser->GotoRow(row);
+	int rec = qsodb.index().last(callsign);
+	if (rec >= 0) {
+		wBrowser->GotoRow(qsodb.position(rec));
 		inpName->value(inpName_log->value());
 		inpQth->value(inpQth_log->value());
 		inpLoc->value(inpLoc_log->value());
@@ -806,7 +796,6 @@ void SearchLastQSO(const char *callsign)
 		inpAZ->value("");
 		inpSearchString->value("");
 	}
-	delete [] re;
 }
 
 void cb_search(Fl_Widget* w, void*)
@@ -975,7 +964,6 @@ void saveRecord() {
 	rec.putField(TX_PWR, inpTX_pwr_log->value());
 
 	qsodb.qsoNewRec (&rec);
-	dxcc_entity_cache_add(&rec);
 	submit_record(rec);
 
 	cQsoDb::reverse = false;
@@ -1028,9 +1016,7 @@ cQsoRec rec;
 	rec.putField(CQZ, inpCQZ_log->value());
 	rec.putField(ITUZ, inpITUZ_log->value());
 	rec.putField(TX_PWR, inpTX_pwr_log->value());
-	dxcc_entity_cache_rm(qsodb.getRec(editNbr));
 	qsodb.qsoUpdRec (editNbr, &rec);
-	dxcc_entity_cache_add(&rec);
 
 	cQsoDb::reverse = false;
 	qsodb.SortByDate(progdefaults.sort_date_time_off);
@@ -1049,7 +1035,6 @@ void deleteRecord () {
 					       _("Yes"), _("No"), NULL, wBrowser->valueAt(-1, 2)))
 		return;
 
-	dxcc_entity_cache_rm(qsodb.getRec(editNbr));
 	qsodb.qsoDelRec(editNbr);
 
 	cQsoDb::reverse = false;
@@ -1170,27 +1155,39 @@ void cb_browser (Fl_Widget *w, void *data )
 	EditRecord (editNbr);
 }
 
+// The browser reads the rows it shows straight from qsodb, in its sort order
+static const char *browser_cell(int row, int col, void *)
+{
+	static char sNbr[12];
+	const cQsoRec *rec = qsodb.getRec(row);
+
+	switch (col) {
+	case 0:
+		return rec->getField(progdefaults.sort_date_time_off ? QSO_DATE_OFF : QSO_DATE);
+	case 1:
+		return timeview4(rec->getField(progdefaults.sort_date_time_off ? TIME_OFF : TIME_ON));
+	case 2:
+		return rec->getField(CALL);
+	case 3:
+		return rec->getField(NAME);
+	case 4:
+		return rec->getField(FREQ);
+	case 5:
+		return rec->getField(MODE);
+	default:
+		snprintf(sNbr, sizeof(sNbr), "%d", row);
+		return sNbr;
+	}
+}
+
 void loadBrowser(bool keep_pos)
 {
-	cQsoRec *rec;
-	char sNbr[6];
 	int row = wBrowser->value(), pos = wBrowser->scrollPos();
 	if (row >= qsodb.nbrRecs()) row = qsodb.nbrRecs() - 1;
 	wBrowser->clear();
 	if (qsodb.nbrRecs() == 0)
 		return;
-	for( int i = 0; i < qsodb.nbrRecs(); i++ ) {
-		rec = qsodb.getRec (i);
-		snprintf(sNbr,sizeof(sNbr),"%d",i);
-		wBrowser->addRow (7,
-			rec->getField(progdefaults.sort_date_time_off ? QSO_DATE_OFF : QSO_DATE),
-			timeview4(rec->getField(progdefaults.sort_date_time_off ? TIME_OFF : TIME_ON)),
-			rec->getField(CALL),
-			rec->getField(NAME),
-			rec->getField(FREQ),
-			rec->getField(MODE),
-			sNbr);
-	}
+	wBrowser->dataSource(browser_cell, 0, qsodb.nbrRecs());
 	if (keep_pos && row >= 0) {
 		wBrowser->value(row);
 		wBrowser->scrollTo(pos);
@@ -1573,77 +1570,8 @@ SOAPBOX: \n\n",
     return;
 }
 
-#if HAVE_STD_HASH
-#	include <unordered_map>
- 	typedef std::unordered_map<string, unsigned> dxcc_entity_cache_t;
-#elif HAVE_STD_TR1_HASH
-#	include <tr1/unordered_map>
- 	typedef tr1::unordered_map<string, unsigned> dxcc_entity_cache_t;
-#else
-#	error "No std::hash or std::tr1::hash support"
-#endif
-
-static dxcc_entity_cache_t dxcc_entity_cache;
-static bool dxcc_entity_cache_enabled = false;
-
-#include "dxcc.h"
-
-static void dxcc_entity_cache_clear(void)
-{
-	if (dxcc_entity_cache_enabled)
-		dxcc_entity_cache.clear();
-}
-
-static void dxcc_entity_cache_add(cQsoRec* r)
-{
-	if (!dxcc_entity_cache_enabled | !r)
-		return;
-
-	const dxcc* e = dxcc_lookup(r->getField(CALL));
-	if (e)
-		dxcc_entity_cache[e->country]++;
-}
-static void dxcc_entity_cache_add(cQsoDb& db)
-{
-	if (!dxcc_entity_cache_enabled)
-		return;
-
-	int n = db.nbrRecs();
-	for (int i = 0; i < n; i++)
-		dxcc_entity_cache_add(db.getRec(i));
-	if (!dxcc_entity_cache.empty())
-		LOG_INFO("Found %" PRIuSZ " countries in %d QSO records",
-			 dxcc_entity_cache.size(), n);
-}
-
-static void dxcc_entity_cache_rm(cQsoRec* r)
-{
-	if (!dxcc_entity_cache_enabled || !r)
-		return;
-
-	const dxcc* e = dxcc_lookup(r->getField(CALL));
-	if (!e)
-		return;
-	dxcc_entity_cache_t::iterator i = dxcc_entity_cache.find(e->country);
-	if (i != dxcc_entity_cache.end()) {
-		if (i->second)
-			i->second--;
-		else
-			dxcc_entity_cache.erase(i);
-	}
-}
-
-void dxcc_entity_cache_enable(bool v)
-{
-	if (dxcc_entity_cache_enabled == v)
-		return;
-
-	dxcc_entity_cache_clear();
-	if ((dxcc_entity_cache_enabled = v))
-		dxcc_entity_cache_add(qsodb);
-}
-
-bool qsodb_dxcc_entity_find(const char* country)
+// cty.dat has been (re)loaded, the entities of the log index may change
+void qsodb_dxcc_update(void)
 {
-	return dxcc_entity_cache.find(country) != dxcc_entity_cache.end();
+	qsodb.index().refresh();
 }
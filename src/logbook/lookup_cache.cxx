@@ -0,0 +1,250 @@
+// ----------------------------------------------------------------------------
+// lookup_cache.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "lookup_cache.h"
+#include "mapped_file.h"
+#include "debug.h"
+
+using namespace std;
+
+// The cache file holds one entry per line: the key, the time stamp, the notes
+// flag and the record fields, separated by tabs.
+#define LOOKUP_CACHE_VERSION "# fldigi lookup cache 1"
+
+static void escape(ostream& out, const string& s)
+{
+	for (string::const_iterator i = s.begin(); i != s.end(); ++i) {
+		switch (*i) {
+		case '\\': out << "\\\\"; break;
+		case '\t': out << "\\t"; break;
+		case '\n': out << "\\n"; break;
+		case '\r': out << "\\r"; break;
+		default: out << *i; break;
+		}
+	}
+}
+
+static void unescape(string& s)
+{
+	string::iterator o = s.begin();
+	for (string::iterator i = s.begin(); i != s.end(); ++i, ++o) {
+		if (*i == '\\' && i + 1 != s.end()) {
+			switch (*++i) {
+			case 't': *o = '\t'; break;
+			case 'n': *o = '\n'; break;
+			case 'r': *o = '\r'; break;
+			default: *o = *i; break;
+			}
+		}
+		else
+			*o = *i;
+	}
+	s.erase(o, s.end());
+}
+
+static string lookup_record::* const fields[] = {
+	&lookup_record::name, &lookup_record::fname, &lookup_record::addr1,
+	&lookup_record::addr2, &lookup_record::state, &lookup_record::province,
+	&lookup_record::zip, &lookup_record::country, &lookup_record::born,
+	&lookup_record::qth, &lookup_record::grid, &lookup_record::latd,
+	&lookup_record::lond, &lookup_record::notes
+};
+static const size_t nfields = sizeof(fields) / sizeof(*fields);
+
+lookup_cache::lookup_cache(const string& filename_)
+	: filename(filename_), maxsize(5000), ttl(30 * 86400), changes(0)
+{
+	pthread_mutex_init(&mutex, NULL);
+}
+
+lookup_cache::~lookup_cache()
+{
+	pthread_mutex_destroy(&mutex);
+}
+
+void lookup_cache::limits(size_t maxsize_, time_t ttl_)
+{
+	guard_lock lock(&mutex);
+	maxsize = maxsize_;
+	ttl = ttl_;
+	trim();
+}
+
+bool lookup_cache::expired(const lookup_record& rec, time_t now) const
+{
+	return ttl > 0 && (now - rec.stamp > ttl || rec.stamp > now + 86400);
+}
+
+// Drop least recently used entries until the cache is within its bound
+void lookup_cache::trim(void)
+{
+	while (entries.size() > maxsize) {
+		index.erase(entries.back().first);
+		entries.pop_back();
+		changes++;
+	}
+}
+
+bool lookup_cache::get(const string& key, lookup_record& rec)
+{
+	guard_lock lock(&mutex);
+
+	map<string, entry_list_t::iterator>::iterator i = index.find(key);
+	if (i == index.end())
+		return false;
+	if (expired(i->second->second, time(NULL))) {
+		entries.erase(i->second);
+		index.erase(i);
+		changes++;
+		return false;
+	}
+
+	entries.splice(entries.begin(), entries, i->second);
+	rec = i->second->second;
+	return true;
+}
+
+bool lookup_cache::fresh(const string& key)
+{
+	guard_lock lock(&mutex);
+
+	map<string, entry_list_t::iterator>::iterator i = index.find(key);
+	return i != index.end() && !expired(i->second->second, time(NULL));
+}
+
+void lookup_cache::put(const string& key, const lookup_record& rec)
+{
+	guard_lock lock(&mutex);
+
+	map<string, entry_list_t::iterator>::iterator i = index.find(key);
+	if (i != index.end()) {
+		entries.erase(i->second);
+		index.erase(i);
+	}
+	entries.push_front(entry_t(key, rec));
+	index[key] = entries.begin();
+	changes++;
+	trim();
+}
+
+bool lookup_cache::dirty(void)
+{
+	guard_lock lock(&mutex);
+	return changes != 0;
+}
+
+bool lookup_cache::load(void)
+{
+	ifstream in(filename.c_str());
+	if (!in)
+		return false;
+
+	guard_lock lock(&mutex);
+
+	entries.clear();
+	index.clear();
+
+	time_t now = time(NULL);
+	string line;
+	vector<string> v;
+	if (!getline(in, line) || line != LOOKUP_CACHE_VERSION) {
+		LOG_VERBOSE("Ignoring %s: unknown format", filename.c_str());
+		return false;
+	}
+	// entries are saved least recently used first
+	while (getline(in, line)) {
+		v.clear();
+		string::size_type p = 0, q;
+		do {
+			q = line.find('\t', p);
+			v.push_back(line.substr(p, q == string::npos ? q : q - p));
+			p = q + 1;
+		} while (q != string::npos);
+		if (v.size() != nfields + 3)
+			continue;
+
+		lookup_record rec;
+		rec.stamp = strtol(v[1].c_str(), NULL, 10);
+		rec.append_notes = v[2] == "1";
+		for (size_t j = 0; j < nfields; j++) {
+			unescape(v[j + 3]);
+			rec.*fields[j] = v[j + 3];
+		}
+		if (expired(rec, now))
+			continue;
+
+		unescape(v[0]);
+		map<string, entry_list_t::iterator>::iterator i = index.find(v[0]);
+		if (i != index.end())
+			entries.erase(i->second);
+		entries.push_front(entry_t(v[0], rec));
+		index[v[0]] = entries.begin();
+	}
+	trim();
+	changes = 0;
+
+	LOG_VERBOSE("Loaded %" PRIuSZ " entries from %s", entries.size(), filename.c_str());
+	return true;
+}
+
+bool lookup_cache::save(void)
+{
+	ostringstream out;
+	size_t saved;
+	{
+		guard_lock lock(&mutex);
+		if ((saved = changes) == 0)
+			return true;
+
+		time_t now = time(NULL);
+		out << LOOKUP_CACHE_VERSION << '\n';
+		for (entry_list_t::reverse_iterator i = entries.rbegin(); i != entries.rend(); ++i) {
+			const lookup_record& rec = i->second;
+			if (expired(rec, now))
+				continue;
+			escape(out, i->first);
+			out << '\t' << static_cast<long>(rec.stamp) << '\t' << rec.append_notes;
+			for (size_t j = 0; j < nfields; j++) {
+				out << '\t';
+				escape(out, rec.*fields[j]);
+			}
+			out << '\n';
+		}
+	}
+
+	const string& s = out.str();
+	if (!snapshot_write(filename, s.data(), s.length())) {
+		LOG_ERROR("Could not write %s", filename.c_str());
+		return false;
+	}
+
+	guard_lock lock(&mutex);
+	changes -= saved;
+	return true;
+}
@@ -33,6 +33,8 @@
 #include <sys/time.h>
 #include "signal.h"
 #include <string>
+#include <deque>
+#include <map>
 #include <iostream>
 #include <cstring>
 #include <cmath>
@@ -44,6 +46,7 @@
 #include "configuration.h"
 
 #include "lookupcall.h"
+#include "lookup_cache.h"
 #include "logsupport.h"
 #include "main.h"
 #include "confdialog.h"
@@ -57,6 +60,8 @@
 #include "debug.h"
 #include "network.h"
 #include "locator.h"
+#include "spot.h"
+#include "pskrep.h"
 
 using namespace std;
 
@@ -86,6 +91,9 @@ string lookup_notes;
 qrz_xmlquery_t DB_XML_query = QRZXMLNONE;
 qrz_webquery_t DB_WEB_query = QRZWEBNONE;
 
+// set by the query functions whose notes are added to the existing log notes
+static bool lookup_append_notes = false;
+
 enum TAG {
 	QRZ_IGNORE,	QRZ_KEY,	QRZ_ALERT,	QRZ_ERROR,	QRZ_CALL,
 	QRZ_FNAME,	QRZ_NAME,	QRZ_ADDR1,	QRZ_ADDR2,	QRZ_STATE,
@@ -97,6 +105,37 @@ pthread_t* QRZ_thread = 0;
 pthread_mutex_t qrz_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t qrz_cond = PTHREAD_COND_INITIALIZER;
 
+// A lookup request.  Requests made by the user go to the front of the queue;
+// prefetches go to the back and their results are cached but not shown.
+struct lookup_request_t {
+	string call;
+	qrz_xmlquery_t xml;
+	qrz_webquery_t web;
+	bool quiet;
+};
+
+// the following are guarded by qrz_mutex
+static deque<lookup_request_t> lookup_queue;
+static string lookup_inflight;		// key of the request being processed
+static bool lookup_inflight_show;	// show its result when it completes
+static bool lookup_exit = false;
+static map<string, time_t> lookup_prefetched;
+static lookup_record lookup_pending;	// the result for QRZ_disp_result
+static bool lookup_pending_set = false;
+
+static lookup_request_t lookup_current;
+static lookup_record lookup_shown;
+static bool lookup_displayed;
+static lookup_cache* lookup_db = 0;
+static unsigned lookup_unsaved = 0;
+
+// at most this many prefetches may be waiting at any time
+#define LOOKUP_PREFETCH_MAX 32
+// a callsign is not prefetched again within this many seconds
+#define LOOKUP_PREFETCH_INTERVAL 900
+// the cache is written after this many new results
+#define LOOKUP_SAVE_INTERVAL 20
+
 static void *LOOKUP_loop(void *args);
 
 bool parseSessionKey();
@@ -106,7 +145,7 @@ bool getSessionKey(string& sessionpage);
 bool QRZGetXML(string& xmlpage);
 int  bearing(const char *, const char *);
 void qra(const char *, double &, double &);
-void QRZ_disp_result();
+void QRZ_disp_result(void);
 void QRZ_CD_query();
 void Lookup_init(void);
 void QRZclose(void);
@@ -375,56 +414,168 @@ void camel_case(string &s)
 	}
 }
 
-void QRZ_disp_result()
+// Show the pending lookup result in the log panel.  The result is not passed
+// with the request, so nothing leaks if the request is dropped; a later
+// request shows the newest result.
+void QRZ_disp_result(void)
 {
 	ENSURE_THREAD(FLMAIN_TID);
 
-	if (lookup_fname.length() > 0) {
-		camel_case(lookup_fname);
-		string::size_type spacePos = lookup_fname.find(" ");
+	lookup_record rec;
+	{
+		guard_lock lock(&qrz_mutex);
+		if (!lookup_pending_set)
+			return;
+		rec = lookup_pending;
+		lookup_pending_set = false;
+	}
+
+	if (rec.fname.length() > 0) {
+		camel_case(rec.fname);
+		string::size_type spacePos = rec.fname.find(" ");
 		//    if fname is "ABC" then display "ABC"
 		// or if fname is "A BCD" then display "A BCD"
 		if (spacePos == string::npos || (spacePos == 1)) {
-			inpName->value(lookup_fname.c_str());
+			inpName->value(rec.fname.c_str());
 		}
 		// if fname is "ABC Y" then display "ABC"
 		else if (spacePos > 2) {
 			string fname;
-			fname.assign(lookup_fname, 0, spacePos);
+			fname.assign(rec.fname, 0, spacePos);
 			inpName->value(fname.c_str());
 		}
 		// fname must be "ABC DEF" so display "ABC DEF"
 		else {
-			inpName->value(lookup_fname.c_str());
+			inpName->value(rec.fname.c_str());
 		}
-	} else if (lookup_name.length() > 0) {
+	} else if (rec.name.length() > 0) {
 		// only name is set; don't know first/last, so just show all
-		inpName->value(lookup_name.c_str());
+		inpName->value(rec.name.c_str());
 	}
 
-	inpQth->value(lookup_qth.c_str());
+	inpQth->value(rec.qth.c_str());
 
-	inpState->value(lookup_state.c_str());
+	inpState->value(rec.state.c_str());
 
-	inpVEprov->value(lookup_province.c_str());
+	inpVEprov->value(rec.province.c_str());
 
-	inpLoc->value(lookup_grid.c_str());
+	inpLoc->value(rec.grid.c_str());
 
-	if (!lookup_country.empty())
-		inpCountry->value(lookup_country.c_str());
+	if (!rec.country.empty())
+		inpCountry->value(rec.country.c_str());
 
-	if (!progdefaults.myLocator.empty() && !lookup_grid.empty()) {
+	if (!progdefaults.myLocator.empty() && !rec.grid.empty()) {
 		char buf[10];
 		buf[0] = '\0';
 		double distance, azimuth, lon[2], lat[2];
 		if (locator2longlat(&lon[0], &lat[0], progdefaults.myLocator.c_str()) == RIG_OK &&
-		    locator2longlat(&lon[1], &lat[1], lookup_grid.c_str()) == RIG_OK &&
+		    locator2longlat(&lon[1], &lat[1], rec.grid.c_str()) == RIG_OK &&
 		    qrb(lon[0], lat[0], lon[1], lat[1], &distance, &azimuth) == RIG_OK)
 			snprintf(buf, sizeof(buf), "%03.0f", round(azimuth));
 		inpAZ->value(buf);
 	}
-	inpNotes->value(lookup_notes.c_str());
+	if (rec.append_notes) {
+		string notes = inpNotes->value();
+		if (!notes.empty() && !rec.notes.empty())
+			notes.append("\n");
+		notes.append(rec.notes);
+		inpNotes->value(notes.c_str());
+	}
+	else
+		inpNotes->value(rec.notes.c_str());
+}
+
+static string lookup_key(int xml, const string& call)
+{
+	char prefix[8];
+	snprintf(prefix, sizeof(prefix), "%d:", xml);
+	return string(prefix).append(call);
+}
+
+// only the online services are worth caching
+static bool lookup_cacheable(int xml)
+{
+	return xml == QRZNET || xml == HAMCALLNET || xml == CALLOOK || xml == HAMQTH;
+}
+
+static void lookup_get(lookup_record& rec)
+{
+	rec.name = lookup_name;
+	rec.fname = lookup_fname;
+	rec.addr1 = lookup_addr1;
+	rec.addr2 = lookup_addr2;
+	rec.state = lookup_state;
+	rec.province = lookup_province;
+	rec.zip = lookup_zip;
+	rec.country = lookup_country;
+	rec.born = lookup_born;
+	rec.qth = lookup_qth;
+	rec.grid = lookup_grid;
+	rec.latd = lookup_latd;
+	rec.lond = lookup_lond;
+	rec.notes = lookup_notes;
+	rec.append_notes = lookup_append_notes;
+	rec.stamp = time(NULL);
+}
+
+static void lookup_set(const lookup_record& rec)
+{
+	lookup_name = rec.name;
+	lookup_fname = rec.fname;
+	lookup_addr1 = rec.addr1;
+	lookup_addr2 = rec.addr2;
+	lookup_state = rec.state;
+	lookup_province = rec.province;
+	lookup_zip = rec.zip;
+	lookup_country = rec.country;
+	lookup_born = rec.born;
+	lookup_qth = rec.qth;
+	lookup_grid = rec.grid;
+	lookup_latd = rec.latd;
+	lookup_lond = rec.lond;
+	lookup_notes = rec.notes;
+	lookup_append_notes = rec.append_notes;
+}
+
+// Called by the query functions when a result is ready.  A good result from
+// an online service is cached; the result is shown unless it was prefetched.
+static void lookup_done(bool good)
+{
+	ENSURE_THREAD(QRZ_TID);
+
+	lookup_record rec;
+	lookup_get(rec);
+
+	if (good && lookup_db && progdefaults.lookup_cache && lookup_cacheable(lookup_current.xml)) {
+		lookup_db->limits(progdefaults.lookup_cache_size, progdefaults.lookup_cache_days * 86400);
+		lookup_db->put(lookup_key(lookup_current.xml, lookup_current.call), rec);
+		if (++lookup_unsaved >= LOOKUP_SAVE_INTERVAL) {
+			lookup_db->save();
+			lookup_unsaved = 0;
+		}
+	}
 
+	{
+		guard_lock lock(&qrz_mutex);
+		if (!lookup_inflight_show)
+			return;
+		lookup_pending = rec;
+		lookup_pending_set = true;
+	}
+	lookup_shown = rec;
+	lookup_displayed = true;
+	REQ(QRZ_disp_result);
+}
+
+static void lookup_alert(void)
+{
+	bool show;
+	{
+		guard_lock lock(&qrz_mutex);
+		show = lookup_inflight_show;
+	}
+	if (show)
+		REQ(QRZAlert);
 }
 
 void QRZ_CD_query()
@@ -469,7 +620,7 @@ void QRZ_CD_query()
 		lookup_born.clear();
 		lookup_notes.append("Not found in CD database");
 	}
-	REQ(QRZ_disp_result);
+	lookup_done(false);
 }
 
 void Lookup_init(void)
@@ -478,6 +629,17 @@ void Lookup_init(void)
 
 	if (QRZ_thread)
 		return;
+
+	if (!lookup_db) {
+		string fname = TempDir;
+		fname.append("lookup_cache.txt");
+		lookup_db = new lookup_cache(fname);
+		lookup_db->limits(progdefaults.lookup_cache_size, progdefaults.lookup_cache_days * 86400);
+		if (progdefaults.lookup_cache)
+			lookup_db->load();
+	}
+
+	lookup_exit = false;
 	QRZ_thread = new pthread_t;
 	if (pthread_create(QRZ_thread, NULL, LOOKUP_loop, NULL) != 0) {
 		LOG_PERROR("pthread_create");
@@ -499,12 +661,17 @@ void QRZclose(void)
 	DB_WEB_query = QRZWEB_EXIT;
 
 	pthread_mutex_lock(&qrz_mutex);
+	lookup_exit = true;
+	lookup_queue.clear();
 	pthread_cond_signal(&qrz_cond);
 	pthread_mutex_unlock(&qrz_mutex);
 
 	pthread_join(*QRZ_thread, NULL);
 	delete QRZ_thread;
 	QRZ_thread = 0;
+
+	if (lookup_db && progdefaults.lookup_cache)
+		lookup_db->save();
 }
 
 void qthappend(string &qth, string &datum) {
@@ -544,7 +711,7 @@ bool QRZLogin(string& sessionpage)
 	}
 	if (!ok) {
 		LOG_VERBOSE("failed");
-		REQ(QRZAlert);
+		lookup_alert();
 	}
 
 	return ok;
@@ -571,7 +738,7 @@ void QRZquery()
 	if (ok) {
 		parse_xml(qrzpage);
 		if (!qrzalert.empty() || !qrzerror.empty())
-			REQ(QRZAlert);
+			lookup_alert();
 		else {
 			lookup_qth = lookup_addr2;
 			if (lookup_country.find("Canada") != string::npos) {
@@ -580,9 +747,7 @@ void QRZquery()
 			}
 
 			string notes;
-			notes.assign(inpNotes->value());
 			if (progdefaults.notes_address) {
-				if (!notes.empty()) notes.append("\n");
 				notes.append(lookup_fname).append(" ").append(lookup_name).append("\n");
 				notes.append(lookup_addr1).append("\n");
 				notes.append(lookup_addr2);
@@ -594,12 +759,13 @@ void QRZquery()
 					notes.append("  ").append(lookup_country);
 			}
 			lookup_notes = notes;
-			REQ(QRZ_disp_result);
+			lookup_append_notes = true;
+			lookup_done(true);
 		}
 	}
 	else {
 		qrzerror = qrzpage;
-		REQ(QRZAlert);
+		lookup_alert();
 	}
 }
 
@@ -621,17 +787,17 @@ string node_data(const string &xmlpage, const string nodename)
 	return xmlpage.substr(pos1, pos2 - pos1);
 }
 
-void parse_callook(string& xmlpage)
+bool parse_callook(string& xmlpage)
 {
 	print_data("Callook info", xmlpage);
 	string nodestr;
 	nodestr = node_data(xmlpage, "current");
 	if (nodestr.empty()) {
 		lookup_notes = "no data from callook.info";
-		return;
+		return false;
 	}
 	size_t start_pos = xmlpage.find("</trustee>");
-	if (start_pos == string::npos) return;
+	if (start_pos == string::npos) return false;
 
 	start_pos += 10;
 	xmlpage = xmlpage.substr(start_pos);
@@ -653,14 +819,13 @@ void parse_callook(string& xmlpage)
 	}
 
 	string notes;
-	notes.assign(inpNotes->value());
 	if (progdefaults.notes_address) {
-		if (!notes.empty()) notes.append("\n");
 		notes.append(lookup_name).append("\n");
 		notes.append(lookup_addr1).append("\n");
 		notes.append(lookup_addr2);
 	}
 	lookup_notes = notes;
+	lookup_append_notes = true;
 
 	size_t p = lookup_addr2.find(",");
 	if (p != string::npos) {
@@ -671,6 +836,7 @@ void parse_callook(string& xmlpage)
 			lookup_state = lookup_addr2.substr(0, p);
 	}
 
+	return true;
 }
 
 bool CALLOOKGetXML(string& xmlpage)
@@ -694,8 +860,8 @@ void CALLOOKquery()
 	if (!ok) // change to negative for MS not getting on first try
 		ok = CALLOOKGetXML(CALLOOKpage);
 	if (ok)
-		parse_callook(CALLOOKpage);
-	REQ(QRZ_disp_result);
+		ok = parse_callook(CALLOOKpage);
+	lookup_done(ok);
 }
 
 // ---------------------------------------------------------------------
@@ -769,12 +935,13 @@ void HAMCALLquery()
 	ENSURE_THREAD(QRZ_TID);
 
 	string htmlpage;
+	bool ok;
 
-	if (HAMCALLget(htmlpage))
+	if ((ok = HAMCALLget(htmlpage)))
 		parse_html(htmlpage);
 	else
 		lookup_notes = htmlpage;
-	REQ(QRZ_disp_result);
+	lookup_done(ok);
 }
 
 // ---------------------------------------------------------------------
@@ -821,7 +988,7 @@ bool HAMQTH_get_session_id()
 	return true;
 }
 
-void parse_HAMQTH_html(const string& htmlpage)
+bool parse_HAMQTH_html(const string& htmlpage)
 {
 	print_data("HamQth html", htmlpage);
 
@@ -843,7 +1010,7 @@ void parse_HAMQTH_html(const string& htmlpage)
 		p1 = htmlpage.find("</error>", p);
 		if (p1 != string::npos)
 			lookup_notes.append(htmlpage.substr(p, p1 - p));
-		return;
+		return false;
 	}
 	if ((p = htmlpage.find("<nick>")) != string::npos) {
 		p += 6;
@@ -938,6 +1105,7 @@ void parse_HAMQTH_html(const string& htmlpage)
 			}
 		}
 	}
+	return true;
 }
 
 bool HAMQTHget(string& htmlpage)
@@ -1000,8 +1168,7 @@ void HAMQTHquery()
 
 	if (!HAMQTHget(htmlpage)) return;
 
-	parse_HAMQTH_html(htmlpage);
-	REQ(QRZ_disp_result);
+	lookup_done(parse_HAMQTH_html(htmlpage));
 
 }
 
@@ -1034,6 +1201,23 @@ void HAMQTH_DETAILS_query()
 
 // ----------------------------------------------------------------------------
 
+// Answer a request from the cache.  Returns false if the result must be
+// fetched.
+static bool lookup_cached(void)
+{
+	if (!lookup_db || !progdefaults.lookup_cache || !lookup_cacheable(lookup_current.xml))
+		return false;
+
+	lookup_record rec;
+	if (!lookup_db->get(lookup_key(lookup_current.xml, lookup_current.call), rec))
+		return false;
+
+	LOG_VERBOSE("%s found in lookup cache", lookup_current.call.c_str());
+	lookup_set(rec);
+	lookup_done(false);
+	return true;
+}
+
 static void *LOOKUP_loop(void *args)
 {
 	SET_THREAD_ID(QRZ_TID);
@@ -1043,32 +1227,45 @@ static void *LOOKUP_loop(void *args)
 	for (;;) {
 		TEST_THREAD_CANCEL();
 		pthread_mutex_lock(&qrz_mutex);
-		pthread_cond_wait(&qrz_cond, &qrz_mutex);
+		while (lookup_queue.empty() && !lookup_exit)
+			pthread_cond_wait(&qrz_cond, &qrz_mutex);
+		if (lookup_exit) {
+			pthread_mutex_unlock(&qrz_mutex);
+			return NULL;
+		}
+		lookup_current = lookup_queue.front();
+		lookup_queue.pop_front();
+		lookup_inflight = lookup_key(lookup_current.xml, lookup_current.call);
+		lookup_inflight_show = !lookup_current.quiet;
 		pthread_mutex_unlock(&qrz_mutex);
 
-		switch (DB_XML_query) {
-		case QRZCD :
-			QRZ_CD_query();
-			break;
-		case QRZNET :
-			QRZquery();
-			break;
-		case HAMCALLNET :
-			HAMCALLquery();
-			break;
-		case CALLOOK:
-			CALLOOKquery();
-			break;
-		case HAMQTH:
-			HAMQTHquery();
-			break;
-		case QRZXML_EXIT:
-			return NULL;
-		default:
-			break;
+		callsign = lookup_current.call;
+		lookup_append_notes = false;
+		lookup_displayed = false;
+
+		if (!lookup_cached()) {
+			switch (lookup_current.xml) {
+			case QRZCD :
+				QRZ_CD_query();
+				break;
+			case QRZNET :
+				QRZquery();
+				break;
+			case HAMCALLNET :
+				HAMCALLquery();
+				break;
+			case CALLOOK:
+				CALLOOKquery();
+				break;
+			case HAMQTH:
+				HAMQTHquery();
+				break;
+			default:
+				break;
+			}
 		}
 
-		switch (DB_WEB_query) {
+		switch (lookup_current.web) {
 		case QRZHTML :
 			QRZ_DETAILS_query();
 			break;
@@ -1078,16 +1275,63 @@ static void *LOOKUP_loop(void *args)
 		case HAMQTHHTML :
 			HAMQTH_DETAILS_query();
 			break;
-		case QRZWEB_EXIT:
-			return NULL;
 		default:
 			break;
 		}
+
+		// a prefetch must not disturb the fields of the last shown result
+		if (!lookup_displayed)
+			lookup_set(lookup_shown);
+
+		pthread_mutex_lock(&qrz_mutex);
+		lookup_inflight.clear();
+		pthread_mutex_unlock(&qrz_mutex);
 	}
 
 	return NULL;
 }
 
+// Reduce a portable call to the home call, e.g. W1ABC/4 and VE3/W1ABC to W1ABC
+static void lookup_base_call(string& call)
+{
+	size_t slash;
+	while ((slash = call.rfind('/')) != string::npos) {
+		if (((slash+1) * 2) < call.length())
+			call.erase(0, slash + 1);
+		else
+			call.erase(slash);
+	}
+}
+
+static void lookup_enqueue(const lookup_request_t& req)
+{
+	string key = lookup_key(req.xml, req.call);
+
+	guard_lock lock(&qrz_mutex);
+
+	// a new request from the user replaces one that has not started yet,
+	// and takes over any prefetch of the same call
+	for (deque<lookup_request_t>::iterator i = lookup_queue.begin(); i != lookup_queue.end(); ) {
+		if (!i->quiet || lookup_key(i->xml, i->call) == key)
+			i = lookup_queue.erase(i);
+		else
+			++i;
+	}
+
+	if (key == lookup_inflight && !lookup_inflight_show) {
+		lookup_inflight_show = true;
+		if (req.web != QRZWEBNONE) {
+			lookup_request_t web = req;
+			web.xml = QRZXMLNONE;
+			lookup_queue.push_front(web);
+		}
+	}
+	else
+		lookup_queue.push_front(req);
+
+	pthread_cond_signal(&qrz_cond);
+}
+
 void CALLSIGNquery()
 {
 	ENSURE_THREAD(FLMAIN_TID);
@@ -1096,22 +1340,16 @@ void CALLSIGNquery()
 		Lookup_init();
 
 	// Filter callsign for nonsense characters (remove all but [A-Za-z0-9/])
-	callsign.clear();
+	string call;
 	for (const char* p = inpCall->value(); *p; p++)
 		if (isalnum(*p) || *p == '/')
-			callsign += *p;
-	if (callsign.empty())
+			call += *p;
+	if (call.empty())
 		return;
-	if (callsign != inpCall->value())
-		inpCall->value(callsign.c_str());
+	if (call != inpCall->value())
+		inpCall->value(call.c_str());
 
-	size_t slash;
-	while ((slash = callsign.rfind('/')) != string::npos) {
-		if (((slash+1) * 2) < callsign.length())
-			callsign.erase(0, slash + 1);
-		else
-			callsign.erase(slash);
-	}
+	lookup_base_call(call);
 
 	switch (DB_XML_query = static_cast<qrz_xmlquery_t>(progdefaults.QRZXML)) {
 	case QRZNET:
@@ -1148,9 +1386,67 @@ void CALLSIGNquery()
 
 	DB_WEB_query = static_cast<qrz_webquery_t>(progdefaults.QRZWEB);
 
-	pthread_mutex_lock(&qrz_mutex);
+	lookup_request_t req;
+	req.call = call;
+	req.xml = DB_XML_query;
+	req.web = DB_WEB_query;
+	req.quiet = false;
+	lookup_enqueue(req);
+}
+
+// ----------------------------------------------------------------------------
+// Prefetch the callsigns of stations heard calling CQ or signing with "de".
+// The spotter calls us from the main thread.
+// ----------------------------------------------------------------------------
+
+static void lookup_prefetch(trx_mode mode, int afreq, const char* str, const regmatch_t* calls, size_t len, void* data)
+{
+	if (!progdefaults.lookup_prefetch || !progdefaults.lookup_cache ||
+	    !lookup_cacheable(progdefaults.QRZXML))
+		return;
+	if (unlikely(calls[PSKREP_RE_INDEX].rm_so == -1 || calls[PSKREP_RE_INDEX].rm_eo == -1))
+		return;
+
+	string call(str + calls[PSKREP_RE_INDEX].rm_so, calls[PSKREP_RE_INDEX].rm_eo - calls[PSKREP_RE_INDEX].rm_so);
+	for (size_t i = 0; i < call.length(); i++)
+		call[i] = toupper(call[i]);
+	lookup_base_call(call);
+	if (call.length() < 3 || !strcasecmp(call.c_str(), progdefaults.myCall.c_str()))
+		return;
+
+	if (!QRZ_thread)
+		Lookup_init();
+
+	string key = lookup_key(progdefaults.QRZXML, call);
+	if (!lookup_db || lookup_db->fresh(key))
+		return;
+
+	guard_lock lock(&qrz_mutex);
+
+	if (key == lookup_inflight || lookup_queue.size() >= LOOKUP_PREFETCH_MAX)
+		return;
+	time_t now = time(NULL);
+	map<string, time_t>::iterator i = lookup_prefetched.find(key);
+	if (i != lookup_prefetched.end() && now - i->second < LOOKUP_PREFETCH_INTERVAL)
+		return;
+	if (lookup_prefetched.size() > 1000)
+		lookup_prefetched.clear();
+	lookup_prefetched[key] = now;
+
+	LOG_VERBOSE("Prefetching %s", call.c_str());
+
+	lookup_request_t req;
+	req.call = call;
+	req.xml = static_cast<qrz_xmlquery_t>(progdefaults.QRZXML);
+	req.web = QRZWEBNONE;
+	req.quiet = true;
+	lookup_queue.push_back(req);
 	pthread_cond_signal(&qrz_cond);
-	pthread_mutex_unlock(&qrz_mutex);
+}
+
+void lookup_prefetch_start(void)
+{
+	spot_register_recv(lookup_prefetch, NULL, PSKREP_RE, REG_EXTENDED | REG_ICASE);
 }
 
 //======================================================================
@@ -30,6 +30,8 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string>
+#include <vector>
+#include <algorithm>
 
 #include <iostream>
 using namespace std;
@@ -208,15 +210,26 @@ bool QRZ::ImageExists() {
 	return (hasImage = false);
 }
 
+void QRZ::CloseQRZFiles()
+{
+	if( data != NULL ) free( data );
+	if( datafile != NULL ) fclose( datafile );
+	data = NULL;
+	datafile = NULL;
+	idxmap.close();
+	datmap.close();
+	index = top = idxptr = NULL;
+	dfvalid = false;
+	cache.clear();
+	cachemap.clear();
+}
+
 void QRZ::OpenQRZFiles( const char *fname )
 {
-	long fsize;
 	char dfname[64];
 	char idxname[64];
-	int num1;
-	int num2;
-	num1 = 0;
-	num2 = 0;
+
+	CloseQRZFiles();
 
 	if( fname[0] == 0 ) {
 		QRZvalid = 0;
@@ -239,51 +252,32 @@ void QRZ::OpenQRZFiles( const char *fname )
 	strcat( dfname, fname );
 	strcat( dfname, ".dat" );
 
-	idxfile = fopen( idxname, "r" );
-	if( idxfile == NULL ) {
-		QRZvalid = 0;
-		return;
-	}
-
-	fseek( idxfile, 0, SEEK_END );
-	fsize = ftell( idxfile );
-	rewind( idxfile );
-
-	idxsize = fsize - 48;
-
-	index = (char *) malloc( idxsize );
-
-	if( index == NULL ) {
-		fclose( idxfile );
-		QRZvalid = 0;
-		return;
-	}
-	memset( index, 0, idxsize );
-
-	num1 =  fread( &idxhdr.dataname, 48, 1, idxfile );
-	num2 =  fread( index, idxsize, 1, idxfile );
-
-	if (num1 != 1 || num2 != 1) {
-		fclose( idxfile );
-		free( index );
+// the index is searched in place; it is never copied
+	if( !idxmap.open( idxname ) || idxmap.size() <= sizeof(idxhdr) ) {
+		CloseQRZFiles();
 		QRZvalid = 0;
 		return;
 	}
+	memcpy( &idxhdr, idxmap.data(), sizeof(idxhdr) );
+	index = idxmap.data() + sizeof(idxhdr);
+	idxsize = idxmap.size() - sizeof(idxhdr);
 
-	fflush( stdout );
-
-	fclose( idxfile );
-
-	datafile = fopen( dfname, "r" );
-	if( datafile == NULL ) {
-		free( index );
-		QRZvalid = 0;
-		return;
+// map the data file too where we can; fall back to stdio otherwise
+#ifndef __WOE32__
+	if( !datmap.open( dfname ) )
+#endif
+	{
+		datafile = fopen( dfname, "r" );
+		if( datafile == NULL ) {
+			CloseQRZFiles();
+			QRZvalid = 0;
+			return;
+		}
 	}
 
 	sscanf( idxhdr.bytesperkey, "%d", &datarecsize );
 	if( datarecsize == 0 || datarecsize > 32767 ) {
-		free( index );
+		CloseQRZFiles();
 		QRZvalid = 0;
 		return;
 	}
@@ -292,7 +286,7 @@ void QRZ::OpenQRZFiles( const char *fname )
 
 	data = (char *) malloc( datarecsize + 512 );
 	if( data == NULL ) {
-		free( index );
+		CloseQRZFiles();
 		QRZvalid = 0;
 		return;
 	}
@@ -302,12 +296,21 @@ void QRZ::OpenQRZFiles( const char *fname )
 
 	sscanf( idxhdr.keylen, "%d", &keylen );
 	sscanf( idxhdr.numkeys, "%ld", &numkeys );
+	if( keylen <= 0 ) {
+		CloseQRZFiles();
+		QRZvalid = 0;
+		return;
+	}
+// never search past the end of the mapping
+	if( numkeys < 0 || numkeys > idxsize / keylen )
+		numkeys = idxsize / keylen;
 	top = index + idxsize - keylen;
 
 }
 
 
 QRZ::QRZ( const char *fname )
+	: data(NULL), index(NULL), top(NULL), dfvalid(false), datafile(NULL), idxptr(NULL)
 {
 	int len = strlen(fname);
 	criteria = fname[ len - 1 ];
@@ -315,6 +318,7 @@ QRZ::QRZ( const char *fname )
 }
 
 QRZ::QRZ( const char *fname, char c )
+	: data(NULL), index(NULL), top(NULL), dfvalid(false), datafile(NULL), idxptr(NULL)
 {
 	criteria = c;
 	OpenQRZFiles( fname );
@@ -331,15 +335,13 @@ void QRZ::NewDBpath( const char *fname )
 
 QRZ::~QRZ()
 {
-	if( index != NULL ) free( index );
-	if( data  != NULL ) free( data );
-	if( datafile != NULL ) fclose( datafile );
+	CloseQRZFiles();
 	return;
 }
 
-int QRZ::CallComp( char *s1, char *s2 )
+static int callcomp( const char *s1, const char *s2 )
 {
-	static char sa[7], sb[7];
+	char sa[7], sb[7];
 	strncpy( sb, s2, 6 );
 	strncpy( sa, s1, 6 );
 	sa[6] = 0;
@@ -366,6 +368,16 @@ int QRZ::CallComp( char *s1, char *s2 )
 	return 0;
 }
 
+static int callcomp_n( const char *s1, const char *s2, size_t )
+{
+	return callcomp( s1, s2 );
+}
+
+int QRZ::CallComp( char *s1, char *s2 )
+{
+	return callcomp( s1, s2 );
+}
+
 char *Composite( char *s )
 {
 	static char newstr[7];
@@ -386,21 +398,81 @@ char *Composite( char *s )
 
 int QRZ::ReadDataBlock( long p )
 {
-	rewind( datafile );
-
 	if ( p < 0 ) p = 0;
 
-	if( fseek( datafile, p, SEEK_SET ) != 0 ) {
-		return 1;
-	}
+	if( datmap.is_open() ) {
+		if( (size_t)p > datmap.size() )
+			return 1;
+		databytesread = datmap.size() - p;
+		if( databytesread > (long)datarecsize + 512 )
+			databytesread = datarecsize + 512;
+		memcpy( data, datmap.data() + p, databytesread );
+		memset( data + databytesread, '\n', datarecsize + 512 - databytesread );
+	} else {
+		rewind( datafile );
 
-	databytesread = fread( data, 1, datarecsize + 512, datafile );
+		if( fseek( datafile, p, SEEK_SET ) != 0 ) {
+			return 1;
+		}
+
+		databytesread = fread( data, 1, datarecsize + 512, datafile );
+	}
 	dataoffset = p;
+	dfvalid = true;
 
-	fflush( stdout);
 	return 0;
 }
 
+// Binary search of the index for the first key that does not sort below
+// the search key.  Returns the key number and leaves idxptr pointing at it.
+long QRZ::IndexSearch( const char *key, int (*cmp)( const char *, const char *, size_t ), size_t n )
+{
+	long lo = 0, hi = numkeys;
+	while( lo < hi ) {
+		long mid = lo + (hi - lo) / 2;
+		if( cmp( key, index + mid * keylen, n ) <= 0 )
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	idxptr = index + lo * keylen;
+	return lo;
+}
+
+// Callsign lookups go through a small LRU cache of raw records
+int QRZ::FindCallsignCached( char *field )
+{
+	if( strlen( field ) < 3 )  // must be a valid callsign
+		return (found = 0);
+
+	if ( !(isdigit( field[1] ) || isdigit( field[2] ) ) )
+		return (found = 0);
+
+	strncpy( lastkey, field, 6 );
+	lastkey[6] = 0;
+
+	std::string key( Composite( field ) );
+	std::map<std::string, cache_list::iterator>::iterator i = cachemap.find( key );
+	if( i != cachemap.end() ) {
+		cache.splice( cache.begin(), cache, i->second );
+		found = i->second->second.first;
+		strcpy( recbuffer, i->second->second.second.c_str() );
+		dfvalid = false;   // NextRecord must search again
+		return found;
+	}
+
+	FindCallsign( field );
+
+	cache.push_front( cache_entry( key, std::make_pair( found, std::string( found ? recbuffer : "" ) ) ) );
+	cachemap[key] = cache.begin();
+	if( cache.size() > CACHE_SIZE ) {
+		cachemap.erase( cache.back().first );
+		cache.pop_back();
+	}
+
+	return found;
+}
+
 int QRZ::FindCallsign( char *field )
 {
 	char composite[7], testcall[7];
@@ -420,9 +492,7 @@ int QRZ::FindCallsign( char *field )
 
 	strcpy( composite, Composite( field ) );
 
-	for( iOffset = 0; iOffset < numkeys; iOffset++, idxptr += keylen )
-		if( CallComp( composite, idxptr) <= 0 )
-			break;
+	iOffset = IndexSearch( composite, callcomp_n, 0 );
 
 	iOffset--;
 	if (iOffset < 0) iOffset = 0;
@@ -474,6 +544,11 @@ int QRZ::FindCallsign( char *field )
 
 int QRZ::nextrec()
 {
+	if( !dfvalid ) {   // the last record came from the cache
+		if( FindCallsign( lastkey ) == 0 )
+			return 0;
+	}
+
 	if( dfptr > data + datarecsize ) {
 		if( ReadDataBlock( dataoffset + (dfptr - data) ) != 0)
 			return 0;
@@ -526,9 +601,7 @@ int QRZ::FindName( char *field )
 	found = 0;
 	idxptr = index;
 
-	for( iOffset = 0; iOffset < numkeys; iOffset++, idxptr += keylen )
-		if( strncasecmp( sIdxName, idxptr, keylen ) <= 0 )
-			break;
+	iOffset = IndexSearch( sIdxName, strncasecmp, keylen );
 
 	iOffset--;
 	if (iOffset < 0) iOffset = 0;
@@ -614,9 +687,7 @@ int QRZ::FindState( char *field )
 	found = 0;
 	idxptr = index;
 
-	for( iOffset = 0; iOffset < numkeys; iOffset++, idxptr += keylen )
-		if( strncasecmp( field, idxptr, compsize ) <= 0 )
-			break;
+	iOffset = IndexSearch( field, strncasecmp, compsize );
 
 	iOffset--;
 	if (iOffset < 0) iOffset = 0;
@@ -676,9 +747,7 @@ int QRZ::FindZip( char *field )
 	found = 0;
 	idxptr = index;
 
-	for( iOffset = 0; iOffset < numkeys; iOffset++, idxptr += keylen )
-		if( strncasecmp( field, idxptr, 5 ) <= 0 )
-		break;
+	iOffset = IndexSearch( field, strncasecmp, 5 );
 
 	iOffset--;
 	if (iOffset < 0) iOffset = 0;
@@ -732,7 +801,7 @@ int QRZ::FindRecord( char *field )
 
 	switch (criteria) {
 		case 'c' :
-			FindCallsign( field );
+			FindCallsignCached( field );
 			break;
 		case 'n' :
 			FindName( field );
@@ -746,6 +815,68 @@ int QRZ::FindRecord( char *field )
 	return( ReadRec() );
 }
 
+static bool composite_less( const pair<string, size_t>& a, const pair<string, size_t>& b )
+{
+	return callcomp( a.first.c_str(), b.first.c_str() ) < 0;
+}
+
+// Look up a list of callsigns.  The calls are visited in index order so that
+// the data file is read front to back; results are returned in input order
+// and unmatched calls leave an empty record.
+int QRZ::FindCallsigns( const vector<string>& calls, vector<qrz_record>& recs )
+{
+	recs.clear();
+	recs.resize( calls.size() );
+	if( QRZvalid == 0 || criteria != 'c' )
+		return 0;
+
+	char field[7];
+	vector<pair<string, size_t> > order;
+	order.reserve( calls.size() );
+	for( size_t i = 0; i < calls.size(); i++ ) {
+		strncpy( field, calls[i].c_str(), 6 );
+		field[6] = 0;
+		for( char *p = field; *p; p++ )
+			*p = toupper( *p );
+		if( strlen( field ) < 3 || !(isdigit( field[1] ) || isdigit( field[2] )) )
+			continue;
+		order.push_back( make_pair( string( Composite( field ) ), i ) );
+	}
+	stable_sort( order.begin(), order.end(), composite_less );
+
+	int n = 0;
+	for( size_t i = 0; i < order.size(); i++ ) {
+		size_t j = order[i].second;
+		strncpy( field, calls[j].c_str(), 6 );
+		field[6] = 0;
+		for( char *p = field; *p; p++ )
+			*p = toupper( *p );
+		FindCallsignCached( field );
+		if( ReadRec() == 1 ) {
+			GetRecord( recs[j] );
+			n++;
+		}
+	}
+	return n;
+}
+
+// Copy the fields of the record last read by ReadRec
+void QRZ::GetRecord( qrz_record& rec )
+{
+	rec.call = GetCall();
+	rec.fname = Qfname;
+	rec.lname = Qlname;
+	rec.street = Qmail_str;
+	rec.city = Qmail_city;
+	rec.state = Qmail_st;
+	rec.zip = Qmail_zip;
+	rec.opclass = Qopclass;
+	rec.efdate = Qefdate;
+	rec.expdate = Qexpdate;
+	rec.p_call = Qp_call;
+	rec.p_class = Qp_class;
+}
+
 static char empty[] = { '\0' };
 
 
@@ -23,6 +23,7 @@
 
 #include <config.h>
 #include <fstream>
+#include <algorithm>
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
@@ -303,29 +304,43 @@ cQsoDb::cQsoDb() {
   qsorec = new cQsoRec[maxrecs];
   compby = COMPDATE;
   dirty = 0;
+  sorted = false;
+  // the index of an empty log is up to date
+  qsoindex = new cQsoIndex(*this);
+  qsoindex->clear();
 }
 
 cQsoDb::cQsoDb(cQsoDb *db) {
   nbrrecs = 0;
   maxrecs = db->nbrRecs();
   qsorec = new cQsoRec[maxrecs];
-  for (int i = 0; i < maxrecs; i++)
-    qsorec[i] = db->qsorec[i];
+  order.resize(maxrecs);
+  for (int i = 0; i < maxrecs; i++) {
+    qsorec[i] = *db->getRec(i);
+    order[i] = i;
+  }
   compby = COMPDATE;
   nbrrecs = maxrecs;
   dirty = 0;
+  sorted = false;
+  qsoindex = new cQsoIndex(*this);
 }
 
 cQsoDb::~cQsoDb() {
   delete [] qsorec;
+  delete qsoindex;
 } 
 
 void cQsoDb::deleteRecs() {
+  qsoindex->invalidate();
   delete [] qsorec;
   nbrrecs = 0;
   maxrecs = MAXRECS;
   qsorec = new cQsoRec[maxrecs];
+  order.clear();
   dirty = 0;
+  sorted = false;
+  qsoindex->clear();
 }
 
 void cQsoDb::clearDatabase() {
@@ -334,75 +349,159 @@ void cQsoDb::clearDatabase() {
 
 int cQsoDb::qsoFindRec(cQsoRec *rec) {
   for (int i = 0; i < nbrrecs; i++)
-    if (qsorec[i] == *rec)
+    if (qsorec[order[i]] == *rec)
       return i;
   return -1;
 }
 
-void cQsoDb::qsoNewRec (cQsoRec *nurec) {
-  if (nbrrecs == maxrecs) {
-    maxrecs += INCRRECS;
-    cQsoRec *atemp = new cQsoRec[maxrecs];
-    for (int i = 0; i < nbrrecs; i++)
-        atemp[i] = qsorec[i];
-    delete [] qsorec;
-    qsorec = atemp;
+// compareqsos on the storage indices of the records
+struct rec_order {
+  const cQsoRec *recs;
+  rec_order(const cQsoRec *r) : recs(r) {}
+  bool operator()(int a, int b) const {
+    return compareqsos(&recs[a], &recs[b]) < 0;
+  }
+};
+
+// compby, date_off and reverse are shared by all the databases, set
+// them back to the key of this one before comparing its records
+void cQsoDb::sort_key() {
+  compby = sort_by;
+  date_off = sort_date_off;
+  reverse = sort_rev;
+}
+
+// restores compby, date_off and reverse when it goes out of scope, as
+// they are also the key of the next sort
+struct saved_sort_key {
+  int by;
+  bool off, rev;
+  saved_sort_key() : by(compby), off(date_off), rev(cQsoDb::reverse) {}
+  ~saved_sort_key() {
+    compby = by;
+    date_off = off;
+    cQsoDb::reverse = rev;
   }
+};
+
+// true if the record at pos still sorts between its neighbours
+bool cQsoDb::in_order(int pos) {
+  if (pos > 0 && compareqsos(&qsorec[order[pos - 1]], &qsorec[order[pos]]) > 0)
+    return false;
+  if (pos < nbrrecs - 1 && compareqsos(&qsorec[order[pos]], &qsorec[order[pos + 1]]) > 0)
+    return false;
+  return true;
+}
+
+void cQsoDb::grow() {
+  if (nbrrecs < maxrecs)
+    return;
+  maxrecs += INCRRECS;
+  cQsoRec *atemp = new cQsoRec[maxrecs];
+  for (int i = 0; i < nbrrecs; i++)
+      atemp[i] = qsorec[i];
+  delete [] qsorec;
+  qsorec = atemp;
+}
+
+void cQsoDb::qsoNewRec (cQsoRec *nurec) {
+  grow();
   qsorec[nbrrecs] = *nurec;
   qsorec[nbrrecs].checkBand();
   qsorec[nbrrecs].checkDateTimes();
+  if (sorted) {
+    saved_sort_key saved;
+    sort_key();
+    order.insert(upper_bound(order.begin(), order.end(), nbrrecs, rec_order(qsorec)),
+                 nbrrecs);
+  }
+  else
+    order.push_back(nbrrecs);
+  qsoindex->add(nbrrecs);
   nbrrecs++;
 }
 
+// the caller fills in the record, so it goes at the end.  This is how the
+// ADIF reader thread loads the log: the index stops reading the records
+// before grow() may move them, and is rebuilt when the log has been read.
 cQsoRec* cQsoDb::newrec() {
-  if (nbrrecs == maxrecs) {
-    maxrecs += INCRRECS;
-    cQsoRec *atemp = new cQsoRec[maxrecs];
-    for (int i = 0; i < nbrrecs; i++)
-        atemp[i] = qsorec[i];
-    delete [] qsorec;
-    qsorec = atemp;
-  }
+  qsoindex->invalidate();
+  grow();
+  order.push_back(nbrrecs);
+  sorted = false;
   nbrrecs++;
   return &qsorec[nbrrecs - 1];
 }
 
+// The last record takes the storage of the deleted one
 void cQsoDb::qsoDelRec (int rnbr) {
   if (rnbr < 0 || rnbr > (nbrrecs - 1)) 
     return;
-  for (int i = rnbr; i < nbrrecs - 1; i++)
-    qsorec[i] = qsorec[i+1];
+  int idx = order[rnbr], last = nbrrecs - 1;
+  order.erase(order.begin() + rnbr);
+  qsoindex->remove(idx);
+  if (idx != last) {
+    qsorec[idx] = qsorec[last];
+    *find(order.begin(), order.end(), last) = idx;
+    qsoindex->move(last, idx);
+  }
   nbrrecs--;
   qsorec[nbrrecs].clearRec();
 }
-  
+
+// The record keeps its position, so that callers may update the records
+// in a loop; the next sort puts it in place if it moved
 void cQsoDb::qsoUpdRec (int rnbr, cQsoRec *updrec) {
   if (rnbr < 0 || rnbr > (nbrrecs - 1))
     return;
-  qsorec[rnbr] = *updrec;
-  qsorec[rnbr].checkBand();
+  qsorec[order[rnbr]] = *updrec;
+  qsorec[order[rnbr]].checkBand();
+  qsoindex->update(order[rnbr]);
+  if (sorted) {
+    saved_sort_key saved;
+    sort_key();
+    sorted = in_order(rnbr);
+  }
   return;
 }
 
+int cQsoDb::position(int n) const {
+  vector<int>::const_iterator i = find(order.begin(), order.end(), n);
+  return i == order.end() ? -1 : i - order.begin();
+}
+
+cQsoIndex& cQsoDb::index() {
+  return *qsoindex;
+}
+
+// Sorts the index only, and not at all if it already follows the key
+void cQsoDb::sort(int by) {
+  compby = by;
+  if (sorted && sort_by == by && sort_date_off == date_off && sort_rev == reverse)
+    return;
+  // merge sort, compareCalls is not a strict ordering for every callsign
+  stable_sort(order.begin(), order.end(), rec_order(qsorec));
+  sorted = true;
+  sort_by = by;
+  sort_date_off = date_off;
+  sort_rev = reverse;
+}
+
 void cQsoDb::SortByDate (bool how) {
   date_off = how;
-  compby = COMPDATE;
-  qsort (qsorec, nbrrecs, sizeof (cQsoRec), compareqsos);
+  sort(COMPDATE);
 }
 
 void cQsoDb::SortByCall () {
-  compby = COMPCALL;
-  qsort (qsorec, nbrrecs, sizeof (cQsoRec), compareqsos);
+  sort(COMPCALL);
 }
 
 void cQsoDb::SortByMode () {
-  compby = COMPMODE;
-  qsort (qsorec, nbrrecs, sizeof (cQsoRec), compareqsos);
+  sort(COMPMODE);
 }
 
 void cQsoDb::SortByFreq () {
-	compby = COMPFREQ;
-	qsort (qsorec, nbrrecs, sizeof (cQsoRec), compareqsos);
+	sort(COMPFREQ);
 }
 
 bool cQsoDb::qsoIsValidFile(const char *fname) {
@@ -451,7 +550,7 @@ int cQsoDb::qsoWriteFile (const char *fname) {
   }
   outQsoFile << "_LOGBODUP DBX 3.0" << '\n';
   for (int i = 0; i < nbrrecs; i++)
-    outQsoFile << qsorec[i];
+    outQsoFile << qsorec[order[i]];
   outQsoFile.close();
   return 0;
 }
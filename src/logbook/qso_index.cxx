@@ -0,0 +1,473 @@
+// ----------------------------------------------------------------------------
+// qso_index.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "qso_index.h"
+#include "qso_db.h"
+#include "dxcc.h"
+#include "threads.h"
+#include "util.h"
+
+using namespace std;
+
+static string upcase(const char* s, size_t n = string::npos)
+{
+	string u(s, MIN(strlen(s), n));
+	for (size_t i = 0; i < u.length(); i++)
+		u[i] = toupper(u[i]);
+	return u;
+}
+
+static band_t band_of_name(const string& name)
+{
+	for (int b = 0; b < NUM_BANDS; b++)
+		if (!strcasecmp(band_name((band_t)b), name.c_str()))
+			return (band_t)b;
+	return NUM_BANDS;
+}
+
+cQsoIndex::cQsoIndex(cQsoDb& db_) : db(db_), valid(false)
+{
+	pthread_mutex_init(&mutex, NULL);
+}
+
+cQsoIndex::~cQsoIndex()
+{
+	pthread_mutex_destroy(&mutex);
+}
+
+void cQsoIndex::clear(void)
+{
+	guard_lock lock(&mutex);
+	clear_();
+}
+
+void cQsoIndex::invalidate(void)
+{
+	guard_lock lock(&mutex);
+	valid = false;
+}
+
+void cQsoIndex::rebuild(void)
+{
+	ENSURE_THREAD(FLMAIN_TID);
+
+	guard_lock lock(&mutex);
+	rebuild_();
+}
+
+void cQsoIndex::refresh(void)
+{
+	ENSURE_THREAD(FLMAIN_TID);
+
+	guard_lock lock(&mutex);
+	if (valid)
+		rebuild_();
+}
+
+bool cQsoIndex::ready(void)
+{
+	guard_lock lock(&mutex);
+	return valid;
+}
+
+void cQsoIndex::add(int rec)
+{
+	guard_lock lock(&mutex);
+	add_(rec);
+}
+
+void cQsoIndex::clear_(void)
+{
+	entries.clear();
+	calls.clear();
+	modes.clear();
+	grids.clear();
+	dxccs.clear();
+	for (int b = 0; b < NUM_BANDS; b++)
+		bands[b].clear();
+	dates.clear();
+	statuses.clear();
+	valid = true;
+}
+
+void cQsoIndex::rebuild_(void)
+{
+	clear_();
+	int n = db.nbrRecs();
+	entries.reserve(n);
+	for (int i = 0; i < n; i++)
+		add_(i);
+}
+
+// The keys of record rec
+void cQsoIndex::keys(int rec, entry& e)
+{
+	const cQsoRec& r = db.recarray()[rec];
+
+	e.used = true;
+	e.call = upcase(r.getField(CALL));
+	e.mode = upcase(r.getField(MODE));
+	e.grid = upcase(r.getField(GRIDSQUARE), 4);
+	if (e.grid.length() < 4)
+		e.grid.clear();
+	// the entity of the call as cty.dat has it, which is also what the
+	// spot notifier looks up
+	const dxcc* d = dxcc_lookup(r.getField(CALL));
+	e.dxcc = upcase(d ? d->country : r.getField(COUNTRY));
+	e.band = *r.getField(FREQ) ? band(r.getField(FREQ)) : BAND_OTHER;
+	e.date = r.getField(QSO_DATE);
+	e.when = e.date + r.getField(TIME_ON);
+	e.confirmed = *r.getField(QSLRDATE);
+}
+
+bool cQsoIndex::same_keys(const entry& a, const entry& b)
+{
+	return a.used == b.used && a.confirmed == b.confirmed && a.band == b.band &&
+		a.call == b.call && a.mode == b.mode && a.grid == b.grid &&
+		a.dxcc == b.dxcc && a.date == b.date && a.when == b.when;
+}
+
+void cQsoIndex::add_(int rec)
+{
+	if (!valid)
+		return;
+
+	if ((size_t)rec >= entries.size())
+		entries.resize(rec + 1);
+	entry& e = entries[rec];
+	keys(rec, e);
+
+	if (!e.call.empty())
+		calls[e.call].push_back(rec);
+	if (!e.mode.empty())
+		modes[e.mode].push_back(rec);
+	if (!e.grid.empty())
+		grids[e.grid].push_back(rec);
+	if (!e.dxcc.empty())
+		dxccs[e.dxcc].push_back(rec);
+	bands[e.band].push_back(rec);
+	dates.insert(make_pair(e.date, rec));
+	count(e, 1);
+}
+
+// The keys of the status counts of an entity, on a band, and in a mode
+static inline string status_key(const string& dxcc)
+{
+	return dxcc;
+}
+static inline string status_key(const string& dxcc, band_t band)
+{
+	string key(dxcc);
+	key += '\n';
+	key += (char)('A' + band);
+	return key;
+}
+static inline string status_key(const string& dxcc, band_t band, const string& mode)
+{
+	string key(status_key(dxcc, band));
+	key += '\n';
+	key += mode;
+	return key;
+}
+
+// Adds n, 1 or -1, to the status counts of the entity of e
+void cQsoIndex::count(const entry& e, int n)
+{
+	if (e.dxcc.empty())
+		return;
+
+	string keys[] = {
+		status_key(e.dxcc), status_key(e.dxcc, e.band), status_key(e.dxcc, e.band, e.mode)
+	};
+	for (size_t k = 0; k < sizeof(keys) / sizeof(*keys); k++) {
+		counts& c = statuses[keys[k]];
+		c.worked += n;
+		if (e.confirmed)
+			c.confirmed += n;
+		if (c.worked == 0)
+			statuses.erase(keys[k]);
+	}
+}
+
+void cQsoIndex::unlist(vector<int>& v, int rec)
+{
+	vector<int>::iterator i = std::find(v.begin(), v.end(), rec);
+	if (i != v.end())
+		v.erase(i);
+}
+
+void cQsoIndex::relist(vector<int>& v, int from, int to)
+{
+	vector<int>::iterator i = std::find(v.begin(), v.end(), from);
+	if (i != v.end())
+		*i = to;
+}
+
+// Removes rec from the list of key, and the key when its list is empty
+#define UNLIST(map_, key_, rec_)					\
+	do {								\
+		list_map::iterator i_ = map_.find(key_);		\
+		if (i_ != map_.end()) {					\
+			unlist(i_->second, rec_);			\
+			if (i_->second.empty())				\
+				map_.erase(i_);				\
+		}							\
+	} while (0)
+
+void cQsoIndex::remove(int rec)
+{
+	guard_lock lock(&mutex);
+	remove_(rec);
+}
+
+// Exporting the log updates every record, mostly without changing a key,
+// so that they are not all moved to the end of their lists
+void cQsoIndex::update(int rec)
+{
+	guard_lock lock(&mutex);
+	if (!valid)
+		return;
+
+	entry e;
+	keys(rec, e);
+	if ((size_t)rec < entries.size() && same_keys(entries[rec], e))
+		return;
+	remove_(rec);
+	add_(rec);
+}
+
+void cQsoIndex::remove_(int rec)
+{
+	if (!valid || (size_t)rec >= entries.size() || !entries[rec].used)
+		return;
+
+	entry& e = entries[rec];
+	count(e, -1);
+	UNLIST(calls, e.call, rec);
+	UNLIST(modes, e.mode, rec);
+	UNLIST(grids, e.grid, rec);
+	UNLIST(dxccs, e.dxcc, rec);
+	unlist(bands[e.band], rec);
+	pair<date_map::iterator, date_map::iterator> r = dates.equal_range(e.date);
+	for (date_map::iterator i = r.first; i != r.second; ++i) {
+		if (i->second == rec) {
+			dates.erase(i);
+			break;
+		}
+	}
+	e = entry();
+}
+
+// The record at from now lives at to, which has been removed
+void cQsoIndex::move(int from, int to)
+{
+	guard_lock lock(&mutex);
+	if (!valid || (size_t)from >= entries.size() || !entries[from].used)
+		return;
+
+	entry& e = entries[from];
+	list_map::iterator i;
+	if ((i = calls.find(e.call)) != calls.end())
+		relist(i->second, from, to);
+	if ((i = modes.find(e.mode)) != modes.end())
+		relist(i->second, from, to);
+	if ((i = grids.find(e.grid)) != grids.end())
+		relist(i->second, from, to);
+	if ((i = dxccs.find(e.dxcc)) != dxccs.end())
+		relist(i->second, from, to);
+	relist(bands[e.band], from, to);
+	pair<date_map::iterator, date_map::iterator> r = dates.equal_range(e.date);
+	for (date_map::iterator j = r.first; j != r.second; ++j) {
+		if (j->second == from) {
+			j->second = to;
+			break;
+		}
+	}
+
+	entries[to] = e;
+	entries[from] = entry();
+}
+
+bool cQsoIndex::match(const entry& e, const qso_query& q, band_t band)
+{
+	if (!e.used)
+		return false;
+	if (!q.call.empty() && e.call != q.call)
+		return false;
+	if (!q.mode.empty() && e.mode != q.mode)
+		return false;
+	if (!q.grid.empty() && e.grid != q.grid)
+		return false;
+	if (!q.dxcc.empty() && e.dxcc != q.dxcc)
+		return false;
+	if (band != NUM_BANDS && e.band != band)
+		return false;
+	if (!q.date_from.empty() && e.date < q.date_from)
+		return false;
+	if (!q.date_to.empty() && e.date > q.date_to)
+		return false;
+	return true;
+}
+
+struct cQsoIndex::recent_first {
+	const vector<entry>& e;
+	recent_first(const vector<entry>& e_) : e(e_) {}
+	bool operator()(int a, int b) const { return e[a].when > e[b].when; }
+};
+
+size_t cQsoIndex::find(const qso_query& query, vector<int>& recs, size_t max)
+{
+	guard_lock lock(&mutex);
+	recs.clear();
+	if (!valid)
+		return 0;
+
+	qso_query q = query;
+	q.call = upcase(q.call.c_str());
+	q.mode = upcase(q.mode.c_str());
+	q.grid = upcase(q.grid.c_str(), 4);
+	q.dxcc = upcase(q.dxcc.c_str());
+	band_t band = NUM_BANDS;
+	if (!q.band.empty() && (band = band_of_name(q.band)) == NUM_BANDS)
+		return 0;
+
+	// start from the shortest list that the records must be in
+	const vector<int>* list = 0;
+	static const vector<int> none;
+	struct { const list_map* map; const string* key; } keys[] = {
+		{ &calls, &q.call }, { &modes, &q.mode }, { &grids, &q.grid }, { &dxccs, &q.dxcc }
+	};
+	for (size_t k = 0; k < sizeof(keys) / sizeof(*keys); k++) {
+		if (keys[k].key->empty())
+			continue;
+		list_map::const_iterator i = keys[k].map->find(*keys[k].key);
+		const vector<int>* l = i == keys[k].map->end() ? &none : &i->second;
+		if (!list || l->size() < list->size())
+			list = l;
+	}
+	if (band != NUM_BANDS && (!list || bands[band].size() < list->size()))
+		list = &bands[band];
+
+	vector<int> cand;
+	if (!list) {
+		if (!q.date_from.empty() || !q.date_to.empty()) {
+			date_map::const_iterator i = q.date_from.empty() ? dates.begin() : dates.lower_bound(q.date_from);
+			date_map::const_iterator end = q.date_to.empty() ? dates.end() : dates.upper_bound(q.date_to);
+			for (; i != end; ++i)
+				cand.push_back(i->second);
+		}
+		else {
+			for (size_t i = 0; i < entries.size(); i++)
+				cand.push_back(i);
+		}
+		list = &cand;
+	}
+
+	for (vector<int>::const_iterator i = list->begin(); i != list->end(); ++i)
+		if (match(entries[*i], q, band))
+			recs.push_back(*i);
+
+	if (max && recs.size() > max) {
+		partial_sort(recs.begin(), recs.begin() + max, recs.end(), recent_first(entries));
+		recs.resize(max);
+	}
+	else
+		sort(recs.begin(), recs.end(), recent_first(entries));
+
+	return recs.size();
+}
+
+int cQsoIndex::last(const char* call)
+{
+	guard_lock lock(&mutex);
+	if (!valid)
+		return -1;
+
+	list_map::const_iterator i = calls.find(upcase(call));
+	if (i == calls.end())
+		return -1;
+
+	int rec = -1;
+	for (vector<int>::const_iterator j = i->second.begin(); j != i->second.end(); ++j)
+		if (rec == -1 || entries[*j].when > entries[rec].when)
+			rec = *j;
+	return rec;
+}
+
+bool cQsoIndex::worked(const char* call, const char* band_, const char* mode)
+{
+	guard_lock lock(&mutex);
+	if (!valid)
+		return false;
+
+	list_map::const_iterator i = calls.find(upcase(call));
+	if (i == calls.end())
+		return false;
+
+	band_t band = NUM_BANDS;
+	if (*band_ && (band = band_of_name(band_)) == NUM_BANDS)
+		return false;
+	string m = upcase(mode);
+
+	for (vector<int>::const_iterator j = i->second.begin(); j != i->second.end(); ++j) {
+		const entry& e = entries[*j];
+		if ((band == NUM_BANDS || e.band == band) && (m.empty() || e.mode == m))
+			return true;
+	}
+	return false;
+}
+
+unsigned cQsoIndex::status(const char* dxcc, band_t band, const char* mode)
+{
+	guard_lock lock(&mutex);
+	if (!valid)
+		return 0;
+
+	string d = upcase(dxcc);
+	status_map::const_iterator i;
+	unsigned st = 0;
+
+	if ((i = statuses.find(status_key(d))) == statuses.end())
+		return 0;
+	st |= QSO_WORKED | (i->second.confirmed ? QSO_CONFIRMED : 0);
+	if (band == NUM_BANDS)
+		return st;
+
+	if ((i = statuses.find(status_key(d, band))) == statuses.end())
+		return st;
+	st |= QSO_WORKED_BAND | (i->second.confirmed ? QSO_CONFIRMED_BAND : 0);
+	if (!*mode)
+		return st;
+
+	if ((i = statuses.find(status_key(d, band, upcase(mode)))) != statuses.end())
+		st |= QSO_WORKED_MODE | (i->second.confirmed ? QSO_CONFIRMED_MODE : 0);
+	return st;
+}
@@ -214,6 +214,8 @@ Table::Table(int x, int y, int w, int h, char *label) :
 
   curRow = NULL;
   highlighter = NULL;
+  source = NULL;
+  sourceArg = NULL;
 
   sortColumn = -1;
   selected = -1;
@@ -640,6 +642,8 @@ void Table::addHiddenColumn(const char *label) {
  * Adds a cell with data to the table.
  */
 void Table::addCell(char *data) {
+  if (source)
+    clear();
   if (!noMoreColumns)
     noMoreColumns = true;
 
@@ -671,6 +675,9 @@ void Table::addCell(char *data) {
 void Table::addRow(int cols, ...) {
   char *temp;
 
+  if (source)
+    clear();
+
   if (!noMoreColumns)
     noMoreColumns = true;
 
@@ -716,7 +723,7 @@ void Table::addRow(int cols, ...) {
 void Table::removeRow(int row) {
   if ((row == -1) && (selected >= 0))
     row = selected;
-  if ((row >= 0) && (row < nRows)) {
+  if (!source && (row >= 0) && (row < nRows)) {
     char **rowData = data[row];
     if (rowData == curRow)
       curRow = NULL;
@@ -744,6 +751,7 @@ void Table::clear(bool removeColumns) {
   nRows = 0;
   curRow = NULL;
   cPos = 0;
+  source = NULL;
 
   // Delete row data.
   vector<char**>::iterator end = data.end();
@@ -773,6 +781,55 @@ void Table::clear(bool removeColumns) {
 }
 
 
+/*
+ * ====================================================================
+ *  void Table.dataSource(const char *(*source)(int row, int column,
+ *      void *arg), void *arg, int rows);
+ * ====================================================================
+ *
+ * Makes the table show `rows' rows read from `source' instead of its own
+ * data. Cells are fetched only as rows are drawn, read or searched, and
+ * the strings `source' returns must stay valid until it is called for
+ * the next row. The rows are in the order of the source, which sorts
+ * them itself. Call again after the source changes; clear() drops it.
+ */
+void Table::dataSource(const char *(*source)(int row, int column, void *arg),
+    void *arg, int rows) {
+  clear();
+  this->source = source;
+  sourceArg = arg;
+  nRows = rows;
+}
+
+
+/*
+ * =================================
+ *  char **Table.rowData(int row);
+ * =================================
+ *
+ * Returns the cells of row, from the source if there is one. These are
+ * only valid until the next call.
+ */
+char **Table::rowData(int row) {
+  if (source == NULL)
+    return data[row];
+
+  sourceRow.resize(nCols);
+  for (int i = 0; i < nCols; i++)
+    sourceRow[i] = (char*)cellData(row, i);
+  return &sourceRow[0];
+}
+
+
+const char *Table::cellData(int row, int column) {
+  if (source == NULL)
+    return data[row][column];
+
+  const char *s = source(row, column, sourceArg);
+  return s ? s : "";
+}
+
+
 /*
  * ============================================
  *  char *Table.valueAt(int row, int column);
@@ -783,9 +840,9 @@ void Table::clear(bool removeColumns) {
  */
 char *Table::valueAt(int row, int column) {
   if ((row >= 0) && (row < nRows) && (column >= 0) && (column < nCols))
-    return data[row][column];
+    return (char*)cellData(row, column);
   else if ((row == -1) && (selected >= 0) && (column >= 0) && (column < nCols))
-    return data[selected][column];
+    return (char*)cellData(selected, column);
   else
     return NULL;
 }
@@ -796,7 +853,7 @@ int Table::intValueAt(int row, int column) {
     row = selected;
 
   if ((row >= 0) && (row < nRows) && (column >= 0) && (column < nCols))
-    return strtol(data[row][column], NULL, 10);
+    return strtol(cellData(row, column), NULL, 10);
   else
     return 0;
 }
@@ -814,7 +871,7 @@ void Table::valueAt(int row, int column, char *data) {
   if ((row == -1) && (selected >= 0))
     row = selected;
 
-  if ((row >= 0) && (row < nRows) && (column >= 0) && (column < nCols)) {
+  if (!source && (row >= 0) && (row < nRows) && (column >= 0) && (column < nCols)) {
     if (column == sortColumn)
       toBeSorted = true;
     if (this->data[row][column] != NULL)
@@ -828,7 +885,7 @@ void Table::valueAt(int row, int column, int data) {
   if ((row == -1) && (selected >= 0))
     row = selected;
 
-  if ((row >= 0) && (row < nRows) && (column >= 0) && (column < nCols)) {
+  if (!source && (row >= 0) && (row < nRows) && (column >= 0) && (column < nCols)) {
     if (column == sortColumn)
       toBeSorted = true;
     if (this->data[row][column] != NULL)
@@ -853,7 +910,7 @@ const char **Table::getRow(int row) {
     row = selected;
 
   if ((row >= 0) && (row < nRows))
-    return (const char**)data[row];
+    return (const char**)rowData(row);
   else
     return NULL;
 }
@@ -1104,7 +1161,7 @@ int Table::handle(int event) {
 
       // Create new selection
       int len = 0;
-      char **tableRow = data[selected];
+      char **tableRow = rowData(selected);
       char *buffer;
 
       for (int col = 0; col < nCols; col++)
@@ -1441,7 +1498,7 @@ void Table::dSort(int start, int end,
  * Sorts table according sortColumn and ascent. Does not redraw.
  */
 void Table::sort() {
-  if ((sortColumn == -1) || !canSort)
+  if ((sortColumn == -1) || !canSort || source)
     return;
     /* NOT REACHED */
 
@@ -1558,7 +1615,7 @@ void Table::draw() {
     int yMod = iY - vScroll->value();
     for (int row = topRow, rowY = topRowY; row <= bottomRow;
         row++, rowY += rowHeight)
-      drawRow(row, data[row], xPos, rowY + yMod);
+      drawRow(row, rowData(row), xPos, rowY + yMod);
     fl_pop_clip();
   }
 
@@ -1800,14 +1857,14 @@ void Table::scrollCallback(Fl_Widget *widget, void *data) {
 #include "re.h"
 
 inline static
-bool search_row(const std::vector<char**>& data, int row, int col, int ncols, fre_t& re, bool allcols)
+bool search_row(Table& table, int row, int col, int ncols, fre_t& re, bool allcols)
 {
   if (unlikely(allcols)) {
     for (col = 0; col < ncols; col++)
-      if (re.match(data[row][col]))
+      if (re.match(table.valueAt(row, col)))
 	return true;
   }
-  else if (re.match(data[row][col]))
+  else if (re.match(table.valueAt(row, col)))
     return true;
   return false;
 }
@@ -1839,18 +1896,18 @@ bool Table::search(int& row, int& col, bool rev, const char* re)
   int r = row;
   if (rev) {
     for (; row >= 0; row--)
-      if (search_row(data, row, col, nCols, sre, allcols))
+      if (search_row(*this, row, col, nCols, sre, allcols))
 	return true;
     for (row = nRows - 1; row > r; row--)
-      if (search_row(data, row, col, nCols, sre, allcols))
+      if (search_row(*this, row, col, nCols, sre, allcols))
 	return true;
   }
   else {
     for (; row < nRows; row++)
-      if (search_row(data, row, col, nCols, sre, allcols))
+      if (search_row(*this, row, col, nCols, sre, allcols))
 	return true;
     for (row = 0; row < r; row++)
-      if (search_row(data, row, col, nCols, sre, allcols))
+      if (search_row(*this, row, col, nCols, sre, allcols))
 	return true;
   }
 
@@ -47,6 +47,7 @@
 #endif
 
 #include <unistd.h>
+#include <strings.h>
 
 #include <exception>
 #include <signal.h>
@@ -90,11 +91,17 @@
 #include "pskrep.h"
 #include "notify.h"
 #include "logbook.h"
+#include "lookupcall.h"
 #include "dxcc.h"
 #include "newinstall.h"
 #include "Viewer.h"
 #include "kmlserver.h"
 #include "data_io.h"
+#include "startup.h"
+#include "iq_input.h"
+#include "freqmeas.h"
+#include "wf_stream.h"
+#include "view_route.h"
 
 #if USE_HAMLIB
 	#include "rigclass.h"
@@ -287,6 +294,36 @@ void toggle_io_port_selection(int io_mode)
 	}
 }
 
+// reference data loaders, run by startup_job() while the gui is created
+static void cty_dat_load(void)
+{
+	dxcc_open(string(progdefaults.cty_dat_pathname).append("cty.dat").c_str());
+}
+
+static void lotw_load(void)
+{
+	qsl_open(string(progdefaults.cty_dat_pathname).append("lotw1.txt").c_str(), QSL_LOTW);
+}
+
+static void eqsl_load(void)
+{
+	if (!qsl_open(string(progdefaults.cty_dat_pathname).append("eqsl.txt").c_str(), QSL_EQSL))
+		qsl_open(string(progdefaults.cty_dat_pathname).append("AGMemberList.txt").c_str(), QSL_EQSL);
+}
+
+static void kml_load(void)
+{
+	kml_init(true);
+}
+
+// enable the features that depend on the country and QSL lists
+static void reference_data_loaded(void)
+{
+	update_countries_menu();
+	notify_dxcc_update();
+	qsodb_dxcc_update();
+}
+
 // these functions are all started after Fl::run() is executing
 void delayed_startup(void *)
 {
@@ -305,6 +342,9 @@ void delayed_startup(void *)
 	kiss_init();
 	data_io_enabled = progStatus.data_io_enabled;
 
+	wf_stream_start();
+	view_route_start();
+
 	toggle_io_port_selection(data_io_enabled);
 
 	notify_start();
@@ -313,6 +353,9 @@ void delayed_startup(void *)
 		if (!pskrep_start())
 			LOG_ERROR("Could not start PSK reporter: %s", pskrep_error());
 
+	if (progdefaults.lookup_prefetch)
+		lookup_prefetch_start();
+
 	auto_start();
 
 	if (progdefaults.check_for_updates)
@@ -323,6 +366,7 @@ int main(int argc, char ** argv)
 {
 	// for KISS_IO status information
 	program_start_time = time(0);
+	startup_mark("start");
 
 	active_modem = new NULLMODEM;
 
@@ -451,6 +495,10 @@ int main(int argc, char ** argv)
 				cbq[i]->attach(i, "KISSSOCKET_TID");
 				break;
 
+			case VIEWROUTE_TID:
+				cbq[i]->attach(i, "VIEWROUTE_TID");
+				break;
+
 			case FLMAIN_TID:
 				cbq[i]->attach(i, "FLMAIN_TID");
 				break;
@@ -589,13 +637,15 @@ int main(int argc, char ** argv)
 	if (progdefaults.cty_dat_pathname.empty())
 		progdefaults.cty_dat_pathname = HomeDir;
 
-	dxcc_open(string(progdefaults.cty_dat_pathname).append("cty.dat").c_str());
-	qsl_open(string(progdefaults.cty_dat_pathname).append("lotw1.txt").c_str(), QSL_LOTW);
-	if (!qsl_open(string(progdefaults.cty_dat_pathname).append("eqsl.txt").c_str(), QSL_EQSL))
-		qsl_open(string(progdefaults.cty_dat_pathname).append("AGMemberList.txt").c_str(), QSL_EQSL);
+	startup_mark("configuration");
+
+	startup_job("cty.dat", cty_dat_load, reference_data_loaded);
+	startup_job("lotw", lotw_load, reference_data_loaded);
+	startup_job("eqsl", eqsl_load, reference_data_loaded);
 
 	progStatus.loadLastState();
 	create_fl_digi_main(argc, argv);
+	startup_mark("main window setup");
 
 	if (!have_config || show_cpucheck) {
 		double speed = speed_test(SRC_SINC_FASTEST, 8);
@@ -642,6 +692,7 @@ int main(int argc, char ** argv)
 	progdefaults.testCommPorts();
 
 	macros.loadDefault();
+	startup_mark("macros");
 
 #if USE_HAMLIB
 	xcvr = new Rig();
@@ -656,6 +707,7 @@ int main(int argc, char ** argv)
 
 	progdefaults.initInterface();
 	trx_start();
+	startup_mark("sound and trx");
 
 #if SHOW_WIZARD_BEFORE_MAIN_WINDOW
 	if (!have_config) {
@@ -670,10 +722,12 @@ int main(int argc, char ** argv)
 	create_logbook_dialogs();
 	LOGBOOK_colors_font();
 
+	startup_mark("dialogs");
+
 	if( progdefaults.kml_save_dir.empty() ) {
 		progdefaults.kml_save_dir = KmlDir ;
 	}
-	kml_init(true);
+	startup_job("kml", kml_load);
 
 // OS X will prevent the main window from being resized if we change its
 // size *after* it has been shown. With some X11 window managers, OTOH,
@@ -693,6 +747,7 @@ int main(int argc, char ** argv)
 	update_main_title();
 
 	mode_browser = new Mode_Browser;
+	startup_report();
 
 #if !SHOW_WIZARD_BEFORE_MAIN_WINDOW
 	if (!have_config)
@@ -708,14 +763,19 @@ int main(int argc, char ** argv)
 
 void exit_process() {
 
+	startup_wait();
 	KmlServer::Exit();
 	arq_close();
 	kiss_close();
+	wf_stream_stop();
+	view_route_stop();
 	XML_RPC_Server::stop();
 
 	if (progdefaults.usepskrep)
 		pskrep_stop();
 
+	QRZclose();
+
 	for (int i = 0; i < NUM_QRUNNER_THREADS; i++) {
 		cbq[i]->detach();
 		delete cbq[i];
@@ -819,6 +879,49 @@ void generate_option_help(void) {
 	     << "  --xmlrpc-list\n"
 	     << "    List all available methods\n\n"
 
+	     << "  --iq-input SPEC\n"
+	     << "    Receive from a wide band I/Q stream instead of the sound card.\n"
+	     << "    SPEC is a file or FIFO name, - for standard input, or\n"
+	     << "    unix:PATH for a local socket\n\n"
+	     << "  --iq-format FORMAT\n"
+	     << "    Interleaved I/Q sample format, s16 or f32\n"
+	     << "    The default is: s16\n\n"
+	     << "  --iq-rate RATE\n"
+	     << "    I/Q sample rate\n"
+	     << "    The default is: " << progdefaults.IQSampleRate << "\n\n"
+	     << "  --iq-receivers LIST\n"
+	     << "    Comma separated virtual receivers.  Each is a DIAL frequency,\n"
+	     << "    an offset from the centre of the I/Q band, optionally followed\n"
+	     << "    by :MODE.  Only the first receiver feeds the GUI, that is the\n"
+	     << "    modem and the waterfall, and its :MODE is ignored; the benchmark\n"
+	     << "    batch mode decodes all of them.\n"
+	     << "    The default is: " << progdefaults.IQReceivers << "\n\n"
+
+	     << "  --fmt-carriers LIST\n"
+	     << "    Comma separated audio frequencies that the frequency analysis\n"
+	     << "    modem measures along with the modem frequency\n\n"
+	     << "  --fmt-replay FILE\n"
+	     << "    Write a binary frequency analysis log as CSV to standard output\n"
+	     << "    and exit\n\n"
+
+	     << "  --wf-stream [HOST:]PORT\n"
+	     << "    Stream the waterfall rows to the clients that connect to PORT\n"
+	     << "    The default HOST is: " << progdefaults.WFStreamAddress << "\n\n"
+	     << "  --wf-archive DIR\n"
+	     << "    Write the waterfall stream to hourly files in DIR\n\n"
+	     << "  --wf-archive-hours HOURS\n"
+	     << "    Remove the archive files after HOURS, 0 to keep them\n"
+	     << "    The default is: " << progdefaults.WFArchiveHours << "\n\n"
+	     << "  --wf-replay FILE\n"
+	     << "    Write a waterfall archive file as a PGM image, FILE.pgm, and exit\n\n"
+
+	     << "  --view-stream [HOST:]PORT\n"
+	     << "    Send the decoded lines of the signal browser channels to the\n"
+	     << "    clients that connect to PORT\n"
+	     << "    The default HOST is: " << progdefaults.ViewStreamAddress << "\n\n"
+	     << "  --view-log FILE\n"
+	     << "    Append the decoded lines of the signal browser channels to FILE\n\n"
+
 #if BENCHMARK_MODE
 	     << "  --benchmark-modem ID\n"
 	     << "    Specify the modem\n"
@@ -856,6 +959,31 @@ void generate_option_help(void) {
 	     << "  --benchmark-src-type TYPE\n"
 	     << "    Specify the sample rate conversion type\n"
 	     << "    Default: " << benchmark.src_type << " (" << src_get_name(benchmark.src_type) << ")\n\n"
+#  if USE_SNDFILE
+	     << "  --benchmark-batch INPUT\n"
+	     << "    Decode an audio file, the audio files in a directory, or the\n"
+	     << "    files named in @LISTFILE, faster than real time.  May be repeated.\n"
+	     << "    The decoded text is written to the output file, or to stdout,\n"
+	     << "    as lines tagged with time, audio frequency, mode and file name\n\n"
+	     << "  --benchmark-modes LIST\n"
+	     << "    Decode every batch file with each of the comma separated\n"
+	     << "    modem ids or short names in LIST\n"
+	     << "    Default: the --benchmark-modem modem\n\n"
+	     << "  --benchmark-jobs N\n"
+	     << "    Run up to N batch decoders in parallel\n"
+	     << "    Default: the number of processors\n\n"
+	     << "  --benchmark-replay FILE\n"
+	     << "    Decode the capture FILE as fast as possible, with the modems and\n"
+	     << "    receiver settings recorded in FILE.events while it was captured.\n"
+	     << "    The same capture always gives the same text, whose length and\n"
+	     << "    digest are shown in the event log\n\n"
+#  endif
+	     << "  --benchmark-viterbi BITS\n"
+	     << "    Time the Viterbi decoders of the PSK, MFSK and THOR modems on\n"
+	     << "    BITS random soft bits and exit\n\n"
+	     << "  --benchmark-kiss FRAMES\n"
+	     << "    Time the KISS and HDLC frame encoders and decoders on FRAMES\n"
+	     << "    frames of AX.25 sizes in each direction and exit\n\n"
 #endif
 
 	     << "  --cpu-speed-test\n"
@@ -964,6 +1092,10 @@ int parse_args(int argc, char **argv, int& idx)
 
 	       OPT_CONFIG_XMLRPC_ADDRESS, OPT_CONFIG_XMLRPC_PORT,
 	       OPT_CONFIG_XMLRPC_ALLOW, OPT_CONFIG_XMLRPC_DENY, OPT_CONFIG_XMLRPC_LIST,
+	       OPT_IQ_INPUT, OPT_IQ_FORMAT, OPT_IQ_RATE, OPT_IQ_RECEIVERS,
+	       OPT_FMT_CARRIERS, OPT_FMT_REPLAY,
+	       OPT_WF_STREAM, OPT_WF_ARCHIVE, OPT_WF_ARCHIVE_HOURS, OPT_WF_REPLAY,
+	       OPT_VIEW_STREAM, OPT_VIEW_LOG,
 		   OPT_CONFIG_KISS_ADDRESS, OPT_CONFIG_KISS_PORT_IO, OPT_CONFIG_KISS_PORT_O,
 		   OPT_CONFIG_KISS_DUAL_PORT, OPT_ENABLE_IO_PORT,
 
@@ -971,6 +1103,9 @@ int parse_args(int argc, char **argv, int& idx)
 	       OPT_BENCHMARK_MODEM, OPT_BENCHMARK_AFC, OPT_BENCHMARK_SQL, OPT_BENCHMARK_SQLEVEL,
 	       OPT_BENCHMARK_FREQ, OPT_BENCHMARK_INPUT, OPT_BENCHMARK_OUTPUT,
 	       OPT_BENCHMARK_SRC_RATIO, OPT_BENCHMARK_SRC_TYPE,
+	       OPT_BENCHMARK_BATCH, OPT_BENCHMARK_MODES, OPT_BENCHMARK_JOBS,
+	       OPT_BENCHMARK_REPLAY,
+	       OPT_BENCHMARK_VITERBI, OPT_BENCHMARK_KISS,
 #endif
 
                OPT_FONT, OPT_WFALL_HEIGHT,
@@ -1012,6 +1147,19 @@ int parse_args(int argc, char **argv, int& idx)
 		{ "xmlrpc-deny",           1, 0, OPT_CONFIG_XMLRPC_DENY },
 		{ "xmlrpc-list",           0, 0, OPT_CONFIG_XMLRPC_LIST },
 
+		{ "iq-input",              1, 0, OPT_IQ_INPUT },
+		{ "iq-format",             1, 0, OPT_IQ_FORMAT },
+		{ "iq-rate",               1, 0, OPT_IQ_RATE },
+		{ "iq-receivers",          1, 0, OPT_IQ_RECEIVERS },
+		{ "fmt-carriers",          1, 0, OPT_FMT_CARRIERS },
+		{ "fmt-replay",            1, 0, OPT_FMT_REPLAY },
+		{ "wf-stream",             1, 0, OPT_WF_STREAM },
+		{ "wf-archive",            1, 0, OPT_WF_ARCHIVE },
+		{ "wf-archive-hours",      1, 0, OPT_WF_ARCHIVE_HOURS },
+		{ "wf-replay",             1, 0, OPT_WF_REPLAY },
+		{ "view-stream",           1, 0, OPT_VIEW_STREAM },
+		{ "view-log",              1, 0, OPT_VIEW_LOG },
+
 #if BENCHMARK_MODE
 		{ "benchmark-modem", 1, 0, OPT_BENCHMARK_MODEM },
 		{ "benchmark-frequency", 1, 0, OPT_BENCHMARK_FREQ },
@@ -1022,6 +1170,12 @@ int parse_args(int argc, char **argv, int& idx)
 		{ "benchmark-output", 1, 0, OPT_BENCHMARK_OUTPUT },
 		{ "benchmark-src-ratio", 1, 0, OPT_BENCHMARK_SRC_RATIO },
 		{ "benchmark-src-type", 1, 0, OPT_BENCHMARK_SRC_TYPE },
+		{ "benchmark-batch", 1, 0, OPT_BENCHMARK_BATCH },
+		{ "benchmark-modes", 1, 0, OPT_BENCHMARK_MODES },
+		{ "benchmark-jobs", 1, 0, OPT_BENCHMARK_JOBS },
+		{ "benchmark-replay", 1, 0, OPT_BENCHMARK_REPLAY },
+		{ "benchmark-viterbi", 1, 0, OPT_BENCHMARK_VITERBI },
+		{ "benchmark-kiss", 1, 0, OPT_BENCHMARK_KISS },
 #endif
 
 		{ "font",	   1, 0, OPT_FONT },
@@ -1185,6 +1339,98 @@ int parse_args(int argc, char **argv, int& idx)
 			XML_RPC_Server::list_methods(cout);
 			exit(EXIT_SUCCESS);
 
+		case OPT_IQ_INPUT:
+			progdefaults.IQInput = optarg;
+			break;
+
+		case OPT_IQ_FORMAT:
+			if (!strcasecmp(optarg, "s16"))
+				progdefaults.IQFormat = 0;
+			else if (!strcasecmp(optarg, "f32"))
+				progdefaults.IQFormat = 1;
+			else
+				fatal_error(_("Bad I/Q format"));
+			break;
+
+		case OPT_IQ_RATE:
+			progdefaults.IQSampleRate = strtol(optarg, NULL, 10);
+			if (progdefaults.IQSampleRate <= 0)
+				fatal_error(_("Bad I/Q sample rate"));
+			break;
+
+		case OPT_IQ_RECEIVERS:
+		{
+			vector<iq_channel> channels;
+			if (!parse_iq_channels(optarg, channels) || channels.empty())
+				fatal_error(_("Bad receiver list"));
+#if !BENCHMARK_MODE
+			if (channels.size() > 1 || channels[0].mode != NUM_MODES)
+				cerr << "W: --" << longopts[longindex].name
+				     << ": only the first receiver is decoded, with the current modem\n";
+#endif
+			progdefaults.IQReceivers = optarg;
+		}
+			break;
+
+		case OPT_FMT_CARRIERS:
+		{
+			vector<double> freqs;
+			if (!parse_fmt_carriers(optarg, freqs))
+				fatal_error(_("Bad carrier list"));
+			progdefaults.AnalysisCarriers = optarg;
+		}
+			break;
+
+		case OPT_FMT_REPLAY:
+			exit(fmt_replay(optarg, stdout) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+		case OPT_WF_STREAM:
+		{
+			const char* port = strrchr(optarg, ':');
+			if (port) {
+				progdefaults.WFStreamAddress.assign(optarg, port - optarg);
+				port++;
+			}
+			else
+				port = optarg;
+			if (!*port)
+				fatal_error(_("Bad waterfall stream port"));
+			progdefaults.WFStreamPort = port;
+		}
+			break;
+
+		case OPT_WF_ARCHIVE:
+			progdefaults.WFArchive = optarg;
+			break;
+
+		case OPT_WF_ARCHIVE_HOURS:
+			progdefaults.WFArchiveHours = strtol(optarg, NULL, 10);
+			if (progdefaults.WFArchiveHours < 0)
+				fatal_error(_("Bad number of hours"));
+			break;
+
+		case OPT_WF_REPLAY:
+			exit(wf_stream_replay(optarg) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+		case OPT_VIEW_STREAM:
+		{
+			const char* port = strrchr(optarg, ':');
+			if (port) {
+				progdefaults.ViewStreamAddress.assign(optarg, port - optarg);
+				port++;
+			}
+			else
+				port = optarg;
+			if (!*port)
+				fatal_error(_("Bad browser text port"));
+			progdefaults.ViewStreamPort = port;
+		}
+			break;
+
+		case OPT_VIEW_LOG:
+			progdefaults.ViewLog = optarg;
+			break;
+
 #if BENCHMARK_MODE
 		case OPT_BENCHMARK_MODEM:
 			benchmark.modem = strtol(optarg, NULL, 10);
@@ -1227,6 +1473,49 @@ int parse_args(int argc, char **argv, int& idx)
 		case OPT_BENCHMARK_SRC_TYPE:
 			benchmark.src_type = strtol(optarg, NULL, 10);
 			break;
+
+		case OPT_BENCHMARK_BATCH:
+			benchmark.batch.push_back(optarg);
+			break;
+
+		case OPT_BENCHMARK_MODES:
+			if (!benchmark_set_modes(optarg)) {
+				fatal_error(_("Bad modem list"));
+			}
+			break;
+
+		case OPT_BENCHMARK_JOBS:
+			benchmark.jobs = strtol(optarg, NULL, 10);
+			if (benchmark.jobs < 0) {
+				fatal_error(_("Bad number of jobs"));
+			}
+			break;
+
+		case OPT_BENCHMARK_REPLAY:
+			benchmark.input = optarg;
+			benchmark.replay = true;
+			break;
+
+		case OPT_BENCHMARK_VITERBI:
+		{
+			long nbits = strtol(optarg, NULL, 10);
+			if (nbits <= 0)
+				fatal_error(_("Bad number of bits"));
+			exit(benchmark_viterbi(nbits));
+		}
+
+		case OPT_BENCHMARK_KISS:
+		{
+			long nframes = strtol(optarg, NULL, 10);
+			if (nframes <= 0)
+				fatal_error(_("Bad number of frames"));
+			int failed = 0;
+			// a short frame, a typical one and the largest AX.25 frame
+			failed |= benchmark_kiss(nframes, 20);
+			failed |= benchmark_kiss(nframes, 128);
+			failed |= benchmark_kiss(nframes, 330);
+			exit(failed);
+		}
 #endif
 
 		case OPT_FONT:
@@ -50,9 +50,20 @@ int	txSPP = 8;
 char txclr_tooltip[24];
 char txgry_tooltip[24];
 
-void updateRxPic(unsigned char data, int pos)
+// Called once per received row
+void updateRxPic(const image_sink& sink, int from, int to)
 {
-	picRx->pixel(data, pos);
+	if (!picRx)
+		return;
+	int row_bytes = sink.row_bytes();
+	while (from < to) {
+		int n = std::min(to, (from / row_bytes + 1) * row_bytes) - from;
+		const unsigned char* data = sink.at(from);
+		if (!data)
+			return;
+		picRx->pixels(data, from, n);
+		from += n;
+	}
 }
 
 void createRxViewer()
@@ -27,6 +27,7 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <algorithm>
 #include <libgen.h>
 
 #include <FL/Fl.H>
@@ -73,6 +74,9 @@ char mfskmsg[80];
 
 #include "mfsk-pic.cxx"
 
+// The received picture, published to the viewer row by row
+static image_sink rx_pic_sink(updateRxPic);
+
 void  mfsk::tx_init(SoundBase *sc)
 {
 	scard = sc;
@@ -422,17 +426,19 @@ void mfsk::recvpic(cmplx z)
 
 		if (color) {
 			pixelnbr = rgb + row + 3*col;
-			REQ(updateRxPic, byte, pixelnbr);
+			rx_pic_sink.put(pixelnbr, byte);
 			if (++col == picW) {
 				col = 0;
 				if (++rgb == 3) {
 					rgb = 0;
 					row += 3 * picW;
+					rx_pic_sink.commit(row);
 				}
 			}
 		} else {
 			for (int i = 0; i < 3; i++)
-				REQ(updateRxPic, byte, pixelnbr++);
+				rx_pic_sink.put(pixelnbr++, byte);
+			rx_pic_sink.commit(pixelnbr);
 		}
 		picf = 0.0;
 
@@ -484,6 +490,7 @@ printf("symbolbit = %d, symbits = %d\n", symbolbit, symbits);
 
 		rxstate = RX_STATE_PICTURE_START;
 		picturesize = RXspp * picW * picH * (color ? 3 : 1);
+		rx_pic_sink.reset(picW, 3);
 		pixelnbr = 0;
 		col = 0;
 		row = 0;
@@ -850,8 +857,9 @@ int mfsk::rx_process(const double *buf, int len)
 				rxstate = RX_STATE_DATA;
 				put_status("");
 
+				rx_pic_sink.flush();
 				string autosave_dir = PicsDir;
-				picRx->save_png(autosave_dir.c_str());
+				rx_pic_sink.save_png(autosave_dir.c_str(), false);
 				rx_init();
 			} else
 				recvpic(z);
@@ -24,19 +24,32 @@
 
 #include <fstream>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
+#include <cmath>
+#include <cerrno>
 
 #include <inttypes.h>
 #include <sys/time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <dirent.h>
+#include <strings.h>
+#include <unistd.h>
 
 #ifndef __MINGW32__
 #  include <sys/resource.h>
 #else
 #  include "compat.h"
 #endif
+#ifndef __WOE32__
+#  include <poll.h>
+#  include <sys/wait.h>
+#endif
 
 #if USE_SNDFILE
 #  include <sndfile.h>
@@ -49,6 +62,14 @@
 #include "configuration.h"
 #include "status.h"
 #include "debug.h"
+#include "startup.h"
+#include "iq_input.h"
+#include "viterbi.h"
+#include "kiss_io.h"
+#include "sound.h"
+#include "threads.h"
+#include "qrunner.h"
+#include "replay.h"
 
 #include "benchmark.h"
 
@@ -57,10 +78,36 @@ using namespace std;
 struct benchmark_params benchmark = { MODE_PSK31, 1000, false, false, 0.0, 1.0, SRC_SINC_FASTEST };
 
 
+static int setup_batch(void);
+static int setup_replay(void);
+
+static void setup_modem_params(void)
+{
+	progdefaults.rsid = false;
+	progdefaults.StartAtSweetSpot = false;
+
+	if (benchmark.modem != NUM_MODES)
+		progStatus.lastmode = benchmark.modem;
+	if (benchmark.freq)
+		progStatus.carrier = benchmark.freq;
+	progStatus.afconoff = benchmark.afc;
+	progStatus.sqlonoff = benchmark.sql;
+	progStatus.sldrSquelchValue = benchmark.sqlevel;
+
+	debug::level = debug::INFO_LEVEL;
+}
+
 int setup_benchmark(void)
 {
 	ENSURE_THREAD(FLMAIN_TID);
 
+	if (!benchmark.batch.empty() || !progdefaults.IQInput.empty()) {
+		benchmark.batching = true;
+		return setup_batch();
+	}
+	if (benchmark.replay)
+		return setup_replay();
+
 	if (benchmark.input.empty()) {
 		LOG_ERROR("Missing input");
 		return 1;
@@ -81,18 +128,7 @@ int setup_benchmark(void)
 	if (!benchmark.output.empty())
 		benchmark.buffer.reserve(BUFSIZ);
 
-	progdefaults.rsid = false;
-	progdefaults.StartAtSweetSpot = false;
-
-	if (benchmark.modem != NUM_MODES)
-		progStatus.lastmode = benchmark.modem;
-	if (benchmark.freq)
-		progStatus.carrier = benchmark.freq;
-	progStatus.afconoff = benchmark.afc;
-	progStatus.sqlonoff = benchmark.sql;
-	progStatus.sldrSquelchValue = benchmark.sqlevel;
-
-	debug::level = debug::INFO_LEVEL;
+	setup_modem_params();
 	TRX_WAIT(STATE_ENDED, trx_start(); init_modem(progStatus.lastmode));
 	if (!benchmark.output.empty()) {
 		ofstream out(benchmark.output.c_str());
@@ -109,11 +145,22 @@ SNDFILE* infile = 0;
 
 static size_t do_rx(struct rusage ru[2], struct timespec wall_time[2]);
 static size_t do_rx_src(struct rusage ru[2], struct timespec wall_time[2]);
+static void batch_rx(void);
+static bool replay_rx(void);
 
-void do_benchmark(void)
+// Returns false if a replay has asked for the next modem, and will go on
+// when the trx thread has started it
+bool do_benchmark(void)
 {
 	ENSURE_THREAD(TRX_TID);
 
+	if (benchmark.batching) {
+		batch_rx();
+		return true;
+	}
+	if (benchmark.replay)
+		return replay_rx();
+
 	if (benchmark.src_ratio != 1.0)
 		LOG_INFO("modem=%" PRIdPTR " (%s) rate=%d ratio=%f converter=%d (\"%s\")",
 			 active_modem->get_mode(), mode_info[active_modem->get_mode()].sname,
@@ -128,7 +175,7 @@ void do_benchmark(void)
 		SF_INFO info = { 0, 0, 0, 0, 0, 0 };
 		if ((infile = sf_open(benchmark.input.c_str(), SFM_READ, &info)) == NULL) {
 			LOG_ERROR("Could not open input file \"%s\"", benchmark.input.c_str());
-			return;
+			return true;
 		}
 	}
 #endif
@@ -158,6 +205,8 @@ void do_benchmark(void)
 	LOG_INFO("cpu time : %" PRIdMAX ".%03" PRIdMAX "; speed=%.3f samples/s; factor=%.3f",
 		 (intmax_t)ru[1].ru_utime.tv_sec, (intmax_t)ru[1].ru_utime.tv_usec / 1000,
 		 speed, speed / active_modem->get_samplerate());
+
+	return true;
 }
 
 // ----------------------------------------------------------------------------
@@ -288,3 +337,1069 @@ static size_t do_rx_src(struct rusage ru[2], struct timespec wall_time[2])
 
 	return nread;
 }
+
+// ----------------------------------------------------------------------------
+// Replay of a capture with the receiver settings recorded next to it (see
+// replay.h), as fast as the modems decode it.  The settings are applied at
+// the frames from which they held.  At a mode event the trx thread hands over
+// to the main thread, which starts the next modem as the GUI does, and the
+// replay goes on from the same frame with that modem.  Nothing depends on
+// timing, so every run decodes the same text; its length and digest are
+// logged to compare runs.
+
+// frames read at a time, as many as the trx loop reads from the sound card
+#define REPLAY_CHUNK SCBLOCKSIZE
+
+struct replay_rx_t {
+	vector<replay_event> events;
+	size_t next;		// the first event not yet applied
+#if USE_SNDFILE
+	SNDFILE* file;
+#endif
+	int file_rate;
+	int channels;
+	long long pos;		// frames read
+	float* frames;
+	float* mono;
+	float* out;
+	double* rxbuf;
+	size_t outlen;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	trx_mode mode;		// asked for by the trx thread, or NUM_MODES
+	bool done;
+
+	size_t samples;		// passed to the modems
+	double cpu, wall;
+};
+static replay_rx_t replay;
+
+#if USE_SNDFILE
+static trx_mode replay_mode(const char* name)
+{
+	for (trx_mode id = 0; id < NUM_MODES; id++)
+		if (!strcasecmp(name, mode_info[id].sname))
+			return id;
+	return NUM_MODES;
+}
+
+// Applies the events up to the next frame.  Returns the mode of a mode event
+// that needs another modem, or NUM_MODES.
+static trx_mode replay_apply(void)
+{
+	while (replay.next < replay.events.size() && replay.events[replay.next].frame <= replay.pos) {
+		const replay_event& e = replay.events[replay.next++];
+		const char* v = e.value.c_str();
+
+		if (e.key == "mode") {
+			trx_mode m = replay_mode(v);
+			if (m == NUM_MODES)
+				LOG_WARN("Unknown mode \"%s\" at frame %lld", v, e.frame);
+			else if (m != active_modem->get_mode())
+				return m;
+		}
+		else if (e.key == "freq")
+			active_modem->set_freq(strtod(v, NULL));
+		else if (e.key == "afc")
+			progStatus.afconoff = strtol(v, NULL, 10);
+		else if (e.key == "sql")
+			progStatus.sqlonoff = strtol(v, NULL, 10);
+		else if (e.key == "sqlevel")
+			progStatus.sldrSquelchValue = strtod(v, NULL);
+		else
+			LOG_WARN("Unknown event \"%s\" at frame %lld", e.key.c_str(), e.frame);
+	}
+
+	return NUM_MODES;
+}
+
+// Resamples n frames to the modem's rate and decodes them
+static void replay_process(SRC_STATE* src_state, double ratio, float* in, long n, bool end)
+{
+	if (!src_state) {
+		for (long i = 0; i < n; i++)
+			replay.rxbuf[i] = in[i];
+		if (n)
+			active_modem->rx_process(replay.rxbuf, n);
+		replay.samples += n;
+		return;
+	}
+
+	SRC_DATA data;
+	data.data_in = in;
+	data.input_frames = n;
+	data.src_ratio = ratio;
+	data.end_of_input = end;
+	for (;;) {
+		data.data_out = replay.out;
+		data.output_frames = replay.outlen;
+		int err;
+		if ((err = src_process(src_state, &data)) != 0) {
+			LOG_ERROR("src_process error %d: %s", err, src_strerror(err));
+			return;
+		}
+		long k = data.output_frames_gen;
+		for (long i = 0; i < k; i++)
+			replay.rxbuf[i] = replay.out[i];
+		if (k)
+			active_modem->rx_process(replay.rxbuf, k);
+		replay.samples += k;
+
+		data.data_in += data.input_frames_used;
+		data.input_frames -= data.input_frames_used;
+		if (k == 0 && (data.input_frames == 0 || data.input_frames_used == 0))
+			break;
+		if (data.input_frames == 0 && !end)
+			break;
+	}
+}
+#endif // USE_SNDFILE
+
+// Decodes the capture with the active modem up to its end or to the next
+// mode event.  Called from the trx thread.
+static bool replay_rx(void)
+{
+	trx_mode mode = NUM_MODES;
+
+#if USE_SNDFILE
+	double ratio = (double)active_modem->get_samplerate() / replay.file_rate;
+	SRC_STATE* src_state = 0;
+	if (ratio != 1.0) {
+		int err;
+		if ((src_state = src_new(benchmark.src_type, 1, &err)) == NULL)
+			LOG_ERROR("src_new error %d: %s", err, src_strerror(err));
+	}
+	LOG_INFO("modem=%" PRIdPTR " (%s) rate=%d from frame %lld", active_modem->get_mode(),
+		 mode_info[active_modem->get_mode()].sname, active_modem->get_samplerate(), replay.pos);
+
+	struct rusage ru[2];
+	struct timespec wall_time[2];
+	clock_gettime(CLOCK_MONOTONIC, &wall_time[0]);
+	getrusage(RUSAGE_SELF, &ru[0]);
+
+	while (ratio == 1.0 || src_state) {
+		if ((mode = replay_apply()) != NUM_MODES) {
+			replay_process(src_state, ratio, replay.mono, 0, true);
+			break;
+		}
+
+		sf_count_t n = REPLAY_CHUNK;
+		if (replay.next < replay.events.size())
+			n = MIN(n, replay.events[replay.next].frame - replay.pos);
+		n = sf_readf_float(replay.file, replay.frames, n);
+		if (replay.channels > 1)
+			for (sf_count_t i = 0; i < n; i++)
+				replay.mono[i] = replay.frames[i * replay.channels];
+		replay_process(src_state, ratio, replay.mono, n, n == 0);
+		if (n == 0)
+			break;
+		replay.pos += n;
+	}
+
+	getrusage(RUSAGE_SELF, &ru[1]);
+	clock_gettime(CLOCK_MONOTONIC, &wall_time[1]);
+	ru[1].ru_utime -= ru[0].ru_utime;
+	wall_time[1] -= wall_time[0];
+	replay.cpu += ru[1].ru_utime.tv_sec + ru[1].ru_utime.tv_usec / 1e6;
+	replay.wall += wall_time[1].tv_sec + wall_time[1].tv_nsec / 1e9;
+
+	if (src_state)
+		src_delete(src_state);
+#endif
+
+	guard_lock replay_lock(&replay.mutex);
+	if (mode == NUM_MODES) {
+		replay.done = true;
+		pthread_cond_signal(&replay.cond);
+		return true;
+	}
+	// the main thread starts the modem, and the trx loop calls us again
+	replay.mode = mode;
+	pthread_cond_signal(&replay.cond);
+	while (replay.mode != NUM_MODES)
+		pthread_cond_wait(&replay.cond, &replay.mutex);
+	return false;
+}
+
+static int setup_replay(void)
+{
+#if USE_SNDFILE
+	if (!replay_load(benchmark.input.c_str(), replay.events))
+		return 1;
+	SF_INFO info = { 0, 0, 0, 0, 0, 0 };
+	if ((replay.file = sf_open(benchmark.input.c_str(), SFM_READ, &info)) == NULL) {
+		LOG_ERROR("Could not open input file \"%s\"", benchmark.input.c_str());
+		return 1;
+	}
+	replay.file_rate = info.samplerate;
+	replay.channels = info.channels;
+	replay.frames = new float[REPLAY_CHUNK * replay.channels];
+	replay.mono = replay.channels > 1 ? new float[REPLAY_CHUNK] : replay.frames;
+	// enough for the highest modem rate from the lowest file rate
+	replay.outlen = REPLAY_CHUNK * 8;
+	replay.out = new float[replay.outlen];
+	replay.rxbuf = new double[replay.outlen];
+	replay.next = 0;
+	replay.pos = 0;
+	replay.samples = 0;
+	replay.cpu = replay.wall = 0.0;
+	replay.mode = NUM_MODES;
+	replay.done = false;
+	pthread_mutex_init(&replay.mutex, NULL);
+	pthread_cond_init(&replay.cond, NULL);
+
+	// the decoded text is kept for its digest
+	benchmark.buffer.reserve(BUFSIZ);
+	setup_modem_params();
+	for (size_t i = 0; i < replay.events.size(); i++) {
+		if (replay.events[i].key == "mode") {
+			trx_mode m = replay_mode(replay.events[i].value.c_str());
+			if (replay.events[i].frame == 0 && m != NUM_MODES)
+				progStatus.lastmode = m;
+			break;
+		}
+	}
+
+	trx_start();
+	init_modem(progStatus.lastmode);
+	for (;;) {
+		trx_mode m;
+		{
+			guard_lock replay_lock(&replay.mutex);
+			while (replay.mode == NUM_MODES && !replay.done)
+				pthread_cond_wait(&replay.cond, &replay.mutex);
+			if (replay.done)
+				break;
+			m = replay.mode;
+		}
+		init_modem(m);
+		guard_lock replay_lock(&replay.mutex);
+		replay.mode = NUM_MODES;
+		pthread_cond_signal(&replay.cond);
+	}
+	while (trx_state != STATE_ENDED)
+		trx_wait_state();
+
+	sf_close(replay.file);
+	if (replay.mono != replay.frames)
+		delete [] replay.mono;
+	delete [] replay.frames;
+	delete [] replay.out;
+	delete [] replay.rxbuf;
+
+	// FNV-1a
+	uint64_t digest = 14695981039346656037ULL;
+	for (string::const_iterator i = benchmark.buffer.begin(); i != benchmark.buffer.end(); ++i)
+		digest = (digest ^ (unsigned char)*i) * 1099511628211ULL;
+
+	double secs = (double)replay.pos / replay.file_rate;
+	LOG_INFO("replay: %.1f s of audio, %" PRIuSZ " samples decoded, cpu time %.3f s, wall time %.3f s, factor=%.1f",
+		 secs, replay.samples, replay.cpu, replay.wall, replay.cpu > 0.0 ? secs / replay.cpu : 0.0);
+	LOG_INFO("replay: %" PRIuSZ " characters, digest %016" PRIx64,
+		 benchmark.buffer.length(), digest);
+
+	if (!benchmark.output.empty()) {
+		ofstream out(benchmark.output.c_str());
+		if (out)
+			out << benchmark.buffer;
+	}
+
+	return 0;
+#else
+	LOG_ERROR("Replaying a capture needs libsndfile");
+	return 1;
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// Batch decoding of recorded audio.  Each file is decoded once for every mode
+// by a worker process of its own: the modems keep their state in globals and
+// cannot run side by side in one process.  The workers return timestamped
+// text, which is merged in time order, and their cpu usage.
+//
+// An I/Q input is instead split into virtual receivers by the parent, which
+// reads it once and pipes the audio of each receiver to the workers that
+// decode it.
+
+bool benchmark_set_modes(const char* list)
+{
+	benchmark.modes.clear();
+
+	string s(list);
+	string::size_type p = 0, q;
+	do {
+		q = s.find(',', p);
+		string m = s.substr(p, q == string::npos ? q : q - p);
+		p = q + 1;
+		if (m.empty())
+			continue;
+
+		char* e;
+		long id = strtol(m.c_str(), &e, 10);
+		if (*e != '\0') {
+			for (id = 0; id < NUM_MODES; id++)
+				if (!strcasecmp(m.c_str(), mode_info[id].sname))
+					break;
+		}
+		if (id < 0 || id >= NUM_MODES)
+			return false;
+		benchmark.modes.push_back(id);
+	} while (q != string::npos);
+
+	return !benchmark.modes.empty();
+}
+
+// decoded text is split into lines at these lengths and pauses
+#define BATCH_LINE_MAX 120
+#define BATCH_LINE_GAP 10.0
+// the sample rate of the virtual receivers' audio
+#define BATCH_IQ_RATE 8000
+
+struct batch_rx_t {
+	string file;
+	string name;		// the file name without directory
+	trx_mode mode;
+	int audio_fd;		// receiver audio from the parent, or -1
+	double dial;		// added to the modem frequency
+
+	time_t start;		// time of the first sample
+	double rate;		// modem sample rate
+	size_t pos;		// samples passed to the modem so far
+
+	string line;
+	size_t line_pos;	// position of the first character in the line
+	size_t last_pos;	// and of the latest
+	double line_freq;
+
+	string text;		// the lines and the statistics line
+	size_t frames;		// input frames decoded
+	int file_rate;
+	double cpu, wall;
+};
+static batch_rx_t batch;
+
+static void batch_end_line(void)
+{
+	string::size_type n = batch.line.find_last_not_of(" \t");
+	if (n == string::npos) {
+		batch.line.clear();
+		return;
+	}
+	batch.line.erase(n + 1);
+
+	time_t t = batch.start + (time_t)(batch.line_pos / batch.rate);
+	struct tm tm;
+	gmtime_r(&t, &tm);
+	char hdr[64];
+	size_t len = strftime(hdr, sizeof(hdr), "%Y-%m-%dT%H:%M:%SZ", &tm);
+	snprintf(hdr + len, sizeof(hdr) - len, " %.0f %s ", batch.line_freq, mode_info[batch.mode].sname);
+
+	batch.text.append(hdr).append(batch.name).append(": ").append(batch.line).append(1, '\n');
+	batch.line.clear();
+}
+
+// Called by put_rx_char from the trx thread
+void benchmark_put_char(unsigned int data)
+{
+	if (!batch.line.empty() && batch.pos - batch.last_pos > batch.rate * BATCH_LINE_GAP)
+		batch_end_line();
+
+	if (data == '\n' || data == '\r') {
+		batch_end_line();
+		return;
+	}
+	if ((data < ' ' && data != '\t') || data == 0x7f)
+		return;
+
+	if (batch.line.empty()) {
+		batch.line_pos = batch.pos;
+		batch.line_freq = batch.dial + active_modem->get_freq();
+	}
+	batch.line += (char)data;
+	batch.last_pos = batch.pos;
+	if (batch.line.length() >= BATCH_LINE_MAX)
+		batch_end_line();
+}
+
+struct batch_reader_t {
+#if USE_SNDFILE
+	SNDFILE* file;
+#endif
+	int fd;
+	int channels;
+	size_t chunk;
+	float* frames;
+	float* mono;
+};
+
+// Reads the next chunk and keeps only the first channel
+static long batch_read(void* arg, float** data)
+{
+	batch_reader_t* r = static_cast<batch_reader_t*>(arg);
+
+	long n = 0;
+	if (r->fd != -1) {
+		size_t size = r->chunk * sizeof(float);
+		char* p = reinterpret_cast<char*>(r->frames);
+		size_t got = 0;
+		while (got < size) {
+			ssize_t k = read(r->fd, p + got, size - got);
+			if (k == -1 && errno == EINTR)
+				continue;
+			if (k <= 0)
+				break;
+			got += k;
+		}
+		n = got / sizeof(float);
+	}
+#if USE_SNDFILE
+	else
+		n = (long)sf_readf_float(r->file, r->frames, r->chunk);
+#endif
+	if (r->channels > 1)
+		for (long i = 0; i < n; i++)
+			r->mono[i] = r->frames[i * r->channels];
+	*data = n ? r->mono : 0;
+	return n;
+}
+
+static void batch_rx(void)
+{
+	batch_reader_t r;
+	r.fd = batch.audio_fd;
+	r.channels = 1;
+	if (r.fd != -1)
+		batch.file_rate = BATCH_IQ_RATE;
+	else {
+#if USE_SNDFILE
+		SF_INFO info = { 0, 0, 0, 0, 0, 0 };
+		if ((r.file = sf_open(batch.file.c_str(), SFM_READ, &info)) == NULL) {
+			LOG_ERROR("Could not open input file \"%s\"", batch.file.c_str());
+			return;
+		}
+		// a recording ends when its file was last written to
+		struct stat st;
+		if (stat(batch.file.c_str(), &st) == 0)
+			batch.start = st.st_mtime - (time_t)(info.frames / info.samplerate);
+		batch.file_rate = info.samplerate;
+		r.channels = info.channels;
+#else
+		return;
+#endif
+	}
+	batch.rate = active_modem->get_samplerate();
+	batch.pos = 0;
+
+	// small chunks keep the line time stamps accurate
+	r.chunk = batch.file_rate / 10 + 1;
+	r.frames = new float[r.chunk * r.channels];
+	r.mono = r.channels > 1 ? new float[r.chunk] : r.frames;
+
+	double ratio = batch.rate / batch.file_rate;
+	SRC_STATE* src_state = 0;
+	size_t outlen = r.chunk;
+	float* outbuf = 0;
+	if (ratio != 1.0) {
+		int err;
+		if ((src_state = src_callback_new(batch_read, benchmark.src_type, 1, &err, &r)) == NULL) {
+			LOG_ERROR("src_callback_new error %d: %s", err, src_strerror(err));
+			ratio = 0.0;
+		}
+		outlen = (size_t)ceil(r.chunk * ratio);
+		outbuf = new float[outlen];
+	}
+	double* rxbuf = new double[outlen];
+
+	struct rusage ru[2];
+	struct timespec wall_time[2];
+	clock_gettime(CLOCK_MONOTONIC, &wall_time[0]);
+	getrusage(RUSAGE_SELF, &ru[0]);
+
+	float* p;
+	long n;
+	while (ratio != 0.0) {
+		if (src_state)
+			n = src_callback_read(src_state, ratio, outlen, p = outbuf);
+		else
+			n = batch_read(&r, &p);
+		if (n <= 0)
+			break;
+		for (long i = 0; i < n; i++)
+			rxbuf[i] = p[i];
+		active_modem->rx_process(rxbuf, n);
+		batch.pos += n;
+	}
+
+	getrusage(RUSAGE_SELF, &ru[1]);
+	clock_gettime(CLOCK_MONOTONIC, &wall_time[1]);
+	ru[1].ru_utime -= ru[0].ru_utime;
+	wall_time[1] -= wall_time[0];
+	batch.cpu = ru[1].ru_utime.tv_sec + ru[1].ru_utime.tv_usec / 1e6;
+	batch.wall = wall_time[1].tv_sec + wall_time[1].tv_nsec / 1e9;
+	batch.frames = (size_t)round(batch.pos / batch.rate * batch.file_rate);
+
+	if (src_state)
+		src_delete(src_state);
+	if (r.mono != r.frames)
+		delete [] r.mono;
+	delete [] r.frames;
+	delete [] outbuf;
+	delete [] rxbuf;
+#if USE_SNDFILE
+	if (r.fd == -1)
+		sf_close(r.file);
+#endif
+}
+
+struct batch_job_t {
+	string file;
+	trx_mode mode;
+	int rx;			// virtual receiver, or -1 for a file
+	double dial;
+	time_t start;
+	string output;
+	int in_fd;		// the receiver's audio, written by the parent
+	int audio_fd;		// and read by the worker
+#ifndef __WOE32__
+	pid_t pid;
+	int fd;
+	int status;
+#endif
+};
+
+// Decodes one job in this process.  The output ends with a statistics line
+// that starts with \001.
+static void batch_decode(batch_job_t& job)
+{
+	batch.file = job.file;
+	string::size_type p = job.file.find_last_of("/\\");
+	batch.name = p == string::npos ? job.file : job.file.substr(p + 1);
+	batch.mode = job.mode;
+	batch.audio_fd = job.audio_fd;
+	batch.dial = job.dial;
+	batch.start = job.start;
+	batch.text.clear();
+	batch.line.clear();
+	batch.frames = 0;
+	batch.file_rate = 0;
+	batch.cpu = batch.wall = 0.0;
+
+	progStatus.lastmode = job.mode;
+	TRX_WAIT(STATE_ENDED, trx_start(); init_modem(job.mode));
+	batch_end_line();
+
+	char stats[128];
+	snprintf(stats, sizeof(stats), "\001%lu %d %.3f %.3f\n", (unsigned long)batch.frames,
+		 batch.file_rate, batch.cpu, batch.wall);
+	batch.text += stats;
+	job.output.swap(batch.text);
+}
+
+static bool is_audio_file(const char* name)
+{
+	static const char* ext[] = { ".wav", ".flac", ".ogg", ".aif", ".aiff", ".au", ".snd", ".caf", ".w64" };
+
+	const char* p = strrchr(name, '.');
+	if (!p)
+		return false;
+	for (size_t i = 0; i < sizeof(ext) / sizeof(*ext); i++)
+		if (!strcasecmp(p, ext[i]))
+			return true;
+	return false;
+}
+
+// Adds a file, the audio files in a directory, or the entries of an @list
+static void batch_add_input(const string& in, vector<string>& files)
+{
+	if (in[0] == '@') {
+		ifstream list(in.c_str() + 1);
+		if (!list) {
+			LOG_ERROR("Could not read %s", in.c_str() + 1);
+			return;
+		}
+		string line;
+		while (getline(list, line)) {
+			string::size_type n = line.find_last_not_of(" \t\r");
+			if (n == string::npos || line[0] == '#')
+				continue;
+			line.erase(n + 1);
+			batch_add_input(line, files);
+		}
+		return;
+	}
+
+	struct stat st;
+	if (stat(in.c_str(), &st) == -1) {
+		LOG_PERROR(in.c_str());
+		return;
+	}
+	if (!S_ISDIR(st.st_mode)) {
+		files.push_back(in);
+		return;
+	}
+
+	DIR* dir = opendir(in.c_str());
+	if (!dir) {
+		LOG_PERROR(in.c_str());
+		return;
+	}
+	vector<string> v;
+	string path = in;
+	if (*path.rbegin() != '/')
+		path += '/';
+	for (struct dirent* d; (d = readdir(dir)); )
+		if (is_audio_file(d->d_name))
+			v.push_back(path + d->d_name);
+	closedir(dir);
+	sort(v.begin(), v.end());
+	files.insert(files.end(), v.begin(), v.end());
+}
+
+#ifndef __WOE32__
+static bool batch_write(int fd, const void* buf, size_t n)
+{
+	const char* p = static_cast<const char*>(buf);
+	while (n) {
+		ssize_t w = write(fd, p, n);
+		if (w == -1) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		p += w;
+		n -= w;
+	}
+	return true;
+}
+
+// Reads the I/Q input once and writes the audio of every virtual receiver
+// to the workers that decode it
+static void batch_feed_iq(vector<batch_job_t>& jobs, vector<iq_receiver*>& receivers, iq_source& source)
+{
+	vector<cmplx> iq(progdefaults.IQSampleRate / 10 + 1);
+	vector<float> audio;
+
+	for (size_t n; (n = source.read(&iq[0], iq.size())); ) {
+		for (size_t r = 0; r < receivers.size(); r++) {
+			audio.clear();
+			receivers[r]->process(&iq[0], n, audio);
+			if (audio.empty())
+				continue;
+			for (size_t i = 0; i < jobs.size(); i++) {
+				if (jobs[i].rx != (int)r || jobs[i].in_fd == -1)
+					continue;
+				if (!batch_write(jobs[i].in_fd, &audio[0], audio.size() * sizeof(float))) {
+					close(jobs[i].in_fd);
+					jobs[i].in_fd = -1;
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < jobs.size(); i++) {
+		if (jobs[i].in_fd != -1) {
+			close(jobs[i].in_fd);
+			jobs[i].in_fd = -1;
+		}
+	}
+}
+
+static bool batch_start(vector<batch_job_t>& jobs, size_t j)
+{
+	batch_job_t& job = jobs[j];
+	job.fd = -1;
+	job.status = -1;
+
+	int fd[2], in[2] = { -1, -1 };
+	if (pipe(fd) == -1 || (job.rx != -1 && pipe(in) == -1)) {
+		LOG_PERROR("pipe");
+		return false;
+	}
+
+	fflush(NULL);
+	job.pid = fork();
+	if (job.pid == -1) {
+		LOG_PERROR("fork");
+		close(fd[0]);
+		close(fd[1]);
+		if (in[0] != -1) {
+			close(in[0]);
+			close(in[1]);
+		}
+		return false;
+	}
+	if (job.pid == 0) {
+		// the pipes of the other workers would keep them from seeing their end
+		for (size_t i = 0; i < j; i++) {
+			if (jobs[i].fd != -1)
+				close(jobs[i].fd);
+			if (jobs[i].in_fd != -1)
+				close(jobs[i].in_fd);
+		}
+		close(fd[0]);
+		if (in[1] != -1)
+			close(in[1]);
+		// the request queues and their pipes are the parent's: a worker
+		// gets its own before it starts the trx thread
+		for (int i = 0; i < NUM_QRUNNER_THREADS; i++) {
+			string name = cbq[i]->id_str();
+			delete cbq[i];
+			cbq[i] = new qrunner;
+			cbq[i]->attach(i, name);
+		}
+		job.audio_fd = in[0];
+		batch_decode(job);
+		fflush(NULL);
+		_exit(batch_write(fd[1], job.output.data(), job.output.length()) ?
+		      EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	close(fd[1]);
+	job.fd = fd[0];
+	if (in[0] != -1) {
+		close(in[0]);
+		job.in_fd = in[1];
+	}
+	return true;
+}
+
+// Runs up to nworkers jobs at a time and collects their output.  The I/Q
+// input, if any, is fed to the workers once they have all been started.
+static void batch_run(vector<batch_job_t>& jobs, size_t nworkers,
+		      vector<iq_receiver*>& receivers, iq_source& source)
+{
+	size_t next = 0, running = 0;
+	vector<struct pollfd> fds;
+	vector<size_t> idx;
+	char buf[BUFSIZ];
+
+	if (!receivers.empty()) {
+		for (; next < jobs.size(); next++)
+			if (batch_start(jobs, next))
+				running++;
+		batch_feed_iq(jobs, receivers, source);
+	}
+
+	while (next < jobs.size() || running) {
+		for (; running < nworkers && next < jobs.size(); next++)
+			if (batch_start(jobs, next))
+				running++;
+		if (!running)
+			continue;
+
+		fds.clear();
+		idx.clear();
+		for (size_t i = 0; i < next; i++) {
+			if (jobs[i].fd == -1)
+				continue;
+			struct pollfd p = { jobs[i].fd, POLLIN, 0 };
+			fds.push_back(p);
+			idx.push_back(i);
+		}
+		if (poll(&fds[0], fds.size(), -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			LOG_PERROR("poll");
+			break;
+		}
+
+		for (size_t i = 0; i < fds.size(); i++) {
+			if (!fds[i].revents)
+				continue;
+			batch_job_t& job = jobs[idx[i]];
+			ssize_t n = read(job.fd, buf, sizeof(buf));
+			if (n > 0)
+				job.output.append(buf, n);
+			else if (n == 0 || errno != EINTR) {
+				close(job.fd);
+				job.fd = -1;
+				while (waitpid(job.pid, &job.status, 0) == -1 && errno == EINTR)
+					;
+				running--;
+			}
+		}
+	}
+}
+#endif // !__WOE32__
+
+static bool batch_time_order(const string& a, const string& b)
+{
+	return a.compare(0, 20, b, 0, 20) < 0;
+}
+
+static void batch_add_job(vector<batch_job_t>& jobs, const string& file, trx_mode mode,
+			  int rx, double dial, time_t start)
+{
+	jobs.push_back(batch_job_t());
+	batch_job_t& job = jobs.back();
+	job.file = file;
+	job.mode = mode;
+	job.rx = rx;
+	job.dial = dial;
+	job.start = start;
+	job.in_fd = job.audio_fd = -1;
+}
+
+static int setup_batch(void)
+{
+	if (benchmark.modes.empty())
+		benchmark.modes.push_back(benchmark.modem == NUM_MODES ? MODE_PSK31 : benchmark.modem);
+
+	vector<batch_job_t> jobs;
+	vector<iq_receiver*> receivers;
+	iq_source source;
+
+	if (!progdefaults.IQInput.empty()) {
+#ifdef __WOE32__
+		LOG_ERROR("Decoding an I/Q input needs worker processes");
+		return 1;
+#endif
+		// every receiver is decoded with its own mode, or with all of them
+		vector<iq_channel> channels;
+		if (!parse_iq_channels(progdefaults.IQReceivers, channels) || channels.empty()) {
+			LOG_ERROR("Bad receiver list \"%s\"", progdefaults.IQReceivers.c_str());
+			return 1;
+		}
+		const string& spec = progdefaults.IQInput;
+		if (!source.open(spec, progdefaults.IQFormat ? iq_source::IQ_F32 : iq_source::IQ_S16)) {
+			LOG_PERROR(spec.c_str());
+			return 1;
+		}
+		time_t start = time(NULL);
+		struct stat st;
+		if (source.regular() && stat(spec.c_str(), &st) == 0) {
+			size_t size = (progdefaults.IQFormat ? sizeof(float) : sizeof(short)) * 2;
+			start = st.st_mtime - (time_t)(st.st_size / size / progdefaults.IQSampleRate);
+		}
+		for (size_t i = 0; i < channels.size(); i++) {
+			receivers.push_back(new iq_receiver(progdefaults.IQSampleRate, BATCH_IQ_RATE,
+							    channels[i].dial));
+			if (channels[i].mode != NUM_MODES)
+				batch_add_job(jobs, spec, channels[i].mode, i, channels[i].dial, start);
+			else
+				for (size_t m = 0; m < benchmark.modes.size(); m++)
+					batch_add_job(jobs, spec, benchmark.modes[m], i, channels[i].dial, start);
+		}
+	}
+	else {
+#if USE_SNDFILE
+		vector<string> files;
+		for (vector<string>::const_iterator i = benchmark.batch.begin(); i != benchmark.batch.end(); ++i)
+			batch_add_input(*i, files);
+		if (files.empty()) {
+			LOG_ERROR("No input files");
+			return 1;
+		}
+		for (vector<string>::const_iterator f = files.begin(); f != files.end(); ++f)
+			for (vector<trx_mode>::const_iterator m = benchmark.modes.begin(); m != benchmark.modes.end(); ++m)
+				batch_add_job(jobs, *f, *m, -1, 0.0, 0);
+#else
+		LOG_ERROR("Decoding audio files needs libsndfile");
+		return 1;
+#endif
+	}
+
+	long nworkers = benchmark.jobs;
+	if (nworkers <= 0)
+		nworkers = sysconf(_SC_NPROCESSORS_ONLN);
+	nworkers = CLAMP(nworkers, 1, (long)jobs.size());
+	// the receivers of a stream must all be decoded at the same time
+	if (!receivers.empty())
+		nworkers = jobs.size();
+
+	setup_modem_params();
+	// Only the forking thread is copied into a worker, which must not
+	// inherit a lock held by another thread.  The startup jobs are the
+	// only other threads at this point; the qrunners are not threads,
+	// and each worker replaces them with its own.
+	startup_wait();
+
+	struct timespec wall_time[2];
+	clock_gettime(CLOCK_MONOTONIC, &wall_time[0]);
+#ifndef __WOE32__
+	batch_run(jobs, nworkers, receivers, source);
+#else
+	nworkers = 1;
+	for (size_t i = 0; i < jobs.size(); i++)
+		batch_decode(jobs[i]);
+#endif
+	clock_gettime(CLOCK_MONOTONIC, &wall_time[1]);
+	wall_time[1] -= wall_time[0];
+
+	for (size_t i = 0; i < receivers.size(); i++)
+		delete receivers[i];
+
+	vector<string> lines;
+	double audio = 0.0, cpu = 0.0;
+	size_t failed = 0;
+	for (size_t i = 0; i < jobs.size(); i++) {
+		const string& out = jobs[i].output;
+		string::size_type p = 0, q;
+		unsigned long frames = 0;
+		int rate = 0;
+		double jcpu = 0.0, jwall = 0.0;
+		bool done = false;
+		while ((q = out.find('\n', p)) != string::npos) {
+			if (out[p] == '\001')
+				done = sscanf(out.c_str() + p + 1, "%lu %d %lf %lf",
+					      &frames, &rate, &jcpu, &jwall) == 4;
+			else
+				lines.push_back(out.substr(p, q - p + 1));
+			p = q + 1;
+		}
+#ifndef __WOE32__
+		if (!WIFEXITED(jobs[i].status) || WEXITSTATUS(jobs[i].status) != EXIT_SUCCESS)
+			done = false;
+#endif
+		char rx[32] = "";
+		if (jobs[i].rx != -1)
+			snprintf(rx, sizeof(rx), " %+.0f Hz", jobs[i].dial);
+		if (!done || rate <= 0) {
+			LOG_ERROR("%s%s (%s): failed", jobs[i].file.c_str(), rx, mode_info[jobs[i].mode].sname);
+			failed++;
+			continue;
+		}
+
+		double secs = (double)frames / rate;
+		LOG_INFO("%s%s (%s): %.1f s of audio, cpu time %.3f s, wall time %.3f s, factor=%.1f",
+			 jobs[i].file.c_str(), rx, mode_info[jobs[i].mode].sname,
+			 secs, jcpu, jwall, jcpu > 0.0 ? secs / jcpu : 0.0);
+		audio += secs;
+		cpu += jcpu;
+	}
+
+	stable_sort(lines.begin(), lines.end(), batch_time_order);
+
+	FILE* out = stdout;
+	if (!benchmark.output.empty() && (out = fopen(benchmark.output.c_str(), "w")) == NULL) {
+		LOG_PERROR(benchmark.output.c_str());
+		out = stdout;
+	}
+	for (vector<string>::const_iterator i = lines.begin(); i != lines.end(); ++i)
+		fwrite(i->data(), 1, i->length(), out);
+	if (out != stdout)
+		fclose(out);
+	else
+		fflush(out);
+
+	double wall = wall_time[1].tv_sec + wall_time[1].tv_nsec / 1e9;
+	LOG_INFO("batch: %" PRIuSZ " jobs (%" PRIuSZ " failed) on %ld workers, %" PRIuSZ " lines",
+		 jobs.size(), failed, nworkers, lines.size());
+	LOG_INFO("batch: %.1f s of audio, cpu time %.3f s, wall time %.3f s, factor=%.1f",
+		 audio, cpu, wall, wall > 0.0 ? audio / wall : 0.0);
+
+	return failed ? 1 : 0;
+}
+
+// ----------------------------------------------------------------------------
+
+// Times the Viterbi decoder on random soft symbols, with the vectorised and
+// the plain add-compare-select, and checks that they decode the same bits.
+int benchmark_viterbi(size_t nbits)
+{
+	static const struct {
+		int k, poly1, poly2, chunk, trace;
+		const char* use;
+	} codes[] = {
+		{ 5, 0x17, 0x19, 8, PATHMEM - 1, "QPSK" },
+		{ 7, 0x6d, 0x4f, 4, PATHMEM - 1, "PSK-R" },
+		{ 7, 0x6d, 0x4f, 1, 45, "MFSK, THOR" },
+		{ 13, 016461, 012767, 4, PATHMEM - 1, "punctured PSK" },
+		{ 15, 044735, 063057, 8, PATHMEM - 1, "THOR 100, 25x4, 50" },
+		{ 16, 0152711, 0126723, 4, PATHMEM - 1, "8PSK, 16PSK, XPSK" }
+	};
+
+	vector<unsigned char> sym(2 * nbits);
+	srand(1);
+	for (size_t i = 0; i < sym.size(); i++)
+		sym[i] = rand() & 0xff;
+
+	int failed = 0;
+	for (size_t i = 0; i < sizeof(codes) / sizeof(*codes); i++) {
+		double speed[2] = { 0.0, 0.0 };
+		vector<int> out[2];
+
+		for (int v = 0; v < 2; v++) {
+			viterbi dec(codes[i].k, codes[i].poly1, codes[i].poly2);
+			dec.settraceback(codes[i].trace);
+			dec.setchunksize(codes[i].chunk);
+			if (dec.setvector(v) == -1)
+				continue;
+
+			struct timespec t[2];
+			int c, met;
+			out[v].reserve(nbits);
+			clock_gettime(CLOCK_MONOTONIC, &t[0]);
+			for (size_t n = 0; n < nbits; n++)
+				if ((c = dec.decode(&sym[2 * n], &met)) != -1) {
+					out[v].push_back(c);
+					out[v].push_back(met);
+				}
+			clock_gettime(CLOCK_MONOTONIC, &t[1]);
+			t[1] -= t[0];
+			speed[v] = nbits / (t[1].tv_sec + t[1].tv_nsec / 1e9);
+		}
+
+		bool same = speed[1] == 0.0 || out[0] == out[1];
+		printf("K=%-2d %-20s plain %10.0f bits/s  vector %10.0f bits/s  %s\n",
+		       codes[i].k, codes[i].use, speed[0], speed[1],
+		       speed[1] == 0.0 ? "" : (same ? "same output" : "OUTPUT DIFFERS"));
+		if (!same)
+			failed++;
+	}
+
+	return failed ? 1 : 0;
+}
+
+// Frames of nbytes through both directions of the KISS interface: host to
+// radio decodes a KISS frame and encodes its HDLC frame, radio to host the
+// reverse.  Each frame is checked against the data it came from.
+int benchmark_kiss(size_t nframes, size_t nbytes)
+{
+	vector<char> data(nbytes);
+	srand(1);
+	for (size_t i = 0; i < nbytes; i++)
+		data[i] = rand() & 0xff;
+
+	vector<char> kiss(KISS_ENCODED_SIZE(nbytes)), hdlc(HDLC_ENCODED_SIZE(nbytes));
+	kiss.resize(kiss_encode_frame(KISS_DATA, &data[0], nbytes, CRC16_NONE, &kiss[0]));
+	hdlc.resize(hdlc_encode_frame(&data[0], nbytes, &hdlc[0]));
+
+	int failed = 0;
+	struct timespec t[3];
+	clock_gettime(CLOCK_MONOTONIC, &t[0]);
+	for (size_t n = 0; n < nframes; n++) {
+		KISS_QUEUE_FRAME *in = kiss_frame_alloc(kiss.size());
+		memcpy(in->data, &kiss[0], kiss.size());
+		size_t count = kiss_decode_frame(in->data, kiss.size(), CRC16_NONE);
+		KISS_QUEUE_FRAME *out = kiss_frame_alloc(HDLC_ENCODED_SIZE(count));
+		out->size = hdlc_encode_frame(in->data + 1, count - 1, out->data);
+		if (out->size != hdlc.size() || memcmp(out->data, &hdlc[0], out->size))
+			failed++;
+		kiss_frame_release(out);
+		kiss_frame_release(in);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t[1]);
+	for (size_t n = 0; n < nframes; n++) {
+		// decoded from between the frame delimiters, as received
+		KISS_QUEUE_FRAME *in = kiss_frame_alloc(hdlc.size());
+		in->size = hdlc_decode_frame(&hdlc[1], hdlc.size() - 2, in->data);
+		KISS_QUEUE_FRAME *out = kiss_frame_alloc(KISS_ENCODED_SIZE(in->size));
+		out->size = kiss_encode_frame(KISS_DATA, in->data, in->size, CRC16_NONE, out->data);
+		if (out->size != kiss.size() || memcmp(out->data, &kiss[0], out->size))
+			failed++;
+		kiss_frame_release(out);
+		kiss_frame_release(in);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t[2]);
+
+	t[2] -= t[1];
+	t[1] -= t[0];
+	printf("%" PRIuSZ " byte frames: host to radio %10.0f frames/s  radio to host %10.0f frames/s  %s\n",
+	       nbytes, nframes / (t[1].tv_sec + t[1].tv_nsec / 1e9),
+	       nframes / (t[2].tv_sec + t[2].tv_nsec / 1e9),
+	       failed ? "FRAMES DIFFER" : "same frames");
+
+	return failed ? 1 : 0;
+}
@@ -41,6 +41,12 @@
 #include "configuration.h"
 #include "confdialog.h"
 #include "main.h"
+#include "fl_digi.h"
+#include "notify.h"
+#include "threads.h"
+#include "mapped_file.h"
+#include "startup.h"
+#include "logsupport.h"
 
 using namespace std;
 
@@ -66,28 +72,196 @@ dxcc::dxcc(const char* cn, int cq, int itu, const char* ct, float lat, float lon
 
 typedef unordered_map<string, dxcc*> dxcc_map_t;
 typedef vector<dxcc*> dxcc_list_t;
-static dxcc_map_t* cmap = 0;
+// These are published only after they have been completely filled in, so
+// that dxcc_lookup() may run while dxcc_open() is still busy in a startup job
+static dxcc_map_t* volatile cmap = 0;
 static dxcc_list_t* clist = 0;
 static vector<string>* cnames = 0;
 
-static void add_prefix(string& prefix, dxcc* entry);
+static void add_prefix(dxcc_map_t* m, string& prefix, dxcc* entry);
+
+// Binary snapshot of a parsed cty.dat.  The header is followed by the
+// country records (in file order), the prefix records and the string pool.
+#define CTY_SNAPSHOT_MAGIC "FLCTY\001\0\0"
+
+struct cty_snapshot_header {
+	char magic[8];
+	snapshot_stamp stamp;
+	uint32_t ncountries;
+	uint32_t nprefixes;
+	uint32_t strsize;
+	uint32_t pad;
+};
+
+struct cty_snapshot_record {
+	uint32_t name;    // offset of the prefix or country name in the pool
+	uint32_t country; // country index; ~0 for the country records themselves
+	int32_t cq_zone;
+	int32_t itu_zone;
+	float latitude;
+	float longitude;
+	float gmt_offset;
+	char continent[3];
+	uint8_t shared;   // the prefix maps to the unmodified country record
+};
+
+static void cty_record_set(cty_snapshot_record& r, const dxcc* e)
+{
+	r.cq_zone = e->cq_zone;
+	r.itu_zone = e->itu_zone;
+	r.latitude = e->latitude;
+	r.longitude = e->longitude;
+	r.gmt_offset = e->gmt_offset;
+	memcpy(r.continent, e->continent, sizeof(r.continent));
+}
+
+static void cty_record_get(const cty_snapshot_record& r, dxcc* e)
+{
+	e->cq_zone = r.cq_zone;
+	e->itu_zone = r.itu_zone;
+	e->latitude = r.latitude;
+	e->longitude = r.longitude;
+	e->gmt_offset = r.gmt_offset;
+	memcpy(e->continent, r.continent, sizeof(e->continent));
+	e->continent[2] = '\0';
+}
+
+static bool dxcc_snapshot_read(const char* filename, const snapshot_stamp& stamp,
+			       dxcc_map_t* m, dxcc_list_t* l, vector<string>* n)
+{
+	mapped_file f;
+	if (!f.open(snapshot_path(filename).c_str()) || f.size() < sizeof(cty_snapshot_header))
+		return false;
+
+	const cty_snapshot_header* h = reinterpret_cast<const cty_snapshot_header*>(f.data());
+	if (memcmp(h->magic, CTY_SNAPSHOT_MAGIC, sizeof(h->magic)) ||
+	    h->stamp.size != stamp.size || h->stamp.mtime != stamp.mtime ||
+	    f.size() != sizeof(*h) + (h->ncountries + h->nprefixes) * sizeof(cty_snapshot_record) + h->strsize)
+		return false;
+
+	const cty_snapshot_record* r = reinterpret_cast<const cty_snapshot_record*>(h + 1);
+	const char* pool = reinterpret_cast<const char*>(r + h->ncountries + h->nprefixes);
+	if (h->strsize == 0 || pool[h->strsize - 1] != '\0')
+		return false;
+
+	n->reserve(h->ncountries); // must not reallocate: entries point into it
+	l->reserve(h->ncountries);
+	for (uint32_t i = 0; i < h->ncountries; i++, r++) {
+		if (r->name >= h->strsize)
+			return false;
+		n->push_back(pool + r->name);
+		dxcc* e = new dxcc(n->back().c_str());
+		cty_record_get(*r, e);
+		l->push_back(e);
+	}
+	m->rehash(h->nprefixes);
+	for (uint32_t i = 0; i < h->nprefixes; i++, r++) {
+		if (r->name >= h->strsize || r->country >= h->ncountries)
+			return false;
+		dxcc* e = (*l)[r->country];
+		if (!r->shared) {
+			e = new dxcc(*e);
+			cty_record_get(*r, e);
+		}
+		(*m)[pool + r->name] = e;
+	}
+
+	return true;
+}
+
+static void dxcc_snapshot_write(const char* filename, const snapshot_stamp& stamp,
+				const dxcc_map_t* m, const dxcc_list_t* l)
+{
+	map<const char*, uint32_t> index;
+	for (size_t i = 0; i < l->size(); i++)
+		index[(*l)[i]->country] = i;
+
+	string pool;
+	vector<cty_snapshot_record> recs;
+	recs.reserve(l->size() + m->size());
+
+	cty_snapshot_record r;
+	memset(&r, 0, sizeof(r));
+	for (size_t i = 0; i < l->size(); i++) {
+		r.name = pool.size();
+		r.country = ~0U;
+		pool.append((*l)[i]->country).append(1, '\0');
+		cty_record_set(r, (*l)[i]);
+		recs.push_back(r);
+	}
+	for (dxcc_map_t::const_iterator i = m->begin(); i != m->end(); ++i) {
+		map<const char*, uint32_t>::const_iterator c = index.find(i->second->country);
+		if (c == index.end())
+			return;
+		r.name = pool.size();
+		r.country = c->second;
+		r.shared = i->second == (*l)[c->second];
+		pool.append(i->first).append(1, '\0');
+		cty_record_set(r, i->second);
+		recs.push_back(r);
+	}
+
+	cty_snapshot_header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, CTY_SNAPSHOT_MAGIC, sizeof(h.magic));
+	h.stamp = stamp;
+	h.ncountries = l->size();
+	h.nprefixes = m->size();
+	h.strsize = pool.size();
+
+	string buf;
+	buf.reserve(sizeof(h) + recs.size() * sizeof(r) + pool.size());
+	buf.append(reinterpret_cast<const char*>(&h), sizeof(h));
+	buf.append(reinterpret_cast<const char*>(&recs[0]), recs.size() * sizeof(r));
+	buf.append(pool);
+	snapshot_write(snapshot_path(filename), buf.data(), buf.size());
+}
 
 bool dxcc_open(const char* filename)
 {
 	if (cmap)
 		return true;
 
+	snapshot_stamp stamp;
+	if (!snapshot_stamp_get(filename, stamp)) {
+		LOG_VERBOSE("Could not read contest country file \"%s\"", filename);
+		return false;
+	}
+
+	dxcc_map_t* m = new dxcc_map_t;
+	vector<string>* n = new vector<string>;
+	dxcc_list_t* l = new dxcc_list_t;
+
+	if (dxcc_snapshot_read(filename, stamp, m, l, n)) {
+		LOG_VERBOSE("Loaded %" PRIuSZ " prefixes for %" PRIuSZ " countries from snapshot",
+			    m->size(), l->size());
+		cnames = n;
+		clist = l;
+		write_memory_barrier();
+		cmap = m;
+		return true;
+	}
+	// discard a partially read snapshot
+	for (dxcc_map_t::iterator i = m->begin(); i != m->end(); ++i)
+		if (find(l->begin(), l->end(), i->second) == l->end())
+			delete i->second;
+	for (dxcc_list_t::iterator i = l->begin(); i != l->end(); ++i)
+		delete *i;
+	m->clear();
+	l->clear();
+	n->clear();
+
 	ifstream in(filename);
 	if (!in) {
 		LOG_VERBOSE("Could not read contest country file \"%s\"", filename);
+		delete m;
+		delete n;
+		delete l;
 		return false;
 	}
 
-	cmap = new dxcc_map_t;
-	cnames = new vector<string>;
-	cnames->reserve(345); // approximate number of dxcc entities
-	clist = new dxcc_list_t;
-	clist->reserve(345);
+	n->reserve(345); // approximate number of dxcc entities
+	l->reserve(345);
 
 	dxcc* entry;
 	string record;
@@ -99,10 +273,10 @@ bool dxcc_open(const char* filename)
 		nrec++;
 
 		// read country name
-		cnames->resize(cnames->size() + 1);
-		clist->push_back(entry);
-		getline(is, cnames->back(), ':');
-		entry->country = cnames->back().c_str();
+		n->resize(n->size() + 1);
+		l->push_back(entry);
+		getline(is, n->back(), ':');
+		entry->country = n->back().c_str();
 		// cq zone
 		(is >> entry->cq_zone).ignore();
 		// itu zone
@@ -124,7 +298,7 @@ bool dxcc_open(const char* filename)
 			is >> ws;
 
 			while (getline(is, prefix, ',')) {
-				add_prefix(prefix, entry);
+				add_prefix(m, prefix, entry);
 				if ((c = is.peek()) == '\r' || c == '\n')
 					break;
 			}
@@ -133,7 +307,13 @@ bool dxcc_open(const char* filename)
 		in >> ws; // cr/lf after ';'
 	}
 
-	LOG_VERBOSE("Loaded %" PRIuSZ " prefixes for %u countries", cmap->size(), nrec);
+	LOG_VERBOSE("Loaded %" PRIuSZ " prefixes for %u countries", m->size(), nrec);
+	dxcc_snapshot_write(filename, stamp, m, l);
+
+	cnames = n;
+	clist = l;
+	write_memory_barrier();
+	cmap = m;
 	return true;
 }
 
@@ -146,14 +326,15 @@ void dxcc_close(void)
 {
 	if (!cmap)
 		return;
+	dxcc_map_t* m = cmap;
+	cmap = 0;
 	delete cnames;
 	cnames = 0;
 	map<dxcc*, bool> rm;
-	for (dxcc_map_t::iterator i = cmap->begin(); i != cmap->end(); ++i)
+	for (dxcc_map_t::iterator i = m->begin(); i != m->end(); ++i)
 		if (rm.insert(make_pair(i->second, true)).second)
 			delete i->second;
-	delete cmap;
-	cmap = 0;
+	delete m;
 	delete clist;
 	clist = 0;
 }
@@ -165,8 +346,10 @@ const vector<dxcc*>* dxcc_entity_list(void)
 
 const dxcc* dxcc_lookup(const char* callsign)
 {
+	const dxcc_map_t* cmap = ::cmap;
 	if (!cmap || !callsign || !*callsign)
 		return NULL;
+	read_memory_barrier();
 
 	string sstr;
 	sstr.resize(strlen(callsign) + 1);
@@ -199,7 +382,7 @@ const dxcc* dxcc_lookup(const char* callsign)
 	return NULL;
 }
 
-static void add_prefix(string& prefix, dxcc* entry)
+static void add_prefix(dxcc_map_t* cmap, string& prefix, dxcc* entry)
 {
 	string::size_type i = prefix.find_first_of("([<{");
 	if (likely(i == string::npos)) {
@@ -255,33 +438,166 @@ static void add_prefix(string& prefix, dxcc* entry)
 	(*cmap)[prefix] = entry;
 }
 
-typedef unordered_map<string, unsigned char> qsl_map_t;
-static qsl_map_t* qsl_calls;
-static unsigned char qsl_open_;
+// A sorted callsign list from one QSL service.  The snapshot file is mapped
+// and searched in place, so nothing is copied on the next start.
+#define QSL_SNAPSHOT_MAGIC "FLQSL\001\0\0"
+
+struct qsl_snapshot_header {
+	char magic[8];
+	snapshot_stamp stamp;
+	uint32_t ncalls;
+	uint32_t strsize;
+};
+
+struct qsl_table_t {
+	qsl_t type;
+	mapped_file file;
+	string heap;      // used instead of file if the snapshot could not be written
+	const uint32_t* index;
+	const char* pool;
+	uint32_t ncalls;
+};
+
+enum { QSL_MAX_TABLES = 4 };
+// guarded by qsl_mutex, which qsl_lookup() holds while it searches a table
+static qsl_table_t* qsl_tables[QSL_MAX_TABLES];
+static pthread_mutex_t qsl_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile unsigned char qsl_open_;
 const char* qsl_names[] = { "LoTW", "eQSL" };
 
-bool qsl_open(const char* filename, qsl_t qsl_type)
+static bool qsl_table_set(qsl_table_t* t, const char* data, size_t len, const snapshot_stamp& stamp)
+{
+	const qsl_snapshot_header* h = reinterpret_cast<const qsl_snapshot_header*>(data);
+	if (len < sizeof(*h) || memcmp(h->magic, QSL_SNAPSHOT_MAGIC, sizeof(h->magic)) ||
+	    h->stamp.size != stamp.size || h->stamp.mtime != stamp.mtime ||
+	    len != sizeof(*h) + h->ncalls * sizeof(uint32_t) + h->strsize ||
+	    (h->strsize && data[len - 1] != '\0'))
+		return false;
+
+	t->ncalls = h->ncalls;
+	t->index = reinterpret_cast<const uint32_t*>(h + 1);
+	t->pool = reinterpret_cast<const char*>(t->index + t->ncalls);
+	for (uint32_t i = 0; i < t->ncalls; i++)
+		if (t->index[i] >= h->strsize)
+			return false;
+	return true;
+}
+
+struct qsl_call_less {
+	const string* pool;
+	qsl_call_less(const string* p) : pool(p) { }
+	bool operator()(uint32_t a, uint32_t b) const
+	{
+		return strcmp(pool->c_str() + a, pool->c_str() + b) < 0;
+	}
+};
+
+struct qsl_call_equal {
+	const string* pool;
+	qsl_call_equal(const string* p) : pool(p) { }
+	bool operator()(uint32_t a, uint32_t b) const
+	{
+		return strcmp(pool->c_str() + a, pool->c_str() + b) == 0;
+	}
+};
+
+static bool qsl_table_build(qsl_table_t* t, const char* filename, const snapshot_stamp& stamp)
 {
 	ifstream in(filename);
 	if (!in)
 		return false;
-	if (!qsl_calls)
-		qsl_calls = new qsl_map_t;
 
-	size_t n = qsl_calls->size();
+	string pool;
+	vector<uint32_t> index;
 	string::size_type p;
 	string s;
 	s.reserve(32);
 	while (getline(in, s)) {
 		if ((p = s.rfind('\r')) != string::npos)
 			s.erase(p);
-		(*qsl_calls)[s] |= (1 << qsl_type);
+		if (s.empty())
+			continue;
+		index.push_back(pool.size());
+		pool.append(s).append(1, '\0');
+	}
+	sort(index.begin(), index.end(), qsl_call_less(&pool));
+	index.erase(unique(index.begin(), index.end(), qsl_call_equal(&pool)), index.end());
+
+	qsl_snapshot_header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, QSL_SNAPSHOT_MAGIC, sizeof(h.magic));
+	h.stamp = stamp;
+	h.ncalls = index.size();
+	h.strsize = pool.size();
+
+	t->heap.reserve(sizeof(h) + index.size() * sizeof(uint32_t) + pool.size());
+	t->heap.append(reinterpret_cast<const char*>(&h), sizeof(h));
+	if (!index.empty())
+		t->heap.append(reinterpret_cast<const char*>(&index[0]), index.size() * sizeof(uint32_t));
+	t->heap.append(pool);
+
+	string snapshot = snapshot_path(filename);
+	if (snapshot_write(snapshot, t->heap.data(), t->heap.size()) &&
+	    t->file.open(snapshot.c_str()) &&
+	    qsl_table_set(t, t->file.data(), t->file.size(), stamp)) {
+		string().swap(t->heap);
+		return true;
 	}
+	t->file.close();
+	return qsl_table_set(t, t->heap.data(), t->heap.size(), stamp);
+}
 
-	LOG_VERBOSE("Added %" PRIuSZ " %s callsigns from \"%s\"",
-		    qsl_calls->size() - n, qsl_names[qsl_type], filename);
+static bool qsl_table_find(const qsl_table_t* t, const char* callsign)
+{
+	uint32_t lo = 0, hi = t->ncalls;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		int c = strcmp(t->pool + t->index[mid], callsign);
+		if (c == 0)
+			return true;
+		if (c < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return false;
+}
+
+bool qsl_open(const char* filename, qsl_t qsl_type)
+{
+	snapshot_stamp stamp;
+	if (!snapshot_stamp_get(filename, stamp))
+		return false;
+
+	qsl_table_t* t = new qsl_table_t;
+	t->type = qsl_type;
+	bool cached = t->file.open(snapshot_path(filename).c_str()) &&
+		      qsl_table_set(t, t->file.data(), t->file.size(), stamp);
+	if (!cached) {
+		t->file.close();
+		if (!qsl_table_build(t, filename, stamp)) {
+			delete t;
+			return false;
+		}
+	}
+
+	{
+		guard_lock lock(&qsl_mutex);
+		size_t i;
+		for (i = 0; i < QSL_MAX_TABLES && qsl_tables[i]; i++)
+			;
+		if (i == QSL_MAX_TABLES) {
+			LOG_ERROR("Too many QSL lists, ignoring \"%s\"", filename);
+			delete t;
+			return false;
+		}
+		qsl_tables[i] = t;
+		qsl_open_ |= (1 << qsl_type);
+	}
+
+	LOG_VERBOSE("Added %" PRIu32 " %s callsigns from \"%s\"%s",
+		    t->ncalls, qsl_names[qsl_type], filename, cached ? " (snapshot)" : "");
 
-	qsl_open_ |= (1 << qsl_type);
 	return true;
 }
 
@@ -292,32 +608,49 @@ unsigned char qsl_is_open(void)
 
 void qsl_close(void)
 {
-	delete qsl_calls;
-	qsl_calls = 0;
+	guard_lock lock(&qsl_mutex);
 	qsl_open_ = 0;
+	for (size_t i = 0; i < QSL_MAX_TABLES; i++) {
+		qsl_table_t* t = qsl_tables[i];
+		qsl_tables[i] = 0;
+		delete t;
+	}
 }
 
 unsigned char qsl_lookup(const char* callsign)
 {
-	if (qsl_calls == 0)
+	if (!qsl_open_)
 		return 0;
 
 	string str;
 	str.resize(strlen(callsign));
 	transform(callsign, callsign + str.length(), str.begin(), static_cast<int (*)(int)>(toupper));
 
-	qsl_map_t::const_iterator i = qsl_calls->find(str);
-	return i == qsl_calls->end() ? 0 : i->second;
+	unsigned char r = 0;
+	guard_lock lock(&qsl_mutex);
+	for (size_t i = 0; i < QSL_MAX_TABLES; i++) {
+		const qsl_table_t* t = qsl_tables[i];
+		if (!t)
+			break;
+		if (qsl_table_find(t, str.c_str()))
+			r |= (1 << t->type);
+	}
+	return r;
 }
 
 void reload_cty_dat()
 {
+	startup_wait();
 	dxcc_close();
 	dxcc_open(string(progdefaults.cty_dat_pathname).append("cty.dat").c_str());
 	qsl_close();
 	qsl_open(string(progdefaults.cty_dat_pathname).append("lotw1.txt").c_str(), QSL_LOTW);
 	if (!qsl_open(string(progdefaults.cty_dat_pathname).append("eqsl.txt").c_str(), QSL_EQSL))
 		qsl_open(string(progdefaults.cty_dat_pathname).append("AGMemberList.txt").c_str(), QSL_EQSL);
+
+	update_countries_menu();
+	notify_dxcc_update();
+	qsodb_dxcc_update();
 }
 
 void default_cty_dat_pathname()
@@ -0,0 +1,373 @@
+// ----------------------------------------------------------------------------
+// image_sink.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#ifdef __MINGW32__
+#  include "compat.h"
+#endif
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <vector>
+
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <zlib.h>
+#include <png.h>
+
+#include "image_sink.h"
+#include "fl_digi.h"
+#include "trx.h"
+#include "qrunner.h"
+#include "debug.h"
+
+using namespace std;
+
+static FILE* open_file(const char* name, const char* suffix)
+{
+	FILE* fp;
+
+	size_t flen = strlen(name);
+	if (name[flen - 1] == '/') {
+		// if the name ends in a slash we will generate
+		// a timestamped name in the following  format:
+		const char t[] = "pic_YYYY-MM-DD_HHMMSSz";
+
+		size_t newlen = flen + sizeof(t);
+		if (suffix)
+			newlen += 5;
+		char* newfn = new char[newlen];
+		memcpy(newfn, name, flen);
+
+		time_t time_sec = time(0);
+		struct tm ztime;
+		(void)gmtime_r(&time_sec, &ztime);
+
+		size_t sz;
+		if ((sz = strftime(newfn + flen, newlen - flen, "pic_%Y-%m-%d_%H%M%Sz", &ztime)) > 0) {
+			strncpy(newfn + flen + sz, suffix, newlen - flen - sz);
+			newfn[newlen - 1] = '\0';
+			mkdir(name, 0777);
+			fp = fopen(newfn, "wb");
+		}
+		else
+			fp = NULL;
+		delete [] newfn;
+	}
+	else
+		fp = fopen(name, "wb");
+
+	return fp;
+}
+
+png_stream::png_stream()
+	: png(0), info(0), fp(0)
+{
+}
+
+png_stream::~png_stream()
+{
+	close();
+}
+
+bool png_stream::open(const char* filename, int width, int height, int color_type,
+		      int bit_depth, const char* extra_comments)
+{
+	close();
+
+	if ((fp = open_file(filename, ".png")) == NULL)
+		return false;
+
+	// set up the png structures
+	png_structp p;
+	png_infop i;
+	if ((p = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL)) == NULL) {
+		fclose(fp);
+		fp = 0;
+		return false;
+	}
+	/* png_set_compression_level() shall set the compression level to "level".
+	 * The valid values for "level" range from [0,9], corresponding directly
+	 * to compression levels for zlib. The value 0 implies no compression
+	 * and 9 implies maximal compression. Note: Tests have shown that zlib
+	 * compression levels 3-6 usually perform as well as level 9 for PNG images,
+	 * and do considerably fewer calculations. */
+	png_set_compression_level(p, Z_BEST_COMPRESSION);
+
+	if ((i = png_create_info_struct(p)) == NULL) {
+		png_destroy_write_struct(&p, NULL);
+		fclose(fp);
+		fp = 0;
+		return false;
+	}
+	png = p;
+	info = i;
+	if (setjmp(png_jmpbuf(p))) {
+		close();
+		return false;
+	}
+
+	// use an stdio stream
+	png_init_io(p, fp);
+
+	// set png header
+	png_set_IHDR(p, i, width, height, bit_depth,
+		     color_type, PNG_INTERLACE_NONE,
+		     PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+
+	// write text comments
+	struct tm tm;
+	time_t t = time(NULL);
+	gmtime_r(&t, &tm);
+	char z[20 + 1];
+	strftime(z, sizeof(z), "%Y-%m-%dT%H:%M:%SZ", &tm);
+	z[sizeof(z) - 1] = '\0';
+
+	ostringstream comment;
+	comment << "Program: " PACKAGE_STRING << '\n'
+		<< "Received: " << z << '\n'
+		<< "Modem: " << mode_info[active_modem->get_mode()].name << '\n'
+		<< "Frequency: " << inpFreq->value() << '\n';
+	if( extra_comments ) {
+		comment << extra_comments ;
+	}
+	if (inpCall->size())
+		comment << "Log call: " << inpCall->value() << '\n';
+
+	// set text
+	png_text text;
+	text.key = strdup("Comment");
+	text.text = strdup(comment.str().c_str());
+	text.compression = PNG_TEXT_COMPRESSION_NONE;
+	png_set_text(p, i, &text, 1);
+
+	// write header
+	png_write_info(p, i);
+
+	free(text.key);
+	free(text.text);
+
+	return true;
+}
+
+bool png_stream::write_row(const unsigned char* row)
+{
+	if (!png)
+		return false;
+
+	png_structp p = static_cast<png_structp>(png);
+	if (setjmp(png_jmpbuf(p))) {
+		close();
+		return false;
+	}
+	png_bytep r = const_cast<png_bytep>(row);
+	png_write_rows(p, &r, 1);
+	return true;
+}
+
+bool png_stream::close(void)
+{
+	if (!fp)
+		return true;
+
+	bool ok = true;
+	png_structp p = static_cast<png_structp>(png);
+	png_infop i = static_cast<png_infop>(info);
+	if (p) {
+		png = info = 0;
+		if (setjmp(png_jmpbuf(p)))
+			ok = false;
+		else
+			png_write_end(p, i);
+		png_destroy_write_struct(&p, &i);
+	}
+	ok = (fclose(fp) == 0) && ok;
+	fp = 0;
+
+	return ok;
+}
+
+// ----------------------------------------------------------------------------
+
+image_sink::image_sink(publish_t publish_, int batch_, bool keep_)
+	: publish(publish_), batch(batch_ < 1 ? 1 : batch_), keep(keep_),
+	  width_(0), depth_(1), stride(1), gen(0),
+	  committed_(0), notified(0), published(0),
+	  first_row(0), cur_row(-1), cur_data(0)
+{
+	pthread_mutex_init(&mutex, NULL);
+}
+
+image_sink::~image_sink()
+{
+	release();
+	pthread_mutex_destroy(&mutex);
+}
+
+void image_sink::release(void)
+{
+	for (deque<unsigned char*>::iterator i = rows.begin(); i != rows.end(); ++i)
+		delete [] *i;
+	rows.clear();
+}
+
+// Starts a new image.  Requests that were posted for the previous one are
+// recognised by their generation number and ignored.
+void image_sink::reset(int width, int depth)
+{
+	guard_lock lock(&mutex);
+
+	release();
+	width_ = width;
+	depth_ = depth;
+	stride = width * depth;
+	if (stride < 1)
+		stride = 1;
+	gen++;
+	committed_ = notified = published = 0;
+	first_row = 0;
+	cur_row = -1;
+	cur_data = 0;
+}
+
+// The image starts at pos: the bytes before it are never published
+void image_sink::skip(int pos)
+{
+	guard_lock lock(&mutex);
+
+	if (pos < committed_)
+		return;
+	committed_ = notified = published = pos;
+}
+
+// Returns the storage of row r, which must not have been published
+unsigned char* image_sink::row(int r)
+{
+	guard_lock lock(&mutex);
+
+	if (r < first_row)
+		r = first_row;
+	while (first_row + static_cast<int>(rows.size()) <= r) {
+		unsigned char* p = new unsigned char[stride];
+		memset(p, 0, stride);
+		rows.push_back(p);
+	}
+	return rows[r - first_row];
+}
+
+const unsigned char* image_sink::at(int pos) const
+{
+	int r = pos / stride - first_row;
+	if (r < 0 || r >= static_cast<int>(rows.size()))
+		return 0;
+	return rows[r] + pos % stride;
+}
+
+// The decoder will not change the bytes before pos anymore
+void image_sink::commit(int pos)
+{
+	if (pos <= committed_)
+		return;
+	committed_ = pos;
+	if (pos / stride - notified / stride >= batch)
+		notify(pos);
+}
+
+// Publishes what has been committed, including an incomplete row
+void image_sink::flush(void)
+{
+	if (committed_ > notified)
+		notify(committed_);
+}
+
+// True when everything that was committed has reached the GUI thread
+bool image_sink::idle(void)
+{
+	guard_lock lock(&mutex);
+	return published == committed_;
+}
+
+void image_sink::notify(int pos)
+{
+	notified = pos;
+	REQ(&image_sink::deliver, this, gen, pos);
+}
+
+// Called from the GUI thread.  A request may have been dropped by a full
+// queue: it is then covered by the next one, which publishes everything up
+// to its own position.
+void image_sink::deliver(unsigned g, int to)
+{
+	guard_lock lock(&mutex);
+
+	if (g != gen || to <= published)
+		return;
+
+	publish(*this, published, to);
+	published = to;
+
+	if (keep)
+		return;
+	while (!rows.empty() && (first_row + 1) * stride <= published) {
+		delete [] rows.front();
+		rows.pop_front();
+		first_row++;
+	}
+}
+
+// Streams the committed rows to a PNG file.  This reads the decoder's buffer
+// and must therefore be called from the decoder thread.
+int image_sink::save_png(const char* filename, bool monochrome, const char* extra_comments)
+{
+	int height = (committed_ + stride - 1) / stride;
+	if (!keep || height == 0)
+		return -1;
+
+	bool gray = monochrome || depth_ == 1;
+	png_stream out;
+	if (!out.open(filename, width_, height, gray ? PNG_COLOR_TYPE_GRAY : PNG_COLOR_TYPE_RGB,
+		      8, extra_comments))
+		return -1;
+
+	vector<unsigned char> tmp_row(width_);
+	for (int r = 0; r < height; r++) {
+		const unsigned char* p = row(r);
+		if (gray && depth_ > 1) {
+			for (int j = 0; j < width_; j++) {
+				int sum = 0;
+				for (int k = 0; k < depth_; k++)
+					sum += p[j * depth_ + k];
+				tmp_row[j] = sum / depth_;
+			}
+			p = &tmp_row[0];
+		}
+		if (!out.write_row(p))
+			return -1;
+	}
+
+	return out.close() ? 0 : -1;
+}
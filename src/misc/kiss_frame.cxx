@@ -0,0 +1,526 @@
+// ----------------------------------------------------------------------------
+// kiss_frame.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <pthread.h>
+
+#include "kiss_frame.h"
+#include "threads.h"
+
+/**********************************************************************************
+ * Frame buffer pool.  The buffers are allocated in one block on first use.
+ **********************************************************************************/
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static KISS_QUEUE_FRAME pool[KISS_POOL_FRAMES];
+static char *pool_buffers = 0;
+static KISS_QUEUE_FRAME *free_frames = 0;
+
+static inline bool pooled(KISS_QUEUE_FRAME *frame)
+{
+	return frame >= pool && frame < pool + KISS_POOL_FRAMES;
+}
+
+KISS_QUEUE_FRAME *kiss_frame_alloc(size_t capacity)
+{
+	KISS_QUEUE_FRAME *frame = 0;
+
+	if(capacity <= KISS_POOL_FRAME_SIZE) {
+		guard_lock pool_lock(&pool_mutex);
+		if(!pool_buffers) {
+			pool_buffers = new char[KISS_POOL_FRAMES * KISS_POOL_FRAME_SIZE];
+			for(int i = KISS_POOL_FRAMES - 1; i >= 0; i--) {
+				pool[i].buffer = pool_buffers + i * KISS_POOL_FRAME_SIZE;
+				pool[i].capacity = KISS_POOL_FRAME_SIZE;
+				pool[i].next = free_frames;
+				free_frames = &pool[i];
+			}
+		}
+		if((frame = free_frames))
+			free_frames = frame->next;
+	}
+
+	// large frames, or the pool is empty
+	if(!frame) {
+		frame = new KISS_QUEUE_FRAME;
+		frame->buffer = new char[capacity];
+		frame->capacity = capacity;
+	}
+
+	frame->data = frame->buffer;
+	frame->size = 0;
+	frame->next = 0;
+
+	return frame;
+}
+
+void kiss_frame_release(KISS_QUEUE_FRAME *frame)
+{
+	if(!frame) return;
+
+	if(pooled(frame)) {
+		guard_lock pool_lock(&pool_mutex);
+		frame->next = free_frames;
+		free_frames = frame;
+		return;
+	}
+
+	delete [] frame->buffer;
+	delete frame;
+}
+
+/**********************************************************************************
+ * CRC tables
+ **********************************************************************************/
+static const int ccitt_table[256] = {
+	0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241,
+	0xc601, 0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440,
+	0xcc01, 0xcc0,  0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40,
+	0x0a00, 0xcac1, 0xcb81, 0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841,
+	0xd801, 0x18c0, 0x1980, 0xd941, 0x1b00, 0xdbc1, 0xda81, 0x1a40,
+	0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01, 0x1dc0, 0x1c80, 0xdc41,
+	0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0, 0x1680, 0xd641,
+	0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081, 0x1040,
+	0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
+	0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441,
+	0x3c00, 0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41,
+	0xfa01, 0x3ac0, 0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840,
+	0x2800, 0xe8c1, 0xe981, 0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41,
+	0xee01, 0x2ec0, 0x2f80, 0xef41, 0x2d00, 0xedc1, 0xec81, 0x2c40,
+	0xe401, 0x24c0, 0x2580, 0xe541, 0x2700, 0xe7c1, 0xe681, 0x2640,
+	0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0, 0x2080, 0xe041,
+	0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281, 0x6240,
+	0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
+	0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41,
+	0xaa01, 0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840,
+	0x7800, 0xb8c1, 0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41,
+	0xbe01, 0x7ec0, 0x7f80, 0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40,
+	0xb401, 0x74c0, 0x7580, 0xb541, 0x7700, 0xb7c1, 0xb681, 0x7640,
+	0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101, 0x71c0, 0x7080, 0xb041,
+	0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0, 0x5280, 0x9241,
+	0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481, 0x5440,
+	0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
+	0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841,
+	0x8801, 0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40,
+	0x4e00, 0x8ec1, 0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41,
+	0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641,
+	0x8201, 0x42c0, 0x4380, 0x8341, 0x4100, 0x81c1, 0x8081, 0x4040
+};
+
+static const int fcs_table[256] = {
+	0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
+	0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
+	0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
+	0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
+	0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
+	0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
+	0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
+	0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
+	0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
+	0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
+	0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
+	0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
+	0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
+	0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
+	0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
+	0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
+	0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
+	0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
+	0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
+	0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
+	0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
+	0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
+	0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
+	0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
+	0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
+	0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
+	0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
+	0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
+	0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
+	0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
+	0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
+	0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78
+};
+
+// The CRC of each frame type: its update of one byte, initial value and size
+struct ccitt_crc {
+	enum { init = 0, bytes = 2 };
+	static inline int update(int crc, int c) {
+		return ((crc >> 8) & 0xff) ^ ccitt_table[(crc ^ c) & 0xff];
+	}
+};
+
+struct fcs_crc {
+	enum { init = 0xFFFF, bytes = 2 };
+	static inline int update(int crc, int c) {
+		return ((crc >> 8) & 0xff) ^ fcs_table[(crc ^ c) & 0xff];
+	}
+};
+
+struct xor_crc {
+	enum { init = 0, bytes = 1 };
+	static inline int update(int crc, int c) {
+		return crc ^ (c & 0xff);
+	}
+};
+
+struct no_crc {
+	enum { init = 0, bytes = 0 };
+	static inline int update(int crc, int) {
+		return crc;
+	}
+};
+
+/**********************************************************************************
+ * For SMACK CRC validation
+ **********************************************************************************/
+int calc_ccitt_crc(const char *buf, int n)
+{
+	int crc = ccitt_crc::init;
+	while (--n >= 0)
+		crc = ccitt_crc::update(crc, *buf++);
+	return crc;
+}
+
+/**********************************************************************************
+ * For SMACK CRC validation (BPQ XOR CRC implimentation).
+ **********************************************************************************/
+int calc_xor_crc(const char *buf, int n)
+{
+	int crc = xor_crc::init;
+	while (--n >= 0)
+		crc = xor_crc::update(crc, *buf++);
+	return crc;
+}
+
+/**********************************************************************************
+ * For FCS CRC.
+ **********************************************************************************/
+int calc_fcs_crc(const char *buf, int n)
+{
+	int crc = fcs_crc::init;
+	while (--n >= 0)
+		crc = fcs_crc::update(crc, *buf++);
+	return crc;
+}
+
+/**********************************************************************************
+ * Not all modems are created equal. Translate!
+ * There must be at least HDLC_CNT_OFFSET count offset (+/-, but still in range)
+ * between real values and translated values.
+ **********************************************************************************/
+static const int not_allowed[256] = {
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, //  16
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //  32
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //  48
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //  64
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //  80
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //  96
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 112
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, // 128
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 144
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 160
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 176
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 192
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 208
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 224
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 240
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1  // 256
+};
+
+/**********************************************************************************
+ * Escaping of one byte
+ **********************************************************************************/
+static inline char *kiss_put(char *p, int byte)
+{
+	switch(byte) {
+		case KISS_FESC:
+			*p++ = KISS_FESC;
+			*p++ = KISS_TFESC;
+			break;
+
+		case KISS_FEND:
+			*p++ = KISS_FESC;
+			*p++ = KISS_TFEND;
+			break;
+
+		default:
+			*p++ = byte;
+	}
+	return p;
+}
+
+static inline char *hdlc_put(char *p, int byte)
+{
+	if(not_allowed[byte]) {
+		*p++ = HDLC_CNT;
+		if((byte + HDLC_CNT_OFFSET) > 255)
+			*p++ = ((byte - HDLC_CNT_OFFSET) & 0xFF);
+		else
+			*p++ = ((byte + HDLC_CNT_OFFSET) & 0xFF);
+		return p;
+	}
+
+	switch(byte) {
+		case KISS_FESC:
+			*p++ = KISS_FESC;
+			*p++ = KISS_TFESC;
+			break;
+
+		case KISS_FEND:
+			*p++ = KISS_FESC;
+			*p++ = KISS_TFEND;
+			break;
+
+		case HDLC_CNT:
+			*p++ = KISS_FESC;
+			*p++ = HDLC_TCNT;
+			break;
+
+		default:
+			*p++ = byte;
+	}
+	return p;
+}
+
+/**********************************************************************************
+ * KISS frames.  The CRC covers the header byte and the data.
+ **********************************************************************************/
+template <class CRC>
+static size_t kiss_encode(int header, const char *src, size_t n, char *dst)
+{
+	char *p = dst;
+	int crc = CRC::init;
+
+	*p++ = KISS_FEND;
+
+	header &= 0xFF;
+	crc = CRC::update(crc, header);
+	p = kiss_put(p, header);
+
+	for(size_t index = 0; index < n; index++) {
+		int byte = src[index] & 0xFF;
+		crc = CRC::update(crc, byte);
+		p = kiss_put(p, byte);
+	}
+
+	if(CRC::bytes > 0)
+		p = kiss_put(p, CRC_LOW(crc));
+	if(CRC::bytes > 1)
+		p = kiss_put(p, CRC_HIGH(crc));
+
+	*p++ = KISS_FEND;
+
+	return p - dst;
+}
+
+size_t kiss_encode_frame(int header, const char *src, size_t n, int crc_type, char *dst)
+{
+	switch(crc_type) {
+		case CRC16_CCITT:
+			return kiss_encode<ccitt_crc>(header, src, n, dst);
+		case CRC16_FCS:
+			return kiss_encode<fcs_crc>(header, src, n, dst);
+		case CRC8_XOR:
+			return kiss_encode<xor_crc>(header, src, n, dst);
+		default:
+			return kiss_encode<no_crc>(header, src, n, dst);
+	}
+}
+
+int kiss_frame_header(const char *buf, size_t n)
+{
+	size_t index = 0;
+
+	while(index < n && (buf[index] & 0xFF) == KISS_FEND)
+		index++;
+	if(index == n)
+		return -1;
+	if((buf[index] & 0xFF) != KISS_FESC)
+		return buf[index] & 0xFF;
+
+	if(++index == n)
+		return -1;
+	switch(buf[index] & 0xFF) {
+		case KISS_TFEND:
+			return KISS_FEND;
+		case KISS_TFESC:
+			return KISS_FESC;
+		default:
+			return buf[index] & 0xFF;
+	}
+}
+
+// The CRC is computed over the decoded bytes CRC::bytes behind the last one,
+// so that it stops short of the CRC at the end of the frame.
+template <class CRC>
+static size_t kiss_decode(char *buf, size_t n)
+{
+	const size_t crc_bytes = CRC::bytes;
+	size_t count = 0;
+	int crc = CRC::init;
+	int last_byte = KISS_INVALID;
+
+	for(size_t index = 0; index < n; index++) {
+		int byte = buf[index] & 0xFF;
+		int c = byte;
+
+		if(byte == KISS_FEND)
+			continue;
+
+		if(byte == KISS_FESC) {
+			last_byte = byte;
+			continue;
+		}
+
+		if(last_byte == KISS_FESC) {
+			if(byte == KISS_TFEND)
+				c = KISS_FEND;
+			else if(byte == KISS_TFESC)
+				c = KISS_FESC;
+		}
+		last_byte = byte;
+
+		buf[count++] = c;
+		if(count > crc_bytes)
+			crc = CRC::update(crc, buf[count - 1 - crc_bytes]);
+	}
+
+	if(crc_bytes == 0)
+		return count;
+	if(count <= 2 * crc_bytes)
+		return 0;
+
+	count -= crc_bytes;
+	if(crc_bytes == 2) {
+		if(crc != CRC_LOW_HIGH(buf[count], buf[count + 1]))
+			return 0;
+	}
+	else if(CRC_LOW(crc) != CRC_LOW(buf[count]))
+		return 0;
+
+	return count;
+}
+
+size_t kiss_decode_frame(char *buf, size_t n, int crc_type)
+{
+	switch(crc_type) {
+		case CRC16_CCITT:
+			return kiss_decode<ccitt_crc>(buf, n);
+		case CRC16_FCS:
+			return kiss_decode<fcs_crc>(buf, n);
+		case CRC8_XOR:
+			return kiss_decode<xor_crc>(buf, n);
+		default:
+			return kiss_decode<no_crc>(buf, n);
+	}
+}
+
+/**********************************************************************************
+ * HDLC frames, with their FCS low byte first
+ **********************************************************************************/
+size_t hdlc_encode_frame(const char *src, size_t n, char *dst)
+{
+	char *p = dst;
+	int crc = fcs_crc::init;
+
+	*p++ = ' ';
+	*p++ = KISS_FEND;
+
+	for(size_t index = 0; index < n; index++) {
+		int byte = src[index] & 0xFF;
+		crc = fcs_crc::update(crc, byte);
+		p = hdlc_put(p, byte);
+	}
+
+	p = hdlc_put(p, CRC_LOW(crc));
+	p = hdlc_put(p, CRC_HIGH(crc));
+
+	*p++ = KISS_FEND;
+	*p++ = ' ';
+
+	return p - dst;
+}
+
+size_t hdlc_decode_frame(const char *src, size_t n, char *dst)
+{
+	size_t count = 0;
+	int last_byte = KISS_INVALID;
+	int check_byte = 0;
+	int crc = fcs_crc::init;
+
+	for(size_t index = 0; index < n; index++) {
+		int byte = src[index] & 0xFF;
+
+		if(last_byte == HDLC_CNT) {
+			last_byte = byte;
+
+			check_byte = byte - HDLC_CNT_OFFSET;
+			if((check_byte < 0) || !not_allowed[check_byte]) {
+				check_byte = byte + HDLC_CNT_OFFSET;
+				if((check_byte > 255) || !not_allowed[check_byte])
+					continue;
+			}
+			byte = check_byte;
+		}
+		else {
+			switch(byte) {
+				case KISS_FEND:
+					continue;
+
+				case KISS_FESC:
+				case HDLC_CNT:
+					last_byte = byte;
+					continue;
+
+				case KISS_TFEND:
+					if(last_byte == KISS_FESC)
+						byte = KISS_FEND;
+					break;
+
+				case KISS_TFESC:
+					if(last_byte == KISS_FESC)
+						byte = KISS_FESC;
+					break;
+
+				case HDLC_TCNT:
+					if(last_byte == KISS_FESC)
+						byte = HDLC_CNT;
+					break;
+			}
+			last_byte = KISS_INVALID;
+		}
+
+		dst[count++] = byte;
+		if(count > 2)
+			crc = fcs_crc::update(crc, dst[count - 3]);
+	}
+
+	if(count <= 2)
+		return 0;
+
+	count -= 2;
+	if(crc != CRC_LOW_HIGH(dst[count], dst[count + 1]))
+		return 0;
+
+	return count;
+}
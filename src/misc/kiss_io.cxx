@@ -168,30 +168,6 @@ extern void ax25_decode(unsigned char *buffer, size_t count, bool pad, bool tx_f
 
 static int kiss_raw_enabled = KISS_RAW_DISABLED;
 
-/**********************************************************************************
- * Not all modems are created equal. Translate!
- * There must be at least HDLC_CNT_OFFSET count offset (+/-, but still in range)
- * between real values and translated values.
- **********************************************************************************/
-static int not_allowed[256] = {
-	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, //  16
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //  32
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //  48
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //  64
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //  80
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, //  96
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 112
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, // 128
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 144
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 160
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 176
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 192
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 208
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 224
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 240
-	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1  // 256
-};
-
 /**********************************************************************************
  * KISS hardware frame commands strings and calling functions
  **********************************************************************************/
@@ -287,113 +263,6 @@ static string noctrl(string src)
 }
 #endif // USE_NOCTRL
 
-/**********************************************************************************
- * For SMACK CRC validation
- **********************************************************************************/
-static int  calc_ccitt_crc(char *buf, int n)
-{
-	static int  crc_table[] = {
-		0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241,
-		0xc601, 0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440,
-		0xcc01, 0xcc0,  0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40,
-		0x0a00, 0xcac1, 0xcb81, 0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841,
-		0xd801, 0x18c0, 0x1980, 0xd941, 0x1b00, 0xdbc1, 0xda81, 0x1a40,
-		0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01, 0x1dc0, 0x1c80, 0xdc41,
-		0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0, 0x1680, 0xd641,
-		0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081, 0x1040,
-		0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
-		0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441,
-		0x3c00, 0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41,
-		0xfa01, 0x3ac0, 0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840,
-		0x2800, 0xe8c1, 0xe981, 0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41,
-		0xee01, 0x2ec0, 0x2f80, 0xef41, 0x2d00, 0xedc1, 0xec81, 0x2c40,
-		0xe401, 0x24c0, 0x2580, 0xe541, 0x2700, 0xe7c1, 0xe681, 0x2640,
-		0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0, 0x2080, 0xe041,
-		0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281, 0x6240,
-		0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
-		0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41,
-		0xaa01, 0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840,
-		0x7800, 0xb8c1, 0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41,
-		0xbe01, 0x7ec0, 0x7f80, 0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40,
-		0xb401, 0x74c0, 0x7580, 0xb541, 0x7700, 0xb7c1, 0xb681, 0x7640,
-		0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101, 0x71c0, 0x7080, 0xb041,
-		0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0, 0x5280, 0x9241,
-		0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481, 0x5440,
-		0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
-		0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841,
-		0x8801, 0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40,
-		0x4e00, 0x8ec1, 0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41,
-		0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641,
-		0x8201, 0x42c0, 0x4380, 0x8341, 0x4100, 0x81c1, 0x8081, 0x4040
-	};
-
-	int crc;
-	crc = 0;
-	while (--n >= 0)
-		crc = ((crc >> 8) & 0xff) ^ crc_table[(crc ^ *buf++) & 0xff];
-	return crc;
-}
-
-/**********************************************************************************
- * For SMACK CRC validation (BPQ XOR CRC implimentation).
- **********************************************************************************/
-static int  calc_xor_crc(char *buf, int n)
-{
-	int crc;
-	crc = 0;
-	while (--n >= 0)
-		crc ^= (*buf++ & 0xff);
-	return crc;
-}
-
-/**********************************************************************************
- * For FCS CRC.
- **********************************************************************************/
-static int  calc_fcs_crc(char *buf, int n)
-{
-
-	static int fcstab[256] = {
-		0x0000, 0x1189, 0x2312, 0x329b, 0x4624, 0x57ad, 0x6536, 0x74bf,
-		0x8c48, 0x9dc1, 0xaf5a, 0xbed3, 0xca6c, 0xdbe5, 0xe97e, 0xf8f7,
-		0x1081, 0x0108, 0x3393, 0x221a, 0x56a5, 0x472c, 0x75b7, 0x643e,
-		0x9cc9, 0x8d40, 0xbfdb, 0xae52, 0xdaed, 0xcb64, 0xf9ff, 0xe876,
-		0x2102, 0x308b, 0x0210, 0x1399, 0x6726, 0x76af, 0x4434, 0x55bd,
-		0xad4a, 0xbcc3, 0x8e58, 0x9fd1, 0xeb6e, 0xfae7, 0xc87c, 0xd9f5,
-		0x3183, 0x200a, 0x1291, 0x0318, 0x77a7, 0x662e, 0x54b5, 0x453c,
-		0xbdcb, 0xac42, 0x9ed9, 0x8f50, 0xfbef, 0xea66, 0xd8fd, 0xc974,
-		0x4204, 0x538d, 0x6116, 0x709f, 0x0420, 0x15a9, 0x2732, 0x36bb,
-		0xce4c, 0xdfc5, 0xed5e, 0xfcd7, 0x8868, 0x99e1, 0xab7a, 0xbaf3,
-		0x5285, 0x430c, 0x7197, 0x601e, 0x14a1, 0x0528, 0x37b3, 0x263a,
-		0xdecd, 0xcf44, 0xfddf, 0xec56, 0x98e9, 0x8960, 0xbbfb, 0xaa72,
-		0x6306, 0x728f, 0x4014, 0x519d, 0x2522, 0x34ab, 0x0630, 0x17b9,
-		0xef4e, 0xfec7, 0xcc5c, 0xddd5, 0xa96a, 0xb8e3, 0x8a78, 0x9bf1,
-		0x7387, 0x620e, 0x5095, 0x411c, 0x35a3, 0x242a, 0x16b1, 0x0738,
-		0xffcf, 0xee46, 0xdcdd, 0xcd54, 0xb9eb, 0xa862, 0x9af9, 0x8b70,
-		0x8408, 0x9581, 0xa71a, 0xb693, 0xc22c, 0xd3a5, 0xe13e, 0xf0b7,
-		0x0840, 0x19c9, 0x2b52, 0x3adb, 0x4e64, 0x5fed, 0x6d76, 0x7cff,
-		0x9489, 0x8500, 0xb79b, 0xa612, 0xd2ad, 0xc324, 0xf1bf, 0xe036,
-		0x18c1, 0x0948, 0x3bd3, 0x2a5a, 0x5ee5, 0x4f6c, 0x7df7, 0x6c7e,
-		0xa50a, 0xb483, 0x8618, 0x9791, 0xe32e, 0xf2a7, 0xc03c, 0xd1b5,
-		0x2942, 0x38cb, 0x0a50, 0x1bd9, 0x6f66, 0x7eef, 0x4c74, 0x5dfd,
-		0xb58b, 0xa402, 0x9699, 0x8710, 0xf3af, 0xe226, 0xd0bd, 0xc134,
-		0x39c3, 0x284a, 0x1ad1, 0x0b58, 0x7fe7, 0x6e6e, 0x5cf5, 0x4d7c,
-		0xc60c, 0xd785, 0xe51e, 0xf497, 0x8028, 0x91a1, 0xa33a, 0xb2b3,
-		0x4a44, 0x5bcd, 0x6956, 0x78df, 0x0c60, 0x1de9, 0x2f72, 0x3efb,
-		0xd68d, 0xc704, 0xf59f, 0xe416, 0x90a9, 0x8120, 0xb3bb, 0xa232,
-		0x5ac5, 0x4b4c, 0x79d7, 0x685e, 0x1ce1, 0x0d68, 0x3ff3, 0x2e7a,
-		0xe70e, 0xf687, 0xc41c, 0xd595, 0xa12a, 0xb0a3, 0x8238, 0x93b1,
-		0x6b46, 0x7acf, 0x4854, 0x59dd, 0x2d62, 0x3ceb, 0x0e70, 0x1ff9,
-		0xf78f, 0xe606, 0xd49d, 0xc514, 0xb1ab, 0xa022, 0x92b9, 0x8330,
-		0x7bc7, 0x6a4e, 0x58d5, 0x495c, 0x3de3, 0x2c6a, 0x1ef1, 0x0f78
-	};
-
-	int crc;
-	crc = 0xFFFF;
-	while (--n >= 0)
-		crc = ((crc >> 8) & 0xff) ^ fcstab[(crc ^ *buf++) & 0xff];
-	return crc;
-}
-
 /**********************************************************************************
  *
  **********************************************************************************/
@@ -1746,8 +1615,7 @@ bool bcast_rsid_kiss_frame(int new_wf_pos, int new_mode, int old_wf_pos, int old
 
 	kiss_bc_frame.append((const char *) frame->data, (size_t) frame->size);
 
-	if(frame->data)	delete [] frame->data;
-	if(frame) delete frame;
+	kiss_frame_release(frame);
 
 	return true;
 }
@@ -1789,8 +1657,7 @@ void bcast_trxs_kiss_frame(int state)
 
 	kiss_bc_frame.append((const char *) frame->data, (size_t) frame->size);
 
-	if(frame->data)	delete [] frame->data;
-	if(frame) delete frame;
+	kiss_frame_release(frame);
 }
 
 /**********************************************************************************
@@ -1816,8 +1683,7 @@ void bcast_tx_buffer_empty_kiss_frame(void)
 
 	kiss_bc_frame.append((const char *) frame->data, (size_t) frame->size);
 
-	if(frame->data)	delete [] frame->data;
-	if(frame) delete frame;
+	kiss_frame_release(frame);
 }
 
 /**********************************************************************************
@@ -1868,464 +1734,85 @@ static bool kiss_queue_frame(KISS_QUEUE_FRAME * frame, std::string cmd)
 
 	if(frame->size == 0 || frame->data == (char *)0) {
 		LOG_DEBUG("Frame null content (%s)", cmd.c_str());
-		if(frame->data) delete[] frame->data;
-		delete frame;
+		kiss_frame_release(frame);
 		return false;
 	}
 
 	WriteToHostBuffered((const char *) frame->data, (size_t) frame->size);
 
-	delete[] frame->data;
-	delete frame;
+	kiss_frame_release(frame);
 
 	return true;
 }
 
 /**********************************************************************************
- *
- **********************************************************************************/
-size_t kiss_encode(char *src, size_t src_size, char **dst)
-{
-	if(!src || !dst || src_size < 1) return 0;
-
-	size_t index = 0;
-	int count = 0;
-	int buffer_size = 0;
-	int byte = 0;
-	char *buffer = (char *)0;
-
-	buffer_size = (src_size * KISS_BUFFER_FACTOR) + BUFFER_PADDING;
-	buffer = new char[buffer_size];
-
-	if(!buffer) {
-		LOG_DEBUG("Memory allocation error near line %d", __LINE__);
-		*dst = (char *)0;
-		return 0;
-	}
-
-	memset(buffer, 0, buffer_size);
-	count = 0;
-	buffer[count++] = KISS_FEND;
-
-	for(index = 0; index < src_size; index++) {
-		byte = (int) src[index] & 0xFF;
-		switch(byte) {
-			case KISS_FESC:
-				buffer[count++] = KISS_FESC;
-				buffer[count++] = KISS_TFESC;
-				break;
-
-			case KISS_FEND:
-				buffer[count++] = KISS_FESC;
-				buffer[count++] = KISS_TFEND;
-				break;
-
-			default:
-				buffer[count++] = byte;
-		}
-	}
-
-	buffer[count++] = KISS_FEND;
-	*dst = (char *) buffer;
-
-	return count;
-}
-
-/**********************************************************************************
- *
- **********************************************************************************/
-size_t kiss_decode(char *src, size_t src_size, char **dst)
-{
-	if(!src || !dst || src_size < 1) return 0;
-
-	size_t index = 0;
-	int count = 0;
-	int buffer_size = 0;
-	int byte = 0;
-	int last_byte = 0;
-	char *buffer = (char *)0;
-
-	buffer_size = src_size + BUFFER_PADDING;
-	buffer = new char[buffer_size];
-
-	if(!buffer) {
-		LOG_DEBUG("Memory allocation error near line %d", __LINE__);
-		*dst = (char *)0;
-		return 0;
-	}
-
-	memset(buffer, 0, buffer_size);
-	count = 0;
-	last_byte = KISS_INVALID;
-
-	for(index = 0; index < src_size; index++) {
-
-		byte = src[index] & 0xFF;
-
-		switch(byte) {
-			case KISS_FEND:
-				continue;
-
-			case KISS_FESC:
-				break;
-
-			case KISS_TFEND:
-				if(last_byte == KISS_FESC)
-					buffer[count++] = KISS_FEND;
-				else
-					buffer[count++] = byte;
-				break;
-
-			case KISS_TFESC:
-				if(last_byte == KISS_FESC)
-					buffer[count++] = KISS_FESC;
-				else
-					buffer[count++] = byte;
-				break;
-
-			default:
-				buffer[count++] = byte;
-		}
-
-		last_byte = byte;
-	}
-
-	*dst = (char *) buffer;
-	return count;
-}
-
-#if 0
-/**********************************************************************************
- *
- **********************************************************************************/
-std::string kiss_decode(std::string frame)
-{
-	int count = 0;
-	int frame_size = 0;
-	char *dst = (char *)0;
-
-	static std::string ret_str = "";
-
-	if(frame.empty()) return frame;
-
-	frame_size = frame.size();
-
-	ret_str.clear();
-	ret_str.reserve(frame_size + BUFFER_PADDING);
-
-	count = kiss_decode((char *) frame.c_str(), frame.size(), &dst);
-
-	if(count && dst) {
-		ret_str.assign(dst, count);
-		dst[0] = 0;
-		delete [] dst;
-	}
-
-	return ret_str;
-}
-#endif // 0
-
-/**********************************************************************************
- *
- **********************************************************************************/
-std::string kiss_encode(std::string frame)
-{
-	int count = 0;
-	int frame_size = 0;
-	char *dst = (char *)0;
-
-	static std::string ret_str = "";
-
-	if(frame.empty()) return frame;
-
-	frame_size = frame.size();
-
-	ret_str.clear();
-	ret_str.reserve((frame_size * 2) + BUFFER_PADDING);
-
-	count = kiss_encode((char *) frame.c_str(), frame.size(), &dst);
-
-	if(count && dst) {
-		ret_str.assign(dst, count);
-		dst[0] = 0;
-		delete [] dst;
-	}
-
-	return ret_str;
-}
-
-
-/**********************************************************************************
- *
- **********************************************************************************/
-size_t hdlc_encode(char *src, size_t src_size, char **dst)
-{
-	if(!src || !dst || src_size < 1) return 0;
-
-	size_t index = 0;
-	int count = 0;
-	int buffer_size = 0;
-	int byte = 0;
-	char *buffer = (char *)0;
-
-	buffer_size = (src_size * HDLC_BUFFER_FACTOR) + BUFFER_PADDING;
-	buffer = new char[buffer_size];
-
-	if(!buffer) {
-		LOG_DEBUG("Memory allocation error near line %d", __LINE__);
-		*dst = (char *)0;
-		return 0;
-	}
-
-	memset(buffer, 0, buffer_size);
-	count = 0;
-	buffer[count++] = ' ';
-	buffer[count++] = KISS_FEND;
-
-	for(index = 0; index < src_size; index++) {
-		byte = (int) src[index] & 0xFF;
-
-		if(not_allowed[byte]) {
-			buffer[count++] = HDLC_CNT;
-			if((byte + HDLC_CNT_OFFSET) > 255)
-				buffer[count++] = ((byte - HDLC_CNT_OFFSET) & 0xFF);
-			else
-				buffer[count++] = ((byte + HDLC_CNT_OFFSET) & 0xFF);
-			continue;
-		}
-
-		switch(byte) {
-			case KISS_FESC:
-				buffer[count++] = KISS_FESC;
-				buffer[count++] = KISS_TFESC;
-				break;
-
-			case KISS_FEND:
-				buffer[count++] = KISS_FESC;
-				buffer[count++] = KISS_TFEND;
-				break;
-
-			case HDLC_CNT:
-				buffer[count++] = KISS_FESC;
-				buffer[count++] = HDLC_TCNT;
-				break;
-
-			default:
-				buffer[count++] = byte;
-		}
-	}
-
-	buffer[count++] = KISS_FEND;
-	buffer[count++] = ' ';
-
-	*dst = (char *) buffer;
-
-	return count;
-}
-
-/**********************************************************************************
- *
- **********************************************************************************/
-size_t hdlc_decode(char *src, size_t src_size, char **dst)
-{
-	if(!src || !dst || src_size < 1) return 0;
-
-	size_t index = 0;
-	int count = 0;
-	int buffer_size = 0;
-	int byte = 0;
-	int last_byte = 0;
-	int check_byte = 0;
-	char *buffer = (char *)0;
-
-	buffer_size = src_size + BUFFER_PADDING;
-	buffer = new char[buffer_size];
-
-	if(!buffer) {
-		LOG_DEBUG("Memory allocation error near line %d", __LINE__);
-		*dst = (char *)0;
-		return 0;
-	}
-
-	memset(buffer, 0, buffer_size);
-	count = 0;
-	last_byte = KISS_INVALID;
-
-	for(index = 0; index < src_size; index++) {
-
-		byte = src[index] & 0xFF;
-
-		if(last_byte == HDLC_CNT) {
-			check_byte = byte - HDLC_CNT_OFFSET;
-			if((check_byte > -1) && (check_byte < 256) && not_allowed[check_byte]) {
-				buffer[count++] = check_byte;
-				last_byte = byte;
-				continue;
-			}
-
-			check_byte = byte + HDLC_CNT_OFFSET;
-			if((check_byte > -1) && (check_byte < 256) && not_allowed[check_byte]) {
-				buffer[count++] = check_byte;
-			}
-
-			last_byte = byte;
-			continue;
-		}
-
-		switch(byte) {
-			case KISS_FEND:
-				continue;
-
-			case KISS_FESC:
-			case HDLC_CNT:
-				last_byte = byte;
-				continue;
-
-			case KISS_TFEND:
-				if(last_byte == KISS_FESC)
-					byte = KISS_FEND;
-				break;
-
-			case KISS_TFESC:
-				if(last_byte == KISS_FESC)
-					byte = KISS_FESC;
-				break;
-
-			case HDLC_TCNT:
-				if(last_byte == KISS_FESC)
-					byte = HDLC_CNT;
-				break;
-		}
-
-		last_byte = buffer[count++] = byte;
-	}
-
-	*dst = (char *) buffer;
-	return count;
-
-}
-
-/**********************************************************************************
- *  Buffer must be at least twice the size of the data provided + BUFFER_PADDING
  *  data_count: Number of bytes in the buffer to be converted.
- *  Return is the converted byte count. Buffer is overwritten with converted data.
+ *  Returns a frame of the HDLC encoded data and its FCS, encoded in one pass.
+ *  The caller releases the frame.
  **********************************************************************************/
-static size_t encap_hdlc_frame(char *buffer, size_t data_count)
+static KISS_QUEUE_FRAME *encap_hdlc_frame(const char *buffer, size_t data_count)
 {
 	if(!buffer || !data_count) {
 		LOG_DEBUG("%s", "Parameter Data Error [NULL]");
-		return false;
+		return (KISS_QUEUE_FRAME *)0;
 	}
 
-	size_t count = 0;
-	unsigned int crc_value = 0;
-	char *kiss_encap = (char *)0;
-
 	if(progdefaults.ax25_decode_enabled) {
 		ax25_decode((unsigned char *) buffer, data_count, true, true);
 	}
 
-	crc_value = calc_fcs_crc(buffer, (int) data_count);
+	KISS_QUEUE_FRAME *frame = kiss_frame_alloc(HDLC_ENCODED_SIZE(data_count));
+	frame->size = hdlc_encode_frame(buffer, data_count, frame->data);
 
-	buffer[data_count++] = CRC_LOW(crc_value);
-	buffer[data_count++] = CRC_HIGH(crc_value);
-
-	count = hdlc_encode(buffer, data_count, &kiss_encap);
-
-	if(kiss_encap && count) {
-		memcpy(buffer, kiss_encap, count);
 #ifdef EXTENED_DEBUG_INFO
-		LOG_HEX(buffer, count);
+	LOG_HEX(frame->data, frame->size);
 #endif
-		delete [] kiss_encap;
-	} else {
-		LOG_DEBUG("%s", "Kiss Encode Memory Allocation Error");
-		return 0;
-	}
 
-	return count;
+	return frame;
 }
 
 /*********************************************************************************
- * Buffer is presently larger then what will be returned.
+ * Decodes the HDLC frame in buffer to a frame of its data, and checks its FCS.
  * data_count: Number of bytes in the buffer to process.
- * Returns the converted byte count. Buffer is over written with converted data.
+ * Returns the frame, to be released by the caller, or NULL if the FCS is bad.
  *********************************************************************************/
-static size_t decap_hdlc_frame(char *buffer, size_t data_count)
+static KISS_QUEUE_FRAME *decap_hdlc_frame(const char *buffer, size_t data_count)
 {
 	if(!buffer || !data_count) {
 		LOG_DEBUG("%s", "Parameter Data Error/NULL");
-		return false;
+		return (KISS_QUEUE_FRAME *)0;
 	}
 
-	size_t count = 0;
-	//	size_t index = 0;
-	unsigned int crc_value = 0;
-	unsigned int calc_crc_value = 0;
-	char *kiss_decap = (char *)0;
-
-	count = hdlc_decode(buffer, data_count, &kiss_decap);
-
 #ifdef EXTENED_DEBUG_INFO
-	if(data_count && buffer)
-		LOG_HEX(buffer, data_count);
-
-	if(count && kiss_decap)
-		LOG_HEX(kiss_decap, count);
+	LOG_HEX(buffer, data_count);
 #endif
 
-	do  {
-
-		if(count > data_count || !kiss_decap) {
-			LOG_DEBUG("%s", "Kiss decode error");
-			count = 0;
-			break;
-		}
-
-		if(count > 2)
-			count -= 2;
-
-		if(count) {
-			calc_crc_value = calc_fcs_crc(kiss_decap, (int) count);
-		}
-		else {
-			LOG_DEBUG("%s", "Kiss decode error");
-			count = 0;
-			break;
-		}
-
-		crc_value = CRC_LOW_HIGH(kiss_decap[count], kiss_decap[count + 1]);
+	KISS_QUEUE_FRAME *frame = kiss_frame_alloc(data_count);
+	frame->size = hdlc_decode_frame(buffer, data_count, frame->data);
 
-		if(crc_value != calc_crc_value) {
-			count = 0;
-			break;
-		}
-
-		temp_disable_tx_inhibit = time(0) + DISABLE_TX_INHIBIT_DURATION; // valid packet, disable busy channel inhitbit for x duration.
-
-		kiss_decap[count] = kiss_decap[count + 1] = 0;
-		memcpy(buffer, kiss_decap, count);
+	if(!frame->size) {
+		kiss_frame_release(frame);
+		return (KISS_QUEUE_FRAME *)0;
+	}
 
-		if(progdefaults.ax25_decode_enabled) {
-			ax25_decode((unsigned char *) buffer, count, true, false);
-		}
+#ifdef EXTENED_DEBUG_INFO
+	LOG_HEX(frame->data, frame->size);
+#endif
 
-		break;
-	} while(1);
+	temp_disable_tx_inhibit = time(0) + DISABLE_TX_INHIBIT_DURATION; // valid packet, disable busy channel inhitbit for x duration.
 
-	if(kiss_decap) {
-		kiss_decap[0] = 0;
-		delete [] kiss_decap;
+	if(progdefaults.ax25_decode_enabled) {
+		ax25_decode((unsigned char *) frame->data, frame->size, true, false);
 	}
 
-	return count;
+	return frame;
 }
 
-
 /**********************************************************************************
- *
+ * Returns a frame of the KISS encoded data, with its SMACK CRC if enabled.
+ * The CRC is computed as the data is escaped.  The caller releases the frame.
  **********************************************************************************/
-static KISS_QUEUE_FRAME *encap_kiss_frame(char *buffer, size_t buffer_size, int frame_type, int port)
+static KISS_QUEUE_FRAME *encap_kiss_frame(const char *buffer, size_t buffer_size, int frame_type, int port)
 {
 	if(!buffer || buffer_size < 1) {
 		LOG_DEBUG("%s", "KISS encap argument 'data' contains no data");
@@ -2353,86 +1840,21 @@ static KISS_QUEUE_FRAME *encap_kiss_frame(char *buffer, size_t buffer_size, int
 			return (KISS_QUEUE_FRAME *)0;
 	}
 
-	int size = 0;
-	int index = 0;
-	unsigned int crc_value = 0;
-	KISS_QUEUE_FRAME *frame = (KISS_QUEUE_FRAME *)0;
-
-	frame = new KISS_QUEUE_FRAME;
-
-	if(!frame) {
-		LOG_DEBUG("%s", "KISS struct frame memory allocation error");
-		return (KISS_QUEUE_FRAME *)0;
-	}
-
-	size = (buffer_size * KISS_BUFFER_FACTOR) + BUFFER_PADDING; // Resulting data space could be 2 fold higher.
-	frame->data = (char *) new char[size];
+	int header = SET_KISS_TYPE_PORT(frame_type, port);
+	int crc_type = CRC16_NONE;
 
-	if(!frame->data) {
-		delete frame;
-		LOG_DEBUG("%s", "KISS buffer frame memory allocation error");
-		return (KISS_QUEUE_FRAME *)0;
+	if(((frame_type == KISS_DATA) || (frame_type == KISS_RAW)) && smack_crc_enabled) {
+		header = SMACK_CRC_ASSIGN(header);
+		crc_type = crc_mode;
 	}
 
-	memset(frame->data, 0, size);
-	size = buffer_size;
-
-	frame->data[0] = SET_KISS_TYPE_PORT(frame_type, port);
-	memcpy(&frame->data[1], buffer, size);
-
-	size++;
-
-	if((frame_type == KISS_DATA) || (frame_type == KISS_RAW)) {
-
-		if(smack_crc_enabled) {
-
-			frame->data[0] = SMACK_CRC_ASSIGN(frame->data[0]);
-
-			switch(crc_mode) {
-				case CRC16_CCITT:
-					crc_value = calc_ccitt_crc((char *) frame->data, size);
-					frame->data[size++] = CRC_LOW(crc_value);
-					frame->data[size++] = CRC_HIGH(crc_value);
-					break;
-
-				case CRC16_FCS:
-					crc_value = calc_fcs_crc((char *) frame->data, size);
-					frame->data[size++] = CRC_LOW(crc_value);
-					frame->data[size++] = CRC_HIGH(crc_value);
-					break;
-
-				case CRC8_XOR:
-					crc_value = calc_xor_crc((char *) frame->data, size);
-					frame->data[size++] = CRC_LOW(crc_value);
-					break;
-
-				default:
-					break;
-			}
-		}
-	}
-
-	char *tmp = (char *)0;
-
-	index = kiss_encode((char *) frame->data, size, &tmp);
-
-	if(tmp) {
+	KISS_QUEUE_FRAME *frame = kiss_frame_alloc(KISS_ENCODED_SIZE(buffer_size));
+	frame->size = kiss_encode_frame(header, buffer, buffer_size, crc_type, frame->data);
 
 #ifdef EXTENED_DEBUG_INFO
-		LOG_HEX(tmp, index);
+	LOG_HEX(frame->data, frame->size);
 #endif
 
-		frame->data[0] = 0;
-		delete [] frame->data;
-		frame->data = (char *) tmp;
-		frame->size = index;
-	} else {
-		LOG_DEBUG("KISS encode allocation error near line %d", __LINE__);
-		delete [] frame->data;
-		delete frame;
-		frame = (KISS_QUEUE_FRAME *)0;
-	}
-
 	return frame;
 }
 
@@ -2442,120 +1864,62 @@ static KISS_QUEUE_FRAME *encap_kiss_frame(char *buffer, size_t buffer_size, int
 static KISS_QUEUE_FRAME * encap_kiss_frame(std::string data, int frame_type, int port)
 {
 	if(data.empty()) return (KISS_QUEUE_FRAME *)0;
-	return encap_kiss_frame((char *) data.c_str(), (size_t) data.size(), frame_type, port);
+	return encap_kiss_frame(data.data(), data.size(), frame_type, port);
 }
 
 /**********************************************************************************
- *
+ * Decodes a KISS frame in place and checks its SMACK CRC.
+ * Returns the size of the frame data, which *data points to in buffer, or 0.
  **********************************************************************************/
-std::string unencap_kiss_frame(char *buffer, size_t buffer_size, int *frame_type, int *kiss_port_no)
+static size_t unencap_kiss_frame(char *buffer, size_t buffer_size, int *frame_type, int *kiss_port_no, char **data)
 {
-	if(!buffer || buffer_size < 1 || !frame_type || !kiss_port_no)
-		return std::string("");
+	if(!buffer || buffer_size < 1 || !frame_type || !kiss_port_no || !data)
+		return 0;
 
-	char *decoded_buffer = (char *)0;
 	size_t count = 0;
-	unsigned int crc_extracted = 0;
-	unsigned int crc_calc = 0;
 	unsigned int port = 0;
 	unsigned int ftype = 0;
-
-	static std::string ret_str = "";
-
-	ret_str.clear();
+	int header = 0;
+	int crc_type = CRC16_NONE;
 
 #ifdef EXTENED_DEBUG_INFO
 	LOG_HEX(buffer, buffer_size);
 #endif
 
-	count = kiss_decode(buffer, buffer_size, &decoded_buffer);
+	header = kiss_frame_header(buffer, buffer_size);
 
-	if(!count || !decoded_buffer) {
-		LOG_DEBUG("Kiss decoder memory allocation error near line %d", __LINE__);
-		return ret_str;
+	if(header < 0) {
+		LOG_DEBUG("Empty Kiss frame near line %d", __LINE__);
+		return 0;
 	}
 
-	ftype = KISS_CMD(decoded_buffer[0]);
-	port = KISS_PORT(decoded_buffer[0]);
+	ftype = KISS_CMD(header);
+	port = KISS_PORT(header);
 
 	if((ftype == KISS_DATA) || (ftype == KISS_RAW)) {
 		smack_crc_enabled = SMACK_CRC(port);
 		port = SMACK_CRC_MASK(port);
 
-		if(smack_crc_enabled) {
-			switch(crc_mode) {
-				case CRC16_CCITT:
-					count -= 2;
-					if(count > 2) {
-						crc_calc = calc_ccitt_crc(decoded_buffer, count);
-						crc_extracted = CRC_LOW_HIGH(decoded_buffer[count], decoded_buffer[count + 1]);
-					} else {
-						crc_calc = crc_extracted + 1; // Force a fail
-					}
-					break;
-
-				case CRC16_FCS:
-					count -= 2;
-					if(count > 2) {
-						crc_calc = calc_fcs_crc(decoded_buffer, count);
-						crc_extracted = CRC_LOW_HIGH(decoded_buffer[count], decoded_buffer[count + 1]);
-					} else {
-						crc_calc = crc_extracted + 1;
-					}
-					break;
-
-				case CRC8_XOR:
-					count -= 1;
-					if(count > 1) {
-						crc_calc = CRC_LOW(calc_fcs_crc(decoded_buffer, count));
-						crc_extracted = CRC_LOW(decoded_buffer[count]);
-					} else {
-						crc_calc = crc_extracted + 1;
-					}
-					break;
-
-				default:
-					LOG_DEBUG("CRC type not found %d", crc_mode);
-			}
+		if(smack_crc_enabled)
+			crc_type = crc_mode;
+	}
 
-			if(crc_calc != crc_extracted) {
+	*frame_type = ftype;
+	*kiss_port_no = port;
 
-				if(frame_type) *frame_type = ftype;
-				if(kiss_port_no) *kiss_port_no = port;
-				if(decoded_buffer) delete [] decoded_buffer;
-
-				ret_str.clear();
-				return ret_str;
-			}
-		}
-	}
+	count = kiss_decode_frame(buffer, buffer_size, crc_type);
 
 	if(count > 0)
 		count--;
 
 #ifdef EXTENED_DEBUG_INFO
-	LOG_HEX(&decoded_buffer[1], count);
+	LOG_HEX(&buffer[1], count);
 #endif
 
-	ret_str.assign(&decoded_buffer[1], count);
-
-	if(frame_type) *frame_type = ftype;
-	if(kiss_port_no) *kiss_port_no = port;
-	if(decoded_buffer) delete [] decoded_buffer;
-
-	return ret_str;
+	*data = &buffer[1];
+	return count;
 }
 
-/**********************************************************************************
- *
- **********************************************************************************/
-std::string unencap_kiss_frame(std::string package, int *frame_type, int *kiss_port_no)
-{
-	if(package.empty() || !frame_type || !kiss_port_no)
-		return std::string("");
-
-	return unencap_kiss_frame((char *) package.c_str(), (size_t) package.size(), frame_type, kiss_port_no);
-}
 
 /**********************************************************************************
  *
@@ -2632,18 +1996,16 @@ static void parse_kiss_frame(std::string frame_segment)
 {
 	guard_lock kiss_rx_lock(&kiss_frame_mutex);
 
-	unsigned int cur_byte    = KISS_INVALID;
+	static const char frame_marker[2] = { (char)(KISS_FEND), 0 };
 	unsigned int frame_size  = 0;
-	unsigned int index       = 0;
-	unsigned int fend_count  = 0;
 	unsigned int cmsa_data   = 0;
-	int buffer_size = 0;
 	int port_no     = KISS_INVALID;
 	int frame_type  = KISS_INVALID;
-	int data_count = 0;
-
-	bool process_one_frame = false;
-	char *buffer = (char *)0;
+	size_t data_count = 0;
+	size_t pos = 0;
+	size_t pos2 = 0;
+	char *data = (char *)0;
+	KISS_QUEUE_FRAME *frame = (KISS_QUEUE_FRAME *)0;
 
 	kiss_frame.append(frame_segment);
 
@@ -2651,41 +2013,28 @@ static void parse_kiss_frame(std::string frame_segment)
 
 		if(kiss_frame.empty()) return;
 
-		frame_size = kiss_frame.size();
-		process_one_frame = false;
-		fend_count = 0;
-		kiss_one_frame.clear();
-
-		for(index = 0; index < frame_size; index++) {
-			cur_byte = kiss_frame[index] & 0xFF;
-
-			if(cur_byte == KISS_FEND) {
-				fend_count++;
-			}
-
-			if(fend_count) {
-				kiss_one_frame += cur_byte;
-			}
-
-			if(fend_count == 2) {
-				kiss_frame.erase(0, index);
-				process_one_frame = true;
-				break;
-			}
-		}
+		pos = kiss_frame.find(frame_marker);
+		if(pos == std::string::npos)
+			return;
 
-		if(!process_one_frame)
+		pos2 = kiss_frame.find(frame_marker, pos + 1);
+		if(pos2 == std::string::npos)
 			return;
 
+		// The closing FEND may open the next frame
+		kiss_one_frame.assign(kiss_frame, pos, pos2 - pos + 1);
+		kiss_frame.erase(0, pos2);
+
 		frame_size = kiss_one_frame.size();
 
 		if(frame_size < 3) {
 			continue; // Invalid Frame size
 		}
 
-		kiss_one_frame = unencap_kiss_frame(kiss_one_frame, &frame_type, &port_no);
+		// Decoded in place, data points into kiss_one_frame
+		data_count = unencap_kiss_frame(&kiss_one_frame[0], frame_size, &frame_type, &port_no, &data);
 
-		if(kiss_one_frame.empty())
+		if(!data_count)
 			continue;
 
 		if(port_no != (int)kiss_port_no) {
@@ -2698,7 +2047,7 @@ static void parse_kiss_frame(std::string frame_segment)
 			case KISS_SLOTTIME:
 			case KISS_TXTAIL:
 			case KISS_DUPLEX:
-				cmsa_data = kiss_one_frame[0] & 0xFF;
+				cmsa_data = data[0] & 0xFF;
 				break;
 
 			case KISS_DATA:
@@ -2722,29 +2071,18 @@ static void parse_kiss_frame(std::string frame_segment)
 
 		switch(frame_type) {
 			case KISS_DATA:
-				buffer_size = (frame_size * HDLC_BUFFER_FACTOR) + BUFFER_PADDING;
-				buffer = new char[buffer_size];
-
-				if(!buffer) {
-					LOG_DEBUG("%s", "Buffer Allocation Error");
-					return;
-				}
-				data_count = kiss_one_frame.size();
-				memset(buffer, 0, buffer_size);
-				memcpy(buffer, kiss_one_frame.c_str(), data_count);
-
-				data_count = encap_hdlc_frame(buffer, data_count);
+				frame = encap_hdlc_frame(data, data_count);
 
-				WriteToRadioBuffered((const char *) buffer, (size_t) data_count);
+				if(!frame)
+					break;
 
-				buffer[0] = 0;
-				delete [] buffer;
-				buffer = 0;
+				WriteToRadioBuffered((const char *) frame->data, (size_t) frame->size);
+				kiss_frame_release(frame);
 
 				break;
 
 			case KISS_RAW:
-				WriteToRadioBuffered((const char *) kiss_one_frame.c_str(), (size_t) kiss_one_frame.size());
+				WriteToRadioBuffered((const char *) data, data_count);
 				break;
 
 			case KISS_TXDELAY:
@@ -2770,7 +2108,7 @@ static void parse_kiss_frame(std::string frame_segment)
 				break;
 
 			case KISS_HARDWARE:
-				parse_hardware_frame(kiss_one_frame);
+				parse_hardware_frame(std::string(data, data_count));
 				break;
 		}
 	} // while(1)
@@ -3617,10 +2955,9 @@ void ReadFromRadioBuffered(void)
 
 	int pos = 0;
 	int pos2 = 0;
-	//	unsigned int crc = 0;
 	KISS_QUEUE_FRAME *frame = (KISS_QUEUE_FRAME *)0;
+	KISS_QUEUE_FRAME *data = (KISS_QUEUE_FRAME *)0;
 	static char frame_marker[2] = { (char)(KISS_FEND), 0 };
-	std::string one_frame = "";
 
 	pos = from_radio.find(frame_marker);
 
@@ -3635,66 +2972,31 @@ void ReadFromRadioBuffered(void)
 	}
 
 	pos2 = from_radio.find(frame_marker, pos + 1);
-	if(pos2 != (int)(std::string::npos)) {
-		one_frame.assign(from_radio, pos, pos2 - pos + 1);
-	} else {
+	if(pos2 == (int)(std::string::npos)) {
 		if(from_radio.size() > MAX_TEMP_BUFFER_SIZE)
 			from_radio.clear();
 		return;
 	}
 
-	char *buffer = (char *)0;
-	size_t buffer_size = one_frame.size() + BUFFER_PADDING;
+	// Decoded straight from the receive buffer
+	data = decap_hdlc_frame(from_radio.data() + pos, pos2 - pos + 1);
 
-	buffer = new char [buffer_size];
-
-	if(!buffer) {
-		LOG_DEBUG("Memory Allocation Error Near Line No. %d", __LINE__);
-		goto EXIT;
-	}
-
-	memset(buffer, 0, buffer_size);
-
-	buffer_size = one_frame.size();
-	memcpy(buffer, one_frame.c_str(), buffer_size);
-
-#ifdef EXTENED_DEBUG_INFO
-	LOG_HEX(buffer, buffer_size);
-#endif
-
-	buffer_size = decap_hdlc_frame(buffer, buffer_size);
-
-	if(buffer_size) {
+	if(data) {
 		from_radio.erase(pos, pos2 - pos + 1);
 
 		if(kiss_raw_enabled != KISS_RAW_ONLY) {
-			frame = encap_kiss_frame(buffer, buffer_size, KISS_DATA, kiss_port_no);
+			frame = encap_kiss_frame(data->data, data->size, KISS_DATA, kiss_port_no);
 
-			if(!frame || !frame->data) {
-				LOG_DEBUG("Frame Allocation Error Near Line %d", __LINE__);
-				goto EXIT;
+			if(frame) {
+				WriteToHostBuffered((const char *) frame->data, (size_t) frame->size);
+				kiss_frame_release(frame);
 			}
-
-			WriteToHostBuffered((const char *) frame->data, (size_t) frame->size);
 		}
+
+		kiss_frame_release(data);
 	} else {
 		from_radio.erase(pos, pos + 1);
 	}
-
-EXIT:;
-
-	if(frame) {
-		if(frame->data) {
-			frame->data[0] = 0;
-			delete [] frame->data;
-		}
-		delete frame;
-	}
-
-	if(buffer) {
-		buffer[0] = 0;
-		delete [] buffer;
-	}
 }
 
 /**********************************************************************************
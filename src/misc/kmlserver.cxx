@@ -27,6 +27,8 @@
 #include <math.h>
 #include <assert.h>
 #include <sys/stat.h>
+#include <dirent.h>
+#include <ctype.h>
 
 #include <string>
 #include <set>
@@ -585,16 +587,8 @@ class  KmlSrvImpl : public KmlServer {
 	*/
 	class PlacesMapT : public std::multimap< std::string, PlacemarkT >
 	{
-		/// Written to by the main thread with lock protection, read (and emptied)
-		/// by the sub thread which is later in charge of writing things to disk.
-		typedef std::list< value_type > PlacemarkListT ;
-
-		/// A separate queue helps for performance because the insertion in the main container
-		/// might take time and the main thread may lose data.
-		PlacemarkListT m_queue_to_insert ;
-
-		/// This is not set when inserting at load time, but when emptying
-		/// the queue, and when data are ready for writing to disk.
+		/// This is not set when inserting at load time, but when new placemarks
+		/// are inserted, and when data are ready for writing to disk.
 		mutable bool m_must_save ;
 
 	public:
@@ -607,23 +601,15 @@ class  KmlSrvImpl : public KmlServer {
 		/// called by the subthread in charge of flushing PlacemarkT to the KML file.
 		void DirectInsert( const value_type & refVL, double merge_dist )
 		{
-			/// Not needed to use equal_range because we need the last placemark matching
-			/// this key, and this iterator is forward_iterator only.
-			iterator it = find( refVL.first ), en = end() ;
-			if( it == en ) {
+			/// Elements with the same key keep their insertion order, so the last position of
+			/// this object is just before the upper bound. No need to walk along its trajectory.
+			iterator next = upper_bound( refVL.first ), last = next ;
+			if( ( next == begin() ) || ( (--last)->first != refVL.first ) ) {
 				// LOG_INFO("Cannot find '%s'", refVL.first.c_str() );
-				it = insert( end(), refVL );
+				insert( next, refVL );
 				return;
 			}
 
-			/// Searches for the last element with the same key.
-			iterator last = it, next = it ;
-			++next ;
-			while( next != en && next->first == refVL.first ) {
-				last = next;
-				++next ;
-			}
-
 			double dist = last->second.distance_to( refVL.second );
 
 			/// We can reuse the last element because it is not too far from our coordinates.
@@ -667,80 +653,8 @@ class  KmlSrvImpl : public KmlServer {
 			}
 		} // DirectInsert
 
-		/// Enqueues a new placemark for insertion by the subthread. Called by the  main thread
-		/// each time a Broadcast of a new PlacemarkT is done.
-		void Enqueue( const std::string & kmlNam, const PlacemarkT & refPM ) {
-			/// So we will save to a file, because something changed.
-			m_queue_to_insert.push_back( value_type( kmlNam, refPM ) );
-		}
-
-		/// Called by the subthread. It can merge data of placemarks with the same name
-		/// and different positions due to a move. This has to be very fast because under lock protection.
-		void FlushQueue(double merge_dist) {
-			// LOG_INFO("FlushQueue nbelts %d sz=%d", m_queue_to_insert.size(), size() );
-
-			if( m_queue_to_insert.empty() ) return ;
-
-			for( PlacemarkListT::iterator itPL = m_queue_to_insert.begin(), enPL = m_queue_to_insert.end(); itPL != enPL; ++ itPL )
-			{
-				DirectInsert( *itPL, merge_dist );
-			}
-			// LOG_INFO("Flushed into sz=%d", size() );
-
-			// TODO: If lock contention problems, we might swap this list with another one owned by this
-			// objet. This would later be merged into the container before saving data to disk.
-			m_queue_to_insert.clear();
-			m_must_save = true ;
-		}
-
-		/// Removes obsolete data for one category only.
-		void PruneKmlFile( int retention_delay )
-		{
-			/// By convention, it means keeping all data.
-			if( retention_delay <= 0 ) return ;
-
-			/// Called only once per hour, instead of at every call. Saves CPU.
-			static time_t prev_call_tm = 0 ;
-			time_t now = time(NULL);
-
-			static const int seconds_per_hour = 60 * 60 ;
-
-			/// First call of this function, always do the processing.
-			if( prev_call_tm != 0 ) {
-				/// If this was called for less than one hour, then return.
-				if( prev_call_tm > now - seconds_per_hour ) return ;
-			}
-			prev_call_tm = now ;
-
-			/// Cleanup all data older than this.
-			time_t limit_time = now - retention_delay * seconds_per_hour ;
-
-			LOG_INFO("sz=%d retention=%d hours now=%s limit=%s",
-				(int)size(), retention_delay, KmlTimestamp(now).c_str(), KmlTimestamp(limit_time).c_str() );
-
-			size_t nbFullErased = 0 ;
-			size_t nbPartErased = 0 ;
-			for( iterator itMap = begin(), nxtMap = itMap, enMap = end() ; itMap != enMap; itMap = nxtMap ) {
-				PlacemarkT & refP = itMap->second ;
-				++nxtMap ;
-
-				/// Erases all elements older than the limit, or the whole element.
-				PlacemarkT::iterator itP = refP.upper_bound( limit_time );
-				if( itP == refP.end() ) {
-					erase( itMap );
-					++nbFullErased ;
-				} else if( itP != refP.begin() ) {
-					refP.erase( refP.begin(), itP );
-					++nbPartErased ;
-				}
-			}
-
-			// Maybe the container only lost data because of data expiration, so it must be saved.
-			bool must_save_now = m_must_save || ( nbFullErased > 0 ) || ( nbPartErased > 0 ) ;
-			LOG_INFO("Sz=%d FullyErased=%d PartialErased=%d m_must_save=%d must_save_now=%d",
-					(int)size(), (int)nbFullErased, (int)nbPartErased, m_must_save, must_save_now );
-			m_must_save = must_save_now ;
-		}
+		/// Called when new data were inserted.
+		void MustSave(void) { m_must_save = true; }
 
 		/// This is not efficient because we reopen the file at each access, but it ensures
 		/// that the file is consistent and accessible at any moment.
@@ -828,17 +742,289 @@ class  KmlSrvImpl : public KmlServer {
 
 	}; // KmlSrvImpl::PlacesMapT
 
-	/// There is a very small number of categories: Synop, Navtex etc...
-	struct PlacemarksCacheT : public std::map< std::string, PlacesMapT > {
-		const PlacesMapT * FindCategory( const std::string & category ) const {
-			const_iterator it = find( category );
-			if( it == end() ) return NULL ;
-			return &it->second;
+	/** The placemarks of a category are saved in segments holding the data received
+	during one hour, plus a file for the permanent placemarks. Only the current segment
+	and the permanent placemarks are rewritten at each refresh: Older segments never change,
+	and when they are too old, they are deleted as a whole.
+	The KML file of the category only contains links to these files.
+	*/
+	class CategoryT
+	{
+		/// Written to by the main thread with lock protection, read (and emptied)
+		/// by the sub thread which is later in charge of writing things to disk.
+		typedef std::list< PlacesMapT::value_type > PlacemarkListT ;
+
+		/// A separate queue helps for performance because the insertion in the main container
+		/// might take time and the main thread may lose data.
+		PlacemarkListT m_queue_to_insert ;
+
+		/// Placemarks received during the current hour, and the file they are saved to.
+		PlacesMapT  m_current ;
+		std::string m_current_nam ;
+
+		/// Segments which ended since the last time files were written.
+		std::map< std::string, PlacesMapT > m_closing ;
+
+		/// Placemarks whose event is unique. They are never purged.
+		PlacesMapT  m_permanent ;
+		bool        m_has_permanent ;
+
+		/// Names of the segment files on disk. Sorting the names sorts them by time.
+		std::set< std::string > m_segments ;
+
+		/// Set when the list of files linked from the category file changes.
+		bool        m_index_dirty ;
+
+		/// When old segments were last looked for.
+		time_t      m_prev_prune ;
+
+		/// Merges a placemark into the segment or the permanent placemarks.
+		void Insert( const PlacesMapT::value_type & refVL, double merge_dist ) {
+			PlacesMapT & refMap =
+				( ! refVL.second.empty() ) && ( refVL.second.begin()->first == KmlServer::UniqueEvent )
+				? m_permanent : m_current ;
+			refMap.DirectInsert( refVL, merge_dist );
+			refMap.MustSave();
+		}
+
+		/// Writes one segment. The category file must link to it once it exists.
+		bool SaveSegment(
+				const std::string & kml_dir,
+				const std::string & category,
+				const std::string & segNam,
+				const PlacesMapT  & refMap,
+				int balloon_style ) {
+			if( ! refMap.RewriteKmlFileOneCategory( category, kml_dir + segNam, balloon_style ) )
+				return false ;
+			if( m_segments.insert( segNam ).second )
+				m_index_dirty = true ;
+			return true ;
+		}
+
+		/// Writes the category file, with links to all segments.
+		void WriteIndex( const std::string & kml_dir, const std::string & category, int refresh_interval ) const {
+			// This file must be atomic because it is periodically read.
+			AtomicRenamer ar( kml_dir + category + ".kml" );
+			KmlHeader( ar, category );
+			if( m_has_permanent )
+				SegmentNetworkLink( ar, category, PermanentName( category ), refresh_interval );
+			for( std::set< std::string >::const_iterator it = m_segments.begin(), en = m_segments.end(); it != en; ++it ) {
+				/// Only the current segment might change.
+				SegmentNetworkLink( ar, category, *it, *it == m_current_nam ? refresh_interval : 0 );
+			}
+			ar << KmlFooter ;
+			LOG_INFO("Saved %s: %d segments", category.c_str(), (int)m_segments.size() );
+		}
+
+		/// Older segments are not refreshed by the viewer.
+		static void SegmentNetworkLink(
+				std::ostream      & strm,
+				const std::string & category,
+				const std::string & segNam,
+				int                 refresh_interval ) {
+			strm << 
+				"<NetworkLink>\n"
+				"	<name>" << segNam.substr( category.size() + 1, segNam.size() - category.size() - 5 ) << "</name>\n"
+				"	<Link>\n"
+				"		<href>" << segNam << "</href>\n";
+			if( refresh_interval > 0 ) {
+				strm <<
+				"		<refreshMode>onInterval</refreshMode>\n"
+				"		<refreshInterval>" << refresh_interval << "</refreshInterval>\n";
+			}
+			strm <<
+				"	</Link>\n"
+				"</NetworkLink>\n";
+		}
+
+	public:
+		CategoryT() : m_has_permanent(false), m_index_dirty(true), m_prev_prune(0) {}
+
+		/// The segment file of the hour of a given time, such as "Synop-20141019-13.kml".
+		static std::string SegmentName( const std::string & category, time_t tim ) {
+			tm objTm;
+			gmtime_r( &tim, &objTm );
+			char bufTm[24];
+			snprintf( bufTm, sizeof(bufTm), "-%04d%02d%02d-%02d.kml",
+				objTm.tm_year + 1900,
+				objTm.tm_mon + 1,
+				objTm.tm_mday,
+				objTm.tm_hour );
+			return category + bufTm ;
+		}
+
+		/// Tells whether a file name is a segment of this category.
+		static bool IsSegmentName( const std::string & category, const std::string & filNam ) {
+			static const size_t lenStamp = sizeof("-20141019-13.kml") - 1 ;
+			return ( filNam.size() == category.size() + lenStamp )
+				&& ( 0 == filNam.compare( 0, category.size(), category ) )
+				&& ( filNam[ category.size() ] == '-' )
+				&& isdigit( filNam[ category.size() + 1 ] )
+				&& ( 0 == filNam.compare( filNam.size() - 4, 4, ".kml" ) );
+		}
+
+		/// The file of the placemarks which are never purged.
+		static std::string PermanentName( const std::string & category ) {
+			return category + "-" + KmlSrvUnique + ".kml" ;
+		}
+
+		PlacesMapT & Current(void) { return m_current; }
+		PlacesMapT & Permanent(void) { return m_permanent; }
+
+		/// Number of placemarks in memory. Debugging purpose only.
+		size_t size(void) const { return m_current.size() + m_permanent.size(); }
+
+		/// Called when reloading the files of a previous session.
+		void AddSegment( const std::string & segNam ) { m_segments.insert( segNam ); }
+		void HasPermanent(void) { m_has_permanent = true; }
+
+		/// Enqueues a new placemark for insertion by the subthread. Called by the main thread
+		/// each time a Broadcast of a new PlacemarkT is done.
+		void Enqueue( const std::string & kmlNam, const PlacemarkT & refPM ) {
+			m_queue_to_insert.push_back( PlacesMapT::value_type( kmlNam, refPM ) );
+		}
+
+		/// Placemarks are added to the segment of the current hour. When a new hour starts,
+		/// the current segment is kept aside until it is saved.
+		void StartSegment( const std::string & category, time_t now ) {
+			std::string segNam = SegmentName( category, now );
+			if( segNam == m_current_nam ) return ;
+
+			if( ! m_current.empty() ) {
+				PlacesMapT & refClosing = m_closing[ m_current_nam ];
+				refClosing.swap( m_current );
+				refClosing.MustSave();
+				m_current.clear();
+			}
+			m_current_nam = segNam ;
+			/// The link to the current segment is refreshed, not the previous ones.
+			m_index_dirty = true ;
+		}
+
+		/// Called by the subthread. It can merge data of placemarks with the same name
+		/// and different positions due to a move. This has to be very fast because under lock protection.
+		void FlushQueue( const std::string & category, double merge_dist, time_t now ) {
+			// LOG_INFO("FlushQueue nbelts %d sz=%d", m_queue_to_insert.size(), size() );
+
+			if( m_queue_to_insert.empty() ) return ;
+
+			StartSegment( category, now );
+			for( PlacemarkListT::iterator itPL = m_queue_to_insert.begin(), enPL = m_queue_to_insert.end(); itPL != enPL; ++ itPL )
+			{
+				Insert( *itPL, merge_dist );
+			}
+			// LOG_INFO("Flushed into sz=%d", size() );
+
+			m_queue_to_insert.clear();
+		}
+
+		/// Placemarks loaded from a file written by a previous version, which did not use segments.
+		void Import( const std::string & category, const PlacesMapT & refMap, double merge_dist, time_t now ) {
+			if( refMap.empty() ) return ;
+
+			StartSegment( category, now );
+			for( PlacesMapT::const_iterator it = refMap.begin(), en = refMap.end(); it != en; ++it ) {
+				Insert( *it, merge_dist );
+			}
+			LOG_INFO("Imported %d placemarks into %s", (int)refMap.size(), m_current_nam.c_str() );
 		}
-		PlacesMapT * FindCategory( const std::string & category ) {
+
+		/// Deletes the segments older than the retention delay. The segment of this hour is never deleted.
+		void Prune( const std::string & kml_dir, const std::string & category, int retention_delay, time_t now )
+		{
+			/// By convention, it means keeping all data.
+			if( retention_delay <= 0 ) return ;
+
+			static const int seconds_per_hour = 60 * 60 ;
+
+			/// Called only once per hour, instead of at every call. Saves CPU.
+			if( ( m_prev_prune != 0 ) && ( m_prev_prune > now - seconds_per_hour ) ) return ;
+			m_prev_prune = now ;
+
+			/// A segment is not modified after its hour, so its data are older than its last write.
+			time_t limit_time = now - retention_delay * seconds_per_hour ;
+
+			std::string nowNam = SegmentName( category, now );
+			size_t nbErased = 0 ;
+			for( std::set< std::string >::iterator it = m_segments.begin(), nxt = it, en = m_segments.end(); it != en; it = nxt ) {
+				++nxt ;
+				if( *it == nowNam ) continue ;
+
+				std::string filNam = kml_dir + *it ;
+				struct stat st;
+				if( ( stat( filNam.c_str(), &st ) == 0 ) && ( st.st_mtime >= limit_time ) ) continue ;
+
+				if( ( remove( filNam.c_str() ) != 0 ) && ( errno != ENOENT ) ) {
+					LOG_WARN("Cannot remove %s: %s", filNam.c_str(), strerror(errno) );
+					continue ;
+				}
+				/// Nothing was received since this segment was written.
+				if( *it == m_current_nam ) {
+					m_current.clear();
+					m_current_nam.clear();
+				}
+				m_segments.erase( it );
+				++nbErased ;
+			}
+
+			LOG_INFO("retention=%d hours now=%s limit=%s segments=%d erased=%d",
+				retention_delay, KmlTimestamp(now).c_str(), KmlTimestamp(limit_time).c_str(),
+				(int)m_segments.size(), (int)nbErased );
+			if( nbErased > 0 ) m_index_dirty = true ;
+		}
+
+		/// Writes the segments which changed, and the category file if needed.
+		bool Write( const std::string & kml_dir, const std::string & category, int refresh_interval, int balloon_style ) {
+			bool wasSaved = false ;
+
+			for( std::map< std::string, PlacesMapT >::const_iterator it = m_closing.begin(), en = m_closing.end(); it != en; ++it ) {
+				wasSaved |= SaveSegment( kml_dir, category, it->first, it->second, balloon_style );
+			}
+			m_closing.clear();
+
+			if( ! m_current_nam.empty() ) {
+				wasSaved |= SaveSegment( kml_dir, category, m_current_nam, m_current, balloon_style );
+			}
+
+			if( m_permanent.RewriteKmlFileOneCategory( category, kml_dir + PermanentName( category ), balloon_style ) ) {
+				wasSaved = true ;
+				if( ! m_has_permanent ) {
+					m_has_permanent = true ;
+					m_index_dirty = true ;
+				}
+			}
+
+			if( m_index_dirty ) {
+				WriteIndex( kml_dir, category, refresh_interval );
+				m_index_dirty = false ;
+				wasSaved = true ;
+			}
+			return wasSaved ;
+		}
+
+		/// Removes all files of the category, and all placemarks in memory.
+		void Reset( const std::string & kml_dir, const std::string & category, int refresh_interval ) {
+			for( std::set< std::string >::const_iterator it = m_segments.begin(), en = m_segments.end(); it != en; ++it ) {
+				remove( ( kml_dir + *it ).c_str() );
+			}
+			remove( ( kml_dir + PermanentName( category ) ).c_str() );
+
+			m_segments.clear();
+			m_closing.clear();
+			m_current.clear();
+			m_permanent.clear();
+			m_has_permanent = false ;
+			WriteIndex( kml_dir, category, refresh_interval );
+			m_index_dirty = false ;
+		}
+	}; // KmlSrvImpl::CategoryT
+
+	/// There is a very small number of categories: Synop, Navtex etc...
+	struct PlacemarksCacheT : public std::map< std::string, CategoryT > {
+		CategoryT * FindCategory( const std::string & category ) {
 			iterator it = find( category );
 			if( it == end() )
-				it = insert( end(), value_type( category, PlacesMapT() ) );
+				it = insert( end(), value_type( category, CategoryT() ) );
 			return &it->second ;
 		}
 	};
@@ -1008,14 +1194,6 @@ class  KmlSrvImpl : public KmlServer {
 		return m_kml_dir + category + ".kml";
 	}
 
-	/// Resets the files. Called from the test program and the GUI.
-	void CreateNewKmlFile( const std::string & category ) const {
-		// This file must be atomic because it is periodically read.
-		AtomicRenamer ar( CategFile( category ) );
-		KmlHeader( ar, category);
-		ar << KmlFooter ;
-	}
-
 	/// Template parameters should not be local types.
 	struct PlacesMapIterSortT {
 		// This sort iterators on placemarks, based on the style name then the placemark name.
@@ -1066,18 +1244,13 @@ class  KmlSrvImpl : public KmlServer {
 	}
 
 	/// Loads a file of a previous session. The mutex should be locked at this moment.
-	void ReloadSingleKmlFile( const std::string & category ) {
-		std::string kmlFilNam = CategFile( category );
-
+	bool ReloadSingleKmlFile( const std::string & kmlFilNam, const std::string & category, PlacesMapT * ptrMap ) {
 		LOG_INFO("kmlFilNam=%s m_merge_dist=%lf", kmlFilNam.c_str(), m_merge_dist );
 
-		PlacesMapT *ptrMap = m_placemarks.FindCategory( category );
-
 		FILE * filKml = fopen( kmlFilNam.c_str(), "r" );
 		if( filKml == NULL ) {
-			LOG_ERROR("Could not open %s. Creating one.", kmlFilNam.c_str() );
-			CreateNewKmlFile( category );
-			return ;
+			LOG_INFO("Could not open %s", kmlFilNam.c_str() );
+			return false ;
 		}
 		/// The destructor ensures the file will be closed if an exception is thrown.
 		struct FilCloserT {
@@ -1088,7 +1261,7 @@ class  KmlSrvImpl : public KmlServer {
 		std::auto_ptr< irr::io::IrrXMLReader > xml( irr::io::createIrrXMLReader( Closer.m_file ) );
 		if( xml.get() == NULL ) {
 			LOG_ERROR("Could not parse %s", kmlFilNam.c_str() );
-			return ;
+			return false ;
 		}
 
 		using namespace irr::io ;
@@ -1154,6 +1327,9 @@ class  KmlSrvImpl : public KmlServer {
 					case KMLRD_NONE :
 						if (!strcmp("Folder", nodeName)) {
 							currState = KMLRD_FOLDER ;
+						} else if (!strcmp("NetworkLink", nodeName)) {
+							/// The category file links to its segments, which are loaded separately.
+							avoidNode = nodeName ;
 						} else {
 							/// These tags are not meaningful for us.
 							if(	strcmp( "kml", nodeName ) &&
@@ -1338,25 +1514,73 @@ class  KmlSrvImpl : public KmlServer {
 		}
 
 		LOG_INFO("kmlFilNam=%s loaded sz=%d", kmlFilNam.c_str(), (int)ptrMap->size() );
+		return true ;
 	} // KmlSrvImpl::ReloadSingleKmlFile
 
-	/// Rewrites only the categories which have changed.
+	/// Reloads the segment of the current hour and the permanent placemarks, so that the
+	/// files can be rewritten with them. Older segments are only listed.
+	void ReloadCategory( const std::string & category ) {
+		CategoryT *ptrCat = m_placemarks.FindCategory( category );
+
+		std::set< std::string > segNams ;
+		DIR *dir = opendir( m_kml_dir.c_str() );
+		if( dir ) {
+			struct dirent *entry ;
+			while( ( entry = readdir( dir ) ) != NULL ) {
+				if( CategoryT::IsSegmentName( category, entry->d_name ) )
+					segNams.insert( entry->d_name );
+			}
+			closedir( dir );
+		}
+		for( std::set< std::string >::const_iterator it = segNams.begin(), en = segNams.end(); it != en; ++it ) {
+			ptrCat->AddSegment( *it );
+		}
+
+		if( ReloadSingleKmlFile( m_kml_dir + CategoryT::PermanentName( category ), category, &ptrCat->Permanent() ) )
+			ptrCat->HasPermanent();
+
+		time_t now = time(NULL);
+		std::string segNam = CategoryT::SegmentName( category, now );
+		if( segNams.count( segNam ) ) {
+			ptrCat->StartSegment( category, now );
+			ReloadSingleKmlFile( m_kml_dir + segNam, category, &ptrCat->Current() );
+		}
+
+		/// Files written before segments were used contain placemarks instead of links.
+		PlacesMapT oldPlacemarks ;
+		ReloadSingleKmlFile( CategFile( category ), category, &oldPlacemarks );
+		ptrCat->Import( category, oldPlacemarks, m_merge_dist, now );
+
+		LOG_INFO("Category %s: %d segments", category.c_str(), (int)segNams.size() );
+	} // KmlSrvImpl::ReloadCategory
+
+	/// Rewrites only the segments which have changed.
 	bool RewriteKmlFileFull(void) {
+		guard_lock myGuard( &m_mutex_files );
+
 		bool wasSaved = false ;
+		time_t now = time(NULL);
 		// LOG_INFO("nb_categories=%d", nb_categories );
 		for( size_t i = 0; i < nb_categories; ++i ) {
 			const char * category = categories[i];
-			PlacesMapT *ptrMap = m_placemarks.FindCategory( category );
-			if( ptrMap == NULL ) {
-				LOG_INFO("Category %s undefined", category );
-				continue;
-			}
-			ptrMap->PruneKmlFile( m_retention_delay );
-			wasSaved |= ptrMap->RewriteKmlFileOneCategory( category, CategFile( category ), m_balloon_style );
+			CategoryT *ptrCat = m_placemarks.FindCategory( category );
+			ptrCat->Prune( m_kml_dir, category, m_retention_delay, now );
+			wasSaved |= ptrCat->Write( m_kml_dir, category, m_refresh_interval, m_balloon_style );
 		}
 		return wasSaved ;
 	} // KmlSrvImpl::RewriteKmlFileFull
 
+	/// Moves the broadcasted placemarks to the segments. The mutex must be locked.
+	void FlushQueues(void) {
+		time_t now = time(NULL);
+		for( size_t i = 0; i < nb_categories; ++i )
+		{
+			// TODO: If there are contention problems, internally swap the queue
+			// with a fresh empty one.
+			m_placemarks.FindCategory( categories[i] )->FlushQueue( categories[i], m_merge_dist, now );
+		}
+	}
+
 #ifdef FLDIGI_KML_CONDITION_VARIABLE
 	/// This is signaled when geographic data is broadcasted.
 	pthread_cond_t  m_cond_queue ;
@@ -1369,6 +1593,9 @@ class  KmlSrvImpl : public KmlServer {
 #endif
 	pthread_mutex_t m_mutex_write ;
 
+	/// Held when writing files, so they are not removed at the same time.
+	pthread_mutex_t m_mutex_files ;
+
 	typedef std::list< PlacemarkT > PlacemarkListT ;
 
 	PlacemarkListT m_queues[ nb_categories ];
@@ -1442,23 +1669,17 @@ class  KmlSrvImpl : public KmlServer {
 				}
 
 				// We might have missed the condition signal so a quick check will not do any harm.
-				for( size_t i = 0; i < nb_categories; ++i )
-				{
-					PlacesMapT *ptrMap = m_placemarks.FindCategory( categories[i] );
-					if( ptrMap == NULL ) {
-						LOG_INFO("Category %s undefined", categories[i] );
-						continue;
-					}
-					// TODO: If there are contention problems, internally swap the queue
-					// with a fresh empty one.
-					ptrMap->FlushQueue( m_merge_dist );
-				}
+				FlushQueues();
 				// LOG_INFO("Releasing lock" );
 			}
 			if( r == ETIMEDOUT )
 			{
 				// LOG_INFO("Saving after wait=%d", refresh );
+				// The files mutex must not be held by a cancelled thread.
+				int oldstate ;
+				pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, &oldstate );
 				bool wasSaved = RewriteKmlFileFull();
+				pthread_setcancelstate( oldstate, NULL );
 
 				// Maybe a user process must be created to process these KML files.
 				if(wasSaved) {
@@ -1542,7 +1763,7 @@ public:
 		// This loads placemarks without the subthread, because it is simpler.
 		for( size_t i = 0; i < nb_categories; ++i ) {
 			try {
-				ReloadSingleKmlFile( categories[i] );
+				ReloadCategory( categories[i] );
 			} catch( const std::exception & exc ) {
 				LOG_INFO("Category %s. Caught %s", categories[i], exc.what() );
 			}
@@ -1573,6 +1794,7 @@ public:
 		m_kml_must_leave = false;
 #endif
 		pthread_mutex_init( &m_mutex_write, NULL );
+		pthread_mutex_init( &m_mutex_files, NULL );
 
 		/// TODO: Add this thread to the other fldigi threads stored in cbq[].
 		if( pthread_create( &m_writer_thread, NULL, ThreadFunc, this ) ) {
@@ -1608,18 +1830,15 @@ public:
 		guard_lock myGuard( &m_mutex_write );
 
 		++KmlServer::m_nb_broadcasts;
-		PlacesMapT *ptrMap = m_placemarks.FindCategory( category );
-		if(ptrMap == NULL ) {
-			LOG_ERROR("Category %s undefined", category.c_str());
-		}
-		ptrMap->Enqueue( tmpKmlNam, currPM );
+		CategoryT *ptrCat = m_placemarks.FindCategory( category );
+		ptrCat->Enqueue( tmpKmlNam, currPM );
 #ifdef FLDIGI_KML_CONDITION_VARIABLE
 		pthread_cond_signal( &m_cond_queue );
 #else
 		m_bool_queue = true;
 #endif
 		LOG_INFO("'%s' sz=%d time=%s nb_broad=%d m_merge_dist=%lf",
-			descrTxt.c_str(), (int)ptrMap->size(),
+			descrTxt.c_str(), (int)ptrCat->size(),
 			KmlTimestamp(evtTim).c_str(),
 			KmlServer::m_nb_broadcasts,m_merge_dist );
 	}
@@ -1659,18 +1878,22 @@ public:
 		LOG_INFO("Thread stopped. Message:%s", msg );
 
 		/// Here we are sure that the subthread is stopped. The subprocess is not called.
+		FlushQueues();
 		RewriteKmlFileFull();
 
 #ifdef FLDIGI_KML_CONDITION_VARIABLE
 		pthread_cond_destroy( &m_cond_queue );
 #endif
+		pthread_mutex_destroy( &m_mutex_files );
 		pthread_mutex_destroy( &m_mutex_write );
 	}
 
 	/// Empties the generated files.
 	void Reset(void) {
+		guard_lock myGuard( &m_mutex_write );
+		guard_lock filesGuard( &m_mutex_files );
 		for( size_t i = 0; i < nb_categories; ++i ) {
-			CreateNewKmlFile(categories[i]);
+			m_placemarks.FindCategory( categories[i] )->Reset( m_kml_dir, categories[i], m_refresh_interval );
 		}
 		ResetCounter();
 	}
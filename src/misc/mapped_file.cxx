@@ -0,0 +1,157 @@
+// ----------------------------------------------------------------------------
+// mapped_file.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifndef __WOE32__
+#  include <sys/mman.h>
+#endif
+
+#include "mapped_file.h"
+#include "main.h"
+#include "debug.h"
+
+using namespace std;
+
+mapped_file::mapped_file()
+	: data_(0), size_(0), heap(false)
+{
+}
+
+mapped_file::~mapped_file()
+{
+	close();
+}
+
+bool mapped_file::open(const char* filename)
+{
+	close();
+
+	int fd = ::open(filename, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+	size_t len = st.st_size;
+
+#ifndef __WOE32__
+	void* p = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (p == MAP_FAILED) {
+		LOG_PERROR("mmap");
+		return false;
+	}
+	data_ = static_cast<const char*>(p);
+	heap = false;
+#else
+	char* buf = new char[len];
+	size_t n = 0;
+	ssize_t r;
+	while (n < len && (r = ::read(fd, buf + n, len - n)) > 0)
+		n += r;
+	::close(fd);
+	if (n != len) {
+		delete [] buf;
+		return false;
+	}
+	data_ = buf;
+	heap = true;
+#endif
+	size_ = len;
+
+	return true;
+}
+
+void mapped_file::close(void)
+{
+	if (!data_)
+		return;
+#ifndef __WOE32__
+	if (!heap)
+		munmap(const_cast<char*>(data_), size_);
+	else
+#endif
+		delete [] data_;
+	data_ = 0;
+	size_ = 0;
+}
+
+bool snapshot_stamp_get(const char* filename, snapshot_stamp& stamp)
+{
+	struct stat st;
+	if (stat(filename, &st) == -1)
+		return false;
+	stamp.size = st.st_size;
+	stamp.mtime = st.st_mtime;
+	return true;
+}
+
+// Write to a temporary file and rename it so that a reader never maps a
+// partially written snapshot
+bool snapshot_write(const string& filename, const void* data, size_t len)
+{
+	string tmp(filename);
+	tmp.append(".tmp");
+
+	FILE* f = fopen(tmp.c_str(), "wb");
+	if (!f) {
+		LOG_VERBOSE("Could not write %s", tmp.c_str());
+		return false;
+	}
+	bool ok = fwrite(data, 1, len, f) == len;
+	ok = (fclose(f) == 0) && ok;
+#ifdef __WOE32__
+	if (ok)
+		remove(filename.c_str());
+#endif
+	if (!ok || rename(tmp.c_str(), filename.c_str()) != 0) {
+		remove(tmp.c_str());
+		return false;
+	}
+	return true;
+}
+
+// Snapshots live in the temp directory and are named after their source
+string snapshot_path(const char* source)
+{
+	const char* p = strrchr(source, '/');
+#ifdef __WOE32__
+	const char* q = strrchr(source, '\\');
+	if (q > p)
+		p = q;
+#endif
+	string path(TempDir);
+	path.append(p ? p + 1 : source).append(".bin");
+	return path;
+}
@@ -0,0 +1,186 @@
+// ----------------------------------------------------------------------------
+// replay.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+
+#include "replay.h"
+#include "modem.h"
+#include "trx.h"
+#include "status.h"
+#include "threads.h"
+#include "debug.h"
+
+LOG_FILE_SOURCE(debug::LOG_AUDIO);
+
+using namespace std;
+
+struct replay_state_t
+{
+	trx_mode mode;
+	double freq;
+	bool afc, sql;
+	double sqlevel;
+};
+
+static pthread_mutex_t record_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FILE* record_file = 0;
+static string record_name;
+static replay_state_t recorded;
+static bool record_all;		// write the whole state with the next block
+static bool record_freq;	// the frequency was set by another thread
+
+bool replay_record_start(const char* name)
+{
+	guard_lock record_lock(&record_mutex);
+
+	if (record_file)
+		fclose(record_file);
+	record_name.assign(name).append(".events");
+	if ((record_file = fopen(record_name.c_str(), "w")) == NULL) {
+		LOG_ERROR("Could not write %s: %s", record_name.c_str(), strerror(errno));
+		return false;
+	}
+	fprintf(record_file, "# fldigi %s\n# FRAME KEY VALUE, FRAME in the frames of %s\n",
+		PACKAGE_VERSION, name);
+	record_all = true;
+	record_freq = false;
+
+	return true;
+}
+
+void replay_record_stop(void)
+{
+	guard_lock record_lock(&record_mutex);
+
+	if (!record_file)
+		return;
+	if (fclose(record_file) == EOF)
+		LOG_ERROR("Could not write %s: %s", record_name.c_str(), strerror(errno));
+	record_file = 0;
+}
+
+void replay_freq_changed(void)
+{
+	if (GET_THREAD_ID() == TRX_TID)
+		return;
+	guard_lock record_lock(&record_mutex);
+	record_freq = true;
+}
+
+void replay_record(long long frame)
+{
+	if (!record_file || !active_modem)
+		return;
+
+	replay_state_t s;
+	s.mode = active_modem->get_mode();
+	s.freq = active_modem->get_freq();
+	s.afc = progStatus.afconoff;
+	s.sql = progStatus.sqlonoff;
+	s.sqlevel = progStatus.sldrSquelchValue;
+
+	guard_lock record_lock(&record_mutex);
+	if (!record_file)
+		return;
+
+	bool all = record_all, wrote = false;
+	if (all || s.mode != recorded.mode) {
+		fprintf(record_file, "%lld mode %s\n", frame, mode_info[s.mode].sname);
+		// the new modem has its own frequency
+		record_freq = true;
+		wrote = true;
+	}
+	if (record_freq) {
+		fprintf(record_file, "%lld freq %.17g\n", frame, s.freq);
+		wrote = true;
+	}
+	if (all || s.afc != recorded.afc) {
+		fprintf(record_file, "%lld afc %d\n", frame, s.afc);
+		wrote = true;
+	}
+	if (all || s.sql != recorded.sql) {
+		fprintf(record_file, "%lld sql %d\n", frame, s.sql);
+		wrote = true;
+	}
+	if (all || s.sqlevel != recorded.sqlevel) {
+		fprintf(record_file, "%lld sqlevel %.17g\n", frame, s.sqlevel);
+		wrote = true;
+	}
+	record_all = record_freq = false;
+	recorded = s;
+
+	// a session that ends badly is the one to replay
+	if (wrote && fflush(record_file) == EOF) {
+		LOG_ERROR("Could not write %s: %s", record_name.c_str(), strerror(errno));
+		fclose(record_file);
+		record_file = 0;
+	}
+}
+
+static bool replay_frame_order(const replay_event& a, const replay_event& b)
+{
+	return a.frame < b.frame;
+}
+
+bool replay_load(const char* name, vector<replay_event>& events)
+{
+	string fname(name);
+	fname.append(".events");
+	FILE* f = fopen(fname.c_str(), "r");
+	if (!f) {
+		LOG_ERROR("Could not read %s: %s", fname.c_str(), strerror(errno));
+		return false;
+	}
+
+	events.clear();
+	char line[256];
+	for (unsigned n = 1; fgets(line, sizeof(line), f); n++) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (*line == '\0' || *line == '#')
+			continue;
+
+		replay_event e;
+		char key[32];
+		int value;
+		if (sscanf(line, "%lld %31s %n", &e.frame, key, &value) != 2 ||
+		    e.frame < 0 || line[value] == '\0') {
+			LOG_ERROR("%s:%u: bad event \"%s\"", fname.c_str(), n, line);
+			fclose(f);
+			return false;
+		}
+		e.key = key;
+		e.value = line + value;
+		events.push_back(e);
+	}
+	fclose(f);
+
+	stable_sort(events.begin(), events.end(), replay_frame_order);
+	return true;
+}
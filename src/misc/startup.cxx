@@ -0,0 +1,197 @@
+// ----------------------------------------------------------------------------
+// startup.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include <FL/Fl.H>
+
+#include "startup.h"
+#include "threads.h"
+#include "timeops.h"
+#include "debug.h"
+
+using namespace std;
+
+struct startup_phase_t {
+	string name;
+	bool background;
+	double start; // ms since the first mark
+	double end;
+};
+
+struct startup_job_t {
+	string name;
+	void (*job)(void);
+	void (*done)(void);
+	pthread_t thread;
+	bool joined;
+	size_t phase;
+};
+
+static pthread_mutex_t startup_mutex = PTHREAD_MUTEX_INITIALIZER;
+static vector<startup_phase_t> phases;
+static vector<startup_job_t*> jobs;
+static struct timespec t_start;
+static double t_last;
+static size_t jobs_pending;
+static bool main_done;
+static bool reported;
+
+static double startup_now(void)
+{
+#ifdef _POSIX_MONOTONIC_CLOCK
+	static const clockid_t clk = CLOCK_MONOTONIC;
+#else
+	static const clockid_t clk = CLOCK_REALTIME;
+#endif
+	struct timespec t;
+	clock_gettime(clk, &t);
+	if (t_start.tv_sec == 0 && t_start.tv_nsec == 0)
+		t_start = t;
+	t -= t_start;
+	return t.tv_sec * 1e3 + t.tv_nsec / 1e6;
+}
+
+void startup_mark(const char* phase)
+{
+	guard_lock lock(&startup_mutex);
+
+	startup_phase_t p;
+	p.name = phase;
+	p.background = false;
+	p.start = t_last;
+	p.end = t_last = startup_now();
+	phases.push_back(p);
+}
+
+static void startup_job_done(void* arg);
+
+static void* startup_job_loop(void* arg)
+{
+	startup_job_t* j = static_cast<startup_job_t*>(arg);
+
+	j->job();
+
+	{
+		guard_lock lock(&startup_mutex);
+		phases[j->phase].end = startup_now();
+	}
+	Fl::awake(startup_job_done, j);
+
+	return NULL;
+}
+
+// called from the FLTK thread when a job has finished
+static void startup_job_done(void* arg)
+{
+	startup_job_t* j = static_cast<startup_job_t*>(arg);
+	if (j->done)
+		j->done();
+
+	bool report;
+	{
+		guard_lock lock(&startup_mutex);
+		report = --jobs_pending == 0 && main_done;
+	}
+	if (report)
+		startup_report();
+}
+
+void startup_job(const char* name, void (*job)(void), void (*done)(void))
+{
+	startup_job_t* j = new startup_job_t;
+	j->name = name;
+	j->job = job;
+	j->done = done;
+	j->joined = false;
+
+	{
+		guard_lock lock(&startup_mutex);
+		startup_phase_t p;
+		p.name = name;
+		p.background = true;
+		p.start = p.end = startup_now();
+		j->phase = phases.size();
+		phases.push_back(p);
+		jobs.push_back(j);
+		jobs_pending++;
+	}
+
+	int rc = pthread_create(&j->thread, NULL, startup_job_loop, j);
+	if (rc != 0) {
+		LOG_ERROR("pthread_create: %s", strerror(rc));
+		j->joined = true;
+		job();
+		{
+			guard_lock lock(&startup_mutex);
+			phases[j->phase].end = startup_now();
+		}
+		startup_job_done(j);
+	}
+}
+
+void startup_wait(void)
+{
+	for (size_t i = 0; i < jobs.size(); i++) {
+		if (!jobs[i]->joined) {
+			pthread_join(jobs[i]->thread, NULL);
+			jobs[i]->joined = true;
+		}
+	}
+}
+
+void startup_report(void)
+{
+	bool report;
+	{
+		guard_lock lock(&startup_mutex);
+		if (!main_done) {
+			main_done = true;
+			startup_phase_t p;
+			p.name = "main window";
+			p.background = false;
+			p.start = t_last;
+			p.end = t_last = startup_now();
+			phases.push_back(p);
+		}
+		report = jobs_pending == 0 && !reported;
+		if (report)
+			reported = true;
+	}
+	if (!report)
+		return;
+
+	double total = 0.0;
+	for (size_t i = 0; i < phases.size(); i++) {
+		const startup_phase_t& p = phases[i];
+		LOG_INFO("startup: %-12s %-20s %8.1f ms  [%8.1f - %8.1f]",
+			 p.background ? "background" : "main", p.name.c_str(),
+			 p.end - p.start, p.start, p.end);
+		if (p.end > total)
+			total = p.end;
+	}
+	LOG_INFO("startup: main window after %.1f ms, all data loaded after %.1f ms", t_last, total);
+}
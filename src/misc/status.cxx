@@ -101,6 +101,7 @@ status progStatus = {
 	400,				// uint VIEDWERheight
 	3.0,				// double VIEWER_psksquelch
 	-6.0,				// double VIEWER_rttysquelch
+	12.0,				// double VIEWER_cwsquelch
 	false,				// bool VIEWERvisible
 	100,				// int		tile_x
 	200,				// int		tile_w;
@@ -364,6 +365,7 @@ if (!bWF_only) {
 	spref.set("viewer_h", static_cast<int>(VIEWERheight));
 	spref.set("viewer_psksq", VIEWER_psksquelch);
 	spref.set("viewer_rttysq", VIEWER_rttysquelch);
+	spref.set("viewer_cwsq", VIEWER_cwsquelch);
 	spref.set("viewer_nchars", static_cast<int>(VIEWERnchars));
 
 	spref.set("tile_x", tile_x);
@@ -559,6 +561,7 @@ void status::loadLastState()
 	spref.get("viewer_h", i, VIEWERheight); VIEWERheight = i;
 	spref.get("viewer_psksq", VIEWER_psksquelch, VIEWER_psksquelch);
 	spref.get("viewer_rttysq", VIEWER_rttysquelch, VIEWER_rttysquelch);
+	spref.get("viewer_cwsq", VIEWER_cwsquelch, VIEWER_cwsquelch);
 	spref.get("viewer_nchars", i, VIEWERnchars); VIEWERnchars = i;
 
 
@@ -738,6 +741,17 @@ void status::initLastState()
 		}
 	}
 
+	if (lastmode == MODE_CW) {
+		if (mvsquelch) {
+			mvsquelch->range(6.0, 30.0);
+			mvsquelch->value(VIEWER_cwsquelch);
+		}
+		if (sldrViewerSquelch) {
+			sldrViewerSquelch->range(6.0, 30.0);
+			sldrViewerSquelch->value(VIEWER_cwsquelch);
+		}
+	}
+
 // OLIVIA
 	if (lastmode == MODE_OLIVIA) {
 		i_listbox_olivia_tones->index(progdefaults.oliviatones = oliviatones);
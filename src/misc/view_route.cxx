@@ -0,0 +1,354 @@
+// ----------------------------------------------------------------------------
+// view_route.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+
+#include "view_route.h"
+#include "configuration.h"
+#include "socket.h"
+#include "threads.h"
+#include "debug.h"
+
+LOG_FILE_SOURCE(debug::LOG_SPOTTER);
+
+using namespace std;
+
+#define VIEW_ROUTE_QUEUE	256		// lines the decoders may be ahead of the router
+#define VIEW_CLIENT_BACKLOG	(64 * 1024)	// bytes queued for a client before it drops lines
+
+// ---------------------------------------------------------------------------
+// Line assembly, in the trx thread
+// ---------------------------------------------------------------------------
+
+struct view_partial_t
+{
+	view_partial_t() : snr_sum(0.0) { line.eol = false; }
+	view_line_t line;
+	double snr_sum;
+};
+
+// Only the trx thread touches the partial lines
+static map<int, view_partial_t> view_partial;
+
+static pthread_mutex_t route_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t route_cond = PTHREAD_COND_INITIALIZER;
+static bool route_active = false;	// read without the lock by the decoders
+static bool route_exit = false;
+static deque<view_line_t> route_queue;
+static unsigned route_dropped = 0;
+
+static void view_route_end(view_partial_t& p)
+{
+	view_line_t& line = p.line;
+	if (line.text.empty() && !line.eol)
+		return;
+	line.snr = line.text.empty() ? 0.0 : p.snr_sum / line.text.length();
+
+	if (route_active) {
+		guard_lock route_lock(&route_mutex);
+		if (route_queue.size() == VIEW_ROUTE_QUEUE) {
+			route_queue.pop_front();
+			route_dropped++;
+		}
+		route_queue.push_back(line);
+		pthread_cond_signal(&route_cond);
+	}
+	line.text.clear();
+	line.eol = false;
+}
+
+void view_route_chr(int channel, int afreq, int c, trx_mode mode, double snr)
+{
+	if (!route_active || c == 0)
+		return;
+
+	view_partial_t& p = view_partial[channel];
+	view_line_t& line = p.line;
+	if (!line.text.empty() && line.mode != mode)
+		view_route_end(p);
+
+	if (line.text.empty()) {
+		gettimeofday(&line.time, NULL);
+		line.channel = channel;
+		line.mode = mode;
+		p.snr_sum = 0.0;
+		if (line.text.capacity() < VIEW_ROUTE_LINE_MAX)
+			line.text.reserve(VIEW_ROUTE_LINE_MAX);
+	}
+	line.afreq = afreq;
+	if (c == '\n' || c == '\r') {
+		line.eol = true;
+		view_route_end(p);
+		return;
+	}
+	line.text += (c == '\t' ? ' ' : (char)c);
+	p.snr_sum += snr;
+
+	size_t n = line.text.length();
+	if (n >= VIEW_ROUTE_LINE_MAX || (n >= VIEW_ROUTE_LINE_BREAK && c == ' '))
+		view_route_end(p);
+}
+
+void view_route_clear(int channel)
+{
+	map<int, view_partial_t>::iterator i = view_partial.find(channel);
+	if (i != view_partial.end())
+		view_route_end(i->second);
+}
+
+// ---------------------------------------------------------------------------
+// Subscribers
+// ---------------------------------------------------------------------------
+
+struct view_subscriber_t
+{
+	view_route_cb_t cb;
+	void* data;
+};
+
+static pthread_mutex_t subscriber_mutex = PTHREAD_MUTEX_INITIALIZER;
+static vector<view_subscriber_t> subscribers;
+
+void view_route_subscribe(view_route_cb_t cb, void* data)
+{
+	guard_lock subscriber_lock(&subscriber_mutex);
+	view_subscriber_t s = { cb, data };
+	subscribers.push_back(s);
+}
+
+void view_route_unsubscribe(view_route_cb_t cb, const void* data)
+{
+	guard_lock subscriber_lock(&subscriber_mutex);
+	for (vector<view_subscriber_t>::iterator i = subscribers.begin(); i != subscribers.end(); ++i) {
+		if (i->cb == cb && i->data == data) {
+			subscribers.erase(i);
+			break;
+		}
+	}
+}
+
+static void view_route_deliver(const vector<view_line_t>& lines)
+{
+	guard_lock subscriber_lock(&subscriber_mutex);
+	for (size_t i = 0; i < subscribers.size(); i++)
+		for (size_t j = 0; j < lines.size(); j++)
+			subscribers[i].cb(lines[j], subscribers[i].data);
+}
+
+string view_route_format(const view_line_t& line)
+{
+	struct tm tm;
+	time_t t = line.time.tv_sec;
+	gmtime_r(&t, &tm);
+	char buf[128];
+	size_t n = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+	snprintf(buf + n, sizeof(buf) - n, ".%03dZ\t%d\t%d\t%s\t%.1f\t",
+		 (int)(line.time.tv_usec / 1000), line.channel, line.afreq,
+		 line.mode < NUM_MODES ? mode_info[line.mode].sname : "", line.snr);
+
+	string s(buf);
+	s.append(line.text).append(1, '\n');
+	return s;
+}
+
+// ---------------------------------------------------------------------------
+// Text log and socket clients, in the routing thread
+// ---------------------------------------------------------------------------
+
+struct view_client
+{
+	Socket sock;
+	string pending;
+	size_t sent;
+	view_client(const Socket& s) : sock(s), sent(0) { }
+};
+
+static pthread_t route_thread;
+static Socket* route_server = 0;
+static vector<view_client*> route_clients;
+static FILE* route_log = 0;
+
+static void view_route_accept(void)
+{
+	try {
+		while (route_server->wait(0)) {
+			view_client* c = new view_client(route_server->accept());
+			c->sock.set_nonblocking();
+			c->sock.set_close_on_exec(true);
+			route_clients.push_back(c);
+			LOG_INFO("Browser text client %d", c->sock.fd());
+		}
+	}
+	catch (const SocketException& e) {
+		LOG_ERROR("%s", e.what());
+	}
+}
+
+// Sends what the socket will take without blocking.  Returns false if the
+// client is gone.
+static bool view_route_flush(view_client* c)
+{
+	while (c->sent < c->pending.size()) {
+		ssize_t r = ::send(c->sock.fd(), c->pending.data() + c->sent,
+				 c->pending.size() - c->sent, 0);
+		if (r > 0) {
+			c->sent += r;
+			continue;
+		}
+		if (r == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+			return true;
+		LOG_INFO("Browser text client %d closed", c->sock.fd());
+		return false;
+	}
+	c->pending.clear();
+	c->sent = 0;
+	return true;
+}
+
+static void* view_route_loop(void*)
+{
+	SET_THREAD_ID(VIEWROUTE_TID);
+
+	vector<view_line_t> lines;
+	for (;;) {
+		unsigned dropped;
+		{
+			guard_lock route_lock(&route_mutex);
+			if (route_queue.empty() && !route_exit)
+				pthread_cond_timedwait_rel(&route_cond, &route_mutex, 0.2);
+			if (route_exit)
+				break;
+			lines.assign(route_queue.begin(), route_queue.end());
+			route_queue.clear();
+			dropped = route_dropped;
+			route_dropped = 0;
+		}
+		if (dropped)
+			LOG_WARN("Dropped %u browser line(s)", dropped);
+
+		if (route_server)
+			view_route_accept();
+
+		string text;
+		for (size_t i = 0; i < lines.size(); i++)
+			if (!lines[i].text.empty())
+				text += view_route_format(lines[i]);
+
+		if (route_log && !text.empty()) {
+			if (fwrite(text.data(), text.length(), 1, route_log) != 1 || fflush(route_log) == EOF) {
+				LOG_ERROR("Could not write %s: %s", progdefaults.ViewLog.c_str(), strerror(errno));
+				fclose(route_log);
+				route_log = 0;
+			}
+		}
+		for (size_t i = 0; i < route_clients.size(); i++) {
+			view_client* c = route_clients[i];
+			// a client that cannot keep up misses lines
+			if (c->pending.size() < VIEW_CLIENT_BACKLOG)
+				c->pending.append(text);
+			if (!view_route_flush(c)) {
+				delete c;
+				route_clients.erase(route_clients.begin() + i--);
+			}
+		}
+
+		if (!lines.empty())
+			view_route_deliver(lines);
+	}
+
+	for (size_t i = 0; i < route_clients.size(); i++)
+		delete route_clients[i];
+	route_clients.clear();
+	if (route_log) {
+		fclose(route_log);
+		route_log = 0;
+	}
+
+	return NULL;
+}
+
+void view_route_start(void)
+{
+	if (route_active)
+		return;
+
+	if (!progdefaults.ViewLog.empty()) {
+		if ((route_log = fopen(progdefaults.ViewLog.c_str(), "a")) == NULL)
+			LOG_ERROR("Could not open %s: %s", progdefaults.ViewLog.c_str(), strerror(errno));
+	}
+
+	if (!progdefaults.ViewStreamPort.empty()) {
+		try {
+			route_server = new Socket(Address(progdefaults.ViewStreamAddress.c_str(),
+							  progdefaults.ViewStreamPort.c_str()));
+			route_server->bind();
+			route_server->listen();
+			route_server->set_timeout(0.0);
+		}
+		catch (const SocketException& e) {
+			LOG_ERROR("Could not start browser text server (%s)", e.what());
+			delete route_server;
+			route_server = 0;
+		}
+	}
+
+	route_exit = false;
+	int rc = pthread_create(&route_thread, NULL, view_route_loop, NULL);
+	if (rc != 0) {
+		LOG_ERROR("pthread_create: %s", strerror(rc));
+		delete route_server;
+		route_server = 0;
+		if (route_log) {
+			fclose(route_log);
+			route_log = 0;
+		}
+		return;
+	}
+	route_active = true;
+}
+
+void view_route_stop(void)
+{
+	if (!route_active)
+		return;
+
+	{
+		guard_lock route_lock(&route_mutex);
+		route_active = false;
+		route_exit = true;
+		pthread_cond_signal(&route_cond);
+	}
+	pthread_join(route_thread, NULL);
+
+	delete route_server;
+	route_server = 0;
+}
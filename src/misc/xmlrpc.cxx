@@ -38,12 +38,16 @@
 #include <vector>
 #include <list>
 #include <map>
+#include <set>
 #include <exception>
 #include <cstdlib>
 
 #include <signal.h>
 
+#include <FL/Fl.H>
+
 #include <xmlrpcpp/XmlRpcServer.h>
+#include <xmlrpcpp/XmlRpcServerConnection.h>
 #include <xmlrpcpp/XmlRpcServerMethod.h>
 #include <xmlrpcpp/XmlRpcValue.h>
 
@@ -73,6 +77,8 @@
 #include "debug.h"
 #include "re.h"
 #include "pskrep.h"
+#include "rxlatency.h"
+#include "logsupport.h"
 
 // required for flrig support
 #include "fl_digi.h"
@@ -92,6 +98,50 @@ using namespace XmlRpc;
 #define DBL_MAX 1.7976931348623157e+308
 #endif
 
+// =============================================================================
+// Read-only state that the GUI thread publishes a few times per second.
+// The most frequently polled queries are answered from a copy of it, without
+// waiting for the methods that are busy with the GUI.
+
+struct xmlrpc_state_t
+{
+	bool valid; // cleared by any method that may change the state
+	int mode;
+	int carrier;
+	double rfcarrier;
+	int trx_state;
+	bool tune;
+	bool xmtrcv;
+	bool squelch;
+	double squelch_level;
+	bool afc;
+	bool reverse;
+	bool lock;
+	bool usb;
+	bool txid;
+	bool rsid;
+};
+
+#define XMLRPC_STATE_INTERVAL 0.1
+
+static xmlrpc_state_t xmlrpc_state;
+static unsigned xmlrpc_state_gen;
+static pthread_mutex_t xmlrpc_state_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool xmlrpc_state_get(xmlrpc_state_t& st)
+{
+	guard_lock lock(&xmlrpc_state_mutex);
+	st = xmlrpc_state;
+	return st.valid;
+}
+
+static void xmlrpc_state_invalidate(void)
+{
+	guard_lock lock(&xmlrpc_state_mutex);
+	xmlrpc_state.valid = false;
+	xmlrpc_state_gen++;
+}
+
 namespace xmlrpc_c
 {
 	struct method
@@ -101,6 +151,8 @@ namespace xmlrpc_c
 		virtual std::string help(void) const { return _help;}
 		const char * signature() const { return _signature; }
 		virtual ~method() {}
+		/// Methods that can be answered from the published state override this.
+		bool execute_fast(const xmlrpc_state_t&, XmlRpcValue*) { return false; }
 	};
 
 	typedef method * methodPtr ;
@@ -147,6 +199,11 @@ namespace xmlrpc_c
 		}
 		bool getBoolean(int i) const { return _params[i]; }
 		const std::vector<value> & getArray(int i) const { return _params[i]; }
+		std::map<std::string, value> getStruct(int i) const
+		{
+			value tmp = _params[i];
+			return static_cast<const value::ValueStruct&>(tmp);
+		}
 		void verifyEnd(size_t sz) const
 		{
 			const std::vector<value> & tmpRef = _params ;
@@ -156,17 +213,29 @@ namespace xmlrpc_c
 
 }
 
+static pthread_mutex_t* server_mutex;
+
 template< class RPC_METHOD >
 struct Method : public RPC_METHOD, public XmlRpcServerMethod
 {
 	Method( const char * n )
-	: XmlRpcServerMethod( n ) {}
+	: XmlRpcServerMethod( n ), readonly( strstr(n, ".get_") != NULL ) {}
 
+	/// Called from the connection threads. Methods that cannot use the
+	/// published state serialise themselves with XMLRPC_LOCK.
 	void execute (XmlRpcValue &params, XmlRpcValue &result)
 	{
+		xmlrpc_state_t st;
+		if (xmlrpc_state_get(st) && RPC_METHOD::execute_fast(st, &result))
+			return;
+
 		xmlrpc_c::paramList params2(params) ;
 		RPC_METHOD::execute( params2, &result );
+		if (!readonly)
+			xmlrpc_state_invalidate();
 	}
+
+	bool readonly;
 };
 
 typedef XmlRpcServerMethod * (*RpcFactory)( const char * );
@@ -180,6 +249,31 @@ struct RpcBuilder
 	}
 };
 
+// Each client connection is served by its own thread, so that a method waiting
+// on the GUI does not hold up the other clients. Connections beyond this number
+// are served by the thread that accepts them.
+#define XMLRPC_MAX_CONNECTIONS 16
+
+static pthread_mutex_t connection_mutex = PTHREAD_MUTEX_INITIALIZER;
+static set<XmlRpcServerConnection*> connections;
+static volatile bool server_stopping = false;
+
+static void* connection_thread(void* arg)
+{
+	SET_THREAD_ID(XMLRPC_TID);
+	save_signals();
+
+	XmlRpcDispatch disp;
+	disp.addSource(static_cast<XmlRpcServerConnection*>(arg), XmlRpcDispatch::ReadableEvent);
+	// The connection removes itself when the client closes it
+	while (!disp.empty() && !server_stopping)
+		disp.work(1.0);
+	disp.clear();
+
+	restore_signals();
+	return NULL;
+}
+
 struct XmlRpcImpl : public XmlRpcServer
 {
 	void open(const char * port)
@@ -198,9 +292,39 @@ struct XmlRpcImpl : public XmlRpcServer
 	void close()
 	{
 		LOG_INFO("Stopping XML-RPC server");
+		server_stopping = true;
 		exit();
 		shutdown();
 	}
+
+	void dispatchConnection(XmlRpcServerConnection* sc)
+	{
+		{
+			guard_lock lock(&connection_mutex);
+			if (connections.size() < XMLRPC_MAX_CONNECTIONS) {
+				connections.insert(sc);
+				pthread_t t;
+				int rc = pthread_create(&t, NULL, connection_thread, sc);
+				if (rc == 0) {
+					pthread_detach(t);
+					return;
+				}
+				LOG_ERROR("pthread_create: %s", strerror(rc));
+				connections.erase(sc);
+			}
+		}
+		XmlRpcServer::dispatchConnection(sc);
+	}
+	/// Called from the thread of the connection when it is closed.
+	void removeConnection(XmlRpcServerConnection* sc)
+	{
+		{
+			guard_lock lock(&connection_mutex);
+			if (connections.erase(sc))
+				return;
+		}
+		XmlRpcServer::removeConnection(sc);
+	}
 };
 
 struct rpc_method
@@ -214,10 +338,11 @@ typedef list<rpc_method> methods_t;
 static methods_t* methods = 0;
 
 static pthread_t* server_thread;
-static pthread_mutex_t* server_mutex;
 
 XML_RPC_Server* XML_RPC_Server::inst = 0;
 
+static void xmlrpc_state_publish(void*);
+
 XML_RPC_Server::XML_RPC_Server()
 {
 	server_impl = new XmlRpcImpl;
@@ -255,6 +380,7 @@ void XML_RPC_Server::start(const char* node, const char* service)
 		inst->server_impl->open(service);
 		if (pthread_create(server_thread, NULL, thread_func, NULL) != 0)
 			throw runtime_error(strerror(errno));
+		Fl::add_timeout(XMLRPC_STATE_INTERVAL, xmlrpc_state_publish);
 	}
 	catch (const exception& e) {
 		LOG_ERROR("Could not start XML-RPC server (%s)", e.what());
@@ -305,6 +431,52 @@ ostream& XML_RPC_Server::list_methods(ostream& out)
 // Methods that change the server state must call XMLRPC_LOCK
 // guard_lock (include/threads.h) ensures that mutex are always unlocked.
 #define XMLRPC_LOCK SET_THREAD_ID(XMLRPC_TID); guard_lock autolock_(server_mutex)
+// Requests that wait on the GUI thread release the lock while they wait, so
+// that the other connections are not held up by a busy GUI.
+#define XMLRPC_REQ_SYNC(...)					\
+	do {							\
+		pthread_mutex_unlock(server_mutex);		\
+		REQ_SYNC(__VA_ARGS__);				\
+		pthread_mutex_lock(server_mutex);		\
+	} while (0)
+
+// =============================================================================
+
+// called from the FLTK thread
+static void xmlrpc_state_publish(void*)
+{
+	unsigned gen;
+	{
+		guard_lock lock(&xmlrpc_state_mutex);
+		gen = xmlrpc_state_gen;
+	}
+
+	xmlrpc_state_t st;
+	st.mode = active_modem->get_mode();
+	st.carrier = active_modem->get_freq();
+	st.rfcarrier = wf->rfcarrier();
+	st.trx_state = trx_state;
+	st.tune = btnTune->value();
+	st.xmtrcv = wf->xmtrcv->value();
+	st.squelch = btnSQL->value();
+	st.squelch_level = sldrSquelch->value();
+	st.afc = btnAFC->value();
+	st.reverse = wf->btnRev->value();
+	st.lock = wf->xmtlock->value();
+	st.usb = wf->USB();
+	st.txid = btnTxRSID->value();
+	st.rsid = btnRSID->value();
+
+	{
+		guard_lock lock(&xmlrpc_state_mutex);
+		// a method changed something while the widgets were read
+		st.valid = gen == xmlrpc_state_gen;
+		xmlrpc_state = st;
+	}
+
+	if (!server_stopping)
+		Fl::repeat_timeout(XMLRPC_STATE_INTERVAL, xmlrpc_state_publish);
+}
 
 // =============================================================================
 
@@ -525,6 +697,11 @@ public:
 		const char* cur = mode_info[active_modem->get_mode()].sname;
 		*retval = xmlrpc_c::value_string(cur);
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_string(mode_info[st.mode].sname);
+		return true;
+	}
 };
 
 class Modem_get_names : public xmlrpc_c::method
@@ -558,6 +735,11 @@ public:
 		int md = active_modem->get_mode();
 		*retval = xmlrpc_c::value_int(md);
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_int(st.mode);
+		return true;
+	}
 };
 
 class Modem_get_max_id : public xmlrpc_c::method
@@ -590,7 +772,7 @@ public:
 		string s = params.getString(0);
 		for (size_t i = 0; i < NUM_MODES; i++) {
 			if (s == mode_info[i].sname) {
-				REQ_SYNC(init_modem_sync, i, 0);
+				XMLRPC_REQ_SYNC(init_modem_sync, i, 0);
 				*retval = xmlrpc_c::value_string(cur);
 				return;
 			}
@@ -614,7 +796,7 @@ public:
 		int cur = active_modem->get_mode();
 
 		int i = params.getInt(0, 0, NUM_MODES-1);
-		REQ_SYNC(init_modem_sync, i, 0);
+		XMLRPC_REQ_SYNC(init_modem_sync, i, 0);
 
 		*retval = xmlrpc_c::value_int(cur);
 	}
@@ -668,6 +850,11 @@ public:
 	{
 		*retval = xmlrpc_c::value_int(active_modem->get_freq());
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_int(st.carrier);
+		return true;
+	}
 };
 
 // =============================================================================
@@ -871,7 +1058,7 @@ public:
 			case 125: case 250: case 500: case 1000: case 2000:
 			{
 				XMLRPC_LOCK;
-				REQ_SYNC(set_olivia_bw, bw);
+				XMLRPC_REQ_SYNC(set_olivia_bw, bw);
 				*retval = xmlrpc_c::value_nil();
 			}
 				break;
@@ -921,7 +1108,7 @@ public:
 		int tones = params.getInt(0, 2, 256);
 		if (powerof2(tones)) {
 			XMLRPC_LOCK;
-			REQ_SYNC(set_olivia_tones, tones);
+			XMLRPC_REQ_SYNC(set_olivia_tones, tones);
 			*retval = xmlrpc_c::value_nil();
 		}
 		else
@@ -985,6 +1172,11 @@ public:
 	{
 		*retval = xmlrpc_c::value_string(wf->USB() ? "USB" : "LSB");
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_string(st.usb ? "USB" : "LSB");
+		return true;
+	}
 };
 
 class Main_set_sb : public xmlrpc_c::method
@@ -1029,6 +1221,11 @@ public:
 	{
 		*retval = xmlrpc_c::value_string(wf->USB() ? "USB" : "LSB");
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_string(st.usb ? "USB" : "LSB");
+		return true;
+	}
 };
 
 class Main_set_wf_sideband : public xmlrpc_c::method
@@ -1066,6 +1263,11 @@ public:
 		double rfc = wf->rfcarrier();
 		*retval = xmlrpc_c::value_double(rfc);
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_double(st.rfcarrier);
+		return true;
+	}
 };
 
 void xmlrpc_set_qsy(long long rfc)
@@ -1123,6 +1325,11 @@ public:
 	{
 		*retval = xmlrpc_c::value_boolean(btnAFC->value());
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_boolean(st.afc);
+		return true;
+	}
 };
 
 class Main_set_afc : public xmlrpc_c::method
@@ -1173,6 +1380,11 @@ public:
 	{
 		*retval = xmlrpc_c::value_boolean(btnSQL->value());
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_boolean(st.squelch);
+		return true;
+	}
 };
 
 class Main_set_sql : public xmlrpc_c::method
@@ -1223,6 +1435,11 @@ public:
 	{
 		*retval = xmlrpc_c::value_double(sldrSquelch->value());
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_double(st.squelch_level);
+		return true;
+	}
 };
 
 class Main_set_sql_level : public xmlrpc_c::method
@@ -1273,6 +1490,11 @@ public:
 	{
 		*retval = xmlrpc_c::value_boolean(wf->btnRev->value());
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_boolean(st.reverse);
+		return true;
+	}
 };
 
 class Main_set_rev : public xmlrpc_c::method
@@ -1323,6 +1545,11 @@ public:
 	{
 		*retval = xmlrpc_c::value_boolean(wf->xmtlock->value());
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_boolean(st.lock);
+		return true;
+	}
 };
 
 class Main_set_lock : public xmlrpc_c::method
@@ -1372,6 +1599,11 @@ public:
 	{
 		*retval = xmlrpc_c::value_boolean(btnTxRSID->value());
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_boolean(st.txid);
+		return true;
+	}
 };
 
 class Main_set_txid : public xmlrpc_c::method
@@ -1420,6 +1652,11 @@ public:
 	{
 		*retval = xmlrpc_c::value_boolean(btnRSID->value());
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_boolean(st.rsid);
+		return true;
+	}
 };
 
 class Main_set_rsid : public xmlrpc_c::method
@@ -1475,6 +1712,16 @@ public:
 		else
 			*retval = xmlrpc_c::value_string("rx");
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		if (st.tune)
+			*retval = xmlrpc_c::value_string("tune");
+		else if (st.xmtrcv)
+			*retval = xmlrpc_c::value_string("tx");
+		else
+			*retval = xmlrpc_c::value_string("rx");
+		return true;
+	}
 };
 
 class Main_tx : public xmlrpc_c::method
@@ -1657,6 +1904,16 @@ public:
 		else
 			*retval = xmlrpc_c::value_string("OTHER");
 	}
+	bool execute_fast(const xmlrpc_state_t& st, xmlrpc_c::value* retval)
+	{
+		if (st.trx_state == STATE_TX || st.trx_state == STATE_TUNE)
+			*retval = xmlrpc_c::value_string("TX");
+		else if (st.trx_state == STATE_RX)
+			*retval = xmlrpc_c::value_string("RX");
+		else
+			*retval = xmlrpc_c::value_string("OTHER");
+		return true;
+	}
 };
 
 
@@ -2053,7 +2310,7 @@ public:
 		for (vector<xmlrpc_c::value>::const_iterator i = v.begin(); i != v.end(); ++i)
 			modes.push_back(static_cast<string>(xmlrpc_c::value_string(*i)));
 
-		REQ_SYNC(set_combo_contents, qso_opMODE, &modes);
+		XMLRPC_REQ_SYNC(set_combo_contents, qso_opMODE, &modes);
 
 		*retval = xmlrpc_c::value_nil();
 	}
@@ -2087,7 +2344,7 @@ public:
 	{
 		XMLRPC_LOCK;
 		vector<xmlrpc_c::value> modes;
-		REQ_SYNC(get_combo_contents, qso_opMODE, &modes);
+		XMLRPC_REQ_SYNC(get_combo_contents, qso_opMODE, &modes);
 
 		*retval = xmlrpc_c::value_array(modes);
 	}
@@ -2126,7 +2383,7 @@ public:
 		for (vector<xmlrpc_c::value>::const_iterator i = v.begin(); i != v.end(); ++i)
 			bws.push_back(static_cast<string>(xmlrpc_c::value_string(*i)));
 
-		REQ_SYNC(set_combo_contents, qso_opBW, &bws);
+		XMLRPC_REQ_SYNC(set_combo_contents, qso_opBW, &bws);
 
 		*retval = xmlrpc_c::value_nil();
 	}
@@ -2160,7 +2417,7 @@ public:
 	{
 		XMLRPC_LOCK;
 		vector<xmlrpc_c::value> bws;
-		REQ_SYNC(get_combo_contents, qso_opBW, &bws);
+		XMLRPC_REQ_SYNC(get_combo_contents, qso_opBW, &bws);
 
 		*retval = xmlrpc_c::value_array(bws);
 	}
@@ -2267,6 +2524,8 @@ public:
 	void execute(const xmlrpc_c::paramList& params, xmlrpc_c::value* retval)
 	{
 		XMLRPC_LOCK;
+		// holds the lock so that the enable and disable requests
+		// reach the GUI in the order of the counter updates
 		if (++rig_control_counter == 1)
 			REQ_SYNC(set_rig_control, true);
 		*retval = xmlrpc_c::value_nil();
@@ -2753,6 +3012,145 @@ public:
 	}
 };
 
+// Copies the records out of qsodb, so it runs in the main thread, which
+// owns the log.  The index answers worked and status queries from any
+// thread under its own lock.
+static void log_find(const qso_query* q, size_t max, vector<cQsoRec>* recs)
+{
+	vector<int> found;
+	qsodb.index().find(*q, found, max);
+	for (size_t i = 0; i < found.size(); i++)
+		recs->push_back(qsodb.recarray()[found[i]]);
+}
+
+static xmlrpc_c::value log_qso_struct(const cQsoRec& r)
+{
+	static const struct { const char* name; int field; } fields[] = {
+		{ "call", CALL }, { "date", QSO_DATE }, { "time_on", TIME_ON },
+		{ "frequency", FREQ }, { "band", BAND }, { "mode", MODE },
+		{ "name", NAME }, { "qth", QTH }, { "state", STATE },
+		{ "country", COUNTRY }, { "locator", GRIDSQUARE }
+	};
+	map<string, xmlrpc_c::value> qso;
+	for (size_t i = 0; i < sizeof(fields) / sizeof(*fields); i++)
+		qso[fields[i].name] = xmlrpc_c::value_string(r.getField(fields[i].field));
+	return xmlrpc_c::value_struct(qso);
+}
+
+class Log_get_last_qso : public xmlrpc_c::method
+{
+public:
+	Log_get_last_qso()
+	{
+		_signature = "S:s";
+		_help = "Returns the most recent logbook QSO with a callsign, or an empty struct.";
+	}
+	void execute(const xmlrpc_c::paramList& params, xmlrpc_c::value* retval)
+	{
+		XMLRPC_LOCK;
+		qso_query q;
+		q.call = params.getString(0);
+		vector<cQsoRec> recs;
+		XMLRPC_REQ_SYNC(log_find, &q, 1, &recs);
+
+		if (recs.empty())
+			*retval = xmlrpc_c::value_struct(map<string, xmlrpc_c::value>());
+		else
+			*retval = log_qso_struct(recs[0]);
+	}
+};
+
+class Log_get_worked : public xmlrpc_c::method
+{
+public:
+	Log_get_worked()
+	{
+		_signature = "b:sss";
+		_help = "Returns true if a callsign is in the logbook, on a band (e.g. 20m) "
+			"and in a mode unless these are empty.";
+	}
+	void execute(const xmlrpc_c::paramList& params, xmlrpc_c::value* retval)
+	{
+		string call = params.getString(0), band = params.getString(1), mode = params.getString(2);
+		bool worked = qsodb.index().worked(call.c_str(), band.c_str(), mode.c_str());
+
+		*retval = xmlrpc_c::value_boolean(worked);
+	}
+};
+
+class Log_get_dxcc_status : public xmlrpc_c::method
+{
+public:
+	Log_get_dxcc_status()
+	{
+		_signature = "i:sss";
+		_help = "Returns the worked and confirmed status of a DXCC entity, on a band and in a mode "
+			"unless these are empty.  The bits are: worked 1, on the band 2, in the mode 4, "
+			"confirmed 8, on the band 16, in the mode 32.";
+	}
+	void execute(const xmlrpc_c::paramList& params, xmlrpc_c::value* retval)
+	{
+		string dxcc = params.getString(0), band = params.getString(1), mode = params.getString(2);
+		band_t b = NUM_BANDS;
+		for (int i = 0; i < NUM_BANDS && !band.empty(); i++) {
+			if (!strcasecmp(band_name((band_t)i), band.c_str())) {
+				b = (band_t)i;
+				break;
+			}
+		}
+		unsigned st = qsodb.index().status(dxcc.c_str(), b, mode.c_str());
+
+		*retval = xmlrpc_c::value_int((int)st);
+	}
+};
+
+class Log_get_qsos : public xmlrpc_c::method
+{
+public:
+	Log_get_qsos()
+	{
+		_signature = "A:S";
+		_help = "Returns the logbook QSOs that match a struct of call, band, mode, grid, dxcc, "
+			"date_from and date_to (YYYYMMDD), the most recent first.  "
+			"Returns at most max QSOs, 100 by default.";
+	}
+	void execute(const xmlrpc_c::paramList& params, xmlrpc_c::value* retval)
+	{
+		XMLRPC_LOCK;
+		map<string, xmlrpc_c::value> args = params.getStruct(0);
+		qso_query q;
+		int max = 100;
+		for (map<string, xmlrpc_c::value>::iterator i = args.begin(); i != args.end(); ++i) {
+			if (i->first == "max")
+				max = MAX((int)i->second, 0);
+			else if (i->first == "call")
+				q.call = (string)i->second;
+			else if (i->first == "band")
+				q.band = (string)i->second;
+			else if (i->first == "mode")
+				q.mode = (string)i->second;
+			else if (i->first == "grid")
+				q.grid = (string)i->second;
+			else if (i->first == "dxcc")
+				q.dxcc = (string)i->second;
+			else if (i->first == "date_from")
+				q.date_from = (string)i->second;
+			else if (i->first == "date_to")
+				q.date_to = (string)i->second;
+			else
+				throw xmlrpc_c::fault("Unknown query field");
+		}
+
+		vector<cQsoRec> recs;
+		XMLRPC_REQ_SYNC(log_find, &q, (size_t)max, &recs);
+
+		vector<xmlrpc_c::value> qsos;
+		for (size_t i = 0; i < recs.size(); i++)
+			qsos.push_back(log_qso_struct(recs[i]));
+		*retval = xmlrpc_c::value_array(qsos);
+	}
+};
+
 // =============================================================================
 
 class Io_in_use : public xmlrpc_c::method
@@ -2861,7 +3259,7 @@ public:
 		char* text;
 		int size;
 
-		REQ_SYNC(get_rx_text_range, &params, &err, &text, &size);
+		XMLRPC_REQ_SYNC(get_rx_text_range, &params, &err, &text, &size);
 		if (unlikely(err)) {
 			xmlrpc_c::fault f(*err);
 			delete err;
@@ -2906,7 +3304,7 @@ public:
 	void execute(const xmlrpc_c::paramList& params, xmlrpc_c::value* retval)
 	{
 		XMLRPC_LOCK;
-		REQ_SYNC(&FTextTX::add_text, TransmitText, params.getString(0));
+		XMLRPC_REQ_SYNC(&FTextTX::add_text, TransmitText, params.getString(0));
 		*retval = xmlrpc_c::value_nil();
 	}
 };
@@ -2924,7 +3322,7 @@ public:
 		XMLRPC_LOCK;
 		vector<unsigned char> bytes = params.getBytestring(0);
 		bytes.push_back(0);
-		REQ_SYNC(&FTextTX::add_text, TransmitText, string((const char*)&bytes[0]));
+		XMLRPC_REQ_SYNC(&FTextTX::add_text, TransmitText, string((const char*)&bytes[0]));
 
 		*retval = xmlrpc_c::value_nil();
 	}
@@ -2956,21 +3354,19 @@ public:
 		_signature = "6:n";
 		_help = "Returns all RXTX combined data since last query.";
 	}
-	static void get_rxtx(char **text, int *size)
+	static void get_rxtx(vector<unsigned char>* bytes)
 	{
 		// the get* methods may throw but this function is not allowed to do so
-		*text = get_rxtx_data();
-		*size = strlen(*text);
+		// the data is copied here, before another request can reuse its buffer
+		const char* text = get_rxtx_data();
+		bytes->assign(text, text + strlen(text));
 	}
 	void execute(const xmlrpc_c::paramList& params, xmlrpc_c::value* retval)
 	{
 		XMLRPC_LOCK;
-		char *text;
-		int size;
-		REQ_SYNC(get_rxtx, &text, &size);
+		vector<unsigned char> bytes;
+		XMLRPC_REQ_SYNC(get_rxtx, &bytes);
 
-		vector<unsigned char> bytes(size);
-		memcpy(&bytes[0], text, size);
 		*retval = xmlrpc_c::value_bytestring(bytes);
 	}
 };
@@ -2985,27 +3381,110 @@ public:
 		_signature = "6:n";
 		_help = "Returns all RX data received since last query.";
 	}
-	static void get_rx(char **text, int *size)
+	static void get_rx(vector<unsigned char>* bytes)
 	{
 		// the get* methods may throw but this function is not allowed to do so
-		*text = get_rx_data();
-		*size = strlen(*text);
+		// the data is copied here, before another request can reuse its buffer
+		const char* text = get_rx_data();
+		bytes->assign(text, text + strlen(text));
 	}
 	void execute(const xmlrpc_c::paramList& params, xmlrpc_c::value* retval)
 	{
 		XMLRPC_LOCK;
-		char *text;
-		int size;
-		REQ_SYNC(get_rx, &text, &size);
+		vector<unsigned char> bytes;
+		XMLRPC_REQ_SYNC(get_rx, &bytes);
 
-		vector<unsigned char> bytes(size);
-		memcpy(&bytes[0], text, size);
 		*retval = xmlrpc_c::value_bytestring(bytes);
 	}
 };
 
 // =============================================================================
 
+class RX_get_latency : public xmlrpc_c::method
+{
+public:
+	RX_get_latency()
+	{
+		_signature = "S:n";
+		_help = "Returns the receive path latency and queue depth histograms.";
+	}
+	void execute(const xmlrpc_c::paramList& params, xmlrpc_c::value* retval)
+	{
+		map<string, xmlrpc_c::value> result;
+
+		for (int i = 0; i < RXLAT_NUM_STAGES; i++) {
+			rxlat_hist_t h;
+			rxlat_get(i, h);
+			map<string, xmlrpc_c::value> stage;
+			stage["count"] = xmlrpc_c::value_int((int)h.count);
+			stage["mean_ms"] = xmlrpc_c::value_double(h.count ? 1e3 * h.sum / h.count : 0.0);
+			stage["p50_ms"] = xmlrpc_c::value_double(1e3 * rxlat_percentile(h, 0.5));
+			stage["p90_ms"] = xmlrpc_c::value_double(1e3 * rxlat_percentile(h, 0.9));
+			stage["p99_ms"] = xmlrpc_c::value_double(1e3 * rxlat_percentile(h, 0.99));
+			stage["max_ms"] = xmlrpc_c::value_double(1e3 * h.max);
+			// [upper bound in ms, count] of the buckets in use
+			vector<xmlrpc_c::value> buckets;
+			for (int b = 0; b < RXLAT_BUCKETS; b++) {
+				if (!h.bucket[b])
+					continue;
+				vector<xmlrpc_c::value> bucket;
+				bucket.push_back(xmlrpc_c::value_double(1e3 * rxlat_bucket_top(b)));
+				bucket.push_back(xmlrpc_c::value_int((int)h.bucket[b]));
+				buckets.push_back(xmlrpc_c::value_array(bucket));
+			}
+			stage["buckets"] = xmlrpc_c::value_array(buckets);
+			result[rxlat_stage_name(i)] = xmlrpc_c::value_struct(stage);
+		}
+
+		for (int i = 0; i < RXLAT_NUM_QUEUES; i++) {
+			rxlat_depth_t d;
+			rxlat_get_queue(i, d);
+			map<string, xmlrpc_c::value> queue;
+			queue["count"] = xmlrpc_c::value_int((int)d.count);
+			queue["mean"] = xmlrpc_c::value_double(d.count ? (double)d.sum / d.count : 0.0);
+			queue["max"] = xmlrpc_c::value_int((int)d.max);
+			vector<xmlrpc_c::value> depths;
+			for (int b = 0; b < RXLAT_DEPTHS; b++)
+				depths.push_back(xmlrpc_c::value_int((int)d.bucket[b]));
+			queue["depths"] = xmlrpc_c::value_array(depths);
+			result[string(rxlat_queue_name(i)) + "_queue"] = xmlrpc_c::value_struct(queue);
+		}
+
+		*retval = xmlrpc_c::value_struct(result);
+	}
+};
+
+class RX_get_latency_report : public xmlrpc_c::method
+{
+public:
+	RX_get_latency_report()
+	{
+		_signature = "s:n";
+		_help = "Returns the receive path latency summary as text.";
+	}
+	void execute(const xmlrpc_c::paramList& params, xmlrpc_c::value* retval)
+	{
+		*retval = xmlrpc_c::value_string(rxlat_report());
+	}
+};
+
+class RX_reset_latency : public xmlrpc_c::method
+{
+public:
+	RX_reset_latency()
+	{
+		_signature = "n:n";
+		_help = "Clears the receive path latency histograms.";
+	}
+	void execute(const xmlrpc_c::paramList& params, xmlrpc_c::value* retval)
+	{
+		rxlat_reset();
+		*retval = xmlrpc_c::value_nil();
+	}
+};
+
+// =============================================================================
+
 class TX_get_data : public xmlrpc_c::method
 {
 public:
@@ -3014,21 +3493,19 @@ public:
 		_signature = "6:n";
 		_help = "Returns all TX data transmitted since last query.";
 	}
-	static void get_tx(char **text, int *size)
+	static void get_tx(vector<unsigned char>* bytes)
 	{
 		// the get* methods may throw but this function is not allowed to do so
-		*text = get_tx_data();
-		*size = strlen(*text);
+		// the data is copied here, before another request can reuse its buffer
+		const char* text = get_tx_data();
+		bytes->assign(text, text + strlen(text));
 	}
 	void execute(const xmlrpc_c::paramList& params, xmlrpc_c::value* retval)
 	{
 		XMLRPC_LOCK;
-		char *text;
-		int size;
-		REQ_SYNC(get_tx, &text, &size);
+		vector<unsigned char> bytes;
+		XMLRPC_REQ_SYNC(get_tx, &bytes);
 
-		vector<unsigned char> bytes(size);
-		memcpy(&bytes[0], text, size);
 		*retval = xmlrpc_c::value_bytestring(bytes);
 	}
 };
@@ -3502,6 +3979,10 @@ ELEM_(Log_set_call, "log.set_call")								\
 ELEM_(Log_set_name, "log.set_name")								\
 ELEM_(Log_set_qth, "log.set_qth")									\
 ELEM_(Log_set_locator, "log.set_locator")							\
+ELEM_(Log_get_last_qso, "log.get_last_qso")							\
+ELEM_(Log_get_worked, "log.get_worked")							\
+ELEM_(Log_get_qsos, "log.get_qsos")							\
+ELEM_(Log_get_dxcc_status, "log.get_dxcc_status")						\
 \
 ELEM_(Io_in_use, "io.in_use")	          						\
 ELEM_(Io_enable_kiss, "io.enable_kiss")							\
@@ -3516,6 +3997,9 @@ ELEM_(Text_clear_tx, "text.clear_tx")							\
 \
 ELEM_(RXTX_get_data, "rxtx.get_data")							\
 ELEM_(RX_get_data, "rx.get_data")								\
+ELEM_(RX_get_latency, "rx.get_latency")							\
+ELEM_(RX_get_latency_report, "rx.get_latency_report")				\
+ELEM_(RX_reset_latency, "rx.reset_latency")						\
 ELEM_(TX_get_data, "tx.get_data")								\
 \
 ELEM_(Spot_get_auto, "spot.get_auto")								\
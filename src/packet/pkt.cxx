@@ -153,7 +153,7 @@ void pkt::rx_init()
 	rxstate = PKT_RX_STATE_STOP;
 	scounter = 0;
 
-	cbuf = &rxbuf[0]; // init rx buf ptr
+	demods.reset();
 }
 
 void pkt::set_freq(double f)
@@ -197,6 +197,7 @@ void pkt::init()
 
 	lo_signal_gain = pow(10, progdefaults.PKT_LOSIG_RXGAIN / 10);
 	hi_signal_gain = pow(10, progdefaults.PKT_HISIG_RXGAIN / 10);
+	demods.init(symbollen, lo_signal_gain, hi_signal_gain);
 
 	lo_txgain = pow(10, progdefaults.PKT_LOSIG_TXGAIN / 10);
 	hi_txgain = pow(10, progdefaults.PKT_HISIG_TXGAIN / 10);
@@ -423,6 +424,8 @@ void pkt::init()
 
 pkt::~pkt()
 {
+	LOG_INFO("packet demodulators:\n%s", demods.statistics().c_str());
+
 	if (nco_lo) delete nco_lo;
 	if (nco_hi) delete nco_hi;
 	if (nco_mid) delete nco_mid;
@@ -472,8 +475,12 @@ void pkt::set_pkt_modem_params(int i)
 void pkt::restart()
 {
 	if (select_val != progdefaults.PKT_BAUD_SELECT) {
+		if (select_val >= 0)
+			LOG_INFO("%d baud packet demodulators:\n%s",
+				 pkt_baud, demods.statistics().c_str());
 		select_val = progdefaults.PKT_BAUD_SELECT;
 		set_pkt_modem_params(select_val);
+		demods.init(symbollen, lo_signal_gain, hi_signal_gain);
 	}
 
 	snprintf(msg1, sizeof(msg1), "%4i / %-4.0f", pkt_baud, pkt_shift);
@@ -559,6 +566,8 @@ pkt::pkt(trx_mode md)
 
 	pipe = dsppipe = (double *)0;
 
+	lo_signal_gain = hi_signal_gain = 1.0;
+
 	select_val = -1; // force modem param init
 
 	restart();
@@ -617,42 +626,8 @@ unsigned char pkt::bitreverse(unsigned char in, int n)
 
 unsigned int pkt::computeFCS(unsigned char *head, unsigned char *tail)
 {
-	unsigned char *c, b, tc;
-
-	// CRC AX.25 Generator mask
-	//			 == bitflip(poly(x**16 + x**12 + x**5 + 1))
-	//			 == bitflip(0x1021) == bitflip(0001000000100001)
-	//			 == 1000010000001000 == 0x8408
-
-	// http://www.ross.net/crc/download/crc_v3.txt
-
-	unsigned int fcsv = 0xFFFF;
-
-	// as in Ross except: shift right instead of left and reflected mask
-	// (mirror image because AX.25 is lsb->msb order)
-
-	for(c = head; c < tail; c++) {
-
-	fcsv ^= *c;
-
-	for(b = 0; b < 8; b++) {
-
-		if (fcsv & 0x0001)
-		fcsv = (fcsv >> 1) ^ 0x8408;
-		else
-		fcsv >>= 1;
-
-		fcsv &= 0xFFFF;
-	}
-	}
-	fcsv ^= 0xFFFF;
-	// fcsv is now (lo,hi)
-
-	tc = (fcsv & 0xFF00) >> 8;
-	fcsv = ((fcsv & 0x00FF) << 8) | tc;
-	// fcsv is now (hi,lo)
-
-	return fcsv;
+	// fcsv is (hi,lo), see pkt_demod_bank::fcs
+	return pkt_demod_bank::fcs(head, tail);
 }
 
 // compare AX.25 Frame CheckSum (FCS) value to computed value
@@ -1737,102 +1712,30 @@ void pkt::do_put_rx_char(unsigned char *cp)
 }
 
 
-void pkt::rx(bool bit)
+void pkt::put_frame(int len)
 {
-	static unsigned char c = 0, bcounter = 0;
-
-	c >>= 1;
-	++bcounter;
-
-	if (bit == false) {
-	c &= ~(1 << (pkt_nbits-1)); // bits are sent lsb first
-
-	if (seq_ones == 6) { // flag byte found
-		bcounter = 0;
-
-		if (cbuf >= &rxbuf[MINOCTETS]) { // flag at end of frame
+	// the demodulators pass only frames with a good FCS
+	unsigned char *cp = &rxbuf[len - 2];
+	rxbuf[len] = PKT_Flag;
 
-		*cbuf = PKT_Flag; // == 0x7e
+	//   monitor Metric and Squelch Level
+	if ( progStatus.sqlonoff &&
+		 metric < progStatus.sldrSquelchValue )
+		return;
 
-		if (debug::level == debug::DEBUG_LEVEL)
-			fprintf(stderr,"7e\n");
-
-		//   monitor Metric and Squelch Level
-		if ( !progStatus.sqlonoff ||
-			 metric >= progStatus.sldrSquelchValue ) { // lazy eval
-			/*
-			// check FCS at end of frame
-			// if FCS is OK - packet is in rxbuffer,
-			//		  put_rx_char() for each byte in rxbuffer
-			*/
-			if (checkFCS((cbuf - 2)) == true) {
-			if (progdefaults.PKT_RXTimestamp) {
-				unsigned char ts[16], *tc = &ts[0];
-				time_t t = time(NULL);
-				struct tm stm;
-
-				(void)gmtime_r(&t, &stm);
-				snprintf((char *)ts, sizeof(ts),
-					 "[%02d:%02d:%02d] ",
-					 stm.tm_hour, stm.tm_min, stm.tm_sec);
-
-				while (*tc)  put_rx_char(*tc++);
-			}
-			do_put_rx_char((cbuf - 2));
-			}
-		}
-
-		cbuf = &rxbuf[0]; // reset after first end frame flag
-		}
-		else {
-		// packet too short if cbuf < &rxbuf[MINOCTETS]
-
-		// put only one beginning flag into buffer
-		rxbuf[0] = PKT_Flag;
-		cbuf = &rxbuf[1];
-
-		if (debug::level == debug::DEBUG_LEVEL)
-			fprintf(stderr,"7e ");
-		}
-	}
-	else if (seq_ones == 5) { // need bit un-stuffing
-		c <<= 1;  // shift c back to skip stuffed bit
-		--bcounter;
-	}
-
-	seq_ones = 0;
-	}
-	else {
-	c |= (1 << (pkt_nbits-1)); // bits are sent lsb first
-	++seq_ones;
-
-	//if (seq_ones > 6) { // something is wrong
-	//}
-	}
+	if (progdefaults.PKT_RXTimestamp) {
+		unsigned char ts[16], *tc = &ts[0];
+		time_t t = time(NULL);
+		struct tm stm;
 
-	if (bcounter == pkt_nbits) {
-	bcounter = 0;
-	if (cbuf < &rxbuf[MAXOCTETS]) {
-		*cbuf++ = c;
+		(void)gmtime_r(&t, &stm);
+		snprintf((char *)ts, sizeof(ts),
+			 "[%02d:%02d:%02d] ",
+			 stm.tm_hour, stm.tm_min, stm.tm_sec);
 
-		if (debug::level == debug::DEBUG_LEVEL)
-		fprintf(stderr,"%02x ",c);
+		while (*tc)  put_rx_char(*tc++);
 	}
-	else
-		// else complain: cbuf is at MAXOCTETS
-		LOG_WARN("Long input packet, %d octets!",(int)(cbuf - &rxbuf[0]));
-	}
-
-	/*
-	//   when flag found: keep collecting flags (0x7e) until !(0x7e) found
-	//   (first non-0x7e begins DATA)
-
-	//   keep collecting bits in DATA, 8 at-a-time, until 0x7e found
-	//   while collecting bits, perform bit-unstuffing so we place in
-	//   databuffer exactly 8 bits at-a-time
-	//   (at times more than 8 bits in to 8 bits out)
-	//   first trailing 0x7e ends DATA and begins STOP
-	*/
+	do_put_rx_char(cp);
 }
 
 void pkt::Metric()
@@ -1899,6 +1802,8 @@ void pkt::correlate(double sample)
 	hi_signal_buf[correlate_buf_ptr] = yh;
 	hi_signal_corr = hi_signal_gain * corr_power(hi_signal_energy);
 
+	demods.process(yl, yh);
+
 	yt = nco_mid->cmplx_sample();
 	yt *= sample;
 
@@ -1954,13 +1859,9 @@ void pkt::detect_signal()
 	detect_drop = pkt_detectlen; // reset signal drop counter
 
 	if (rxstate == PKT_RX_STATE_DROP) {
-		rxstate = PKT_RX_STATE_START;
-
-		// init STATE_START
+		// the demodulators keep their own bit clocks
+		rxstate = PKT_RX_STATE_DATA;
 		signal_gain = 1.0; // 5.0
-		scounter = pkt_detectlen; //(was) 9 * symbollen;//11 instead of 9?
-		lo_sync = 100.0;
-		hi_sync = -100.0;
 	}
 	}
 	else if (--detect_drop < 1 && rxstate == PKT_RX_STATE_DATA) { // lazy eval
@@ -1973,74 +1874,6 @@ void pkt::detect_signal()
 	}
 }
 
-void pkt::do_sync()
-{
-	double power_delta = lo_signal_corr - hi_signal_corr;
-
-	lo_sync_ptr--; hi_sync_ptr--;
-
-	if (lo_sync > power_delta && power_delta < 0) {
-	lo_sync_ptr = 0;
-	lo_sync = power_delta;
-	}
-
-	if (hi_sync < power_delta && power_delta > 0) {
-	hi_sync_ptr = 0;
-	hi_sync = power_delta;
-	}
-
-	if (--scounter < 1) {
-	int offset;
-
-	if (fabs(hi_sync) > fabs(lo_sync))
-		offset = -hi_sync_ptr;
-	else
-		offset = -lo_sync_ptr;
-
-	offset %= symbollen; // clamp offset to +/- one symbol
-
-	mid_symbol = symbollen - offset;
-	prev_symbol = pll_symbol = hi_signal_corr < lo_signal_corr;
-	
-	rxstate = PKT_RX_STATE_DATA;
-	seq_ones = 0;	 // reset once on transition to STATE_DATA
-	cbuf = &rxbuf[0]; // and reset packet buffer ptr
-	}
-}
-
-void pkt::rx_data()
-{
-	bool tbit = hi_signal_corr < lo_signal_corr; // detect current symbol
-
-	mid_symbol -= 1;
-	int imid_symbol = (int) floor(mid_symbol+0.5);
-
-	// hard-decision symbol decoding.  done at mid-symbol (imid_symbol < 1).
-	//
-	// might do instead a soft-decision by cumulative voting
-	// of more than one mid-symbol sample?  symbollen-2 samples max?
-	//
-	if (imid_symbol < 1) { // counting down to middle of next symbol
-
-	bool bit = prev_symbol == tbit; // detect symbol change
-
-	prev_symbol = pll_symbol = tbit;
-	mid_symbol += symbollen; // advance to middle of next symbol
-
-	// remember to check value of reverse here to determine symbol
-	rx(reverse ? !bit : bit);
-	}
-	else
-	if (tbit != pll_symbol) { // update PLL
-		if (mid_symbol < ((double)symbollen/2))
-		mid_symbol += PKT_PLLAdjVal;
-		else
-		mid_symbol -= PKT_PLLAdjVal;
-
-		pll_symbol = tbit;
-	}
-}
-
 int pkt::rx_process(const double *buf, int len)
 {
 	double x_n;
@@ -2094,19 +1927,17 @@ int pkt::rx_process(const double *buf, int len)
 			detect_signal();
 			break;
 
-		case PKT_RX_STATE_START:
-			correlate( x_n );
-			do_sync();
-			break;
-
 		case PKT_RX_STATE_DATA:
 			correlate( x_n );
-			rx_data();
 			detect_signal();
 			break;
 		}
 	} // while(len)
 
+	int n;
+	while ((n = demods.get_frame(rxbuf)) > 0)
+		put_frame(n);
+
 	if (metric < progStatus.sldrSquelchValue && progStatus.sqlonoff) {
 		if (clear_zdata) {
 			for (int i = 0; i < MAX_ZLEN; i++) 
@@ -0,0 +1,294 @@
+// ---------------------------------------------------------------------
+// pkt_demod.cxx  --  bank of AX.25 AFSK demodulators
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is a proposed part of fldigi.
+//
+// fldigi is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi; if not, write to the Free Software
+// Foundation, Inc.
+// 59 Temple Place
+// Suite 330
+// Boston, MA  02111-1307  USA
+// ---------------------------------------------------------------------
+
+#include <config.h>
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+
+#include "pkt_demod.h"
+
+using namespace std;
+
+// mark to space power ratio of each slicer in dB.  A VHF FM receiver
+// with or without de-emphasis tilts the audio by several dB, which moves
+// the mark/space threshold; larger corrections hurt the 3/4 window, whose
+// filters overlap more.
+static const double tilt_db[PKT_Tilts] = { 0.0, -3.0, 3.0 };
+
+// share of the bit clock error corrected at a symbol transition
+#define PKT_PLLGain	0.25
+
+pkt_demod_bank::pkt_demod_bank()
+	: symbollen(0), lo_buf(0), hi_buf(0)
+{
+	for (int d = 0; d < PKT_Demods; d++)
+		decoded[d] = first[d] = only[d] = 0;
+	init(10, 1.0, 1.0);
+}
+
+pkt_demod_bank::~pkt_demod_bank()
+{
+	delete [] lo_buf;
+	delete [] hi_buf;
+}
+
+void pkt_demod_bank::init(int len, double lo, double hi)
+{
+	if (len != symbollen) {
+		delete [] lo_buf;
+		delete [] hi_buf;
+		symbollen = len;
+		lo_buf = new cmplx[symbollen];
+		hi_buf = new cmplx[symbollen];
+	}
+	shortlen = (3 * symbollen + 2) / 4;
+
+	for (int t = 0; t < PKT_Tilts; t++) {
+		double tilt = pow(10, tilt_db[t] / 20);
+		lo_gain[t] = lo * tilt;
+		hi_gain[t] = hi / tilt;
+	}
+
+	reset();
+}
+
+void pkt_demod_bank::reset()
+{
+	for (int i = 0; i < symbollen; i++)
+		lo_buf[i] = hi_buf[i] = cmplx(0, 0);
+	ptr = 0;
+	for (int w = 0; w < PKT_Windows; w++)
+		lo_sum[w] = hi_sum[w] = cmplx(0, 0);
+
+	for (int d = 0; d < PKT_Demods; d++) {
+		mid_symbol[d] = symbollen;
+		prev_symbol[d] = pll_symbol[d] = false;
+		deframer[d].shift = 0;
+		deframer[d].nbits = 0;
+		deframer[d].ones = 0;
+		deframer[d].len = -1;
+	}
+
+	for (int i = 0; i < PKT_Recent; i++)
+		recent[i].used = false;
+	next_recent = 0;
+	nsample = 0;
+	frames.clear();
+}
+
+void pkt_demod_bank::process(cmplx lo, cmplx hi)
+{
+	nsample++;
+
+	// sliding sums over one symbol and over the last shortlen samples
+	int old = ptr - shortlen;
+	if (old < 0) old += symbollen;
+	lo_sum[0] += lo - lo_buf[ptr];
+	hi_sum[0] += hi - hi_buf[ptr];
+	lo_sum[1] += lo - lo_buf[old];
+	hi_sum[1] += hi - hi_buf[old];
+	lo_buf[ptr] = lo;
+	hi_buf[ptr] = hi;
+	if (++ptr == symbollen)
+		ptr = 0;
+
+	// slicers
+	bool tbit[PKT_Demods];
+	for (int w = 0; w < PKT_Windows; w++) {
+		double lo_pwr = norm(lo_sum[w]);
+		double hi_pwr = norm(hi_sum[w]);
+		for (int t = 0; t < PKT_Tilts; t++)
+			tbit[w * PKT_Tilts + t] = hi_pwr * hi_gain[t] < lo_pwr * lo_gain[t];
+	}
+
+	// bit clocks: sample in the middle of the symbol, and move the clock
+	// toward a transition half a symbol away from it
+	for (int d = 0; d < PKT_Demods; d++) {
+		mid_symbol[d] -= 1;
+		if (mid_symbol[d] < 0.5) {
+			// NRZI: no change is a one.  This does not depend on which
+			// tone is mark, so reverse does not matter here.
+			bool bit = prev_symbol[d] == tbit[d];
+			prev_symbol[d] = pll_symbol[d] = tbit[d];
+			mid_symbol[d] += symbollen;
+			hdlc(d, bit);
+		}
+		else if (tbit[d] != pll_symbol[d]) {
+			mid_symbol[d] -= PKT_PLLGain * (mid_symbol[d] - symbollen / 2.0);
+			pll_symbol[d] = tbit[d];
+		}
+	}
+}
+
+inline void pkt_demod_bank::put_bit(deframer_t& m, int bit)
+{
+	// bits are sent lsb first
+	m.shift = (m.shift >> 1) | (bit << 7);
+	if (++m.nbits < 8)
+		return;
+	m.nbits = 0;
+	if (m.len < 0)
+		return;
+	if (m.len < MAXOCTETS)
+		m.buf[m.len++] = m.shift;
+	else
+		m.len = -1; // too long
+}
+
+void pkt_demod_bank::hdlc(int d, bool bit)
+{
+	deframer_t& m = deframer[d];
+
+	if (bit) {
+		if (++m.ones > 6) { // abort, or noise
+			m.len = -1;
+			return;
+		}
+		put_bit(m, 1);
+		return;
+	}
+
+	if (m.ones == 6) { // flag
+		// the flag's first seven bits went into the register; they
+		// must not have completed a byte
+		if (m.len >= MINOCTETS && m.nbits == 7)
+			frame(d);
+		m.len = 0;
+		m.nbits = 0;
+	}
+	else if (m.ones != 5) // a zero after five ones is stuffed
+		put_bit(m, 0);
+	m.ones = 0;
+}
+
+unsigned int pkt_demod_bank::fcs(const unsigned char *head, const unsigned char *tail)
+{
+	// CRC AX.25 Generator mask
+	//			 == bitflip(poly(x**16 + x**12 + x**5 + 1))
+	//			 == bitflip(0x1021) == 0x8408
+	unsigned int fcsv = 0xFFFF;
+
+	for (const unsigned char *c = head; c < tail; c++) {
+		fcsv ^= *c;
+		for (int b = 0; b < 8; b++) {
+			if (fcsv & 0x0001)
+				fcsv = (fcsv >> 1) ^ 0x8408;
+			else
+				fcsv >>= 1;
+		}
+	}
+	fcsv ^= 0xFFFF;
+
+	// (lo,hi) to (hi,lo)
+	return ((fcsv & 0x00FF) << 8) | ((fcsv & 0xFF00) >> 8);
+}
+
+void pkt_demod_bank::retire(recent_t& r)
+{
+	if (!r.used)
+		return;
+	r.used = false;
+
+	int n = 0, d = 0;
+	for (int i = 0; i < PKT_Demods; i++)
+		if (r.mask & (1 << i)) {
+			n++;
+			d = i;
+		}
+	if (n == 1)
+		only[d]++;
+}
+
+void pkt_demod_bank::frame(int d)
+{
+	deframer_t& m = deframer[d];
+
+	// the FCS goes in the buffer big endian
+	unsigned int fcsv_rcvd = (m.buf[m.len - 2] << 8) | m.buf[m.len - 1];
+	if (fcsv_rcvd != fcs(m.buf, m.buf + m.len - 2))
+		return;
+
+	decoded[d]++;
+
+	unsigned long window = (unsigned long)PKT_DedupSymbols * symbollen;
+	for (int i = 0; i < PKT_Recent; i++) {
+		recent_t& r = recent[i];
+		if (!r.used)
+			continue;
+		if (nsample - r.when > window) {
+			retire(r);
+			continue;
+		}
+		if (r.len == m.len && !memcmp(r.buf, m.buf, m.len)) {
+			r.mask |= 1 << d;
+			return;
+		}
+	}
+
+	first[d]++;
+
+	recent_t& r = recent[next_recent];
+	retire(r);
+	r.used = true;
+	r.when = nsample;
+	r.mask = 1 << d;
+	r.len = m.len;
+	memcpy(r.buf, m.buf, m.len);
+	next_recent = (next_recent + 1) % PKT_Recent;
+
+	string f(1, (char)PKT_Flag);
+	f.append((const char *)m.buf, m.len);
+	frames.push_back(f);
+}
+
+int pkt_demod_bank::get_frame(unsigned char *buf)
+{
+	if (frames.empty())
+		return 0;
+
+	int len = frames.front().length();
+	memcpy(buf, frames.front().data(), len);
+	frames.pop_front();
+
+	return len;
+}
+
+string pkt_demod_bank::statistics()
+{
+	string s = "demod window tilt  frames  first   only\n";
+	char line[80];
+
+	for (int d = 0; d < PKT_Demods; d++) {
+		snprintf(line, sizeof(line), "%5d %6s %+4.0f %7lu %6lu %6lu\n",
+			 d, d / PKT_Tilts ? "3/4" : "1", tilt_db[d % PKT_Tilts],
+			 decoded[d], first[d], only[d]);
+		s.append(line);
+	}
+
+	return s;
+}
@@ -138,6 +138,16 @@ double pskeval::peak(int &f0, int f1, int f2, double db)
 	return (peak - sigmin) / sigmin ;
 }
 
+// The signal to noise ratio at f in dB, in the bandwidth of the signal
+double pskeval::snr(int f)
+{
+	if (f < 0 || f >= FFT_LEN)
+		return 0.0;
+	double s = sigpwr[f] - sigmin;
+	if (s < sigmin * 1e-3) s = sigmin * 1e-3;
+	return 10.0 * log10(s / sigmin);
+}
+
 void pskeval::clear() {
 	for (int i = 0; i < FFT_LEN; i++) sigpwr[i] = 0.0;
 }
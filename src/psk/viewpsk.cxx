@@ -40,6 +40,7 @@
 #include "Viewer.h"
 #include "qrunner.h"
 #include "status.h"
+#include "view_route.h"
 
 extern waterfall *wf;
 
@@ -170,6 +171,8 @@ void viewpsk::rx_bit(int ch, int bit)
 		if (c == '\n' || c == '\r') c = ' ';
 		if (iscntrl(c & 0xFF)) return;
 		REQ(&viewaddchr, ch, (int)channel[ch].frequency, c, viewmode);
+		view_route_chr(ch, (int)channel[ch].frequency, c, viewmode,
+			       evalpsk ? evalpsk->snr((int)channel[ch].frequency) : 0.0);
 	}
 }
 
@@ -217,6 +220,7 @@ inline void viewpsk::timeout_check()
 			channel[ch].acquire = 0;
 			REQ(&viewclearchannel, ch);
 			REQ(&viewaddchr, ch, NULLFREQ, 0, viewmode);
+			view_route_clear(ch);
 		}
 	}
 }
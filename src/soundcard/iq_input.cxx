@@ -0,0 +1,373 @@
+// ----------------------------------------------------------------------------
+// iq_input.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef __WOE32__
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#endif
+
+#include "iq_input.h"
+#include "configuration.h"
+#include "trx.h"
+#include "util.h"
+#include "debug.h"
+
+LOG_FILE_SOURCE(debug::LOG_AUDIO);
+
+using namespace std;
+
+iq_source::iq_source()
+	: fd(-1), regular_(false), format(IQ_S16), have(0)
+{
+}
+
+iq_source::~iq_source()
+{
+	close();
+}
+
+bool iq_source::open(const string& spec, format_t format_)
+{
+	close();
+	format = format_;
+	have = 0;
+
+	if (spec == "-")
+		fd = dup(STDIN_FILENO);
+	else if (spec.compare(0, 5, "unix:") == 0) {
+#ifndef __WOE32__
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (spec.length() - 5 >= sizeof(addr.sun_path)) {
+			errno = ENAMETOOLONG;
+			return false;
+		}
+		strcpy(addr.sun_path, spec.c_str() + 5);
+		if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) != -1 &&
+		    connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+			int e = errno;
+			::close(fd);
+			fd = -1;
+			errno = e;
+		}
+#else
+		errno = ENOSYS;
+#endif
+	}
+	else
+		fd = ::open(spec.c_str(), O_RDONLY);
+
+	if (fd == -1)
+		return false;
+
+	struct stat st;
+	regular_ = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+	return true;
+}
+
+void iq_source::close(void)
+{
+	if (fd != -1) {
+		::close(fd);
+		fd = -1;
+	}
+}
+
+size_t iq_source::read(cmplx* buf, size_t n)
+{
+	if (fd == -1 || n == 0)
+		return 0;
+
+	size_t size = format == IQ_S16 ? 2 * sizeof(short) : 2 * sizeof(float);
+	raw.resize(n * size);
+
+	// block until there is at least one whole sample
+	while (have < size) {
+		ssize_t r = ::read(fd, &raw[have], raw.size() - have);
+		if (r == -1 && errno == EINTR)
+			continue;
+		if (r <= 0) {
+			if (r == -1)
+				LOG_PERROR("read");
+			close();
+			return 0;
+		}
+		have += r;
+	}
+
+	size_t nsamples = have / size;
+	if (format == IQ_S16) {
+		const short* p = reinterpret_cast<const short*>(&raw[0]);
+		for (size_t i = 0; i < nsamples; i++, p += 2)
+			buf[i] = cmplx(p[0] / 32768.0, p[1] / 32768.0);
+	}
+	else {
+		const float* p = reinterpret_cast<const float*>(&raw[0]);
+		for (size_t i = 0; i < nsamples; i++, p += 2)
+			buf[i] = cmplx(p[0], p[1]);
+	}
+
+	size_t used = nsamples * size;
+	memmove(&raw[0], &raw[used], have - used);
+	have -= used;
+
+	return nsamples;
+}
+
+// ----------------------------------------------------------------------------
+
+iq_receiver::iq_receiver(double in_rate_, double out_rate_, double dial)
+	: in_rate(in_rate_), out_rate(out_rate_), count(0), src_state(0)
+{
+	decimation = (int)floor(in_rate / out_rate);
+	if (decimation < 1)
+		decimation = 1;
+	mid_rate = in_rate / decimation;
+
+	// the slice must stay below half of both the decimated and the output
+	// rate once it has been moved up to start at 0 Hz
+	bandwidth = 0.45 * MIN(mid_rate, out_rate);
+
+	// the filter only runs once per output sample
+	int len = MAX(10 * decimation + 1, 31);
+	filter.init_lowpass(len, decimation, bandwidth / 2.0 / in_rate);
+
+	up = 1.0;
+	up_step = polar(1.0, 2.0 * M_PI * bandwidth / 2.0 / mid_rate);
+
+	if (fabs(mid_rate - out_rate) > 0.5) {
+		int err;
+		if ((src_state = src_new(progdefaults.sample_converter, 1, &err)) == NULL)
+			LOG_ERROR("src_new error %d: %s", err, src_strerror(err));
+	}
+
+	nco = 1.0;
+	tune(dial);
+}
+
+iq_receiver::~iq_receiver()
+{
+	if (src_state)
+		src_delete(src_state);
+}
+
+void iq_receiver::tune(double dial)
+{
+	dial_ = dial;
+	nco_step = polar(1.0, -2.0 * M_PI * (dial + bandwidth / 2.0) / in_rate);
+}
+
+void iq_receiver::process(const cmplx* in, size_t n, vector<float>& out)
+{
+	mid.clear();
+
+	cmplx z;
+	for (size_t i = 0; i < n; i++) {
+		if (filter.run(in[i] * nco, z)) {
+			mid.push_back((z * up).real());
+			up *= up_step;
+		}
+		nco *= nco_step;
+		// keep the rotating phasors on the unit circle
+		if (++count == 1024) {
+			nco /= abs(nco);
+			up /= abs(up);
+			count = 0;
+		}
+	}
+	if (mid.empty())
+		return;
+
+	if (!src_state) {
+		out.insert(out.end(), mid.begin(), mid.end());
+		return;
+	}
+
+	SRC_DATA data;
+	data.src_ratio = out_rate / mid_rate;
+	resampled.resize((size_t)ceil(mid.size() * data.src_ratio) + 16);
+	data.data_in = &mid[0];
+	data.input_frames = mid.size();
+	data.end_of_input = 0;
+	while (data.input_frames > 0) {
+		data.data_out = &resampled[0];
+		data.output_frames = resampled.size();
+		int err;
+		if ((err = src_process(src_state, &data)) != 0) {
+			LOG_ERROR("src_process error %d: %s", err, src_strerror(err));
+			break;
+		}
+		out.insert(out.end(), resampled.begin(), resampled.begin() + data.output_frames_gen);
+		if (data.input_frames_used == 0 && data.output_frames_gen == 0)
+			break;
+		data.data_in += data.input_frames_used;
+		data.input_frames -= data.input_frames_used;
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+bool parse_iq_channels(const string& list, vector<iq_channel>& channels)
+{
+	channels.clear();
+
+	string::size_type p = 0, q;
+	do {
+		q = list.find(',', p);
+		string s = list.substr(p, q == string::npos ? q : q - p);
+		p = q + 1;
+		if (s.empty())
+			continue;
+
+		iq_channel ch;
+		char* e;
+		ch.dial = strtod(s.c_str(), &e);
+		ch.mode = NUM_MODES;
+		if (e == s.c_str())
+			return false;
+		if (*e == ':') {
+			const char* m = e + 1;
+			ch.mode = strtol(m, &e, 10);
+			if (*e != '\0' || e == m) {
+				for (ch.mode = 0; ch.mode < NUM_MODES; ch.mode++)
+					if (!strcasecmp(m, mode_info[ch.mode].sname))
+						break;
+			}
+			if (ch.mode < 0 || ch.mode >= NUM_MODES)
+				return false;
+		}
+		else if (*e != '\0')
+			return false;
+		channels.push_back(ch);
+	} while (q != string::npos);
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+SoundIQ::SoundIQ(const string& spec_)
+	: spec(spec_), rx(0), head(0), eof(false)
+{
+}
+
+SoundIQ::~SoundIQ()
+{
+	delete rx;
+}
+
+int SoundIQ::Open(int mode, int freq)
+{
+	if (mode == O_WRONLY) {
+		sample_frequency = freq;
+		return 0;
+	}
+
+	if (!source.is_open() && !eof) {
+		if (!source.open(spec, progdefaults.IQFormat ? iq_source::IQ_F32 : iq_source::IQ_S16)) {
+			int err = errno;
+			throw SndException(err, string("I/Q input ") + spec + ": " + strerror(err));
+		}
+		LOG_INFO("I/Q input %s at %d Hz", spec.c_str(), progdefaults.IQSampleRate);
+	}
+
+	if (!rx || freq != sample_frequency) {
+		vector<iq_channel> channels;
+		if (!parse_iq_channels(progdefaults.IQReceivers, channels))
+			throw SndException(EINVAL, string("Bad I/Q receiver list ") + progdefaults.IQReceivers);
+		delete rx;
+		rx = new iq_receiver(progdefaults.IQSampleRate, freq,
+				     channels.empty() ? 0.0 : channels[0].dial);
+		iqbuf.resize(progdefaults.IQSampleRate / 50 + 1);
+		audio.clear();
+		head = 0;
+	}
+	sample_frequency = freq;
+
+	return 0;
+}
+
+size_t SoundIQ::Write(double* buf, size_t count)
+{
+#if USE_SNDFILE
+	if (generate)
+		write_file(ofGenerate, buf, count);
+#endif
+	MilliSleep((long)ceil((1e3 * count) / sample_frequency));
+
+	return count;
+}
+
+size_t SoundIQ::Write_stereo(double* bufleft, double* bufright, size_t count)
+{
+	return Write(bufleft, count);
+}
+
+size_t SoundIQ::Read(float *buf, size_t count)
+{
+	while (audio.size() - head < count) {
+		size_t n = eof ? 0 : source.read(&iqbuf[0], iqbuf.size());
+		if (n == 0) {
+			// the recording or the stream has ended: continue with silence
+			if (!eof)
+				LOG_INFO("End of I/Q input %s", spec.c_str());
+			eof = true;
+			audio.resize(head + count, 0.0f);
+			break;
+		}
+		if (head) {
+			audio.erase(audio.begin(), audio.begin() + head);
+			head = 0;
+		}
+		rx->process(&iqbuf[0], n, audio);
+	}
+
+	memcpy(buf, &audio[head], count * sizeof(*buf));
+	head += count;
+	if (head == audio.size()) {
+		audio.clear();
+		head = 0;
+	}
+
+#if USE_SNDFILE
+	if (capture)
+		write_file(ofCapture, buf, count);
+#endif
+	// a live stream arrives at its own pace
+	if ((source.regular() || eof) && !bHighSpeed)
+		MilliSleep((long)ceil((1e3 * count) / sample_frequency));
+
+	return count;
+}
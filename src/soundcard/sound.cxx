@@ -68,12 +68,14 @@
 #include "threads.h"
 #include "timeops.h"
 #include "ringbuffer.h"
+#include "rxlatency.h"
 #include "debug.h"
 #include "qrunner.h"
 #include "icons.h"
 #include "macros.h"
 
 #include "estrings.h"
+#include "replay.h"
 
 #define SND_BUF_LEN	 65536
 #define SND_RW_LEN	(8 * SND_BUF_LEN)
@@ -97,7 +99,7 @@ SoundBase::SoundBase()
 #if USE_SNDFILE
 		  ofCapture(0), ifPlayback(0), ofGenerate(0),
 #endif
-	  capture(false), playback(false), generate(false)
+	  capture(false), playback(false), generate(false), rx_age(0.0)
 {
 	memset(wrt_buffer, 0, SND_BUF_LEN * sizeof(*wrt_buffer));
 
@@ -123,6 +125,7 @@ SoundBase::SoundBase()
 	if (!src_inp_buffer)
 		throw SndException(src_strerror(err));
 	modem_wr_sr = modem_play_sr = 0;
+	capture_frames = 0;
 	inp_pointer = src_out_buffer;
 #endif
 }
@@ -188,6 +191,7 @@ int SoundBase::Capture(bool val)
 			ofCapture = 0;
 		}
 		capture = false;
+		replay_record_stop();
 		return 1;
 	}
 
@@ -211,6 +215,8 @@ int SoundBase::Capture(bool val)
 //	memset(src_inp_buffer, 0, 512 * sizeof(float));
 //	write_file(ofCapture, src_inp_buffer, 512);
 
+	capture_frames = 0;
+	replay_record_start(fname);
 	capture = true;
 	return 1;
 }
@@ -403,8 +409,13 @@ void SoundBase::write_file(SNDFILE* file, float* buf, size_t count)
 
 	size_t output_size = writ_src_data->output_frames_gen;
 
+	// the receiver settings hold from the first frame of this block
+	if (file == ofCapture)
+		replay_record(capture_frames);
 	if (output_size)
 		sf_writef_float(file, writ_src_data->data_out, output_size);
+	if (file == ofCapture)
+		capture_frames += output_size;
 
 	return;
 
@@ -960,6 +971,7 @@ SoundPort::SoundPort(const char *in_dev, const char *out_dev) : req_sample_rate(
 	sd[0].state = sd[1].state = spa_continue;
 	sd[0].rb = sd[1].rb = 0;
 	sd[0].advance = sd[1].advance = 0;
+	sd[0].cb_time = sd[1].cb_time = 0.0;
 
 	sem_t** sems[] = { &sd[0].rwsem, &sd[1].rwsem };
 #if USE_NAMED_SEMAPHORES
@@ -1218,8 +1230,11 @@ size_t SoundPort::Read(float *buf, size_t count)
 	if (rxppm != progdefaults.RX_corr)
 		rxppm = progdefaults.RX_corr;
 
-	sd[0].src_ratio = req_sample_rate / (sd[0].dev_sample_rate * (1.0 + rxppm / 1e6));
-	src_set_ratio(rx_src_state, sd[0].src_ratio);
+	double ratio = req_sample_rate / (sd[0].dev_sample_rate * (1.0 + rxppm / 1e6));
+	if (ratio != sd[0].src_ratio) {
+		sd[0].src_ratio = ratio;
+		src_set_ratio(rx_src_state, sd[0].src_ratio);
+	}
 
 	size_t maxframes = (size_t)floor(sd[0].rb->length() * sd[0].src_ratio / sd[0].params.channelCount);
 
@@ -1247,14 +1262,17 @@ size_t SoundPort::Read(float *buf, size_t count)
 		return n;
 	}
 
-	float* rbuf = fbuf;
+	// A mono stream goes from the ringbuffer or the resampler straight to
+	// buf; only the first of several channels needs the fbuf copy.
+	unsigned channels = sd[0].params.channelCount;
+	float* rbuf = (channels == 1 ? buf : fbuf);
 	if (req_sample_rate != sd[0].dev_sample_rate || rxppm != 0) {
 		long r;
 		size_t n = 0;
 		sd[0].blocksize = SCBLOCKSIZE;
 		while (n < count) {
 			if  ((r = src_callback_read(rx_src_state, sd[0].src_ratio,
-							count - n, rbuf + n * sd[0].params.channelCount)) == 0) {
+							count - n, rbuf + n * channels)) == 0) {
 				pa_perror(2, "Portaudio read error #2");
 				throw SndException("Portaudio read error 2");
 			}
@@ -1263,34 +1281,31 @@ size_t SoundPort::Read(float *buf, size_t count)
 	}
 	else {
 		bool timeout = false;
-		WAIT_FOR_COND( (sd[0].rb->read_space() >= count * sd[0].params.channelCount / sd[0].src_ratio), sd[0].rwsem,
-				   (MAX(1.0, 2 * count * sd[0].params.channelCount / sd->dev_sample_rate)) );
+		WAIT_FOR_COND( (sd[0].rb->read_space() >= count * channels / sd[0].src_ratio), sd[0].rwsem,
+				   (MAX(1.0, 2 * count * channels / sd->dev_sample_rate)) );
 		if (timeout) {
 			pa_perror(3, "Portaudio read error #3");
 			throw SndException("Portaudio read error 3");
 		}
-		ringbuffer<float>::vector_type vec[2];
-		sd[0].rb->get_rv(vec);
-		if (vec[0].len >= count * sd[0].params.channelCount) {
-			rbuf = vec[0].buf;
-			sd[0].advance = vec[0].len;
-		}
-		else
-			sd[0].rb->read(fbuf, count * sd[0].params.channelCount);
+		sd[0].rb->read(rbuf, count * channels);
 	}
 	if (sd[0].advance) {
 		sd[0].rb->read_advance(sd[0].advance);
 		sd[0].advance = 0;
 	}
 
-	if (sd[0].params.channelCount == 1)
-		memcpy(buf, rbuf, count * sizeof(float));
-	else {
+	if (channels != 1) {
 		// write first channel
 		for (size_t i = 0; i < count; i++)
-			buf[i] = rbuf[sd[0].params.channelCount * i];
+			buf[i] = rbuf[channels * i];
 	}
 
+	// the newest sample in the ringbuffer arrived with the last callback
+	double cb_time = sd[0].cb_time;
+	if (cb_time > 0.0)
+		rx_age = rxlat_now() - cb_time +
+			(double)sd[0].rb->read_space() / channels / sd[0].dev_sample_rate;
+
 #if USE_SNDFILE
 	if (capture)
 		write_file(ofCapture, buf, count);
@@ -1681,8 +1696,10 @@ int SoundPort::stream_process(
 	if (in) {
 		switch (sd->state) {
 			case spa_continue: // write into the rb, post rwsem if we wrote anything
-				if (sd->rb->write(reinterpret_cast<const float*>(in), sd->params.channelCount * nframes))
+				if (sd->rb->write(reinterpret_cast<const float*>(in), sd->params.channelCount * nframes)) {
+					sd->cb_time = rxlat_now();
 					sem_post(sd->rwsem);
+				}
 				break;
 			case spa_drain: case spa_pause: // signal the cv
 				pthread_mutex_lock(sd->cmutex);
@@ -2109,6 +2126,11 @@ size_t SoundPulse::Read(float *buf, size_t count)
 			throw SndPulseException(err);
 	}
 
+	int err;
+	pa_usec_t latency = pa_simple_get_latency(sd[0].stream, &err);
+	if (latency != (pa_usec_t)-1)
+		rx_age = latency / 1e6;
+
 #if USE_SNDFILE
 	if (capture)
 				write_file(ofCapture, buf, count);
@@ -155,11 +155,11 @@ typedef list<notify_t> notify_list_t;
 
 
 static void notify_init_window(void);
+static void notify_init_dxcc(void);
 static void notify_save(void);
 static void notify_load(void);
 static void notify_register(notify_t& n);
 static void notify_unregister(const notify_t& n);
-static void notify_set_qsodb_cache(void);
 
 static void notify_event_cb(Fl_Widget* w, void* arg);
 static void notify_select_cb(Fl_Widget* w, void* arg);
@@ -286,7 +286,6 @@ void notify_start(void)
 				notify_register(*i);
 		tblNotifyList->value(0);
 		tblNotifyList->do_callback();
-		notify_set_qsodb_cache();
 	}
 }
 
@@ -295,7 +294,6 @@ void notify_stop(void)
 	for (notify_list_t::iterator i = notify_list.begin(); i != notify_list.end(); ++i)
 		notify_unregister(*i);
 	notify_list.clear();
-	notify_set_qsodb_cache();
 	tblNotifyList->clear();
 }
 
@@ -332,6 +330,13 @@ void notify_dxcc_show(bool readonly)
 	dxcc_window->show();
 }
 
+// called when the country or QSL lists have been (re)loaded
+void notify_dxcc_update(void)
+{
+	if (notify_window && dxcc_window)
+		notify_init_dxcc();
+}
+
 // called by the myCall callback when the operator callsign is changed
 void notify_change_callsign(void)
 {
@@ -621,6 +626,13 @@ static void notify_init_window(void)
 	cntNotifyDupTime->value(3600);
 	mnuNotifyEvent->do_callback(); // for the dup menu
 
+	notify_init_dxcc();
+}
+
+// fill in the country table and enable the filters whose data is loaded
+static void notify_init_dxcc(void)
+{
+	tblNotifyFilterDXCC->clear();
 	dxcc_list = dxcc_entity_list();
 	if (dxcc_list) {
 		char cq[5], itu[5];
@@ -630,6 +642,8 @@ static void notify_init_window(void)
 			tblNotifyFilterDXCC->addRow(NOTIFY_DXCC_NUMCOL, "[x]", (*i)->country,
 						    (*i)->continent, itu, cq);
 		}
+		chkNotifyFilterDXCC->activate();
+		btnNotifyFilterDXCC->activate();
 	}
 	else {
 		chkNotifyFilterDXCC->deactivate();
@@ -637,11 +651,14 @@ static void notify_init_window(void)
 	}
 
 	unsigned char q = qsl_is_open();
-	if (!(q & (1 << QSL_LOTW)))
+	if (q & (1 << QSL_LOTW))
+		chkNotifyFilterLOTW->activate();
+	else
 		chkNotifyFilterLOTW->deactivate();
-	if (!(q & (1 << QSL_EQSL)))
+	if (q & (1 << QSL_EQSL))
+		chkNotifyFilterEQSL->activate();
+	else
 		chkNotifyFilterEQSL->deactivate();
-
 }
 
 // append event n to the table widget
@@ -981,7 +998,9 @@ static void notify_recv(trx_mode mode, int afreq, const char* str, const regmatc
 					return;
 			}
 			else { // check for nwb, lotw, eqsl
-				if (n->filter.nwb && SearchLog(call.c_str()))
+				// not the GUI thread: of the log only the index may be read,
+				// and a call is not worked while the index is out of date
+				if (n->filter.nwb && qsodb.index().worked(call.c_str()))
 					return;
 				if ((n->filter.lotw || n->filter.eqsl) && qsl_is_open() &&
 				    !(qsl_lookup(call.c_str()) & (1 << QSL_LOTW | 1 << QSL_EQSL)))
@@ -995,7 +1014,8 @@ static void notify_recv(trx_mode mode, int afreq, const char* str, const regmatc
 				// if the dxcc filter is not empty, it must contain the country for call
 				if (!n->filter.dxcc.empty() && n->filter.dxcc.find(e->country) == n->filter.dxcc.end())
 					return;
-				if (n->filter.nwb && qsodb_dxcc_entity_find(e->country))
+				// not worked while the index is out of date, as above
+				if (n->filter.nwb && (qsodb.index().status(e->country) & QSO_WORKED))
 					return;
 			}
 
@@ -1018,18 +1038,6 @@ static void notify_recv(trx_mode mode, int afreq, const char* str, const regmatc
 	}
 }
 
-static void notify_set_qsodb_cache(void)
-{
-	bool v = false;
-	for (notify_list_t::iterator i = notify_list.begin(); i != notify_list.end(); ++i) {
-		if (i->event == NOTIFY_EVENT_STATION && i->filter.match == NOTIFY_FILTER_DXCC && i->enabled) {
-			v = true;
-			break;
-		}
-	}
-	dxcc_entity_cache_enable(v);
-}
-
 // register event n with the spotter
 static void notify_register(notify_t& n)
 {
@@ -1541,8 +1549,6 @@ static void notify_dxcc_check_cb(Fl_Widget* w, void* arg)
 // save the event list
 static void notify_save(void)
 {
-	notify_set_qsodb_cache();
-
 	remove(string(HomeDir).append("/").append("notify.prefs").c_str());
 	Fl_Preferences ndata(HomeDir.c_str(), PACKAGE_TARNAME, "notify");
 	ndata.set("items", static_cast<int>(notify_list.size()));
@@ -44,11 +44,14 @@
 #include <cstring>
 #include <cstdlib>
 
+#include <cerrno>
+#include <cstdio>
 #include <string>
-#include <deque>
+#include <map>
 #include <vector>
 #include <algorithm>
 #include <fstream>
+#include <sstream>
 
 #if GCC_VER_OK
 #	if HAVE_STD_HASH
@@ -89,6 +92,7 @@ namespace __gnu_cxx {
 #include "configuration.h"
 #include "globals.h"
 #include "spot.h"
+#include "mapped_file.h"
 
 #include "pskrep.h"
 
@@ -119,39 +123,59 @@ static pthread_mutex_t pskrep_mutex = PTHREAD_MUTEX_INITIALIZER;
 // Maximum send size
 #define DGRAM_MAX (1500-14-24-8)
 
+// Send at most SEND_BURST datagrams at a time, and the rest of the queue
+// SEND_SPACING seconds later
+#define SEND_BURST 4
+#define SEND_SPACING 5
+
+// Rewrite the journal when it holds this many more records than it needs
+#define JOURNAL_SLACK 1000
+
 #define PSKREP_QUEUE_FILE "pskrqueue.txt"
+#define PSKREP_JOURNAL_FILE "pskrjournal.txt"
 #define PSKREP_ID_FILE "pskrkey.txt"
 
 // -------------------------------------------------------------------------------------------------
 
 using namespace std;
 
-enum status_t { PSKR_STATUS_NEW, PSKR_STATUS_PENDING, PSKR_STATUS_SENT };
 enum rtype_t { PSKREP_AUTO = 1, PSKREP_LOG = 2, PSKREP_MANUAL = 3 };
 
 struct rcpt_report_t
 {
 	rcpt_report_t(trx_mode m = 0, long long f = 0, time_t t = 0,
 		      rtype_t p = PSKREP_AUTO, string loc = "")
-		: mode(m), freq(f), rtime(t), rtype(p),
-		  status(PSKR_STATUS_NEW), locator(loc) { }
+		: mode(m), freq(f), rtime(t), rtype(p), locator(loc) { }
 
 	trx_mode mode;
 	long long freq;
 	time_t rtime;
 	rtype_t rtype;
 
-	status_t status;
-
 	string locator;
 };
 
-// A band_map_t holds a list of reception reports (for a particular callsign and band)
-typedef deque<rcpt_report_t> band_map_t;
-// A call_map_t holds reception reports for a particular callsign
-typedef MAP_TYPE<band_t, band_map_t, HASH_TYPE<int> > call_map_t;
-// A container of this type holds all reception reports, sorted by callsign and band
-typedef MAP_TYPE<string, call_map_t> queue_t;
+// A report waiting to be sent
+struct queued_report_t
+{
+	string call;
+	band_t band;
+	rcpt_report_t report;
+};
+// The queued reports, by journal record number, which is their order of arrival
+typedef map<unsigned long, queued_report_t> queue_t;
+
+// The last report for a callsign and band.  id is the record number of the
+// report, which has been sent once it is no longer in the queue.
+struct last_report_t
+{
+	last_report_t() : band(BAND_OTHER), rtime(0), id(0) { }
+	band_t band;
+	time_t rtime;
+	unsigned long id;
+};
+// The last reports, by callsign and band
+typedef MAP_TYPE<string, last_report_t> last_map_t;
 
 class pskrep_sender
 {
@@ -161,8 +185,12 @@ public:
 		      const string& long_id_, const string& short_id_);
 	~pskrep_sender();
 
-	bool append(const string& callsign, const band_map_t::value_type& r);
+	bool append(const string& callsign, const rcpt_report_t& r);
 	bool send(void);
+	/// The size of the record of a report
+	static size_t record_size(const string& callsign, const rcpt_report_t& r);
+	/// The room for records in any datagram
+	size_t capacity(void) const;
 
 private:
 	void write_station_info(void);
@@ -212,6 +240,8 @@ public:
 	static void log(const char* call, const char* loc, long long freq, trx_mode mode, time_t rtime, void* obj);
 	static void manual(const char* call, const char* loc, long long freq, trx_mode mode, time_t rtime, void* obj);
 	bool progress(void);
+	/// True if reports were left in the queue by the last progress()
+	bool backlog(void) { return more; }
 	unsigned count(void) { return new_count; }
 
 	static fre_t locator_re;
@@ -219,18 +249,22 @@ private:
 
 	void append(string call, const char* loc, long long freq, trx_mode mode, time_t rtime, rtype_t rtype);
 	void gc(void);
+	void note_last(const string& call, band_t band, time_t rtime, unsigned long id);
 
+	void load_journal(void);
 	void load_queue(void);
-	void save_queue(void);
-
-	static bool not_sent(const band_map_t::value_type& r)
-	{
-		return r.status != PSKR_STATUS_SENT;
-	}
+	void journal_write(const string& record);
+	void journal_compact(void);
 
 	queue_t queue;
+	last_map_t last;
 	pskrep_sender sender;
 	unsigned new_count;
+	bool more;
+
+	unsigned long next_id;
+	FILE* journal;
+	size_t journal_records;
 };
 
 fre_t pskrep::locator_re("[a-r]{2}[0-9]{2}[a-x]{2}", REG_EXTENDED | REG_NOSUB | REG_ICASE);
@@ -273,8 +307,9 @@ const char* pskrep_error(void)
 
 static void pskrep_progress(void* obj)
 {
-	if (reinterpret_cast<pskrep*>(obj)->progress())
-		Fl::add_timeout(SEND_INTERVAL, pskrep_progress, obj);
+	pskrep* p = reinterpret_cast<pskrep*>(obj);
+	if (p->progress())
+		Fl::add_timeout(p->backlog() ? SEND_SPACING : SEND_INTERVAL, pskrep_progress, obj);
 	else
 		pskrep_stop();
 }
@@ -355,7 +390,8 @@ pskrep::pskrep(const string& call, const string& loc, const string& ant,
 	       const string& host, const string& port,
 	       const string& long_id, const string& short_id,
 	       bool reg_auto, bool reg_log, bool reg_manual)
-	: sender(call, loc, ant, host, port, long_id, short_id), new_count(0)
+	: sender(call, loc, ant, host, port, long_id, short_id), new_count(0), more(false),
+	  next_id(1), journal(0), journal_records(0)
 {
 	if (reg_auto)
 		spot_register_recv(pskrep::recv, this, PSKREP_RE, REG_EXTENDED | REG_ICASE);
@@ -363,7 +399,7 @@ pskrep::pskrep(const string& call, const string& loc, const string& ant,
 		spot_register_log(pskrep::log, this);
 	if (reg_manual)
 		spot_register_manual(pskrep::manual, this);
-	load_queue();
+	load_journal();
 }
 
 pskrep::~pskrep()
@@ -371,7 +407,8 @@ pskrep::~pskrep()
 	spot_unregister_recv(pskrep::recv, this);
 	spot_unregister_log(pskrep::log, this);
 	spot_unregister_manual(pskrep::manual, this);
-	save_queue();
+	if (journal)
+		fclose(journal);
 }
 
 // This function is called by spot_recv() when its buffer matches our PSKREP_RE
@@ -403,6 +440,9 @@ void pskrep::manual(const char* call, const char* loc, long long freq, trx_mode
 	reinterpret_cast<pskrep*>(obj)->append(call, loc, freq, mode, rtime, PSKREP_MANUAL);
 }
 
+static ostream& operator<<(ostream& out, const rcpt_report_t& r);
+static istream& operator>>(istream& in, rcpt_report_t& r);
+
 void pskrep::append(string call, const char* loc, long long freq, trx_mode mode, time_t rtime, rtype_t rtype)
 {
 	if (unlikely(call.empty()))
@@ -415,122 +455,249 @@ void pskrep::append(string call, const char* loc, long long freq, trx_mode mode,
 	if (*loc && !locator_re.match(loc))
 		loc = "";
 
-	band_map_t& bandq = queue[call][band(freq)];
-	if (bandq.empty() || rtime - bandq.back().rtime >= DUP_INTERVAL) { // add new
-		bandq.push_back(rcpt_report_t(mode, freq, rtime, rtype, loc));
+	guard_lock pskrep_lock(&pskrep_mutex);
+
+	band_t b = band(freq);
+	last_report_t& l = last[call + ' ' + band_name(b)];
+	if (rtime - l.rtime >= DUP_INTERVAL) { // add new
+		l.band = b;
+		l.rtime = rtime;
+		l.id = next_id++;
+		queued_report_t& q = queue[l.id];
+		q.call = call;
+		q.band = b;
+		q.report = rcpt_report_t(mode, freq, rtime, rtype, loc);
 		LOG_VERBOSE("Added (call=\"%s\", loc=\"%s\", mode=\"%s\", freq=%d, time=%" PRIdMAX ", type=%u)",
 			 call.c_str(), loc, mode_info[mode].adif_name,
 			 static_cast<int>(freq), (intmax_t)rtime, rtype);
 		new_count++;
-		save_queue();
+
+		ostringstream rec;
+		rec << "+ " << l.id << ' ' << q.report << ' ' << b << ' ' << call << '\n';
+		journal_write(rec.str());
 	}
-	else if (!bandq.empty()) {
-		band_map_t::value_type& r = bandq.back();
-		if (r.status != PSKR_STATUS_SENT && *loc && r.locator != loc) { // update last
+	else {
+		queue_t::iterator i = queue.find(l.id);
+		if (i != queue.end() && *loc && i->second.report.locator != loc) { // update last
+			rcpt_report_t& r = i->second.report;
 			r.locator = loc;
 			r.rtype = rtype;
 			LOG_VERBOSE("Updated (call=\"%s\", loc=\"%s\", mode=\"%s\", freq=%d, time=%d, type=%u)",
 				 call.c_str(), loc, mode_info[r.mode].adif_name,
 				 static_cast<int>(r.freq),
 				 static_cast<int>(r.rtime), rtype);
-			save_queue();
+
+			ostringstream rec;
+			rec << "L " << l.id << ' ' << rtype << ' ' << loc << '\n';
+			journal_write(rec.str());
 		}
 	}
 }
 
-// Handle queued reports
+// Send the queued reports.  They are packed in as few datagrams as
+// possible: first fit, the largest reports first.
 bool pskrep::progress(void)
 {
-	if (queue.empty())
+	guard_lock pskrep_lock(&pskrep_mutex);
+
+	more = false;
+	if (queue.empty()) {
+		gc();
 		return true;
+	}
 
-	unsigned nrep = 0;
-	bool sender_full = false;
-	for (queue_t::iterator i = queue.begin(); i != queue.end(); ++i) {
-		for (call_map_t::iterator j = i->second.begin(); j != i->second.end(); ++j) {
-			for (band_map_t::iterator k = j->second.begin(); k != j->second.end(); ++k) {
-				switch (k->status) {
-				case PSKR_STATUS_NEW:
-					if ((sender_full = !sender.append(i->first, *k)))
-						goto send_reports;
-					k->status = PSKR_STATUS_PENDING;
-					nrep++;
-					break;
-				case PSKR_STATUS_PENDING: // sent in last cycle
-					k->status = PSKR_STATUS_SENT;
-				default:
-					break;
-				}
-			}
+	vector< pair<size_t, unsigned long> > reports; // size, record number
+	reports.reserve(queue.size());
+	for (queue_t::iterator i = queue.begin(); i != queue.end(); ++i)
+		reports.push_back(make_pair(pskrep_sender::record_size(i->second.call, i->second.report),
+					    i->first));
+	sort(reports.begin(), reports.end(), greater< pair<size_t, unsigned long> >());
+
+	size_t capacity = sender.capacity();
+	vector< vector<unsigned long> > dgrams;
+	vector<size_t> room;
+	for (size_t i = 0; i < reports.size(); i++) {
+		size_t j = 0;
+		while (j < dgrams.size() && room[j] < reports[i].first)
+			j++;
+		if (j == dgrams.size()) {
+			dgrams.push_back(vector<unsigned long>());
+			room.push_back(capacity);
 		}
+		dgrams[j].push_back(reports[i].second);
+		room[j] -= reports[i].first;
 	}
-
-send_reports:
-	LOG_VERBOSE("Found %u new report(s)", nrep);
-	if (nrep) {
+	LOG_VERBOSE("Found %" PRIuSZ " new report(s) for %" PRIuSZ " datagram(s)",
+		    reports.size(), dgrams.size());
+
+	// The rest is sent SEND_SPACING seconds later
+	more = dgrams.size() > SEND_BURST;
+	if (more)
+		dgrams.resize(SEND_BURST);
+
+	for (size_t i = 0; i < dgrams.size(); i++) {
+		size_t n = 0;
+		for (; n < dgrams[i].size(); n++) {
+			queued_report_t& q = queue[dgrams[i][n]];
+			if (!sender.append(q.call, q.report))
+				break;
+		}
 		if (!sender.send()) {
 			LOG_ERROR("Sender failed, disabling pskreporter");
 			return false;
 		}
-		return progress();
+		ostringstream rec;
+		for (size_t j = 0; j < n; j++) {
+			queue.erase(dgrams[i][j]);
+			rec << "- " << dgrams[i][j] << '\n';
+		}
+		journal_write(rec.str());
 	}
 
 	gc();
-	save_queue();
 	return true;
 }
 
-// Delete sent reports that are older than DUP_INTERVAL seconds
+void pskrep::note_last(const string& call, band_t band, time_t rtime, unsigned long id)
+{
+	last_report_t& l = last[call + ' ' + band_name(band)];
+	if (rtime >= l.rtime) {
+		l.band = band;
+		l.rtime = rtime;
+		l.id = id;
+	}
+}
+
+// Forget the sent reports that are older than DUP_INTERVAL seconds
 void pskrep::gc(void)
 {
 	time_t threshold = time(NULL) - DUP_INTERVAL;
 	unsigned rm = 0;
 
-	for (queue_t::iterator i = queue.begin(); i != queue.end() ; ) {
-		for (call_map_t::iterator j = i->second.begin(); j != i->second.end() ; ) {
-			band_map_t& b = j->second;
-			band_map_t::iterator k = find_if(b.begin(), b.end(), not_sent);
-			if (k != b.begin() && k == b.end())
-				--k;
-			rm += k - b.begin();
-			k = b.erase(b.begin(), k);
-
-			if (k != b.end() && k->status == PSKR_STATUS_SENT && k->rtime <= threshold) {
-				b.erase(k);
-				rm++;
-			}
-
-			if (b.empty())
-				i->second.erase(j++);
-			else
-				++j;
+	for (last_map_t::iterator i = last.begin(); i != last.end(); ) {
+		if (i->second.rtime <= threshold && queue.find(i->second.id) == queue.end()) {
+			last.erase(i++);
+			rm++;
 		}
-		if (i->second.empty())
-			queue.erase(i++);
 		else
 			++i;
 	}
 
 	LOG_DEBUG("Removed %u sent report(s)", rm);
+
+	if (journal_records > queue.size() + last.size() + JOURNAL_SLACK)
+		journal_compact();
 }
 
-static ostream& operator<<(ostream& out, const rcpt_report_t& r);
-static istream& operator>>(istream& in, rcpt_report_t& r);
-static ostream& operator<<(ostream& out, const queue_t& q);
-static istream& operator>>(istream& in, queue_t& q);
+// The reports are kept in an append-only journal, one record per line:
+//
+//	+ ID MODE FREQ TIME TYPE LOCATOR BAND CALL	a new report
+//	L ID TYPE LOCATOR				its locator has changed
+//	- ID						it has been sent
+//	D TIME BAND CALL				a sent report, for deduplication
+//
+// Each record is flushed as it is written, so a crash loses at most the
+// record being written.  The journal is rewritten with only the queued and
+// recent reports when it grows too long.
+void pskrep::journal_write(const string& record)
+{
+	if (!journal)
+		return;
+	if (fputs(record.c_str(), journal) == EOF || fflush(journal) == EOF)
+		LOG_ERROR("Could not write the pskreporter journal: %s", strerror(errno));
+	journal_records += std::count(record.begin(), record.end(), '\n');
+}
 
-void pskrep::save_queue(void)
+void pskrep::journal_compact(void)
 {
 	string fname = TempDir;
-	fname.append(PSKREP_QUEUE_FILE);
-	ofstream out(fname.c_str());
+	fname.append(PSKREP_JOURNAL_FILE);
+
+	ostringstream out;
+	size_t n = 0;
+	for (last_map_t::const_iterator i = last.begin(); i != last.end(); ++i) {
+		if (queue.find(i->second.id) != queue.end())
+			continue;
+		out << "D " << i->second.rtime << ' ' << i->second.band << ' '
+		    << i->first.substr(0, i->first.find(' ')) << '\n';
+		n++;
+	}
+	for (queue_t::const_iterator i = queue.begin(); i != queue.end(); ++i) {
+		out << "+ " << i->first << ' ' << i->second.report << ' ' << i->second.band
+		    << ' ' << i->second.call << '\n';
+		n++;
+	}
 
-	if (out)
-		out << queue;
-	else
+	if (journal)
+		fclose(journal);
+	string data = out.str();
+	if (!snapshot_write(fname, data.data(), data.length()))
+		LOG_ERROR("Could not write %s", fname.c_str());
+	if ((journal = fopen(fname.c_str(), "a")) == NULL)
 		LOG_ERROR("Could not write %s", fname.c_str());
+	journal_records = n;
+}
+
+void pskrep::load_journal(void)
+{
+	string fname = TempDir;
+	fname.append(PSKREP_JOURNAL_FILE);
+	ifstream in(fname.c_str());
+	if (!in)
+		load_queue();
+
+	string line;
+	while (getline(in, line) && !in.eof()) { // the last line is partly written unless it ends
+		istringstream rec(line);
+		char type = 0;
+		unsigned long id;
+		rec >> type;
+		switch (type) {
+		case '+': {
+			queued_report_t q;
+			int b;
+			if (!(rec >> id >> q.report >> b >> q.call))
+				break;
+			q.band = static_cast<band_t>(b);
+			queue[id] = q;
+			note_last(q.call, q.band, q.report.rtime, id);
+			next_id = max(next_id, id + 1);
+			break;
+		}
+		case 'L': {
+			int rtype;
+			string loc;
+			if (!(rec >> id >> rtype >> loc))
+				break;
+			queue_t::iterator i = queue.find(id);
+			if (i != queue.end()) {
+				i->second.report.rtype = static_cast<rtype_t>(rtype);
+				i->second.report.locator = loc;
+			}
+			break;
+		}
+		case '-':
+			if (rec >> id)
+				queue.erase(id);
+			break;
+		case 'D': {
+			time_t rtime;
+			int b;
+			string call;
+			if (rec >> rtime >> b >> call)
+				note_last(call, static_cast<band_t>(b), rtime, 0);
+			break;
+		}
+		}
+	}
+	in.close();
+
+	LOG_VERBOSE("Loaded %" PRIuSZ " queued report(s)", queue.size());
+	gc();
+	journal_compact();
 }
 
+// Import the queue file of older versions
 void pskrep::load_queue(void)
 {
 	string fname = TempDir;
@@ -539,13 +706,26 @@ void pskrep::load_queue(void)
 	if (!in)
 		return;
 
-	in >> queue;
-	// restore pending reports as new
-	for (queue_t::iterator i = queue.begin(); i != queue.end(); ++i)
-		for (call_map_t::iterator j = i->second.begin(); j != i->second.end(); ++j)
-			for (band_map_t::iterator k = j->second.begin(); k != j->second.end(); ++k)
-				if (k->status == PSKR_STATUS_PENDING)
-					k->status = PSKR_STATUS_NEW;
+	rcpt_report_t r;
+	int rtype, status, b;
+	string call;
+	while (in >> r.mode >> r.freq >> r.rtime >> rtype >> status >> r.locator >> b >> call) {
+		if (r.locator == "?")
+			r.locator.clear();
+		r.rtype = static_cast<rtype_t>(rtype);
+		band_t band = static_cast<band_t>(b);
+		if (status == 2) // sent
+			note_last(call, band, r.rtime, 0);
+		else {
+			queued_report_t& q = queue[next_id];
+			q.call = call;
+			q.band = band;
+			q.report = r;
+			note_last(call, band, r.rtime, next_id++);
+		}
+	}
+	in.close();
+	remove(fname.c_str());
 }
 
 // -------------------------------------------------------------------------------------------------
@@ -731,10 +911,25 @@ void pskrep_sender::write_preamble(void)
 	dgram_size = p - dgram;
 }
 
-bool pskrep_sender::append(const string& callsign, const band_map_t::value_type& r)
+size_t pskrep_sender::record_size(const string& callsign, const rcpt_report_t& r)
 {
-	guard_lock dsp_lock(&pskrep_mutex);
+	size_t call_len = MIN(MAX_TEXT_SIZE, callsign.length());
+	size_t mode_len = MIN(MAX_TEXT_SIZE, strlen(mode_info[r.mode].adif_name));
+	size_t loc_len = MIN(MAX_TEXT_SIZE, r.locator.length());
 
+	// call_len + call + time + freq + mode_len + mode + loc_len + loc + info
+	return 1 + call_len + 4 + 4 + 1 + mode_len + 1 + loc_len + 1;
+}
+
+size_t pskrep_sender::capacity(void) const
+{
+	// the preamble with the long templates, and the padding of the records
+	return DGRAM_MAX - (16 + sizeof(rcpt_record_template) + sizeof(long_station_info_template) +
+			    long_station_info.size() + 4) - (PAD - 1);
+}
+
+bool pskrep_sender::append(const string& callsign, const rcpt_report_t& r)
+{
 	if (dgram_size == 0)
 		write_preamble();
 
@@ -747,8 +942,7 @@ bool pskrep_sender::append(const string& callsign, const band_map_t::value_type&
 
 	size_t loc_len = MIN(MAX_TEXT_SIZE, r.locator.length());
 
-	// call_len + call + time + freq + mode_len + mode + loc_len + loc + info
-	size_t rlen = 1 + call_len + 4 + 4 + 1 + mode_len + 1 + loc_len + 1;
+	size_t rlen = record_size(callsign, r);
 
 	if (pad(rlen, PAD) + dgram_size > DGRAM_MAX) // datagram full
 		return false;
@@ -861,16 +1055,9 @@ static istream& operator>>(istream& in, rtype_t& t)
 	t = static_cast<rtype_t>(i);
 	return in;
 }
-static istream& operator>>(istream& in, status_t& t)
-{
-	int i;
-	in >> i;
-	t = static_cast<status_t>(i);
-	return in;
-}
 static istream& operator>>(istream& in, rcpt_report_t& r)
 {
-	in >> r.mode >> r.freq  >> r.rtime >> r.rtype >> r.status >> r.locator;
+	in >> r.mode >> r.freq  >> r.rtime >> r.rtype >> r.locator;
 	if (*r.locator.c_str() == '?') r.locator.clear();
 	return in;
 }
@@ -878,25 +1065,5 @@ static istream& operator>>(istream& in, rcpt_report_t& r)
 static ostream& operator<<(ostream& out, const rcpt_report_t& r)
 {
 	return out << r.mode << ' ' << r.freq << ' ' << r.rtime << ' '
-		   << r.rtype << ' ' << r.status << ' ' << (r.locator.empty() ? "?" : r.locator);
-}
-static ostream& operator<<(ostream& out, const queue_t& q)
-{
-	for (queue_t::const_iterator i = q.begin(); i != q.end(); ++i)
-		for (call_map_t::const_iterator j = i->second.begin(); j != i->second.end(); ++j)
-			for (band_map_t::const_iterator k = j->second.begin(); k != j->second.end(); ++k)
-				out << *k << "  " << j->first << "  " << i->first << '\n';
-
-	return out;
-}
-static istream& operator>>(istream& in, queue_t& q)
-{
-	rcpt_report_t rep;
-	int band;
-	string call;
-
-	while (in >> rep >> band >> call)
-	 	q[call][static_cast<band_t>(band)].push_back(rep);
-
-	return in;
+		   << r.rtype << ' ' << (r.locator.empty() ? "?" : r.locator);
 }
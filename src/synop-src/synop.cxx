@@ -37,6 +37,7 @@
 #include <set>
 #include <list>
 #include <vector>
+#include <bitset>
 #include <stdexcept>
 #include <typeinfo>
 #include <memory>
@@ -1148,6 +1149,115 @@ public:
 
 typedef TokenProxy::Ptr (*ProxyGen)( int reg_idx, const std::string & wrd, size_t txt_offset);
 
+/// Precompiled form of the regular expression of a Synop group.
+/// These expressions are only made of literal characters and bracket expressions,
+/// repeated with {n}, {n,m} or ?. Each one becomes a table of character sets
+/// with their repeat counts, so matching a group is a few table lookups
+/// instead of a regexec call. Other expressions are left to regexec.
+class GroupMatcher
+{
+	struct Elt {
+		std::bitset<256> m_set ;
+		size_t           m_min ;
+		size_t           m_max ;
+	};
+	std::vector< Elt > m_elts ;
+	size_t m_min_len ;
+	size_t m_max_len ;
+	bool   m_valid ;
+
+	/// Reads a bracket expression. The pointer is on the opening bracket.
+	static bool Bracket( const char * & reg, std::bitset<256> & set ) {
+		++reg ;
+		bool negate = ( *reg == '^' );
+		if( negate ) ++reg ;
+		/// A closing bracket coming first is a literal one.
+		for( const char * first = reg ; *reg != ']' || reg == first ; ++reg ) {
+			if( *reg == '\0' || *reg == '[' ) return false ;
+			unsigned char beg = *reg ;
+			unsigned char end = beg ;
+			if( reg[1] == '-' && reg[2] != ']' && reg[2] != '\0' ) {
+				end = reg[2];
+				reg += 2 ;
+			}
+			for( unsigned c = beg; c <= end; ++c ) set.set(c);
+		}
+		++reg ;
+		if( negate ) set.flip();
+		return true ;
+	}
+
+	/// Reads an optional repeat count after an element.
+	static bool Repeat( const char * & reg, size_t & mini, size_t & maxi ) {
+		static const size_t unbounded = 255 ;
+		mini = maxi = 1 ;
+		switch( *reg ) {
+			case '?' : ++reg; mini = 0; return true ;
+			case '*' : ++reg; mini = 0; maxi = unbounded; return true ;
+			case '+' : ++reg; maxi = unbounded; return true ;
+			case '{' : break ;
+			default  : return true ;
+		}
+		char * next ;
+		mini = strtoul( reg + 1, &next, 10 );
+		if( next == reg + 1 ) return false ;
+		maxi = mini ;
+		if( *next == ',' ) {
+			const char * from = next + 1 ;
+			maxi = strtoul( from, &next, 10 );
+			if( next == from ) maxi = unbounded ;
+		}
+		if( *next != '}' || maxi < mini ) return false ;
+		reg = next + 1 ;
+		return true ;
+	}
+
+	bool Compile( const char * reg ) {
+		while( *reg ) {
+			Elt elt ;
+			if( *reg == '[' ) {
+				if( ! Bracket( reg, elt.m_set ) ) return false ;
+			} else if( strchr( "()|.\\^$*+?{}]", *reg ) ) {
+				return false ;
+			} else {
+				elt.m_set.set( (unsigned char)*reg++ );
+			}
+			if( ! Repeat( reg, elt.m_min, elt.m_max ) ) return false ;
+			m_elts.push_back( elt );
+			m_min_len += elt.m_min ;
+			m_max_len += elt.m_max ;
+		}
+		return true ;
+	}
+
+	/// Repeats are greedy, and give back characters if the rest does not match.
+	bool MatchFrom( size_t idx, const unsigned char * str ) const {
+		if( idx == m_elts.size() ) return *str == '\0';
+		const Elt & elt = m_elts[idx];
+		size_t nb = 0 ;
+		while( nb < elt.m_max && str[nb] != '\0' && elt.m_set.test( str[nb] ) ) ++nb ;
+		for( ; nb >= elt.m_min; --nb ) {
+			if( MatchFrom( idx + 1, str + nb ) ) return true ;
+			if( nb == 0 ) break ;
+		}
+		return false ;
+	}
+public:
+	GroupMatcher( const char * reg ) : m_min_len(0), m_max_len(0) {
+		m_valid = Compile( reg );
+	}
+
+	/// False if the expression must be matched with regexec.
+	bool Valid(void) const { return m_valid; }
+
+	/// The whole string must match, as with "^...$".
+	bool Match( const char * str ) const {
+		size_t len = strlen( str );
+		if( len < m_min_len || len > m_max_len ) return false ;
+		return MatchFrom( 0, (const unsigned char *)str );
+	}
+}; // GroupMatcher
+
 /// Stores the regular expression associated to a Synop code,
 /// plus a factory to create an object modelizing this code.
 class RegexT : public WithRefCnt< RegexT >
@@ -1155,6 +1265,7 @@ class RegexT : public WithRefCnt< RegexT >
 	const char * m_str ;
 	const char * m_name ;
 	regex_t      m_regex ;
+	GroupMatcher m_table ;
 	ProxyGen     m_generator ;
 	priority_t   m_priority ;
 
@@ -1181,6 +1292,7 @@ public:
 	RegexT( const char * reg, const char * name, ProxyGen gener, priority_t priority )
 	: m_str(reg)
 	, m_name(name)
+	, m_table(reg)
 	, m_generator(gener)
 	, m_priority(priority) {
 		char tmpbuf[ 3 + strlen(m_str) ];
@@ -1236,6 +1348,9 @@ public:
 	}
 
 	bool Match( const std::string & str ) const {
+		if( m_table.Valid() && ! synop::GetPosixRegex() )
+			return m_table.Match( str.c_str() );
+
 		int stat = regexec( &m_regex, str.c_str(), 0, 0, 0 );
 		switch(stat) {
 			case 0:
@@ -6031,6 +6146,9 @@ void synop::regex_usage(void) {
 /// This helps in debug mode: Only the regex name is displayed.
 bool synop::m_test_mode = false ;
 
+/// The precompiled tables are used by default.
+bool synop::m_posix_regex = false ;
+
 const synop_callback * synop::ptr_callback ;
 
 /* Useful links about decoding:
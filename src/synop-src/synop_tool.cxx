@@ -25,11 +25,18 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <string>
+#include <vector>
+#include <stdexcept>
 
 #include "synop.h"
 #include "kmlserver.h"
@@ -1101,6 +1108,92 @@ static void process_file( synop * ptr_synop, const char * namin )
 	std::cout << "====== " << nb << " chars =======================================================\n";
 }
 
+// ----------------------------------------------------------------------------
+
+static double monotonic_seconds(void)
+{
+	struct timespec ts ;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec * 1e-9 ;
+}
+
+/// Decodes a buffer and returns the output and the elapsed time.
+static std::string decode_timed( synop * ptr_synop, const std::string & input, double & seconds )
+{
+	std::stringstream strm_out ;
+	dbg_strm = &strm_out ;
+	ptr_synop->cleanup();
+	double start = monotonic_seconds();
+	for( std::string::const_iterator it = input.begin(); it != input.end(); ++it )
+		ptr_synop->add( *it );
+	ptr_synop->flush(true);
+	seconds = monotonic_seconds() - start ;
+	dbg_strm = &std::cout ;
+	return strm_out.str();
+}
+
+/// Decodes a file with regexec, then with the precompiled tables, and checks
+/// that the outputs are identical. Anonymous ships are numbered by a process-wide
+/// counter, so their names differ from one decoding to the next.
+static bool compare_file( synop * ptr_synop, const char * namin )
+{
+	std::ifstream filin( namin );
+	std::stringstream strm_in ;
+	strm_in << filin.rdbuf();
+	const std::string input = strm_in.str();
+
+	size_t nb_groups = 0 ;
+	std::istringstream strm_words( input );
+	for( std::string word; strm_words >> word; ) ++nb_groups ;
+
+	double secs_regex, secs_table ;
+	synop::SetPosixRegex(true);
+	const std::string out_regex = decode_timed( ptr_synop, input, secs_regex );
+	synop::SetPosixRegex(false);
+	const std::string out_table = decode_timed( ptr_synop, input, secs_table );
+
+	std::ofstream filout( ( namin + std::string(".out") ).c_str() );
+	filout << out_table ;
+
+	bool same = ( out_regex == out_table );
+	std::cout << namin << ": " << nb_groups << " groups"
+		<< " regex=" << (size_t)( nb_groups / secs_regex ) << " groups/s"
+		<< " tables=" << (size_t)( nb_groups / secs_table ) << " groups/s"
+		<< ( same ? " identical" : " DIFFERENT" ) << "\n";
+	return same ;
+}
+
+// ----------------------------------------------------------------------------
+
+/// The decoder is a process-wide singleton, as is the KML server which starts
+/// its thread when first used. The files are therefore decoded by processes,
+/// forked before anything is initialised. Returns the index of the job in
+/// the children, -1 in the parent when all of them succeeded, and -2 otherwise.
+static int fork_jobs( int nb_jobs )
+{
+	std::cout.flush();
+	std::vector< pid_t > pids ;
+	bool failed = false ;
+	for( int job = 0; job < nb_jobs; ++job ) {
+		pid_t pid = fork();
+		if( pid == 0 ) return job ;
+		if( pid < 0 ) {
+			std::cerr << "fork:" << strerror(errno) << "\n";
+			failed = true ;
+			break ;
+		}
+		pids.push_back( pid );
+	}
+	for( size_t i = 0; i < pids.size(); ++i ) {
+		int status ;
+		if( waitpid( pids[i], &status, 0 ) < 0
+		||  ! WIFEXITED(status)
+		||  WEXITSTATUS(status) != EXIT_SUCCESS )
+			failed = true ;
+	}
+	return failed ? -2 : -1 ;
+}
+
 // ----------------------------------------------------------------------------
 //
 // These stub definitions so we do not link with too much fldigi code.
@@ -1178,6 +1271,13 @@ static	bool regex_output_only = false ;
 // and the number of times each of them was used.
 static	bool display_synop_usage = false ;
 
+// If set, each file is decoded with regexec and with the precompiled tables,
+// and the speed and outputs are compared.
+static	bool compare_regex = false ;
+
+// Number of processes which decode the files given on the command line.
+static	int nb_jobs = 1 ;
+
 // Where the CSV files for Synop decoding are loaded from.
 static	std::string data_dir = "data/";
 
@@ -1201,7 +1301,7 @@ try {
 	opterr = 0;
 
 	for(;;) {
-		static const char shortopts[] = "b:k:l:d:utmrvwh";
+		static const char shortopts[] = "b:k:l:d:j:utmrcvwh";
 		static const struct option longopts[] = {
 			{ "data_dir",  required_argument, 0, 'b' },
 			{ "kml_dir",   required_argument, 0, 'k' },
@@ -1211,6 +1311,8 @@ try {
 			{ "test",      no_argument,       0, 't' },
 			{ "matrix",    no_argument,       0, 'm' },
 			{ "regex",     no_argument,       0, 'r' },
+			{ "compare",   no_argument,       0, 'c' },
+			{ "jobs",      required_argument, 0, 'j' },
 			{ "version",   no_argument,       0, 'v' },
 			{ "help",      no_argument,       0, 'h' },
 			{ NULL, 0, 0, 0 }
@@ -1254,6 +1356,16 @@ try {
 			case 'u':
 				display_synop_usage = true ;
 				continue ;
+			case 'c':
+				compare_regex = true ;
+				continue ;
+			case 'j':
+				nb_jobs = atoi(optarg);
+				if( nb_jobs < 1 ) {
+					std::cerr << "Invalid number of jobs:" << optarg << "\n";
+					exit(EXIT_FAILURE);
+				}
+				continue ;
 			case 'v':
 				std::cout << "version 1.0\n";
 				exit(EXIT_SUCCESS);
@@ -1272,7 +1384,34 @@ try {
 		break;
 	}
 
-	g_adif_file.open( g_adif_name, std::ios_base::out );
+	// Each job decodes one file out of nb_jobs, and writes its ADIF records
+	// and KML files apart from the others. The first job runs the internal
+	// tests. The parent only waits for the jobs, and writes no output file.
+	std::string adif_name = g_adif_name ;
+	int first_file = optind ;
+	if( nb_jobs > 1 && optind < argC ) {
+		if( display_synop_usage ) {
+			std::cerr << "The usage of each job would be partial, --usage is ignored\n";
+			display_synop_usage = false ;
+		}
+		double batch_start = monotonic_seconds();
+		int job = fork_jobs( nb_jobs );
+		if( job < 0 ) {
+			std::cout << ( argC - optind ) << " files, " << nb_jobs << " jobs: "
+				<< monotonic_seconds() - batch_start << " seconds\n";
+			exit( job == -2 ? EXIT_FAILURE : EXIT_SUCCESS );
+		}
+		std::stringstream strm_job ;
+		strm_job << job ;
+		adif_name += "." + strm_job.str();
+		if( ! kml_dir.empty() && kml_dir[ kml_dir.size() - 1 ] != '/' ) kml_dir += '/';
+		mkdir( kml_dir.c_str(), 0777 );
+		kml_dir += "job" + strm_job.str() + "/";
+		first_file = optind + job ;
+		if( job != 0 ) internal_test = false ;
+	}
+
+	g_adif_file.open( adif_name.c_str(), std::ios_base::out );
 
 	/// Where the warning, informational and error messages are written.
 //	debug::start(dbg_file.c_str());
@@ -1322,8 +1461,13 @@ try {
 	
 	synop::SetTestMode(regex_output_only);
 
-	while (optind < argC)
-		process_file( ptr_synop, argV[optind++] );
+	bool all_identical = true ;
+	for( int i = first_file; i < argC; i += nb_jobs ) {
+		if( compare_regex )
+			all_identical = compare_file( ptr_synop, argV[i] ) && all_identical ;
+		else
+			process_file( ptr_synop, argV[i] );
+	}
 
 	if( display_synop_usage ) {
 		synop::regex_usage();
@@ -1333,7 +1477,7 @@ try {
 
 	g_adif_file.close();
 	// std::cin.get();
-	return 0 ;
+	return all_identical ? EXIT_SUCCESS : EXIT_FAILURE ;
 }
 catch( const std::exception & exc )
 {
@@ -40,6 +40,7 @@
 
 #include "status.h"
 #include "debug.h"
+#include "replay.h"
 
 using namespace std;
 
@@ -251,6 +252,7 @@ void modem::set_freq(double freq)
 	if (freqlock == false)
 		tx_frequency = frequency;
 	REQ(put_freq, frequency);
+	replay_freq_changed();
 }
 
 void modem::set_freqlock(bool on)
@@ -0,0 +1,243 @@
+// ----------------------------------------------------------------------------
+// rxlatency.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <string>
+
+#include "rxlatency.h"
+#include "timeops.h"
+#include "threads.h"
+#include "qrunner.h"
+#include "util.h"
+#include "debug.h"
+
+LOG_FILE_SOURCE(debug::LOG_MODEM);
+
+using namespace std;
+
+// seconds between two reports in the debug log
+#define RXLAT_LOG_INTERVAL 60.0
+
+static const char* stage_names[RXLAT_NUM_STAGES] = {
+	"capture", "read", "modem", "decode", "display"
+};
+
+static const char* queue_names[RXLAT_NUM_QUEUES] = {
+	"sound", "gui"
+};
+
+static rxlat_hist_t hist[RXLAT_NUM_STAGES];
+static rxlat_depth_t depth[RXLAT_NUM_QUEUES];
+
+// rxlat_reset() only bumps reset_gen; the writer of each histogram clears
+// it when it sees the change, so that there is still a single writer.
+static volatile unsigned reset_gen = 0;
+static unsigned hist_gen[RXLAT_NUM_STAGES];
+static unsigned depth_gen[RXLAT_NUM_QUEUES];
+
+// trx thread only
+static double block_time = -1.0;
+static bool block_chars = false;
+static double last_log = 0.0;
+
+double rxlat_now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// bucket 0 holds times under 1 us, bucket b > 0 those in
+// [2^((b-1)/4), 2^(b/4)) us
+static inline int bucket_of(double seconds)
+{
+	double us = seconds * 1e6;
+	if (us < 1.0)
+		return 0;
+	int b = (int)(4.0 * log(us) / M_LN2) + 1;
+	return b < RXLAT_BUCKETS ? b : RXLAT_BUCKETS - 1;
+}
+
+double rxlat_bucket_top(int b)
+{
+	return pow(2.0, b / 4.0) / 1e6;
+}
+
+void rxlat_stage(int stage, double seconds)
+{
+	rxlat_hist_t& h = hist[stage];
+
+	if (unlikely(hist_gen[stage] != reset_gen)) {
+		memset(&h, 0, sizeof(h));
+		hist_gen[stage] = reset_gen;
+	}
+	if (seconds < 0.0)
+		seconds = 0.0;
+
+	h.bucket[bucket_of(seconds)]++;
+	h.sum += seconds;
+	if (seconds > h.max)
+		h.max = seconds;
+	write_memory_barrier();
+	h.count++;
+}
+
+void rxlat_queue(int queue, unsigned long n)
+{
+	rxlat_depth_t& d = depth[queue];
+
+	if (unlikely(depth_gen[queue] != reset_gen)) {
+		memset(&d, 0, sizeof(d));
+		depth_gen[queue] = reset_gen;
+	}
+
+	d.bucket[n < RXLAT_DEPTHS ? n : RXLAT_DEPTHS - 1]++;
+	d.sum += n;
+	if (n > d.max)
+		d.max = n;
+	write_memory_barrier();
+	d.count++;
+}
+
+// GUI thread.  Queued after the characters of the block, so it runs once
+// they have been shown.
+static void rxlat_displayed(double capture_time)
+{
+	rxlat_stage(RXLAT_DISPLAY, rxlat_now() - capture_time);
+}
+
+void rxlat_block(double capture_time)
+{
+	block_time = capture_time;
+	block_chars = false;
+}
+
+void rxlat_char(void)
+{
+	if (block_time < 0.0 || GET_THREAD_ID() != TRX_TID)
+		return;
+	rxlat_stage(RXLAT_DECODE, rxlat_now() - block_time);
+	block_chars = true;
+}
+
+void rxlat_block_done(void)
+{
+	if (block_chars)
+		REQ(rxlat_displayed, block_time);
+	block_time = -1.0;
+
+	if (debug::DEBUG_LEVEL > debug::level)
+		return;
+	double now = rxlat_now();
+	if (now - last_log < RXLAT_LOG_INTERVAL)
+		return;
+	last_log = now;
+
+	string report = rxlat_report();
+	string::size_type p = 0, q;
+	while ((q = report.find('\n', p)) != string::npos) {
+		LOG_DEBUG("%s", report.substr(p, q - p).c_str());
+		p = q + 1;
+	}
+}
+
+void rxlat_get(int stage, rxlat_hist_t& h)
+{
+	unsigned long n = hist[stage].count;
+	read_memory_barrier();
+	h = hist[stage];
+	h.count = n;
+	if (hist_gen[stage] != reset_gen)
+		memset(&h, 0, sizeof(h));
+}
+
+void rxlat_get_queue(int queue, rxlat_depth_t& d)
+{
+	unsigned long n = depth[queue].count;
+	read_memory_barrier();
+	d = depth[queue];
+	d.count = n;
+	if (depth_gen[queue] != reset_gen)
+		memset(&d, 0, sizeof(d));
+}
+
+// upper bound of the bucket that holds the p quantile
+double rxlat_percentile(const rxlat_hist_t& h, double p)
+{
+	unsigned long total = 0;
+	for (int b = 0; b < RXLAT_BUCKETS; b++)
+		total += h.bucket[b];
+	if (total == 0)
+		return 0.0;
+
+	unsigned long rank = (unsigned long)ceil(p * total), n = 0;
+	for (int b = 0; b < RXLAT_BUCKETS; b++) {
+		n += h.bucket[b];
+		if (n >= rank && n > 0)
+			return b == RXLAT_BUCKETS - 1 ? h.max : MIN(rxlat_bucket_top(b), h.max);
+	}
+	return h.max;
+}
+
+const char* rxlat_stage_name(int stage)
+{
+	return stage >= 0 && stage < RXLAT_NUM_STAGES ? stage_names[stage] : "";
+}
+
+const char* rxlat_queue_name(int queue)
+{
+	return queue >= 0 && queue < RXLAT_NUM_QUEUES ? queue_names[queue] : "";
+}
+
+string rxlat_report(void)
+{
+	string s = "stage         count    mean     p50     p90     p99     max (ms)\n";
+	char line[120];
+
+	for (int i = 0; i < RXLAT_NUM_STAGES; i++) {
+		rxlat_hist_t h;
+		rxlat_get(i, h);
+		snprintf(line, sizeof(line), "%-8s %10lu %7.2f %7.2f %7.2f %7.2f %7.2f\n",
+			 stage_names[i], h.count, h.count ? 1e3 * h.sum / h.count : 0.0,
+			 1e3 * rxlat_percentile(h, 0.5), 1e3 * rxlat_percentile(h, 0.9),
+			 1e3 * rxlat_percentile(h, 0.99), 1e3 * h.max);
+		s.append(line);
+	}
+	for (int i = 0; i < RXLAT_NUM_QUEUES; i++) {
+		rxlat_depth_t d;
+		rxlat_get_queue(i, d);
+		snprintf(line, sizeof(line), "%-8s queue depth mean %.1f, max %lu (%lu samples)\n",
+			 queue_names[i], d.count ? (double)d.sum / d.count : 0.0, d.max, d.count);
+		s.append(line);
+	}
+
+	return s;
+}
+
+void rxlat_reset(void)
+{
+	reset_gen = reset_gen + 1;
+}
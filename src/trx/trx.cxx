@@ -41,7 +41,9 @@
 #include "dtmf.h"
 
 #include "soundconf.h"
+#include "iq_input.h"
 #include "ringbuffer.h"
+#include "rxlatency.h"
 #include "qrunner.h"
 #include "debug.h"
 #include "nullmodem.h"
@@ -204,8 +206,9 @@ void trx_trx_receive_loop()
     }
 
 #if BENCHMARK_MODE
-    do_benchmark();
-    trx_state = STATE_ENDED;
+    // a replay may instead have asked for the next modem
+    if (do_benchmark())
+	trx_state = STATE_ENDED;
     return;
 #endif
 
@@ -235,11 +238,14 @@ void trx_trx_receive_loop()
     ringbuffer<double>::vector_type rbvec[2];
     rbvec[0].buf = rbvec[1].buf = 0;
 
+	double read_start = 0.0, read_end = 0.0;
 	while (1) {
 		try {
+			read_start = rxlat_now();
 			numread = 0;
 			while (numread < SCBLOCKSIZE && trx_state == STATE_RX)
 				numread += scard->Read(fbuf + numread, SCBLOCKSIZE - numread);
+			read_end = rxlat_now();
 			if (numread > SCBLOCKSIZE) {
 				LOG_ERROR("numread error %lu", (unsigned long) numread);
 				numread = SCBLOCKSIZE;
@@ -282,7 +288,16 @@ void trx_trx_receive_loop()
 			REQ(&waterfall::sig_data, wf, rbvec[0].buf, numread, current_samplerate);
 
 			if (!bHistory) {
+				double age = scard->capture_age();
+				rxlat_stage(RXLAT_READ, read_end - read_start);
+				rxlat_stage(RXLAT_CAPTURE, age);
+				rxlat_queue(RXLAT_SOUND_QUEUE, (unsigned long)(age * current_samplerate / SCBLOCKSIZE));
+				rxlat_queue(RXLAT_GUI_QUEUE, cbq[TRX_TID]->size());
+				rxlat_block(read_end - age);
+				double t = rxlat_now();
 				active_modem->rx_process(rbvec[0].buf, numread);
+				rxlat_stage(RXLAT_MODEM, rxlat_now() - t);
+				rxlat_block_done();
 				if (progdefaults.rsid)
 					ReedSolomon->receive(fbuf, numread);
 				dtmf->receive(fbuf, numread);
@@ -559,7 +574,9 @@ void trx_reset_loop()
 		scard = 0;
 	}
 
-	switch (progdefaults.btnAudioIOis) {
+	if (!progdefaults.IQInput.empty())
+		scard = new SoundIQ(progdefaults.IQInput);
+	else switch (progdefaults.btnAudioIOis) {
 #if USE_OSS
 	case SND_IDX_OSS:
 		scard = new SoundOSS(scDevice[0].c_str());
@@ -607,7 +624,9 @@ void trx_start(void)
 	if (dtmf) delete dtmf;
 
 
-	switch (progdefaults.btnAudioIOis) {
+	if (!progdefaults.IQInput.empty())
+		scard = new SoundIQ(progdefaults.IQInput);
+	else switch (progdefaults.btnAudioIOis) {
 #if USE_OSS
 	case SND_IDX_OSS:
 		scard = new SoundOSS(scDevice[0].c_str());
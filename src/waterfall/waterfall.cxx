@@ -48,6 +48,7 @@
 #include "trx.h"
 #include "misc.h"
 #include "waterfall.h"
+#include "wf_stream.h"
 #include "main.h"
 #include "modem.h"
 #include "qrunner.h"
@@ -538,13 +539,22 @@ void WFdisp::processFFT() {
 				log2disp100,
 				progdefaults.LowFreqCutoff * sizeof(*fft_db));
 
+		// the row in dB for the stream clients, if any
+		signed char *row = wf_stream_row(IMAGE_WIDTH);
+		if (row)
+			memset(row, -100, (progdefaults.LowFreqCutoff + 1) * sizeof(*row));
+
 		int n = 0;
 		for (int i = progdefaults.LowFreqCutoff + 1; i < IMAGE_WIDTH; i++) {
 			n = round(scale * i);
 			pwr[i] = norm(wfbuf[n]);
 			int ffth = round(10.0 * log10(pwr[i] + 1e-10) );
 			fft_db[ptrFFTbuff * IMAGE_WIDTH + i] = log2disp(ffth);
+			if (row)
+				row[i] = ffth < -128 ? -128 : ffth > 127 ? 127 : ffth;
 		}
+		if (row)
+			wf_stream_commit(rfc, usb, reflevel, ampspan);
 
 		ptrFFTbuff--;
 		if (ptrFFTbuff < 0) ptrFFTbuff += image_height;
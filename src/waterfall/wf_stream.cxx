@@ -0,0 +1,610 @@
+// ----------------------------------------------------------------------------
+// wf_stream.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <dirent.h>
+
+#include "wf_stream.h"
+#include "configuration.h"
+#include "socket.h"
+#include "threads.h"
+#include "util.h"
+#include "debug.h"
+
+using namespace std;
+
+#define WF_QUEUE_ROWS		64	// rows the waterfall may be ahead of the server
+#define WF_CLIENT_BACKLOG	(256 * 1024) // bytes queued for a client before it drops rows
+#define WF_ARCHIVE_KEY_INTERVAL	64	// rows between the key frames of the archive
+
+// ---------------------------------------------------------------------------
+// Frames
+// ---------------------------------------------------------------------------
+
+static inline void put16(unsigned char* p, unsigned v)
+{
+	p[0] = v & 0xff;
+	p[1] = (v >> 8) & 0xff;
+}
+
+static inline void put32(unsigned char* p, unsigned v)
+{
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+static inline unsigned get16(const unsigned char* p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static inline unsigned get32(const unsigned char* p)
+{
+	return get16(p) | (get16(p + 2) << 16);
+}
+
+void wf_stream_pack(const wf_stream_header& h, unsigned char* buf)
+{
+	memcpy(buf, WF_STREAM_MAGIC, 4);
+	buf[4] = h.version;
+	buf[5] = h.flags;
+	put16(buf + 6, h.width);
+	put32(buf + 8, h.seq);
+	put32(buf + 12, h.sec);
+	put32(buf + 16, h.usec);
+	put32(buf + 20, (unsigned long long)h.rf & 0xffffffff);
+	put32(buf + 24, (unsigned long long)h.rf >> 32);
+	put16(buf + 28, h.reflevel);
+	put16(buf + 30, h.ampspan);
+	buf[32] = h.usb;
+	buf[33] = buf[34] = buf[35] = 0;
+	put32(buf + 36, h.size);
+}
+
+bool wf_stream_unpack(const unsigned char* buf, wf_stream_header& h)
+{
+	if (memcmp(buf, WF_STREAM_MAGIC, 4) || buf[4] != WF_STREAM_VERSION)
+		return false;
+	h.version = buf[4];
+	h.flags = buf[5];
+	h.width = get16(buf + 6);
+	h.seq = get32(buf + 8);
+	h.sec = get32(buf + 12);
+	h.usec = get32(buf + 16);
+	h.rf = (long long)(get32(buf + 20) | ((unsigned long long)get32(buf + 24) << 32));
+	h.reflevel = (short)get16(buf + 28);
+	h.ampspan = (short)get16(buf + 30);
+	h.usb = buf[32];
+	h.size = get32(buf + 36);
+	return true;
+}
+
+size_t wf_stream_encode(const signed char* row, const signed char* prev, int width,
+			unsigned char* out)
+{
+	unsigned char* p = out;
+	int run = 0;
+
+	for (int i = 0; i < width; i++) {
+		int d = row[i] - (prev ? prev[i] : (i ? row[i - 1] : 0));
+		if (d == 0) {
+			if (++run == 0x7f) {
+				*p++ = 0x80 | run;
+				run = 0;
+			}
+			continue;
+		}
+		if (run) {
+			*p++ = 0x80 | run;
+			run = 0;
+		}
+		if (d >= -64 && d < 64)
+			*p++ = d & 0x7f;
+		else {
+			*p++ = 0x80;
+			*p++ = (unsigned char)row[i];
+		}
+	}
+	if (run)
+		*p++ = 0x80 | run;
+
+	return p - out;
+}
+
+bool wf_stream_decode(const unsigned char* in, size_t n, bool key, int width,
+		      signed char* row)
+{
+	const unsigned char* end = in + n;
+	int i = 0;
+
+	while (in < end) {
+		unsigned c = *in++;
+		if (c < 0x80) {
+			if (i == width)
+				return false;
+			int d = (c & 0x40) ? (int)c - 0x80 : (int)c;
+			row[i] = (key ? (i ? row[i - 1] : 0) : row[i]) + d;
+			i++;
+		}
+		else if (c == 0x80) {
+			if (i == width || in == end)
+				return false;
+			row[i++] = (signed char)*in++;
+		}
+		else {
+			int run = c & 0x7f;
+			if (i + run > width)
+				return false;
+			if (key)
+				for (; run; run--, i++)
+					row[i] = i ? row[i - 1] : 0;
+			else
+				i += run;
+		}
+	}
+
+	return i == width;
+}
+
+// ---------------------------------------------------------------------------
+// Row queue, filled by the waterfall
+// ---------------------------------------------------------------------------
+
+struct wf_row_info
+{
+	unsigned seq;
+	struct timeval t;
+	long long rf;
+	short reflevel, ampspan;
+	bool usb;
+};
+
+static pthread_mutex_t wf_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wf_cond = PTHREAD_COND_INITIALIZER;
+static bool wf_active = false;		// read without the lock by the waterfall
+static bool wf_exit = false;
+static int wf_width = 0;
+static vector<signed char> wf_rows;	// WF_QUEUE_ROWS of wf_width bins
+static wf_row_info wf_info[WF_QUEUE_ROWS];
+static unsigned wf_head = 0, wf_tail = 0; // rows [wf_tail, wf_head) are queued
+static unsigned wf_seq = 0;
+
+signed char* wf_stream_row(int width)
+{
+	if (!wf_active)
+		return 0;
+
+	guard_lock wf_lock(&wf_mutex);
+	if (width != wf_width) {
+		wf_width = width;
+		wf_rows.assign((size_t)WF_QUEUE_ROWS * width, 0);
+		wf_tail = wf_head;
+	}
+	// the server never reads the row at wf_head, drop the oldest to free it
+	if (wf_head - wf_tail == WF_QUEUE_ROWS)
+		wf_tail++;
+	return &wf_rows[(wf_head % WF_QUEUE_ROWS) * wf_width];
+}
+
+void wf_stream_commit(long long rf, bool usb, int reflevel, int ampspan)
+{
+	if (!wf_active)
+		return;
+
+	guard_lock wf_lock(&wf_mutex);
+	wf_row_info& info = wf_info[wf_head % WF_QUEUE_ROWS];
+	info.seq = wf_seq++;
+	gettimeofday(&info.t, NULL);
+	info.rf = rf;
+	info.usb = usb;
+	info.reflevel = reflevel;
+	info.ampspan = ampspan;
+	wf_head++;
+	pthread_cond_signal(&wf_cond);
+}
+
+// ---------------------------------------------------------------------------
+// Server
+// ---------------------------------------------------------------------------
+
+struct wf_client
+{
+	Socket sock;
+	string pending;		// whole frames, the first partly sent
+	size_t sent;
+	bool need_key;
+	wf_client(const Socket& s) : sock(s), sent(0), need_key(true) { }
+};
+
+static pthread_t wf_thread;
+static Socket* wf_server = 0;
+static vector<wf_client*> wf_clients;
+
+static FILE* wf_archive = 0;
+static string wf_archive_name;
+static unsigned wf_archive_rows = 0;
+
+static void wf_accept(void)
+{
+	try {
+		while (wf_server->wait(0)) {
+			wf_client* c = new wf_client(wf_server->accept());
+			c->sock.set_nonblocking();
+			c->sock.set_close_on_exec(true);
+			wf_clients.push_back(c);
+			LOG_INFO("Waterfall stream client %d", c->sock.fd());
+		}
+	}
+	catch (const SocketException& e) {
+		LOG_ERROR("%s", e.what());
+	}
+}
+
+// Sends what the socket will take without blocking.  Returns false if the
+// client is gone.
+static bool wf_flush(wf_client* c)
+{
+	while (c->sent < c->pending.size()) {
+		ssize_t r = ::send(c->sock.fd(), c->pending.data() + c->sent,
+				 c->pending.size() - c->sent, 0);
+		if (r > 0) {
+			c->sent += r;
+			continue;
+		}
+		if (r == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+			return true;
+		LOG_INFO("Waterfall stream client %d closed", c->sock.fd());
+		return false;
+	}
+	c->pending.clear();
+	c->sent = 0;
+	return true;
+}
+
+// Hourly files in the archive directory, removed after WFArchiveHours
+static void wf_archive_prune(time_t now)
+{
+	if (progdefaults.WFArchiveHours <= 0)
+		return;
+
+	time_t t = now - progdefaults.WFArchiveHours * 3600;
+	struct tm tm;
+	gmtime_r(&t, &tm);
+	char oldest[32];
+	strftime(oldest, sizeof(oldest), "wf-%Y%m%d-%H.fwf", &tm);
+
+	DIR* dir = opendir(progdefaults.WFArchive.c_str());
+	if (!dir)
+		return;
+	struct dirent* entry;
+	while ((entry = readdir(dir))) {
+		const char* name = entry->d_name;
+		if (strlen(name) == strlen(oldest) && !strncmp(name, "wf-", 3) &&
+		    strcmp(name, oldest) < 0) {
+			string path = progdefaults.WFArchive + name;
+			if (remove(path.c_str()) == 0)
+				LOG_INFO("Removed %s", path.c_str());
+		}
+	}
+	closedir(dir);
+}
+
+static bool wf_archive_open(time_t now)
+{
+	struct tm tm;
+	gmtime_r(&now, &tm);
+	char name[32];
+	strftime(name, sizeof(name), "wf-%Y%m%d-%H.fwf", &tm);
+	string path = progdefaults.WFArchive + name;
+	if (wf_archive && path == wf_archive_name)
+		return true;
+
+	if (wf_archive)
+		fclose(wf_archive);
+	if ((wf_archive = fopen(path.c_str(), "ab")) == NULL) {
+		LOG_ERROR("Could not open %s: %s", path.c_str(), strerror(errno));
+		wf_archive_name.clear();
+		return false;
+	}
+	wf_archive_name = path;
+	wf_archive_rows = 0;
+	wf_archive_prune(now);
+	return true;
+}
+
+static void* wf_stream_loop(void*)
+{
+	vector<signed char> row, prev;
+	vector<unsigned char> key(WF_STREAM_HEADER_SIZE), delta(WF_STREAM_HEADER_SIZE);
+	wf_row_info info;
+	bool have_prev = false;
+	unsigned last_seq = 0;
+
+	for (;;) {
+		{
+			guard_lock wf_lock(&wf_mutex);
+			if (wf_head == wf_tail && !wf_exit)
+				pthread_cond_timedwait_rel(&wf_cond, &wf_mutex, 0.2);
+			if (wf_exit)
+				break;
+			if (wf_head != wf_tail) {
+				row.assign(&wf_rows[(wf_tail % WF_QUEUE_ROWS) * wf_width],
+					   &wf_rows[(wf_tail % WF_QUEUE_ROWS) * wf_width] + wf_width);
+				info = wf_info[wf_tail % WF_QUEUE_ROWS];
+				wf_tail++;
+			}
+			else
+				row.clear();
+		}
+
+		if (wf_server)
+			wf_accept();
+		if (row.empty()) {
+			for (size_t i = 0; i < wf_clients.size(); i++)
+				if (!wf_flush(wf_clients[i])) {
+					delete wf_clients[i];
+					wf_clients.erase(wf_clients.begin() + i--);
+				}
+			continue;
+		}
+
+		// dropped rows, or a new width
+		if (have_prev && (info.seq != last_seq + 1 || prev.size() != row.size()))
+			have_prev = false;
+		last_seq = info.seq;
+
+		int width = row.size();
+		bool archive = !progdefaults.WFArchive.empty() && wf_archive_open(info.t.tv_sec);
+		bool archive_key = false;
+		if (archive) {
+			archive_key = !have_prev || wf_archive_rows % WF_ARCHIVE_KEY_INTERVAL == 0;
+			wf_archive_rows++;
+		}
+		bool need_key = !have_prev || archive_key;
+		for (size_t i = 0; i < wf_clients.size(); i++)
+			need_key |= wf_clients[i]->need_key;
+
+		wf_stream_header h;
+		h.version = WF_STREAM_VERSION;
+		h.width = width;
+		h.seq = info.seq;
+		h.sec = info.t.tv_sec;
+		h.usec = info.t.tv_usec;
+		h.rf = info.rf;
+		h.reflevel = info.reflevel;
+		h.ampspan = info.ampspan;
+		h.usb = info.usb;
+
+		if (need_key) {
+			key.resize(WF_STREAM_HEADER_SIZE + 2 * width);
+			h.flags = WF_STREAM_KEY;
+			h.size = wf_stream_encode(&row[0], 0, width, &key[WF_STREAM_HEADER_SIZE]);
+			wf_stream_pack(h, &key[0]);
+			key.resize(WF_STREAM_HEADER_SIZE + h.size);
+		}
+		if (have_prev) {
+			delta.resize(WF_STREAM_HEADER_SIZE + 2 * width);
+			h.flags = 0;
+			h.size = wf_stream_encode(&row[0], &prev[0], width, &delta[WF_STREAM_HEADER_SIZE]);
+			wf_stream_pack(h, &delta[0]);
+			delta.resize(WF_STREAM_HEADER_SIZE + h.size);
+		}
+
+		if (archive) {
+			const vector<unsigned char>& f = archive_key ? key : delta;
+			if (fwrite(&f[0], f.size(), 1, wf_archive) != 1) {
+				LOG_ERROR("Could not write %s: %s", wf_archive_name.c_str(), strerror(errno));
+				fclose(wf_archive);
+				wf_archive = 0;
+			}
+		}
+
+		for (size_t i = 0; i < wf_clients.size(); i++) {
+			wf_client* c = wf_clients[i];
+			// a client that cannot keep up skips rows, then resumes with a key frame
+			if (c->pending.size() > WF_CLIENT_BACKLOG)
+				c->need_key = true;
+			else if (c->need_key || !have_prev) {
+				c->pending.append((const char*)&key[0], key.size());
+				c->need_key = false;
+			}
+			else
+				c->pending.append((const char*)&delta[0], delta.size());
+			if (!wf_flush(c)) {
+				delete c;
+				wf_clients.erase(wf_clients.begin() + i--);
+			}
+		}
+
+		prev.swap(row);
+		have_prev = true;
+	}
+
+	for (size_t i = 0; i < wf_clients.size(); i++)
+		delete wf_clients[i];
+	wf_clients.clear();
+	if (wf_archive) {
+		fclose(wf_archive);
+		wf_archive = 0;
+	}
+
+	return NULL;
+}
+
+void wf_stream_start(void)
+{
+	if (wf_active || (progdefaults.WFStreamPort.empty() && progdefaults.WFArchive.empty()))
+		return;
+
+	if (!progdefaults.WFArchive.empty()) {
+		if (*progdefaults.WFArchive.rbegin() != '/')
+			progdefaults.WFArchive += '/';
+		const char* err = create_directory(progdefaults.WFArchive.c_str());
+		if (err) {
+			LOG_ERROR("Could not create %s: %s", progdefaults.WFArchive.c_str(), err);
+			progdefaults.WFArchive.clear();
+		}
+	}
+
+	if (!progdefaults.WFStreamPort.empty()) {
+		try {
+			wf_server = new Socket(Address(progdefaults.WFStreamAddress.c_str(),
+						       progdefaults.WFStreamPort.c_str()));
+			wf_server->bind();
+			wf_server->listen();
+			wf_server->set_timeout(0.0);
+		}
+		catch (const SocketException& e) {
+			LOG_ERROR("Could not start waterfall stream server (%s)", e.what());
+			delete wf_server;
+			wf_server = 0;
+		}
+	}
+
+	if (!wf_server && progdefaults.WFArchive.empty())
+		return;
+
+	wf_exit = false;
+	int rc = pthread_create(&wf_thread, NULL, wf_stream_loop, NULL);
+	if (rc != 0) {
+		LOG_ERROR("pthread_create: %s", strerror(rc));
+		delete wf_server;
+		wf_server = 0;
+		return;
+	}
+	wf_active = true;
+	LOG_INFO("Streaming the waterfall%s%s%s%s",
+		 wf_server ? " on " : "", wf_server ? progdefaults.WFStreamPort.c_str() : "",
+		 progdefaults.WFArchive.empty() ? "" : " to ", progdefaults.WFArchive.c_str());
+}
+
+void wf_stream_stop(void)
+{
+	if (!wf_active)
+		return;
+
+	{
+		guard_lock wf_lock(&wf_mutex);
+		wf_active = false;
+		wf_exit = true;
+		pthread_cond_signal(&wf_cond);
+	}
+	pthread_join(wf_thread, NULL);
+
+	delete wf_server;
+	wf_server = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Replay
+// ---------------------------------------------------------------------------
+
+bool wf_stream_replay(const char* name)
+{
+	FILE* in = fopen(name, "rb");
+	if (!in) {
+		fprintf(stderr, "%s: %s\n", name, strerror(errno));
+		return false;
+	}
+
+	// the image height is the number of rows of the widest frames
+	unsigned char hbuf[WF_STREAM_HEADER_SIZE];
+	wf_stream_header h;
+	size_t nrows = 0;
+	int width = 0;
+	while (fread(hbuf, sizeof(hbuf), 1, in) == 1 && wf_stream_unpack(hbuf, h)) {
+		width = max(width, (int)h.width);
+		nrows++;
+		if (fseek(in, h.size, SEEK_CUR) == -1)
+			break;
+	}
+	if (nrows == 0 || width == 0) {
+		fprintf(stderr, "%s: no waterfall rows\n", name);
+		fclose(in);
+		return false;
+	}
+
+	string pgm_name = string(name) + ".pgm";
+	FILE* out = fopen(pgm_name.c_str(), "wb");
+	if (!out) {
+		fprintf(stderr, "%s: %s\n", pgm_name.c_str(), strerror(errno));
+		fclose(in);
+		return false;
+	}
+	fprintf(out, "P5\n%d %" PRIuSZ "\n255\n", width, nrows);
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+
+	rewind(in);
+	vector<unsigned char> payload;
+	vector<signed char> row(width, -100);
+	vector<unsigned char> gray(width);
+	size_t n = 0, bad = 0;
+	bool have_key = false;
+	for (; n < nrows; n++) {
+		if (fread(hbuf, sizeof(hbuf), 1, in) != 1 || !wf_stream_unpack(hbuf, h))
+			break;
+		payload.resize(h.size + 1);
+		if (h.size && fread(&payload[0], h.size, 1, in) != 1)
+			break;
+		bool key = h.flags & WF_STREAM_KEY;
+		if (key)
+			have_key = true;
+		if (!have_key || !wf_stream_decode(&payload[0], h.size, key, h.width, &row[0])) {
+			have_key = false;
+			bad++;
+		}
+		// the waterfall's own scale, WFdisp::log2disp()
+		int span = h.ampspan > 0 ? h.ampspan : 1;
+		for (int i = 0; i < width; i++) {
+			int v = i < h.width && have_key ? 255 - 255 * (h.reflevel - row[i]) / span : 0;
+			gray[i] = v < 0 ? 0 : v > 255 ? 255 : v;
+		}
+		fwrite(&gray[0], width, 1, out);
+	}
+	for (; n < nrows; n++)
+		fwrite(&gray[0], width, 1, out);
+
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	double dt = t1.tv_sec - t0.tv_sec + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+	fclose(in);
+	bool failed = ferror(out);
+	fclose(out);
+
+	printf("%s: %" PRIuSZ " rows of %d bins in %.3f s, %.0f rows/s%s\n",
+	       pgm_name.c_str(), nrows, width, dt, nrows / (dt > 0 ? dt : 1e-9),
+	       bad ? ", some rows lost" : "");
+
+	return !failed;
+}
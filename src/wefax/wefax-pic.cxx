@@ -25,6 +25,7 @@
 #include <config.h>
 #include <libgen.h>
 #include <string>
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
@@ -58,6 +59,7 @@
 #include "main.h"
 #include "fileselect.h"
 #include "picture.h"
+#include "image_sink.h"
 #include "gettext.h"
 
 Fl_Double_Window	*wefax_pic_rx_win = (Fl_Double_Window *)0;
@@ -366,7 +368,7 @@ int wefax_pic::update_rx_pic_col(unsigned char data, int pix_pos )
 		wefax_pic_rx_scroll->redraw();
 		FL_UNLOCK_D();
 	}
-	wefax_pic_rx_picture->pixel(data, pix_pos);
+	wefax_pic_rx_picture->set_pixel(data, pix_pos);
 	return row_number ;
 }
 
@@ -460,13 +462,9 @@ static int estimate_rx_image_center( int row_end )
 	return min_idx ;
 }
 
-/// Called for each bw pixel.
-void wefax_pic::update_rx_pic_bw(unsigned char data, int pix_pos )
+/// Called for each bw pixel, returns the row number.
+static int update_rx_pic_pixel(unsigned char data, int pix_pos )
 {
-	/// No pixel is added nor printed until this flag is reset to false.
-	if( reception_paused  ) {
-		return ;
-	};
 	/// The image must be horizontally shifted.
 	pix_pos += center_val_prev * bytes_per_pix ;
 	if( pix_pos < 0 ) {
@@ -481,16 +479,9 @@ void wefax_pic::update_rx_pic_bw(unsigned char data, int pix_pos )
 
 	static int last_row_number = 0 ;
 
-	                 update_rx_pic_col(data, pix_pos);
-	                 update_rx_pic_col(data, pix_pos + 1);
-	int row_number = update_rx_pic_col(data, pix_pos + 2);
-
-	/// Prints the row number sometimes only, to save CPU.
-	if( ( pix_pos % 5000 ) == 0 ) {
-		char row_num_buffer[20];
-		snprintf( row_num_buffer, sizeof(row_num_buffer), "%d", row_number );
-		wefax_out_rx_row_num->value( row_num_buffer );
-	}
+	                 wefax_pic::update_rx_pic_col(data, pix_pos);
+	                 wefax_pic::update_rx_pic_col(data, pix_pos + 1);
+	int row_number = wefax_pic::update_rx_pic_col(data, pix_pos + 2);
 
 	/// Maybe we restarted an image or maybe went back because of recentering.
 	if( last_row_number > row_number ) {
@@ -547,6 +538,45 @@ void wefax_pic::update_rx_pic_bw(unsigned char data, int pix_pos )
 		/// that is, shortened. Is this assignment REALLY necessary ?
 		last_row_number = row_number ;
 	}
+	return row_number ;
+}
+
+/// Called with the pixels completed by the decoder since the previous call,
+/// one byte per pixel. There is one call per received row.
+void wefax_pic::update_rx_pic_bw(const image_sink & sink, int from, int to )
+{
+	/// No pixel is added nor printed until this flag is reset to false.
+	if( reception_paused  ) {
+		return ;
+	};
+
+	int row_min = -1, row_max = -1, row_number = 0 ;
+	const int row_bytes = sink.row_bytes();
+	while( from < to ) {
+		int row_end = std::min( to, ( from / row_bytes + 1 ) * row_bytes );
+		const unsigned char * data = sink.at( from );
+		if( data == NULL ) {
+			break ;
+		}
+		for( ; from < row_end ; ++from, ++data ) {
+			row_number = update_rx_pic_pixel( *data, from * bytes_per_pix );
+			if( ( row_min < 0 ) || ( row_number < row_min ) ) row_min = row_number ;
+			if( row_number > row_max ) row_max = row_number ;
+		}
+	}
+	if( row_min < 0 ) {
+		return ;
+	}
+
+	char row_num_buffer[20];
+	snprintf( row_num_buffer, sizeof(row_num_buffer), "%d", row_number );
+	wefax_out_rx_row_num->value( row_num_buffer );
+
+	/// Row numbers start at one. The noise removal changes some previous rows.
+	if( noise_removal ) {
+		row_min -= 2 * picture::noise_height_margin ;
+	}
+	wefax_pic_rx_picture->damage_rows( row_min - 1, row_max - 1 );
 }
 
 static void wefax_cb_pic_rx_pause( Fl_Widget *, void *)
@@ -1331,6 +1361,9 @@ void wefax_pic::set_rx_label(const std::string & win_label)
 
 void wefax_pic::save_image(const std::string & fil_name, const std::string & extra_comments )
 {
+	if (wefax_serviceme != active_modem) return;
+	ENSURE_THREAD(FLMAIN_TID);
+
 	std::string dfname = default_dir_get( progdefaults.wefax_save_dir ) + fil_name ;
 
 	std::stringstream local_comments;
@@ -52,6 +52,7 @@
 #include "strutil.h"
 
 #include "wefax-pic.h"
+#include "image_sink.h"
 
 #include "ascii.h"
 
@@ -303,6 +304,10 @@ static int fm_deviation = -1 ;
 
 #define GARBAGE_STR "garbage"
 
+/// Received pixels, one byte each, handed over to the viewer row by row.
+/// Not a member because the requests posted to the GUI may outlive the modem.
+static image_sink wefax_rx_sink( wefax_pic::update_rx_pic_bw, 1, false );
+
 class fax_implementation {
 	wefax * m_ptr_wefax ;  // Points to the modem of which this is the implementation.
 	fax_state m_rx_state ; // RXPHASING, RXIMAGE etc...
@@ -1408,6 +1413,7 @@ fax_implementation::fax_implementation( int fax_mode, wefax * ptr_wefax  )
 	}
 
 	m_img_width = ioc_to_width( index_of_correlation );
+	wefax_rx_sink.reset( m_img_width, 1 );
 
 	for(size_t i=0; i<m_dbl_sine.size(); i++) {
 		m_dbl_sine[i]=32768.0 * std::sin(2.0*M_PI*i/m_dbl_sine.size());
@@ -1785,7 +1791,9 @@ void fax_implementation::save_automatic(
 	extra_comments << "Standard deviation:"               << stddev << "\n" ;
 	extra_comments << "Comment:"                          << comment << "\n" ;
 	extra_comments << "PID:"                              << getpid() << "\n" ;
-	wefax_pic::save_image( new_filnam, extra_comments.str() );
+	/// The last rows must reach the viewer before it is saved; end_rx waits for them.
+	wefax_rx_sink.flush();
+	REQ( wefax_pic::save_image, new_filnam, extra_comments.str() );
 
 cleanup_rx:
 	/// This clears the current image.
@@ -1888,6 +1896,7 @@ void fax_implementation::decode_phasing(int x, const fax_signal & the_signal )
 
 				/// Now the image will start at the right column offset.
 				m_fax_pix_num = m_last_col * bytes_per_pixel ;
+				wefax_rx_sink.skip( m_last_col );
 
 				LOG_INFO("Center set: m_last_col=%d m_img_width=%d m_smpl_per_lin=%f",
 					m_last_col, m_img_width, m_smpl_per_lin );
@@ -1962,14 +1971,12 @@ bool fax_implementation::decode_image(int x)
 			/// will only be the number of added pixels. And it will hide
 			/// the storage of B/W pixels in three contiguous ones.
 			//
-			// TODO: If the machine is heavily loaded, it loses a couple of pixel.
-			// The consequence is that the image is shifted.
-			// We could use the local clock to deduce where the pixel must be written:
-			// - Store the first pixel reception time.
-			// - Compute m_fax_pix_num = (reception_time * LPM * image_width)
-			REQ( wefax_pic::update_rx_pic_bw, m_pixel_val, m_fax_pix_num );
+			// The viewer is notified once per row, so that no pixel is lost
+			// if the GUI is heavily loaded.
+			wefax_rx_sink.put( m_fax_pix_num / bytes_per_pixel, m_pixel_val );
 			m_statistics.add_bw( m_pixel_val );
 			m_fax_pix_num += bytes_per_pixel ;
+			wefax_rx_sink.commit( m_fax_pix_num / bytes_per_pixel );
 		}
 		m_last_col=curr_col;
 		m_pixel_val=x;
@@ -2087,6 +2094,12 @@ void fax_implementation::end_rx(void)
 	REQ(wefax_pic::abort_rx_viewer );
 	m_rx_state=RXAPTSTART;
 	reset_counters();
+	/// Rows that are still queued for the viewer would be dropped by the reset,
+	/// and with them the end of an image that is about to be saved.
+	if( ! wefax_rx_sink.idle() ) {
+		REQ_FLUSH(GET_THREAD_ID());
+	}
+	wefax_rx_sink.reset( m_img_width, 1 );
 }
 
 /// Receives data from the soundcard.
@@ -2785,7 +2798,6 @@ void wefax::qso_rec_save(void)
 	loadBrowser(true);
 
 	adifFile.writeLog (logbook_filename.c_str(), &qsodb);
-	// dxcc_entity_cache_add(&rec);
 	LOG_INFO( _("Updating log book %s"), logbook_filename.c_str() );
 }
 
@@ -712,6 +712,21 @@ const char* FTextRX::dxcc_lookup_call(int x, int y)
 				stip << qsl_names[i] << ' ';
 		stip << '\n';
 	}
+	if (e) {
+		band_t b = *inpFreq->value() ? band(inpFreq->value()) : NUM_BANDS;
+		unsigned st = qsodb.index().status(e->country, b, mode_info[active_modem->get_mode()].adif_name);
+		const char* need = 0;
+		if (!(st & QSO_WORKED))
+			need = _("New entity");
+		else if (b != NUM_BANDS && !(st & QSO_WORKED_BAND))
+			need = _("New band");
+		else if (b != NUM_BANDS && !(st & QSO_WORKED_MODE))
+			need = _("New mode");
+		else if (!(st & QSO_CONFIRMED))
+			need = _("Entity not confirmed");
+		if (need)
+			stip << "* " << need << '\n';
+	}
 
 ret:
 	free(mem);
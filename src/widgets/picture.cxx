@@ -45,13 +45,13 @@
 #include <FL/Fl.H>
 #include <FL/fl_draw.H>
 
-#include <zlib.h>
 #include <png.h>
 
 #include "fl_digi.h"
 #include "trx.h"
 #include "fl_lock.h"
 #include "picture.h"
+#include "image_sink.h"
 #include "debug.h"
 #include "timeops.h"
 
@@ -69,6 +69,7 @@ picture::picture (int X, int Y, int W, int H, int bg_col) :
 	background = bg_col ;
 	memset( vidbuf, background, bufsize );	
 	zoom = 0 ;
+	dirty_first = dirty_last = -1 ;
 	binary = false ;
 	binary_threshold = 128 ;
 }
@@ -93,6 +94,40 @@ unsigned char picture::pixel(int pos)
 	return vidbuf[pos];
 }
 
+/// Copies a run of bytes, which may span several rows, and redraws these rows only.
+void picture::pixels(unsigned char const *data, int pos, int len)
+{
+	if (pos < 0) {
+		data -= pos;
+		len += pos;
+		pos = 0;
+	}
+	if (pos + len > bufsize)
+		len = bufsize - pos;
+	if (len <= 0)
+		return;
+	FL_LOCK_D();
+	memcpy( vidbuf + pos, data, len );
+	damage_rows( pos / ( width * depth ), ( pos + len - 1 ) / ( width * depth ) );
+	FL_UNLOCK_D();
+}
+
+/// Rows accumulate until the next draw(), which then copies these rows only.
+void picture::damage_rows(int first, int last)
+{
+	if (first < 0)
+		first = 0;
+	if (last >= height)
+		last = height - 1;
+	if (first > last)
+		return;
+	if (dirty_first < 0 || first < dirty_first)
+		dirty_first = first;
+	if (last > dirty_last)
+		dirty_last = last;
+	damage(FL_DAMAGE_USER1);
+}
+
 void picture::clear()
 {
 	FL_LOCK_D();
@@ -337,6 +372,21 @@ void picture::draw_cb( void *data, int x_screen, int y_screen, int wid_screen, u
 
 void picture::draw()
 {
+	/// Only some rows changed: the image drawing is clipped to them.
+	bool rows_only = ( damage() == FL_DAMAGE_USER1 ) && ( dirty_first >= 0 );
+	if( rows_only ) {
+		int y_first = dirty_first, y_end = dirty_last + 1 ;
+		if( zoom < 0 ) {
+			y_first /= -zoom + 1 ;
+			y_end = ( y_end + -zoom ) / ( -zoom + 1 );
+		} else if( zoom > 0 ) {
+			y_first *= zoom + 1 ;
+			y_end *= zoom + 1 ;
+		}
+		fl_push_clip( x(), y() + y_first, w(), y_end - y_first );
+	}
+	dirty_first = dirty_last = -1 ;
+
 	if( ( zoom == 0 ) && ( binary == false ) ) {
 		/// No scaling, this is faster.
 		fl_draw_image( vidbuf, x(), y(), w(), h() );
@@ -344,6 +394,9 @@ void picture::draw()
 		fl_draw_image( draw_cb, this, x(), y(), w(), h() );
 		// redraw();
 	}
+	if( rows_only ) {
+		fl_pop_clip();
+	}
 }
 
 void picture::slant_undo()
@@ -450,43 +503,6 @@ int picture::handle(int event)
 	return 0;
 }
 
-static FILE* open_file(const char* name, const char* suffix)
-{
-	FILE* fp;
-
-	size_t flen = strlen(name);
-	if (name[flen - 1] == '/') {
-		// if the name ends in a slash we will generate
-		// a timestamped name in the following  format:
-		const char t[] = "pic_YYYY-MM-DD_HHMMSSz";
-
-		size_t newlen = flen + sizeof(t);
-		if (suffix)
-			newlen += 5;
-		char* newfn = new char[newlen];
-		memcpy(newfn, name, flen);
-
-		time_t time_sec = time(0);
-		struct tm ztime;
-		(void)gmtime_r(&time_sec, &ztime);
-
-		size_t sz;
-		if ((sz = strftime(newfn + flen, newlen - flen, "pic_%Y-%m-%d_%H%M%Sz", &ztime)) > 0) {
-			strncpy(newfn + flen + sz, suffix, newlen - flen - sz);
-			newfn[newlen - 1] = '\0';
-			mkdir(name, 0777);
-			fp = fopen(newfn, "wb");
-		}
-		else
-			fp = NULL;
-		delete [] newfn;
-	}
-	else
-		fp = fopen(name, "wb");
-
-	return fp;
-}
-
 static inline unsigned char avg_pix( const unsigned char * vidbuf )
 {
 	return ( vidbuf[ 0 ] + vidbuf[ 1 ] + vidbuf[ 2 ] ) / picture::depth ;
@@ -494,75 +510,13 @@ static inline unsigned char avg_pix( const unsigned char * vidbuf )
 
 int picture::save_png(const char* filename, bool monochrome, const char *extra_comments)
 {
-	FILE* fp;
-	if ((fp = open_file(filename, ".png")) == NULL)
-		return -1;
-
-	// set up the png structures
-	png_structp png;
-	png_infop info;
-	if ((png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL)) == NULL) {
-		fclose(fp);
-		return -1;
-	}
-	/* png_set_compression_level() shall set the compression level to "level". 
-	 * The valid values for "level" range from [0,9], corresponding directly 
-	 * to compression levels for zlib. The value 0 implies no compression 
-	 * and 9 implies maximal compression. Note: Tests have shown that zlib 
-	 * compression levels 3-6 usually perform as well as level 9 for PNG images, 
-	 * and do considerably fewer calculations. */
-	png_set_compression_level(png, Z_BEST_COMPRESSION);
-
-	if ((info = png_create_info_struct(png)) == NULL) {
-		png_destroy_write_struct(&png, NULL);
-		fclose(fp);
-		return -1;
-	}
-	if (setjmp(png_jmpbuf(png))) {
-		png_destroy_write_struct(&png, &info);
-		fclose(fp);
-		return -1;
-	}
-
-	// use an stdio stream
-	png_init_io(png, fp);
-
-	// set png header
 	int color_type = monochrome ? PNG_COLOR_TYPE_GRAY : PNG_COLOR_TYPE_RGB ;
 	/// Color images must take eight bits per pixel.
 	const int bit_depth = ( monochrome && binary ) ? 1 : 8 ;
-	png_set_IHDR(png, info, width, height, bit_depth,
-		     color_type, PNG_INTERLACE_NONE,
-		     PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-
-	// write text comments
-	struct tm tm;
-	time_t t = time(NULL);
-	gmtime_r(&t, &tm);
-	char z[20 + 1];
-	strftime(z, sizeof(z), "%Y-%m-%dT%H:%M:%SZ", &tm);
-	z[sizeof(z) - 1] = '\0';
-
-	ostringstream comment;
-	comment << "Program: " PACKAGE_STRING << '\n'
-		<< "Received: " << z << '\n'
-		<< "Modem: " << mode_info[active_modem->get_mode()].name << '\n'
-		<< "Frequency: " << inpFreq->value() << '\n';
-	if( extra_comments ) {
-		comment << extra_comments ;
-	}
-	if (inpCall->size())
-		comment << "Log call: " << inpCall->value() << '\n';
 
-	// set text
-	png_text text;
-	text.key = strdup("Comment");
-	text.text = strdup(comment.str().c_str());
-	text.compression = PNG_TEXT_COMPRESSION_NONE;
-	png_set_text(png, info, &text, 1);
-
-	// write header
-	png_write_info(png, info);
+	png_stream out;
+	if (!out.open(filename, width, height, color_type, bit_depth, extra_comments))
+		return -1;
 
 	// Extra check for debugging.
 	if( height * width * depth != bufsize ) {
@@ -573,7 +527,6 @@ int picture::save_png(const char* filename, bool monochrome, const char *extra_c
 	if(monochrome)
 	{
 		unsigned char tmp_row[width];
-		png_bytep row;
 		for (int i = 0; i < height; i++) {
 			int row_offset = i * width * depth ;
 			if( binary )
@@ -604,27 +557,19 @@ int picture::save_png(const char* filename, bool monochrome, const char *extra_c
 					tmp_row[j] = avg_pix( vidbuf + col_offset );
 				}
 			}
-			row = tmp_row;
-			png_write_rows(png, &row, 1);
+			if (!out.write_row(tmp_row))
+				return -1;
 		}
 	}
 	else
 	{
-		png_bytep row;
 		for (int i = 0; i < height; i++) {
-			row = &vidbuf[i * width * depth];
-			png_write_rows(png, &row, 1);
+			if (!out.write_row(&vidbuf[i * width * depth]))
+				return -1;
 		}
 	}
-	png_write_end(png, info);
 
-	// clean up
-	free(text.key);
-	free(text.text);
-	png_destroy_write_struct(&png, &info);
-	fclose(fp);
-
-	return 0;
+	return out.close() ? 0 : -1;
 }
 
 bool picture::restore( int row, int margin )
@@ -23,18 +23,19 @@
 #include <config.h>
 
 #include <string>
+#include <vector>
 #include <cstdio>
+#include <cmath>
 #include <ctime>
 
 #include "analysis.h"
+#include "freqmeas.h"
 #include "modem.h"
-#include "misc.h"
-#include "filters.h"
-#include "fftfilt.h"
 #include "digiscope.h"
 #include "waterfall.h"
 #include "main.h"
 #include "fl_digi.h"
+#include "configuration.h"
 
 #include "timeops.h"
 #include "debug.h"
@@ -49,7 +50,6 @@ void anal::tx_init(SoundBase *sc)
 
 void anal::rx_init()
 {
-	phaseacc = 0;
 	put_MODEstatus(mode);
 }
 
@@ -62,24 +62,20 @@ void anal::init()
 
 anal::~anal()
 {
-	delete hilbert;
-	delete bpfilt;
-	delete ffilt;
-	delete favg;
+	delete meas;
 }
 
+// The modem frequency is the first carrier, the --fmt-carriers list the
+// others.
 void anal::restart()
 {
-	double fhi = ANAL_BW * 1.1 / samplerate;
-	double flo = 0.0;
-	if (bpfilt)
-		bpfilt->create_filter(flo, fhi);
-	else
-		bpfilt = new fftfilt(flo, fhi, 2048);
-
 	set_bandwidth(ANAL_BW);
 
-	ffilt->reset();
+	vector<double> freqs, extra;
+	freqs.push_back(frequency);
+	if (parse_fmt_carriers(progdefaults.AnalysisCarriers, extra))
+		freqs.insert(freqs.end(), extra.begin(), extra.end());
+	meas->set_carriers(freqs);
 
 	elapsed = 0.0;
 	fout = 0.0;
@@ -90,12 +86,9 @@ void anal::restart()
 		abort();
 	}
 
-	passno = 0;
-	dspcnt = DSP_CNT;
 	for (int i = 0; i < PIPE_LEN; i++) pipe[i] = 0;
 
 	start_csv();
-
 }
 
 anal::anal()
@@ -104,13 +97,13 @@ anal::anal()
 
 	samplerate = ANAL_SAMPLERATE;
 
-	bpfilt = (fftfilt *)0;
-	hilbert = new C_FIR_filter();
-	hilbert->init_hilbert(37, 1);
-	ffilt = new Cmovavg(FILT_LEN * samplerate);
+	meas = new freqmeas(samplerate, ANAL_BW);
 
 	analysisFilename = HomeDir;
 	analysisFilename.append("freqanalysis.csv");
+	analysisLogname = HomeDir;
+	analysisLogname.append("freqanalysis.bin");
+	write_to_csv = false;
 
 	cap &= ~CAP_TX;
 	restart();
@@ -121,108 +114,92 @@ void anal::clear_syncscope()
 	set_scope(0, 0, false);
 }
 
-cmplx anal::mixer(cmplx in)
+// Both logs stay open and are flushed after each block
+void anal::start_csv()
 {
-	cmplx z = cmplx( cos(phaseacc), sin(phaseacc)) * in;
-
-	phaseacc -= TWOPI * frequency / samplerate;
-	if (phaseacc < 0) phaseacc += TWOPI;
+	write_to_csv = csv.open(analysisFilename, meas->carriers());
+	binlog.open(analysisLogname, meas->carriers(), samplerate,
+		    start_time.tv_sec + start_time.tv_nsec / 1e9);
+}
 
-	return z;
+void anal::stop_csv()
+{
+	csv.close();
+	binlog.close();
+	write_to_csv = false;
+	put_status("");
 }
 
-void anal::start_csv()
+void anal::writeFile()
 {
-	FILE *out = fopen(analysisFilename.c_str(), "w");
-	if (unlikely(!out)) {
-		LOG_PERROR("fopen");
+	if (!write_to_csv)
 		return;
+
+	// the block times are counted in samples from the start time
+	double start = start_time.tv_sec + start_time.tv_nsec / 1e9;
+	double sign = wf->USB() ? 1.0 : -1.0;
+	vector<fmt_log_record> rec(meas->carriers());
+
+	for (size_t i = 0; i < rec.size(); i++) {
+		const fmt_result& r = meas->result(i);
+		rec[i].time = start + elapsed;
+		rec[i].elapsed = elapsed;
+		rec[i].carrier = i;
+		rec[i].flags = fabs(r.offset) < ANAL_BW ? FMT_VALID : 0;
+		rec[i].audio = meas->carrier(i);
+		rec[i].rf = wf->rfcarrier() + sign * (meas->carrier(i) + r.offset);
+		rec[i].offset = r.offset;
+		rec[i].mean = r.mean;
+		rec[i].sigma = r.sigma;
+		rec[i].phase = r.phase;
+		rec[i].level = r.level;
 	}
-	fprintf(out, "Clock,Elapsed Time,Freq Error,RF\n");
-	fclose(out);
+
+	csv.write(&rec[0], rec.size());
+	binlog.write(&rec[0], rec.size());
 }
 
-void anal::writeFile()
+// once per block
+void anal::update()
 {
-	struct timespec now;
-	struct tm tm;
+	const fmt_result& r = meas->result(0);
 
-	// calculate wall clock time using the realtime clock
-	if (clock_gettime(CLOCK_REALTIME, &now) == -1) {
-		LOG_PERROR("clock_gettime");
-		abort();
-	}
-	gmtime_r(&now.tv_sec, &tm);
+	fout = r.offset;
+	elapsed = meas->elapsed();
 
-	FILE* out = fopen(analysisFilename.c_str(), "a");
-	if (unlikely(!out)) {
-		LOG_PERROR("fopen");
-		return;
+	for (int i = 0; i < PIPE_LEN - 1; i++)
+		pipe[i] = pipe[i+1];
+
+	if (fabs(fout) < ANAL_BW) {
+		pipe[PIPE_LEN - 1] = fout / 4.0;
+		set_scope(pipe, PIPE_LEN, false);
+
+		if (wf->USB())
+			snprintf(msg1, sizeof(msg1), "%14.4f", wf->rfcarrier() + frequency + r.mean);
+		else
+			snprintf(msg1, sizeof(msg1), "%14.4f", wf->rfcarrier() - frequency - r.mean);
+		put_status(msg1, 2.0);
 	}
-	fprintf(out, "%02d:%02d:%02d, %8.3f, %8.3f, %12.3f\n",
-		tm.tm_hour, tm.tm_min, tm.tm_sec, elapsed, fout,
-		(wf->rfcarrier() + (wf->USB() ? 1.0 : -1.0) * (frequency + fout)));
-	fclose(out);
+
+	writeFile();
 }
 
 int anal::rx_process(const double *buf, int len)
 {
-	cmplx z, *zp;
-	double fin;
-	int n = 0;
-
 	if (wf_freq != frequency) {
 		restart();
 		set_scope(pipe, PIPE_LEN, false);
 	}
 
-	for (int i = 0; i < len; i++) {
-// create analytic signal from sound card input samples
-		z = cmplx( *buf, *buf );
-		buf++;
-//		hilbert->run(z, z);
-// mix it with the audio carrier frequency to create a baseband signal
-		z = mixer(z);
-// low pass filter using Windowed Sinc - Overlap-Add convolution filter
-		n = bpfilt->run(z, &zp);
-
-		if (n) {
-			for (int j = 0; j < n; j++) {
-// measure phase difference between successive samples to determine
-// the frequency of the baseband signal (+anal_baud or -anal_baud)
-// see class cmplx definiton for operator %
-			fin = arg( conj(prevsmpl) * zp[j] ) * samplerate / TWOPI;
-			prevsmpl = zp[j];
-// filter using moving average filter
-			fout = ffilt->run(fin);
-			}
-		} //else prevsmpl = z;
+	// all the carriers in one pass, a block at a time
+	while (len > 0) {
+		int n = meas->run(buf, len);
+		buf += n;
+		len -= n;
+		if (meas->block_done() && meas->valid())
+			update();
 	}
 
-	if (passno++ > 10) {
-		dspcnt -= (1.0 * n / samplerate);
-
-		if (dspcnt <= 0) {
-			for (int i = 0; i < PIPE_LEN; i++)
-				pipe[i] = pipe[i+1];
-
-			double fdsp = fout / 4.0;
-			if (fabs(fdsp) < 2.6) {
-				elapsed += DSP_CNT - dspcnt;
-				pipe[PIPE_LEN - 1] = fout / 4.0;
-				set_scope(pipe, PIPE_LEN, false);
-
-				if (wf->USB())
-					snprintf(msg1, sizeof(msg1), "%12.2f", wf->rfcarrier() + frequency + fout );
-				else
-					snprintf(msg1, sizeof(msg1), "%12.2f", wf->rfcarrier() - frequency - fout );
-				put_status(msg1, 2.0);
-				writeFile();
-			}
-// reset the display counter & the pipe pointer
-			dspcnt = DSP_CNT;
-		}
-	}
 	return 0;
 }
 
@@ -0,0 +1,367 @@
+// ----------------------------------------------------------------------------
+// freqmeas.cxx
+//
+// Copyright (C) 2014
+//              David Freese, W1HKJ
+//
+// This file is part of fldigi.
+//
+// Fldigi is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Fldigi is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with fldigi.  If not, see <http://www.gnu.org/licenses/>.
+// ----------------------------------------------------------------------------
+
+#include <config.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "freqmeas.h"
+#include "util.h"
+#include "debug.h"
+
+LOG_FILE_SOURCE(debug::LOG_MODEM);
+
+using namespace std;
+
+// rate between the two low pass filters
+#define FMT_MID_RATE	200
+#define FMT_LP1_LEN	256
+#define FMT_LP1_FREQ	25.0
+#define FMT_LP2_LEN	128
+
+freqmeas::freqmeas(int samplerate_, double bandwidth_)
+	: samplerate(samplerate_), bandwidth(bandwidth_)
+{
+	dec1 = samplerate / FMT_MID_RATE;
+	dec2 = FMT_MID_RATE / FMT_PHASE_RATE;
+	blocklen = FMT_BLOCK_LEN * samplerate;
+	count = 0;
+	blocks = 0;
+	done = false;
+
+	// the windowed sinc filters are not normalised, measure their gain
+	// for the level
+	C_FIR_filter lp1, lp2;
+	lp1.init_lowpass(FMT_LP1_LEN, dec1, FMT_LP1_FREQ / samplerate);
+	lp2.init_lowpass(FMT_LP2_LEN, dec2, bandwidth / FMT_MID_RATE);
+	cmplx z(0.0, 0.0), zmid;
+	gain = 1.0;
+	for (int i = 0; i < 2 * blocklen; i++)
+		if (lp1.run(cmplx(1.0, 0.0), zmid) && lp2.run(zmid, z))
+			gain = z.real();
+}
+
+freqmeas::~freqmeas()
+{
+	for (size_t i = 0; i < targets.size(); i++)
+		delete targets[i];
+}
+
+void freqmeas::set_carriers(const vector<double>& freqs)
+{
+	for (size_t i = 0; i < targets.size(); i++)
+		delete targets[i];
+	targets.clear();
+
+	for (size_t i = 0; i < freqs.size(); i++) {
+		target* t = new target;
+		t->freq = freqs[i];
+		t->nco = cmplx(1.0, 0.0);
+		t->nco_step = cmplx(cos(2.0 * M_PI * t->freq / samplerate),
+				    -sin(2.0 * M_PI * t->freq / samplerate));
+		t->lp1.init_lowpass(FMT_LP1_LEN, dec1, FMT_LP1_FREQ / samplerate);
+		t->lp2.init_lowpass(FMT_LP2_LEN, dec2, bandwidth / FMT_MID_RATE);
+		t->phase = t->base = 0.0;
+		t->prev = cmplx(1.0, 0.0);
+		t->sp = t->stp = t->sa = 0.0;
+		t->n = 0;
+		memset(&t->res, 0, sizeof(t->res));
+		targets.push_back(t);
+	}
+
+	count = 0;
+	blocks = 0;
+	done = false;
+}
+
+int freqmeas::run(const double* buf, int len)
+{
+	int n = MIN(len, blocklen - count);
+
+	for (size_t k = 0; k < targets.size(); k++) {
+		target& t = *targets[k];
+		cmplx z, zmid;
+		for (int i = 0; i < n; i++) {
+			z = buf[i] * t.nco;
+			t.nco *= t.nco_step;
+			if (!t.lp1.run(z, zmid) || !t.lp2.run(zmid, z))
+				continue;
+			t.phase += arg(conj(t.prev) * z);
+			t.prev = z;
+			// the sums of the fit take the phase from the start of the
+			// block, and lose no precision to a large unwrapped phase
+			double y = t.phase - t.base;
+			t.sp += y;
+			t.stp += t.n * y;
+			t.sa += abs(z);
+			t.n++;
+		}
+	}
+
+	count += n;
+	done = (count == blocklen);
+	if (done) {
+		count = 0;
+		blocks++;
+		for (size_t k = 0; k < targets.size(); k++)
+			end_block(*targets[k]);
+	}
+
+	return n;
+}
+
+// Straight line fit of y[i] at i = 0 .. n-1, returns the slope and the
+// standard error of the slope
+static double fit(const double* y, int n, double& sigma)
+{
+	double tc = 0.5 * (n - 1);
+	double sxx = n * ((double)n * n - 1.0) / 12.0;
+	double sy = 0.0, sty = 0.0;
+	for (int i = 0; i < n; i++) {
+		sy += y[i];
+		sty += (i - tc) * y[i];
+	}
+	double b = sty / sxx, a = sy / n;
+
+	sigma = 0.0;
+	if (n > 2) {
+		double ssr = 0.0;
+		for (int i = 0; i < n; i++) {
+			double r = y[i] - a - b * (i - tc);
+			ssr += r * r;
+		}
+		sigma = sqrt(ssr / (n - 2) / sxx);
+	}
+	return b;
+}
+
+void freqmeas::end_block(target& t)
+{
+	fmt_result& r = t.res;
+
+	if (t.n > 1) {
+		double tc = 0.5 * (t.n - 1);
+		double sxx = t.n * ((double)t.n * t.n - 1.0) / 12.0;
+		r.offset = (t.stp - tc * t.sp) / sxx * FMT_PHASE_RATE / (2.0 * M_PI);
+		r.phase = t.base + t.sp / t.n;
+		r.level = 20.0 * log10(2.0 * t.sa / (t.n * gain) + 1e-20);
+	}
+	t.sp = t.stp = t.sa = 0.0;
+	t.n = 0;
+	t.base = t.phase;
+	t.nco /= abs(t.nco);
+
+	if (!valid()) {
+		t.history.clear();
+		r.mean = r.offset;
+		r.sigma = 0.0;
+		r.blocks = 0;
+		return;
+	}
+
+	if (t.history.size() == FMT_LONG_BLOCKS)
+		t.history.erase(t.history.begin());
+	t.history.push_back(r.phase);
+	r.blocks = t.history.size();
+	if (r.blocks < 2) {
+		r.mean = r.offset;
+		r.sigma = 0.0;
+		return;
+	}
+
+	vector<double> y(r.blocks);
+	for (int i = 0; i < r.blocks; i++)
+		y[i] = t.history[i] - t.history[0];
+	double sigma;
+	r.mean = fit(&y[0], r.blocks, sigma) / (2.0 * M_PI * FMT_BLOCK_LEN);
+	r.sigma = sigma / (2.0 * M_PI * FMT_BLOCK_LEN);
+}
+
+bool parse_fmt_carriers(const string& list, vector<double>& freqs)
+{
+	freqs.clear();
+
+	string::size_type p = 0, q;
+	do {
+		q = list.find(',', p);
+		string s = list.substr(p, q == string::npos ? q : q - p);
+		p = q + 1;
+		if (s.empty())
+			continue;
+
+		char* e;
+		double f = strtod(s.c_str(), &e);
+		if (e == s.c_str() || *e != '\0' || f <= 0.0)
+			return false;
+		freqs.push_back(f);
+	} while (q != string::npos);
+
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+
+bool fmt_csv::open(const string& name, size_t carriers)
+{
+	close();
+	FILE* f = fopen(name.c_str(), "w");
+	if (unlikely(!f)) {
+		LOG_PERROR("fopen");
+		return false;
+	}
+	open(f, carriers);
+	own = true;
+	return true;
+}
+
+// The first four columns are those of the single carrier log
+bool fmt_csv::open(FILE* f, size_t carriers)
+{
+	close();
+	out = f;
+	own = false;
+
+	fprintf(out, "Clock,Elapsed Time,Freq Error,RF,Mean Error,Std Error,Phase,Level");
+	for (size_t i = 1; i < carriers; i++)
+		fprintf(out, ",Freq Error %u,RF %u,Mean Error %u,Std Error %u,Phase %u,Level %u",
+			(unsigned)i + 1, (unsigned)i + 1, (unsigned)i + 1,
+			(unsigned)i + 1, (unsigned)i + 1, (unsigned)i + 1);
+	fprintf(out, "\n");
+	fflush(out);
+	return true;
+}
+
+void fmt_csv::close(void)
+{
+	if (out && own)
+		fclose(out);
+	out = 0;
+}
+
+void fmt_csv::write(const fmt_log_record* rec, size_t n)
+{
+	if (!out || n == 0)
+		return;
+
+	time_t t = (time_t)rec[0].time;
+	struct tm tm;
+	gmtime_r(&t, &tm);
+	fprintf(out, "%02d:%02d:%02d, %8.3f", tm.tm_hour, tm.tm_min, tm.tm_sec, rec[0].elapsed);
+
+	for (size_t i = 0; i < n; i++) {
+		if (rec[i].flags & FMT_VALID)
+			fprintf(out, ", %8.3f, %12.3f, %12.7f, %9.2e, %.4f, %6.1f",
+				rec[i].offset, rec[i].rf, rec[i].mean, rec[i].sigma,
+				rec[i].phase, rec[i].level);
+		else
+			fprintf(out, ",,,,,,");
+	}
+	fprintf(out, "\n");
+	fflush(out);
+}
+
+// ----------------------------------------------------------------------------
+
+bool fmt_log::open(const string& name, size_t carriers, double samplerate, double start)
+{
+	close();
+	out = fopen(name.c_str(), "wb");
+	if (unlikely(!out)) {
+		LOG_PERROR("fopen");
+		return false;
+	}
+
+	fmt_log_header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, FMT_LOG_MAGIC, sizeof(h.magic));
+	h.record_size = sizeof(fmt_log_record);
+	h.carriers = carriers;
+	h.samplerate = samplerate;
+	h.start = start;
+	if (fwrite(&h, sizeof(h), 1, out) != 1) {
+		LOG_PERROR("fwrite");
+		close();
+		return false;
+	}
+	fflush(out);
+	return true;
+}
+
+void fmt_log::close(void)
+{
+	if (out)
+		fclose(out);
+	out = 0;
+}
+
+void fmt_log::write(const fmt_log_record* rec, size_t n)
+{
+	if (!out)
+		return;
+	if (fwrite(rec, sizeof(*rec), n, out) != n) {
+		LOG_PERROR("fwrite");
+		close();
+		return;
+	}
+	fflush(out);
+}
+
+bool fmt_replay(const string& name, FILE* out)
+{
+	FILE* in = fopen(name.c_str(), "rb");
+	if (!in) {
+		LOG_PERROR("fopen");
+		return false;
+	}
+
+	fmt_log_header h;
+	if (fread(&h, sizeof(h), 1, in) != 1 ||
+	    memcmp(h.magic, FMT_LOG_MAGIC, sizeof(h.magic)) ||
+	    h.record_size < sizeof(fmt_log_record) || h.carriers == 0) {
+		LOG_ERROR("%s is not a frequency measurement log", name.c_str());
+		fclose(in);
+		return false;
+	}
+
+	fmt_csv csv;
+	csv.open(out, h.carriers);
+
+	// records may have grown fields at their end
+	vector<char> raw(h.record_size);
+	vector<fmt_log_record> row(h.carriers);
+	size_t n = 0;
+	while (fread(&raw[0], raw.size(), 1, in) == 1) {
+		memcpy(&row[n], &raw[0], sizeof(fmt_log_record));
+		if (++n == row.size()) {
+			csv.write(&row[0], n);
+			n = 0;
+		}
+	}
+
+	fclose(in);
+	return true;
+}
@@ -75,6 +75,9 @@ namespace XmlRpc {
     //! Clear all sources from the monitored sources list. Sources are closed.
     void clear();
 
+    //! Whether there is no source left to monitor
+    bool empty() const { return _sources.empty(); }
+
   protected:
 
     //! Wait for I/O on any source, timeout, or interrupt signal.
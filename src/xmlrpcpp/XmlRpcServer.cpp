@@ -32,6 +32,8 @@
 #include "XmlRpc.h"
 
 #include <stdio.h>
+#include <algorithm>
+#include <vector>
 
 using namespace XmlRpc;
 
@@ -329,10 +331,17 @@ XmlRpcServer::enableIntrospection(bool enabled)
 void
 XmlRpcServer::listMethods(XmlRpcValue& result)
 {
-  int i = 0;
-  result.setSize(int(_methods.size())+1);
+  // The method table is not ordered
+  std::vector<std::string> names;
+  names.reserve(_methods.size());
   for (MethodMap::iterator it=_methods.begin(); it != _methods.end(); ++it)
-    result[i++] = it->first;
+    names.push_back(it->first);
+  std::sort(names.begin(), names.end());
+
+  int i = 0;
+  result.setSize(int(names.size())+1);
+  for (std::vector<std::string>::iterator it=names.begin(); it != names.end(); ++it)
+    result[i++] = *it;
 
   // Multicall support is built into XmlRpcServer::executeRequest
   result[i] = MULTICALL;
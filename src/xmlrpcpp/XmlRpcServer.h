@@ -31,6 +31,12 @@
 #include <map>
 #include <string>
 
+#if HAVE_STD_HASH
+#  include <unordered_map>
+#elif HAVE_STD_TR1_HASH
+#  include <tr1/unordered_map>
+#endif
+
 
 #include "XmlRpcDispatch.h"
 #include "XmlRpcSource.h"
@@ -159,8 +165,14 @@ namespace XmlRpc {
     //! Event dispatcher
     XmlRpcDispatch _disp;
 
-    //! Collection of methods. This could be a set keyed on method name if we wanted...
+    //! Collection of methods, hashed on the method name.
+#if HAVE_STD_HASH
+    typedef std::unordered_map< std::string, XmlRpcServerMethod* > MethodMap;
+#elif HAVE_STD_TR1_HASH
+    typedef std::tr1::unordered_map< std::string, XmlRpcServerMethod* > MethodMap;
+#else
     typedef std::map< std::string, XmlRpcServerMethod* > MethodMap;
+#endif
 
     //! Registered RPC methods.
     MethodMap _methods;